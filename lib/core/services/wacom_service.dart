@@ -1,19 +1,227 @@
 import 'dart:async';
+import 'dart:ui' show Color, Rect;
 import 'package:flutter/services.dart';
 import 'package:flutter/foundation.dart';
+import 'package:path/path.dart' as path;
+import 'package:path_provider/path_provider.dart';
+
+/// Bits of a pen sample's 'flags' value, mirrors pen_sample.h in the plugin.
+class PenSampleFlags {
+  static const proximity = 1 << 1;
+  static const ink = 1 << 2;
+  static const strokeBegin = 1 << 3;
+  static const strokeEnd = 1 << 4;
+  static const hotZone = 1 << 5;
+
+  /// Interpolated by the plugin over reports the pad sent but the host
+  /// never read; see 'sequenceGaps' in [WacomService.getPipelineStats].
+  static const synthetic = 1 << 6;
+}
+
+/// A pen position in raw tablet units, or in drawing units with pressure
+/// 0..1 once [WacomService.setPenTransform] is set.
+class PenPoint {
+  final double x;
+  final double y;
+  final double pressure;
+  final int timestamp;
+
+  const PenPoint(this.x, this.y, this.pressure, this.timestamp);
+}
+
+/// Stroke-level pen events. Strokes are segmented by the plugin, so
+/// listeners only append points to the stroke named by [strokeId]. Stroke
+/// ids are per pad; [deviceId] names the pad.
+sealed class PenStrokeEvent {
+  final int strokeId;
+  final String deviceId;
+
+  const PenStrokeEvent(this.strokeId, {this.deviceId = ''});
+}
+
+class PenStrokeBegin extends PenStrokeEvent {
+  final PenPoint point;
+
+  const PenStrokeBegin(super.strokeId, this.point, {super.deviceId});
+}
+
+class PenStrokePoints extends PenStrokeEvent {
+  final List<PenPoint> points;
+
+  const PenStrokePoints(super.strokeId, this.points, {super.deviceId});
+}
+
+class PenStrokeEnd extends PenStrokeEvent {
+  const PenStrokeEnd(super.strokeId, {super.deviceId});
+}
+
+/// A tap on a zone registered with [WacomService.setHotZones]. The press
+/// itself never shows up as a stroke, so [strokeId] is 0.
+class PenHotZoneTap extends PenStrokeEvent {
+  final String zone;
+
+  const PenHotZoneTap(this.zone, {super.deviceId}) : super(0);
+}
+
+/// The pad [deviceId] went away, e.g. was unplugged. A stroke in progress
+/// gets no [PenStrokeEnd]. The plugin reconnects the pad by itself when it
+/// comes back, settings and all.
+class PenDeviceRemoved extends PenStrokeEvent {
+  const PenDeviceRemoved({super.deviceId}) : super(0);
+}
+
+/// The pad [deviceId] is back after a [PenDeviceRemoved], showing the last
+/// screen sent to it if [screenRestored]. [reconnectTime] runs from the
+/// plugin seeing the pad again to it being ready.
+class PenDeviceReconnected extends PenStrokeEvent {
+  final Duration reconnectTime;
+  final Duration offlineTime;
+  final bool screenRestored;
+
+  const PenDeviceReconnected(
+    this.reconnectTime,
+    this.offlineTime,
+    this.screenRestored, {
+    super.deviceId,
+  }) : super(0);
+}
+
+/// A pad plugged in, from [WacomService.getDevices]. [id] stays the same
+/// while the pad stays on the same USB port, across runs.
+class WacomDevice {
+  final String id;
+  final int productId;
+  final int firmware;
+  final bool connected;
+
+  const WacomDevice(this.id, this.productId, this.firmware, this.connected);
+}
+
+/// Speed/size trade-off of the native PNG encoder.
+enum PngPreset { fast, balanced, smallest }
+
+/// How the plugin reduces a screen image to 16 or 1 bit per pixel.
+enum ScreenDither { none, ordered, diffusion }
+
+/// Settings for the pad's own inking, which draws strokes on its display
+/// as the pen moves. [area] is in screen pixels, null for the whole screen.
+/// Pressure marks are tablet units; null uses the plugin's stroke
+/// thresholds.
+class HardwareInking {
+  final Color color;
+  final int thickness;
+  final Rect? area;
+  final int? onPressure;
+  final int? offPressure;
+
+  const HardwareInking({
+    this.color = const Color(0xFF000000),
+    this.thickness = 1,
+    this.area,
+    this.onPressure,
+    this.offPressure,
+  });
+
+  Map<String, dynamic> toMap() => {
+    'color': color.toARGB32(),
+    'thickness': thickness,
+    if (area != null)
+      'area': {
+        'x': area!.left.round(),
+        'y': area!.top.round(),
+        'width': area!.width.round(),
+        'height': area!.height.round(),
+      },
+    if (onPressure != null) 'onPressure': onPressure,
+    if (offPressure != null) 'offPressure': offPressure,
+  };
+}
 
 class WacomService {
   static const methodChannel = MethodChannel('wacom_stu_channel');
   static const eventChannel = EventChannel('wacom_stu_events');
 
+  /// setSignatureScreen mode that lets the plugin pick the cheapest
+  /// encoding the pad supports.
+  static const encodingAuto = -1;
+
   StreamSubscription? _penSubscription;
+  bool _cachesConfigured = false;
+  // Zone names by native id - 1, from the last setHotZones, per pad
+  final _hotZoneNames = <String, List<String>>{};
+  // The pad calls without a deviceId go to: the first one connected
+  String? _defaultDeviceId;
+
+  // Names the pad a call is for; none means the default one
+  static Map<String, Object> _device(String? deviceId) => {
+    if (deviceId != null) 'deviceId': deviceId,
+  };
 
-  Future<Map<String, dynamic>> connect() async {
+  /// Points the plugin's encoded-screen and pad info caches at the app
+  /// support directory, once per run, so screens encoded by earlier runs
+  /// are reused and pads seen before connect without reading their info.
+  Future<void> _configureCaches() async {
+    if (_cachesConfigured) return;
+    _cachesConfigured = true;
     try {
-      final result = await methodChannel.invokeMethod('connect');
+      final directory = await getApplicationSupportDirectory();
+      await methodChannel.invokeMethod('setScreenCacheDirectory', {
+        'path': path.join(directory.path, 'wacom_screens'),
+      });
+      await methodChannel.invokeMethod('setDeviceCacheDirectory', {
+        'path': path.join(directory.path, 'wacom_devices'),
+      });
+    } catch (e) {
+      debugPrint("Caches unavailable: $e");
+    }
+  }
+
+  /// Pads plugged in, connected or not.
+  Future<List<WacomDevice>> getDevices() async {
+    try {
+      final result = await methodChannel.invokeMethod('getDevices');
+      return [
+        for (final device in result as List)
+          WacomDevice(
+            device['deviceId'] as String,
+            device['productId'] as int,
+            device['firmware'] as int,
+            device['connected'] == true,
+          ),
+      ];
+    } on PlatformException catch (e) {
+      debugPrint("GetDevices Error: ${e.message}");
+      return const [];
+    }
+  }
+
+  /// Connects to the pad [deviceId] from [getDevices], or the first pad.
+  /// Several pads can be connected at once; each runs its own capture and
+  /// screen uploads, and the methods below take the pad's id, defaulting
+  /// to the first one connected. With [hardwareInking] the pad starts
+  /// inking right away where the model can; the result's 'hardwareInking'
+  /// says whether it did. A pad connected before under the same firmware
+  /// skips reading its info ('infoCached'); 'connectMs' is the time until
+  /// it captures. With [encrypted] the pad agrees a session key with the
+  /// host and sends its pen data encrypted; a model without it fails with
+  /// UNSUPPORTED.
+  Future<Map<String, dynamic>> connect({
+    String? deviceId,
+    HardwareInking? hardwareInking,
+    bool encrypted = false,
+  }) async {
+    await _configureCaches();
+    try {
+      final result = await methodChannel.invokeMethod('connect', {
+        ..._device(deviceId),
+        if (hardwareInking != null) 'hardwareInking': hardwareInking.toMap(),
+        if (encrypted) 'encrypted': true,
+      });
       if (result is Map) {
+        _defaultDeviceId ??= result['deviceId'] as String?;
         return {
           'status': result['status'],
+          'deviceId': result['deviceId'],
           'maxX': (result['maxX'] as int).toDouble(),
           'maxY': (result['maxY'] as int).toDouble(),
           'screenWidth': result.containsKey('screenWidth')
@@ -22,6 +230,20 @@ class WacomService {
           'screenHeight': result.containsKey('screenHeight')
               ? (result['screenHeight'] as int).toDouble()
               : null,
+          'maxPressure': result['maxPressure'] as int?,
+          'maxReportRate': result['maxReportRate'] as int?,
+          'resolution': result['resolution'] as int?,
+          'modelName': result['modelName'] as String?,
+          'firmware': result.containsKey('firmwareMajor')
+              ? '${result['firmwareMajor']}.${result['firmwareMinor']}'
+              : null,
+          'secureIc': result['secureIc'] == true,
+          'color': result['color'] == true,
+          'hardwareInkingSupported': result['hardwareInkingSupported'] == true,
+          'hardwareInking': result['hardwareInking'] == true,
+          'encrypted': result['encrypted'] == true,
+          'connectMs': (result['connectMs'] as num?)?.toDouble(),
+          'infoCached': result['infoCached'] == true,
         };
       } else {
         throw Exception('Unexpected result format: $result');
@@ -31,47 +253,504 @@ class WacomService {
     }
   }
 
-  Future<String> disconnect() async {
-    await _penSubscription?.cancel();
-    _penSubscription = null;
+  /// Disconnects the pad [deviceId], or every pad.
+  Future<String> disconnect({String? deviceId}) async {
+    if (deviceId == null) {
+      await _penSubscription?.cancel();
+      _penSubscription = null;
+      _defaultDeviceId = null;
+      _hotZoneNames.clear();
+    } else {
+      _hotZoneNames.remove(deviceId);
+      if (deviceId == _defaultDeviceId) _defaultDeviceId = null;
+    }
     try {
-      final result = await methodChannel.invokeMethod('disconnect');
+      final result = await methodChannel.invokeMethod(
+        'disconnect',
+        _device(deviceId),
+      );
       return result.toString();
     } on PlatformException catch (e) {
       throw Exception("Disconnect Error: ${e.message}");
     }
   }
 
-  Future<void> clearScreen() async {
+  /// Turns the pad's own inking on with [inking], or off with null. It is
+  /// also turned off by [clearScreen]. Returns false where the model has no
+  /// inking mode.
+  Future<bool> setHardwareInking(
+    HardwareInking? inking, {
+    String? deviceId,
+  }) async {
+    try {
+      await methodChannel.invokeMethod('setHardwareInking', {
+        ..._device(deviceId),
+        'enabled': inking != null,
+        ...?inking?.toMap(),
+      });
+      return true;
+    } on PlatformException catch (e) {
+      if (e.code != 'UNSUPPORTED') {
+        debugPrint("SetHardwareInking Error: ${e.message}");
+      }
+      return false;
+    }
+  }
+
+  Future<void> clearScreen({String? deviceId}) async {
     try {
-      await methodChannel.invokeMethod('clearScreen');
+      await methodChannel.invokeMethod('clearScreen', _device(deviceId));
     } on PlatformException catch (e) {
       debugPrint("ClearScreen Error: ${e.message}");
     }
   }
 
+  // Ask the plugin for one packed frame per wakeup instead of one map per
+  // sample. Delta frames are smaller but cost a varint decode here.
+  static const _eventArguments = {'format': 'frames', 'delta': true};
+
+  // Column layout of a packed frame, mirrors pen_frame.h in the plugin.
+  static const _frameX = 0;
+  static const _frameY = 1;
+  static const _framePressure = 2;
+  static const _frameSw = 3;
+  static const _frameTime = 4;
+  static const _frameSequence = 5;
+  static const _frameDeviceTime = 6;
+  static const _frameStrokeId = 7;
+  static const _frameFlags = 8;
+
   Stream<Map<String, dynamic>> get penEvents {
-    return eventChannel.receiveBroadcastStream().map((event) {
-      if (event is Map) {
-        return {
+    return eventChannel
+        .receiveBroadcastStream(_eventArguments)
+        .expand(_decodeEvent);
+  }
+
+  /// Pen input grouped into strokes, with pads going and coming back. Only
+  /// one of [penEvents] and [strokeEvents] can be listened to at a time;
+  /// both carry every connected pad's input, tagged with its 'deviceId'.
+  Stream<PenStrokeEvent> get strokeEvents {
+    return eventChannel
+        .receiveBroadcastStream(_eventArguments)
+        .expand(
+          (event) =>
+              _deviceEvents(event) ?? _groupStrokes(_decodeEvent(event)),
+        );
+  }
+
+  // Pad removal and reconnect events, null for pen input
+  List<PenStrokeEvent>? _deviceEvents(dynamic event) {
+    if (event is! Map) return null;
+    final deviceId = (event['deviceId'] as String?) ?? '';
+    Duration ms(Object? value) =>
+        Duration(microseconds: (((value as num?) ?? 0) * 1000).round());
+    switch (event['type']) {
+      case 'deviceRemoved':
+        return [PenDeviceRemoved(deviceId: deviceId)];
+      case 'deviceReconnected':
+        return [
+          PenDeviceReconnected(
+            ms(event['reconnectMs']),
+            ms(event['offlineMs']),
+            event['screenRestored'] == true,
+            deviceId: deviceId,
+          ),
+        ];
+    }
+    return null;
+  }
+
+  List<Map<String, dynamic>> _decodeEvent(dynamic event) {
+    if (event is Map) {
+      if (event['type'] == 'penFrame') {
+        return decodePenFrame(event);
+      }
+      // Pad removal and reconnects carry no samples
+      if (event['type'] != null) return const [];
+      return [
+        {
           'x': (event['x'] as int).toDouble(),
           'y': (event['y'] as int).toDouble(),
           'pressure': (event['pressure'] as int).toDouble(),
           'sw': (event['sw'] as int),
-        };
+          'deviceId': event['deviceId'] ?? '',
+          'timestamp': event['timestamp'] ?? 0,
+          'strokeId': event['strokeId'] ?? 0,
+          'flags': event['flags'] ?? 0,
+        },
+      ];
+    }
+    throw Exception("Invalid event format");
+  }
+
+  List<PenStrokeEvent> _groupStrokes(List<Map<String, dynamic>> samples) {
+    final events = <PenStrokeEvent>[];
+    var run = <PenPoint>[];
+    var runStrokeId = 0;
+    var runDeviceId = '';
+
+    void flush() {
+      if (run.isNotEmpty) {
+        events.add(PenStrokePoints(runStrokeId, run, deviceId: runDeviceId));
+        run = <PenPoint>[];
+      }
+    }
+
+    for (final sample in samples) {
+      final flags = sample['flags'] as int;
+      final strokeId = sample['strokeId'] as int;
+      final deviceId = sample['deviceId'] as String;
+
+      if (flags & PenSampleFlags.hotZone != 0) {
+        flush();
+        final names = _hotZoneNames[deviceId] ?? const [];
+        if (strokeId >= 1 && strokeId <= names.length) {
+          events.add(PenHotZoneTap(names[strokeId - 1], deviceId: deviceId));
+        }
+        continue;
+      }
+
+      if (flags & PenSampleFlags.strokeEnd != 0) {
+        flush();
+        events.add(PenStrokeEnd(strokeId, deviceId: deviceId));
+        continue;
+      }
+      if (flags & PenSampleFlags.ink == 0) continue;
+
+      final point = PenPoint(
+        sample['x'] as double,
+        sample['y'] as double,
+        sample['pressure'] as double,
+        sample['timestamp'] as int,
+      );
+      if (flags & PenSampleFlags.strokeBegin != 0) {
+        flush();
+        events.add(PenStrokeBegin(strokeId, point, deviceId: deviceId));
+        continue;
+      }
+      if (strokeId != runStrokeId || deviceId != runDeviceId) {
+        flush();
+        runStrokeId = strokeId;
+        runDeviceId = deviceId;
       }
-      throw Exception("Invalid event format");
+      run.add(point);
+    }
+    flush();
+    return events;
+  }
+
+  /// Unpacks one 'penFrame' event into sample maps. The column layout and
+  /// the delta encoding are the plugin's, in windows/pen_frame.h.
+  @visibleForTesting
+  static List<Map<String, dynamic>> decodePenFrame(Map event) {
+    final stride = event['stride'] as int;
+    final count = event['count'] as int;
+    final t0 = event['t0'] as int;
+    final deviceId = (event['deviceId'] as String?) ?? '';
+    final samples = <Map<String, dynamic>>[];
+    // Mapped frames carry fixed-point coordinates and pressure
+    final coordStep = 1 / ((event['coordOne'] as int?) ?? 1);
+    final pressureStep = 1 / ((event['pressureOne'] as int?) ?? 1);
+
+    if (event['delta'] == true) {
+      final bytes = event['samples'] as Uint8List;
+      final row = List<int>.filled(stride, 0);
+      var offset = 0;
+      var x = 0, y = 0, pressure = 0, sequence = 0, strokeId = 0;
+      var time = t0, deviceTime = t0;
+      for (var i = 0; i < count; i++) {
+        for (var c = 0; c < stride; c++) {
+          var value = 0, shift = 0, byte = 0;
+          do {
+            byte = bytes[offset++];
+            value |= (byte & 0x7f) << shift;
+            shift += 7;
+          } while (byte & 0x80 != 0);
+          row[c] = (value >> 1) ^ -(value & 1);
+        }
+        x += row[_frameX];
+        y += row[_frameY];
+        pressure += row[_framePressure];
+        time += row[_frameTime];
+        sequence += row[_frameSequence];
+        deviceTime += row[_frameDeviceTime];
+        strokeId += row[_frameStrokeId];
+        samples.add({
+          'x': x * coordStep,
+          'y': y * coordStep,
+          'pressure': pressure * pressureStep,
+          'sw': row[_frameSw],
+          'deviceId': deviceId,
+          'timestamp': time,
+          'deviceTimestamp': deviceTime,
+          'sequence': sequence,
+          'strokeId': strokeId,
+          'flags': row[_frameFlags],
+        });
+      }
+      return samples;
+    }
+
+    final packed = event['samples'] as Int32List;
+    for (var i = 0; i < count; i++) {
+      final base = i * stride;
+      samples.add({
+        'x': packed[base + _frameX] * coordStep,
+        'y': packed[base + _frameY] * coordStep,
+        'pressure': packed[base + _framePressure] * pressureStep,
+        'sw': packed[base + _frameSw],
+        'deviceId': deviceId,
+        'timestamp': t0 + packed[base + _frameTime],
+        'deviceTimestamp': t0 + packed[base + _frameDeviceTime],
+        'sequence': packed[base + _frameSequence],
+        'strokeId': packed[base + _frameStrokeId],
+        'flags': packed[base + _frameFlags],
+      });
+    }
+    return samples;
+  }
+
+  /// Configures native point decimation. Distances are in tablet units.
+  Future<void> setSimplifier({
+    bool enabled = true,
+    double minDistance = 0,
+    double tolerance = 0,
+    double cornerAngle = 0,
+    int lookahead = 8,
+    String? deviceId,
+  }) async {
+    try {
+      await methodChannel.invokeMethod('setSimplifier', {
+        ..._device(deviceId),
+        'enabled': enabled,
+        'minDistance': minDistance,
+        'tolerance': tolerance,
+        'cornerAngle': cornerAngle,
+        'lookahead': lookahead,
+      });
+    } on PlatformException catch (e) {
+      debugPrint("SetSimplifier Error: ${e.message}");
+    }
+  }
+
+  /// Has the plugin deliver pen frames ready to draw, mapped in fixed point
+  /// over each batch. [matrix] is `[a, b, c, d, e, f]` taking tablet units
+  /// to drawing units as `x' = a*x + b*y + c`, `y' = d*x + e*y + f`.
+  /// [pressureCurve] gives output pressure 0..1 at evenly spaced input
+  /// levels, linear when omitted; points are clamped to [clamp] if given.
+  /// Takes effect from the next batch. Returns false if the plugin could
+  /// not take it, in which case samples stay raw.
+  Future<bool> setPenTransform({
+    required List<double> matrix,
+    List<double>? pressureCurve,
+    Rect? clamp,
+    String? deviceId,
+  }) async {
+    try {
+      await methodChannel.invokeMethod('setPenTransform', {
+        ..._device(deviceId),
+        'matrix': Float64List.fromList(matrix),
+        if (pressureCurve != null)
+          'pressureCurve': Float64List.fromList(pressureCurve),
+        if (clamp != null)
+          'clamp': {
+            'x': clamp.left,
+            'y': clamp.top,
+            'width': clamp.width,
+            'height': clamp.height,
+          },
+      });
+      return true;
+    } on PlatformException catch (e) {
+      debugPrint("SetPenTransform Error: ${e.message}");
+      return false;
+    }
+  }
+
+  /// Back to raw tablet units.
+  Future<void> clearPenTransform({String? deviceId}) async {
+    try {
+      await methodChannel.invokeMethod('setPenTransform', {
+        ..._device(deviceId),
+        'enabled': false,
+      });
+    } on PlatformException catch (e) {
+      debugPrint("ClearPenTransform Error: ${e.message}");
+    }
+  }
+
+  /// Renders the given pen strokes natively and returns PNG bytes.
+  /// [width] and [height] are logical pixels, scaled by [dpi] / 96.
+  Future<Uint8List> renderSignature({
+    required List<int> strokeIds,
+    required double width,
+    required double height,
+    double dpi = 96,
+    required Color color,
+    double minWidth = 1.2,
+    double maxWidth = 2.8,
+    PngPreset preset = PngPreset.balanced,
+    String? deviceId,
+  }) async {
+    final result = await methodChannel.invokeMethod('renderSignature', {
+      ..._device(deviceId),
+      'strokeIds': strokeIds,
+      'width': width,
+      'height': height,
+      'dpi': dpi,
+      'color': color.toARGB32(),
+      'minWidth': minWidth,
+      'maxWidth': maxWidth,
+      'preset': preset.name,
     });
+    return result as Uint8List;
+  }
+
+  /// Registers on-pad buttons, in screen pixels, replacing the previous
+  /// set; an empty map removes them. The plugin hit-tests natively: pen
+  /// strokes that start in a zone never reach [strokeEvents], and lifting
+  /// the pen inside the zone emits one [PenHotZoneTap]. Presses shorter
+  /// than [minPress] or within [refractory] of the last tap do nothing.
+  Future<void> setHotZones(
+    Map<String, Rect> zones, {
+    Duration minPress = const Duration(milliseconds: 20),
+    Duration refractory = const Duration(milliseconds: 150),
+    String? deviceId,
+  }) async {
+    final names = zones.keys.toList();
+    try {
+      await methodChannel.invokeMethod('setHotZones', {
+        ..._device(deviceId),
+        'zones': [
+          for (var i = 0; i < names.length; i++)
+            {
+              'id': i + 1,
+              'x': zones[names[i]]!.left.round(),
+              'y': zones[names[i]]!.top.round(),
+              'width': zones[names[i]]!.width.round(),
+              'height': zones[names[i]]!.height.round(),
+            },
+        ],
+        'minPressMs': minPress.inMilliseconds,
+        'refractoryMs': refractory.inMilliseconds,
+      });
+      final target = deviceId ?? _defaultDeviceId;
+      if (target != null) _hotZoneNames[target] = names;
+    } on PlatformException catch (e) {
+      debugPrint("SetHotZones Error: ${e.message}");
+    }
+  }
+
+  /// Drops the plugin's copy of the ink delivered so far.
+  Future<void> clearStrokes({String? deviceId}) async {
+    try {
+      await methodChannel.invokeMethod('clearStrokes', _device(deviceId));
+    } on PlatformException catch (e) {
+      debugPrint("ClearStrokes Error: ${e.message}");
+    }
+  }
+
+  /// Counters from the native event pipeline, for diagnostics: the
+  /// plugin's, and those of the pad [deviceId] or the default one.
+  Future<Map<String, dynamic>> getPipelineStats({String? deviceId}) async {
+    final result = await methodChannel.invokeMethod(
+      'getPipelineStats',
+      _device(deviceId),
+    );
+    return Map<String, dynamic>.from(result as Map);
+  }
+
+  /// Writes every raw report from the pad [deviceId] to a session file at
+  /// [filePath], with the time each was read, until
+  /// [stopReportRecording]. Sessions replay through the native pipeline
+  /// without a pad, for profiling. Returns false if the file cannot be
+  /// created or no pad is connected.
+  Future<bool> startReportRecording(
+    String filePath, {
+    String? deviceId,
+  }) async {
+    try {
+      await methodChannel.invokeMethod('startReportRecording', {
+        ..._device(deviceId),
+        'path': filePath,
+      });
+      return true;
+    } on PlatformException catch (e) {
+      debugPrint("StartReportRecording Error: ${e.message}");
+      return false;
+    }
+  }
+
+  /// Ends the recording of the pad [deviceId]. Returns the reports and
+  /// bytes written, or null if none was running or the file is incomplete.
+  Future<Map<String, int>?> stopReportRecording({String? deviceId}) async {
+    try {
+      final result = await methodChannel.invokeMethod(
+        'stopReportRecording',
+        _device(deviceId),
+      );
+      if (result is! Map) return null;
+      return {
+        'reports': result['reports'] as int,
+        'bytes': result['bytes'] as int,
+      };
+    } on PlatformException catch (e) {
+      debugPrint("StopReportRecording Error: ${e.message}");
+      return null;
+    }
   }
 
-  Future<void> setSignatureScreen(Uint8List rgbBytes, int mode) async {
+  /// Sends a full screen image to the pad. [format] 'bgr24' passes [bytes]
+  /// through in the encoding selected by [mode]; 'rgba8888' and 'bgra8888'
+  /// take 32-bit pixels of the pad's screen size, encoded natively for
+  /// [mode]. With [encodingAuto] the plugin picks the mode and treats
+  /// 'bgr24' as pixels too. Pixel images only send the rectangles that
+  /// changed since the last one, where the pad supports area writes.
+  /// Whole frames seen before are sent from the plugin's screen cache.
+  ///
+  /// Encoding and the transfer run on a plugin thread. A newer call
+  /// replaces one that has not started yet; the replaced call returns null.
+  /// Returns the mode used, rectangles and bytes sent, whether the frame
+  /// came from the cache, and encode / upload times in ms.
+  Future<Map<String, dynamic>?> setSignatureScreen(
+    Uint8List bytes,
+    int mode, {
+    String format = 'bgr24',
+    ScreenDither dither = ScreenDither.ordered,
+    String? deviceId,
+  }) async {
     try {
-      await methodChannel.invokeMethod('setSignatureScreen', {
-        'data': rgbBytes,
+      final result = await methodChannel.invokeMethod('setSignatureScreen', {
+        ..._device(deviceId),
+        'data': bytes,
         'mode': mode,
+        'format': format,
+        'dither': dither.name,
       });
+      return result is Map ? Map<String, dynamic>.from(result) : null;
+    } on PlatformException catch (e) {
+      // A newer screen or cancelScreenUpload took this one's place
+      if (e.code != 'REPLACED' && e.code != 'CANCELLED') {
+        debugPrint("Error setting signature screen: ${e.message}");
+      }
+      return null;
     } catch (e) {
       debugPrint("Error setting signature screen: $e");
+      return null;
     }
   }
+
+  /// Drops a screen upload that has not started and stops the running one
+  /// at its next rectangle. Their [setSignatureScreen] calls return null.
+  Future<void> cancelScreenUpload({String? deviceId}) async {
+    try {
+      await methodChannel.invokeMethod(
+        'cancelScreenUpload',
+        _device(deviceId),
+      );
+    } on PlatformException catch (e) {
+      debugPrint("CancelScreenUpload Error: ${e.message}");
+    }
+  }
+
 }
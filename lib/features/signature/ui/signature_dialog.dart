@@ -18,7 +18,12 @@ class SignatureDialog extends ConsumerStatefulWidget {
 class _SignatureDialogState extends ConsumerState<SignatureDialog> {
   List<List<Offset>> strokes = [];
   List<Offset> currentStroke = [];
+  // Native stroke id for each entry in [strokes], null for mouse/touch ink.
+  // Lets Apply render pen strokes from the plugin's copy of the ink.
+  final List<int?> _strokeIds = [];
+  int? _currentStrokeId;
   StreamSubscription? _penSubscription;
+  bool _penMapped = false;
 
   // Dialog Canvas Size (Fixed for simplicity or mapped)
   final double canvasWidth = 400;
@@ -64,9 +69,27 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
         _showWacomSignatureScreen(currentState.capabilities!, wacomService);
       }
 
-      _penSubscription = wacomService.penEvents.listen((event) {
-        if (!mounted) return;
-        _handlePenEvent(event, currentState.capabilities!);
+      // Let the plugin drop points that would not change the drawn ink:
+      // anything within a quarter of a canvas pixel.
+      final caps = currentState.capabilities!;
+      final unitsPerPixel = (caps['maxX'] as double) / canvasWidth;
+      await wacomService.setSimplifier(
+        minDistance: unitsPerPixel * 0.25,
+        tolerance: unitsPerPixel * 0.25,
+        cornerAngle: 60,
+      );
+
+      // Points arrive in canvas pixels, scaled natively
+      final scaleY = canvasHeight / (caps['maxY'] as double);
+      _penMapped = await wacomService.setPenTransform(
+        matrix: [1 / unitsPerPixel, 0, 0, 0, scaleY, 0],
+        clamp: Rect.fromLTWH(0, 0, canvasWidth, canvasHeight),
+      );
+
+      // Only the pad this dialog drives, should others be connected
+      _penSubscription = wacomService.strokeEvents.listen((event) {
+        if (!mounted || event.deviceId != caps['deviceId']) return;
+        _handleStrokeEvent(event, currentState.capabilities!);
       });
     }
   }
@@ -142,13 +165,29 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
     final buttonTop = height - buttonHeight;
     final buttonWidth = width / 3;
 
+    final buttons = {
+      'clear': Rect.fromLTWH(0, buttonTop, buttonWidth, buttonHeight),
+      'cancel': Rect.fromLTWH(
+        buttonWidth,
+        buttonTop,
+        buttonWidth,
+        buttonHeight,
+      ),
+      'apply': Rect.fromLTWH(
+        buttonWidth * 2,
+        buttonTop,
+        buttonWidth,
+        buttonHeight,
+      ),
+    };
+
     // Clear Button (Left)
     _drawWacomButton(
       canvas,
       "Clear",
       const Color(0xFFE2E8F0),
       const Color(0xFF0F172A),
-      Rect.fromLTWH(0, buttonTop, buttonWidth, buttonHeight),
+      buttons['clear']!,
     );
     // Cancel Button (Middle)
     _drawWacomButton(
@@ -156,7 +195,7 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
       "Cancel",
       const Color(0xFFF1F5F9),
       const Color(0xFF0F172A),
-      Rect.fromLTWH(buttonWidth, buttonTop, buttonWidth, buttonHeight),
+      buttons['cancel']!,
     );
     // Apply Button (Right)
     _drawWacomButton(
@@ -164,7 +203,7 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
       "Apply",
       const Color(0xFF059669),
       Colors.white,
-      Rect.fromLTWH(buttonWidth * 2, buttonTop, buttonWidth, buttonHeight),
+      buttons['apply']!,
     );
 
     final picture = recorder.endRecording();
@@ -172,26 +211,22 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
     final byteData = await img.toByteData(format: ui.ImageByteFormat.rawRgba);
 
     if (byteData != null) {
-      final rgbaBytes = byteData.buffer.asUint8List();
-      // Convert RGBA (4 bytes) to BGR/RGB (3 bytes)
-      // Wacom generally expects BGR for 24-bit
-      // Mode 4 = 24-bit.
-
-      final int pixelCount = width * height;
-      final Uint8List rgbBytes = Uint8List(pixelCount * 3);
-
-      for (int i = 0; i < pixelCount; i++) {
-        final int rgbaIndex = i * 4;
-        final int rgbIndex = i * 3;
-
-        // RGBA -> BGR
-        rgbBytes[rgbIndex] = rgbaBytes[rgbaIndex + 2]; // B
-        rgbBytes[rgbIndex + 1] = rgbaBytes[rgbaIndex + 1]; // G
-        rgbBytes[rgbIndex + 2] = rgbaBytes[rgbaIndex]; // R
-      }
-
-      await service.setSignatureScreen(rgbBytes, 4);
+      // The plugin encodes RGBA in the cheapest mode the pad supports
+      await service.setSignatureScreen(
+        byteData.buffer.asUint8List(),
+        WacomService.encodingAuto,
+        format: 'rgba8888',
+      );
     }
+
+    // The plugin hit-tests the buttons and sends one tap per press
+    await service.setHotZones(buttons);
+
+    // The pad inks the field itself, so the signer sees strokes with no
+    // round trip through the app; the buttons stay clean
+    await service.setHardwareInking(
+      HardwareInking(color: _selectedColor, thickness: 1, area: fieldRect),
+    );
   }
 
   void _drawWacomButton(
@@ -231,66 +266,74 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
     );
   }
 
-  void _handlePenEvent(Map<String, dynamic> event, Map<String, dynamic> caps) {
+  void _handleStrokeEvent(PenStrokeEvent event, Map<String, dynamic> caps) {
     if (!_wacomUiActive) {
       return; // Ignore pen input when device is in idle/ready state
     }
-    final x = event['x'] as double;
-    final y = event['y'] as double;
-    final pressure = event['pressure'] as double;
-    final sw = event['sw'] as int;
 
     final maxX = caps['maxX'] as double;
     final maxY = caps['maxY'] as double;
 
-    final screenW = caps['screenWidth']?.toDouble() ?? 800.0;
-    final screenH = caps['screenHeight']?.toDouble() ?? 480.0;
-
-    final mappedX = (x / maxX) * screenW;
-    final mappedY = (y / maxY) * screenH;
-
-    final buttonHeight = screenH * 0.2;
-    final buttonTop = screenH - buttonHeight;
-
-    // Debugging Button Logic
-    // debugPrint("Wacom Event: x=$x, y=$y, pressure=$pressure, maxX=$maxX, maxY=$maxY");
-    // debugPrint("Mapped: x=$mappedX, y=$mappedY");
-    // debugPrint("Buttons: Top=$buttonTop, Height=$buttonHeight");
+    // The plugin maps points already, unless setPenTransform failed;
+    // otherwise a simple linear mapping
+    Offset toCanvas(PenPoint p) => _penMapped
+        ? Offset(p.x, p.y)
+        : Offset((p.x / maxX) * canvasWidth, (p.y / maxY) * canvasHeight);
+
+    switch (event) {
+      case PenHotZoneTap(:final zone):
+        _handleWacomButton(zone);
+      case PenStrokeBegin(:final strokeId, :final point):
+        setState(() {
+          currentStroke = [toCanvas(point)];
+          _currentStrokeId = strokeId;
+        });
+      case PenStrokePoints(:final points):
+        setState(() {
+          for (final point in points) {
+            currentStroke.add(toCanvas(point));
+          }
+        });
+      case PenStrokeEnd(:final strokeId):
+        if (currentStroke.isNotEmpty) {
+          setState(() {
+            strokes.add(currentStroke);
+            _strokeIds.add(strokeId);
+            currentStroke = [];
+          });
+        }
+      case PenDeviceRemoved():
+        // The stroke in progress will not get its end; keep what arrived
+        final strokeId = _currentStrokeId;
+        if (currentStroke.isNotEmpty && strokeId != null) {
+          setState(() {
+            strokes.add(currentStroke);
+            _strokeIds.add(strokeId);
+            currentStroke = [];
+          });
+        }
+      case PenDeviceReconnected(:final reconnectTime):
+        // Screen, buttons and settings come back natively
+        debugPrint("Pad reconnected in ${reconnectTime.inMilliseconds} ms");
+    }
+  }
 
-    if (mappedY > buttonTop && pressure > 0) {
-      if (_isClosing) return;
+  // Runs the action of the on-pad button named [zone]
+  void _handleWacomButton(String zone) {
+    if (_isClosing) return;
 
-      debugPrint("Button Click Detected! MappedX=$mappedX");
-      // Button Clicked
-      final buttonWidth = screenW / 3;
-      if (mappedX < buttonWidth) {
+    debugPrint("Button Click Detected! Zone=$zone");
+    switch (zone) {
+      case 'clear':
         debugPrint("Action: Clear");
         _clear();
-      } else if (mappedX < buttonWidth * 2) {
+      case 'cancel':
         debugPrint("Action: Cancel");
         _closeDialog();
-      } else {
+      case 'apply':
         debugPrint("Action: Apply");
         _apply();
-      }
-      return; // Don't draw
     }
-
-    // Map to canvas
-    // Simple linear mapping
-    final double screenX = (x / maxX) * canvasWidth;
-    final double screenY = (y / maxY) * canvasHeight;
-
-    setState(() {
-      if (pressure > 0 || sw != 0) {
-        currentStroke.add(Offset(screenX, screenY));
-      } else {
-        if (currentStroke.isNotEmpty) {
-          strokes.add(List.from(currentStroke));
-          currentStroke.clear();
-        }
-      }
-    });
   }
 
   @override
@@ -311,6 +354,11 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
   Future<void> _showWacomIdleScreen() async {
     if (!_wacomUiActive) return;
     final wacomService = ref.read(wacomServiceProvider);
+    // The signing screen may still be on its way; the idle one wins
+    unawaited(wacomService.cancelScreenUpload());
+    unawaited(wacomService.setHardwareInking(null));
+    unawaited(wacomService.setHotZones({}));
+    unawaited(wacomService.clearPenTransform());
     final currentState = ref.read(wacomConnectionProvider);
     if (currentState.isConnected && currentState.capabilities != null) {
       await _setWacomIdleScreen(currentState.capabilities!, wacomService);
@@ -399,28 +447,23 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
     final byteData = await img.toByteData(format: ui.ImageByteFormat.rawRgba);
 
     if (byteData != null) {
-      final rgbaBytes = byteData.buffer.asUint8List();
-      final int pixelCount = width * height;
-      final Uint8List rgbBytes = Uint8List(pixelCount * 3);
-
-      for (int i = 0; i < pixelCount; i++) {
-        final int rgbaIndex = i * 4;
-        final int rgbIndex = i * 3;
-        rgbBytes[rgbIndex] = rgbaBytes[rgbaIndex + 2]; // B
-        rgbBytes[rgbIndex + 1] = rgbaBytes[rgbaIndex + 1]; // G
-        rgbBytes[rgbIndex + 2] = rgbaBytes[rgbaIndex]; // R
-      }
-      await service.setSignatureScreen(rgbBytes, 4);
+      await service.setSignatureScreen(
+        byteData.buffer.asUint8List(),
+        WacomService.encodingAuto,
+        format: 'rgba8888',
+      );
     }
   }
 
   void _clear() {
     setState(() {
       strokes.clear();
+      _strokeIds.clear();
       currentStroke.clear();
     });
 
     final wacomService = ref.read(wacomServiceProvider);
+    wacomService.clearStrokes();
     final currentState = ref.read(wacomConnectionProvider);
     if (currentState.isConnected && currentState.capabilities != null) {
       _setWacomScreen(currentState.capabilities!, wacomService);
@@ -430,6 +473,48 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
   bool _saveSignature = false;
 
   Future<void> _apply() async {
+    final pngBytes = await _renderSignature();
+
+    if (_saveSignature) {
+      final storageService = ref.read(signatureStorageServiceProvider);
+      await storageService.saveSignature(pngBytes);
+      if (mounted) {
+        ScaffoldMessenger.of(
+          context,
+        ).showSnackBar(const SnackBar(content: Text("Signature Saved!")));
+      }
+    }
+
+    if (mounted) {
+      _closeDialog(pngBytes);
+    }
+  }
+
+  Future<Uint8List> _renderSignature() async {
+    // Pen-only signatures are rendered and encoded by the plugin, which
+    // already holds every point; no redraw or PNG encode on this isolate.
+    final ids = [
+      ..._strokeIds,
+      if (currentStroke.isNotEmpty) _currentStrokeId,
+    ];
+    final wacomState = ref.read(wacomConnectionProvider);
+    if (wacomState.isConnected &&
+        ids.isNotEmpty &&
+        ids.every((id) => id != null)) {
+      try {
+        return await ref
+            .read(wacomServiceProvider)
+            .renderSignature(
+              strokeIds: ids.cast<int>(),
+              width: canvasWidth,
+              height: canvasHeight,
+              color: _selectedColor,
+            );
+      } catch (e) {
+        debugPrint("Native signature render failed, falling back: $e");
+      }
+    }
+
     // Generate Image from strokes
     final recorder = ui.PictureRecorder();
     final canvas = Canvas(
@@ -445,21 +530,7 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
       canvasHeight.toInt(),
     );
     final byteData = await img.toByteData(format: ui.ImageByteFormat.png);
-    final pngBytes = byteData!.buffer.asUint8List();
-
-    if (_saveSignature) {
-      final storageService = ref.read(signatureStorageServiceProvider);
-      await storageService.saveSignature(pngBytes);
-      if (mounted) {
-        ScaffoldMessenger.of(
-          context,
-        ).showSnackBar(const SnackBar(content: Text("Signature Saved!")));
-      }
-    }
-
-    if (mounted) {
-      _closeDialog(pngBytes);
-    }
+    return byteData!.buffer.asUint8List();
   }
 
   Future<void> _closeDialog([Uint8List? result]) async {
@@ -594,6 +665,7 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
                           onPanStart: (details) {
                             setState(() {
                               currentStroke = [details.localPosition];
+                              _currentStrokeId = null;
                             });
                           },
                           onPanUpdate: (details) {
@@ -604,8 +676,9 @@ class _SignatureDialogState extends ConsumerState<SignatureDialog> {
                           onPanEnd: (_) {
                             if (currentStroke.isNotEmpty) {
                               setState(() {
-                                strokes.add(List.from(currentStroke));
-                                currentStroke.clear();
+                                strokes.add(currentStroke);
+                                _strokeIds.add(null);
+                                currentStroke = [];
                               });
                             }
                           },
@@ -9,6 +9,7 @@
 #include <screen_retriever_linux/screen_retriever_linux_plugin.h>
 #include <syncfusion_pdfviewer_linux/syncfusion_pdfviewer_linux_plugin.h>
 #include <url_launcher_linux/url_launcher_plugin.h>
+#include <wacom_stu_plugin/wacom_stu_plugin.h>
 #include <window_manager/window_manager_plugin.h>
 
 void fl_register_plugins(FlPluginRegistry* registry) {
@@ -21,6 +22,9 @@ void fl_register_plugins(FlPluginRegistry* registry) {
   g_autoptr(FlPluginRegistrar) url_launcher_linux_registrar =
       fl_plugin_registry_get_registrar_for_plugin(registry, "UrlLauncherPlugin");
   url_launcher_plugin_register_with_registrar(url_launcher_linux_registrar);
+  g_autoptr(FlPluginRegistrar) wacom_stu_plugin_registrar =
+      fl_plugin_registry_get_registrar_for_plugin(registry, "WacomStuPlugin");
+  wacom_stu_plugin_register_with_registrar(wacom_stu_plugin_registrar);
   g_autoptr(FlPluginRegistrar) window_manager_registrar =
       fl_plugin_registry_get_registrar_for_plugin(registry, "WindowManagerPlugin");
   window_manager_plugin_register_with_registrar(window_manager_registrar);
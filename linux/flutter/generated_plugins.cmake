@@ -6,6 +6,7 @@ list(APPEND FLUTTER_PLUGIN_LIST
   screen_retriever_linux
   syncfusion_pdfviewer_linux
   url_launcher_linux
+  wacom_stu_plugin
   window_manager
 )
 
@@ -0,0 +1,78 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:wacom_app/core/services/wacom_service.dart';
+
+// PackPenFrameDelta's output for the stroke in
+// wacom_stu_plugin/windows/test/pen_frame_test.cpp (PenFrame.DeltaFixture);
+// change the two together
+const _t0 = 1000000;
+final _deltaFixture = Uint8List.fromList([
+  128, 150, 1, 224, 93, 254, 15, 2, 0, 252, 255, 7, 207, 15, 14, //
+  30, 199, 1, 20, 45, 2, 144, 78, 2, 208, 90, 0, 14, 199, 1, //
+  39, 39, 2, 144, 78, 253, 255, 7, 200, 76, 0, 142, 1, 239, 146, //
+  1, 203, 93, 167, 15, 0, 159, 31, 1, 215, 229, 1, 13, 32, //
+]);
+
+// The same stroke as the plugin's columns: x, y, pressure, sw, time,
+// sequence, device time, stroke id, flags. It crosses the sequence wrap,
+// then loses the sequence; times step back and sw and flags go down.
+const _rows = [
+  [9600, 6000, 1023, 1, 1000000, 65534, 999000, 7, 15],
+  [9500, 6010, 1000, 1, 1005000, 65535, 1004800, 7, 7],
+  [9400, 5990, 980, 1, 1010000, 0, 1009700, 7, 71],
+  [0, 0, 0, 0, 1008000, -1, 995000, 0, 16],
+];
+
+void _expectRows(List<Map<String, dynamic>> samples, {int coordOne = 1}) {
+  expect(samples, hasLength(_rows.length));
+  for (var i = 0; i < _rows.length; i++) {
+    final row = _rows[i];
+    final sample = samples[i];
+    expect(sample['x'], row[0] / coordOne, reason: 'x of $i');
+    expect(sample['y'], row[1] / coordOne, reason: 'y of $i');
+    expect(sample['pressure'], row[2], reason: 'pressure of $i');
+    expect(sample['sw'], row[3], reason: 'sw of $i');
+    expect(sample['timestamp'], row[4], reason: 'timestamp of $i');
+    expect(sample['sequence'], row[5], reason: 'sequence of $i');
+    expect(sample['deviceTimestamp'], row[6], reason: 'deviceTimestamp of $i');
+    expect(sample['strokeId'], row[7], reason: 'strokeId of $i');
+    expect(sample['flags'], row[8], reason: 'flags of $i');
+    expect(sample['deviceId'], 'pad-1');
+  }
+}
+
+void main() {
+  test('decodes a delta frame packed by the plugin', () {
+    final samples = WacomService.decodePenFrame({
+      'type': 'penFrame',
+      'deviceId': 'pad-1',
+      'stride': 9,
+      'count': _rows.length,
+      't0': _t0,
+      'delta': true,
+      'samples': _deltaFixture,
+    });
+    _expectRows(samples);
+    expect(samples[2]['flags'] & PenSampleFlags.synthetic, isNonZero);
+  });
+
+  test('decodes a plain frame of the same stroke', () {
+    final packed = Int32List.fromList([
+      for (final row in _rows)
+        for (var c = 0; c < row.length; c++)
+          c == 4 || c == 6 ? row[c] - _t0 : row[c],
+    ]);
+    final samples = WacomService.decodePenFrame({
+      'type': 'penFrame',
+      'deviceId': 'pad-1',
+      'stride': 9,
+      'count': _rows.length,
+      't0': _t0,
+      'samples': packed,
+      'coordOne': 16,
+    });
+    _expectRows(samples, coordOne: 16);
+  });
+}
@@ -0,0 +1,143 @@
+#include "report_loop.h"
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "host_clock.h"
+
+namespace {
+
+// Events taken per epoll_wait; one per pad is plenty
+constexpr int kMaxEvents = 16;
+
+// epoll data for a watch. Generations start at 1, so 0 is the stop event.
+uint64_t WatchToken(int fd, uint32_t generation) {
+  return uint64_t(generation) << 32 | uint32_t(fd);
+}
+
+}  // namespace
+
+ReportLoop::~ReportLoop() { Stop(); }
+
+bool ReportLoop::Start() {
+  epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+  stopEvent_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = 0;
+  if (epoll_ < 0 || stopEvent_ < 0 || ::epoll_ctl(epoll_, EPOLL_CTL_ADD, stopEvent_, &event) < 0) {
+    if (epoll_ >= 0) ::close(epoll_);
+    if (stopEvent_ >= 0) ::close(stopEvent_);
+    epoll_ = stopEvent_ = -1;
+    return false;
+  }
+  thread_ = std::thread([this] { Run(); });
+  return true;
+}
+
+void ReportLoop::Stop() {
+  if (epoll_ < 0) return;
+  const uint64_t one = 1;
+  while (::write(stopEvent_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+  if (thread_.joinable()) thread_.join();
+  ::close(stopEvent_);
+  ::close(epoll_);
+  epoll_ = stopEvent_ = -1;
+  watches_.clear();
+}
+
+bool ReportLoop::Add(int fd, ReportFn onReport, ErrorFn onError) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (epoll_ < 0 && !Start()) return false;
+  Watch watch;
+  watch.generation = nextGeneration_++;
+  if (!nextGeneration_) nextGeneration_ = 1;
+  watch.onReport = std::move(onReport);
+  watch.onError = std::move(onError);
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = WatchToken(fd, watch.generation);
+  // A replaced watch takes the new generation
+  const int op = watches_.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (::epoll_ctl(epoll_, op, fd, &event) < 0) return false;
+  watches_[fd] = std::move(watch);
+  return true;
+}
+
+void ReportLoop::Remove(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = watches_.find(fd);
+  if (it == watches_.end()) return;
+  ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+  watches_.erase(it);
+}
+
+double ReportLoop::CpuMs() const {
+  if (!thread_.joinable()) return 0.0;
+  clockid_t clock;
+  timespec time;
+  if (pthread_getcpuclockid(const_cast<std::thread&>(thread_).native_handle(), &clock) != 0 ||
+      ::clock_gettime(clock, &time) != 0) {
+    return 0.0;
+  }
+  return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+}
+
+void ReportLoop::Run() {
+  epoll_event events[kMaxEvents];
+  for (;;) {
+    const int count = ::epoll_wait(epoll_, events, kMaxEvents, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < count; ++i) {
+      const uint64_t token = events[i].data.u64;
+      if (token == 0) return;
+      const int fd = int(uint32_t(token));
+      auto it = watches_.find(fd);
+      // Removed, or removed and added again, since epoll_wait returned
+      if (it == watches_.end() || it->second.generation != uint32_t(token >> 32)) continue;
+
+      int error = 0;
+      bool ok = true;
+      if (events[i].events & EPOLLIN) ok = Drain(fd, it->second, error);
+      if (ok && (events[i].events & (EPOLLERR | EPOLLHUP))) {
+        ok = false;
+        error = ENODEV;
+      }
+      if (!ok) {
+        ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+        ErrorFn onError = std::move(it->second.onError);
+        watches_.erase(it);
+        if (onError) onError(error);
+      }
+    }
+  }
+}
+
+bool ReportLoop::Drain(int fd, Watch& watch, int& error) {
+  for (;;) {
+    // hidraw hands out one report per read
+    const ssize_t size = ::read(fd, buffer_, sizeof(buffer_));
+    if (size > 0) {
+      watch.onReport(buffer_, size_t(size), HostTimeUs());
+      continue;
+    }
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    // A read of nothing, or EIO, is the pad going away
+    error = size < 0 ? errno : ENODEV;
+    return false;
+  }
+}
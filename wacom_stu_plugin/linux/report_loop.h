@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// One thread reading every connected pad's input reports. Each pad's
+// hidraw fd is non-blocking and registered with epoll; the thread sleeps in
+// epoll_wait until some pad has reports, reads all it has, and goes back to
+// sleep, so an idle pen costs no CPU and no poll latency. An eventfd wakes
+// it to stop.
+class ReportLoop {
+ public:
+  // Loop thread, for each report read, report id first, with the host time
+  // it was read
+  using ReportFn = std::function<void(const uint8_t* data, size_t size, int64_t hostUs)>;
+  // Loop thread, once, when reading fails for good, as when the pad is
+  // unplugged. The fd is no longer watched by then.
+  using ErrorFn = std::function<void(int error)>;
+
+  ReportLoop() = default;
+  // Stops the thread; every fd is left open
+  ~ReportLoop();
+
+  ReportLoop(const ReportLoop&) = delete;
+  ReportLoop& operator=(const ReportLoop&) = delete;
+
+  // Starts watching |fd|, and the thread with the first one. False if epoll
+  // refuses it.
+  bool Add(int fd, ReportFn onReport, ErrorFn onError);
+
+  // Stops watching |fd|. Once it returns, neither callback runs for it
+  // again. Not from a callback.
+  void Remove(int fd);
+
+  // Returns from epoll_wait, and the loop thread's CPU time so far
+  uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+  double CpuMs() const;
+
+ private:
+  struct Watch {
+    // Tells a stale event for a reused fd number from a current one
+    uint32_t generation = 0;
+    ReportFn onReport;
+    ErrorFn onError;
+  };
+
+  bool Start();
+  void Stop();
+  void Run();
+  // Loop thread, under mutex_. Reads |fd| until it runs dry; false if it
+  // failed, with the error in |error|.
+  bool Drain(int fd, Watch& watch, int& error);
+
+  int epoll_ = -1;
+  int stopEvent_ = -1;
+  std::thread thread_;
+  // Held by the loop thread while it runs callbacks, so Remove can wait
+  // them out
+  std::mutex mutex_;
+  std::map<int, Watch> watches_;
+  uint32_t nextGeneration_ = 1;
+  std::atomic<uint64_t> wakeups_{0};
+  // Big enough for any report a HID device can send
+  uint8_t buffer_[4096];
+};
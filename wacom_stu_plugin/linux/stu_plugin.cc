@@ -0,0 +1,1244 @@
+#include "stu_plugin.h"
+
+#include <glib-unix.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "device_id.h"
+#include "host_clock.h"
+#include "pen_frame.h"
+#include "png_encoder.h"
+#include "signature_rasterizer.h"
+
+// A pad that drops off is looked for this often until it is back or
+// disconnected
+constexpr int kReconnectPollMs = 250;
+
+// hidraw has no interface path; the HID physical path stands in for it in
+// the device id, so ids stay put across reconnects and runs
+static std::string DeviceIdOf(const StuHidDevice& device) {
+  return StuDeviceId(device.vendorId, device.productId,
+                     std::wstring(device.phys.begin(), device.phys.end()));
+}
+
+// The capability and information reports and the supported report ids of
+// a freshly attached pad
+static DeviceInfo ReadDeviceInfo(StuTablet& tablet, const StuHidDevice& hidDevice) {
+  DeviceInfo info;
+  info.productId = hidDevice.productId;
+  info.bcdDevice = hidDevice.bcdDevice;
+
+  const auto cap = tablet.GetCapability();
+  info.tabletMaxX = cap.tabletMaxX;
+  info.tabletMaxY = cap.tabletMaxY;
+  info.tabletMaxPressure = cap.tabletMaxPressure;
+  info.screenWidth = cap.screenWidth;
+  info.screenHeight = cap.screenHeight;
+  info.maxReportRate = cap.maxReportRate;
+  info.resolution = cap.resolution;
+  // Older firmware reports no encoding flags; 1-bit is the one mode every
+  // model takes
+  info.encodingFlag = cap.encodingFlag ? cap.encodingFlag : uint8_t(kStuEncoding1Bit);
+
+  const auto information = tablet.GetInformation();
+  info.modelName = information.modelName;
+  info.firmwareMajor = information.firmwareMajor;
+  info.firmwareMinor = information.firmwareMinor;
+  info.secureIc = information.secureIc;
+
+  info.areaWrites = tablet.IsSupported(kStuReportStartImageDataArea);
+  info.hardwareInk = tablet.IsSupported(kStuReportInkingMode);
+  info.penDataOptionMode = tablet.IsSupported(kStuReportPenDataOptionMode);
+  return info;
+}
+
+// The host's side of an encrypted capture, as on Windows: agrees a session
+// key with the pad and starts the capture under a fresh session id. A pad
+// without usable parameters of its own takes the host's. False if the pad
+// answers with a key that cannot be used; throws if it does not answer.
+static bool StartEncryptedCapture(StuTablet& tablet, SessionKeyExchange::Key& sessionKey,
+                                  uint32_t& sessionId) {
+  SessionKeyExchange exchange;
+  if (!exchange.SetParameters(tablet.GetDHprime(), tablet.GetDHbase())) {
+    tablet.SetDHprime(exchange.prime());
+    tablet.SetDHbase(exchange.base());
+  }
+  tablet.SetHostPublicKey(exchange.GeneratePublicKey());
+  const bool agreed = exchange.ComputeSessionKey(tablet.GetDevicePublicKey(), sessionKey);
+  exchange.Clear();
+  if (!agreed) return false;
+
+  std::random_device random;
+  sessionId = random();
+  tablet.StartCapture(sessionId);
+  return true;
+}
+
+// Argument helpers for method calls that take a map of optional settings.
+// The standard codec hands every Dart int over as a 64-bit int here.
+static FlValue* FindArg(FlValue* map, const char* key) {
+  if (!map || fl_value_get_type(map) != FL_VALUE_TYPE_MAP) return nullptr;
+  return fl_value_lookup_string(map, key);
+}
+
+static double GetDoubleArg(FlValue* map, const char* key, double fallback) {
+  FlValue* value = FindArg(map, key);
+  if (!value) return fallback;
+  if (fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) return fl_value_get_float(value);
+  if (fl_value_get_type(value) == FL_VALUE_TYPE_INT) return (double)fl_value_get_int(value);
+  return fallback;
+}
+
+static int64_t GetIntArg(FlValue* map, const char* key, int64_t fallback) {
+  FlValue* value = FindArg(map, key);
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_INT) return fallback;
+  return fl_value_get_int(value);
+}
+
+static bool GetBoolArg(FlValue* map, const char* key, bool fallback) {
+  FlValue* value = FindArg(map, key);
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_BOOL) return fallback;
+  return fl_value_get_bool(value);
+}
+
+// Null if missing or not a string
+static const char* GetStringArg(FlValue* map, const char* key) {
+  FlValue* value = FindArg(map, key);
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) return nullptr;
+  return fl_value_get_string(value);
+}
+
+static void SetInt(FlValue* map, const char* key, int64_t value) {
+  fl_value_set_string_take(map, key, fl_value_new_int(value));
+}
+
+static void SetDouble(FlValue* map, const char* key, double value) {
+  fl_value_set_string_take(map, key, fl_value_new_float(value));
+}
+
+static void SetBool(FlValue* map, const char* key, bool value) {
+  fl_value_set_string_take(map, key, fl_value_new_bool(value));
+}
+
+static void SetString(FlValue* map, const char* key, const std::string& value) {
+  fl_value_set_string_take(map, key, fl_value_new_string(value.c_str()));
+}
+
+// Converts a sample into the map format the Dart side listens for
+static FlValue* EncodePenSample(const PenSample& sample, const std::string& deviceId) {
+  FlValue* map = fl_value_new_map();
+  SetString(map, "deviceId", deviceId);
+  SetInt(map, "x", sample.x);
+  SetInt(map, "y", sample.y);
+  SetInt(map, "pressure", sample.pressure);
+  SetInt(map, "sw", sample.sw);
+  SetInt(map, "timestamp", sample.timestampUs);
+  SetInt(map, "deviceTimestamp", sample.deviceTimeUs);
+  if (sample.flags & kPenSampleHasSequence) SetInt(map, "sequence", sample.sequence);
+  SetInt(map, "strokeId", sample.strokeId);
+  SetInt(map, "flags", sample.flags);
+  return map;
+}
+
+// Builds a single event holding a whole batch of samples, see pen_frame.h
+static FlValue* EncodePenFrame(const std::string& deviceId, const std::vector<PenSample>& samples,
+                               bool delta, std::vector<int32_t>& packed,
+                               std::vector<uint8_t>& deltaPacked, const PenFrameMapped* mapped) {
+  const int64_t t0 = samples.front().timestampUs;
+
+  FlValue* map = fl_value_new_map();
+  SetString(map, "type", "penFrame");
+  SetString(map, "deviceId", deviceId);
+  SetInt(map, "stride", kFrameStride);
+  SetInt(map, "count", (int64_t)samples.size());
+  SetInt(map, "t0", t0);
+  SetBool(map, "delta", delta);
+  if (mapped) {
+    // x and y are target units times coordOne, pressure 0..pressureOne
+    SetInt(map, "coordOne", PenTransform::kCoordOne);
+    SetInt(map, "pressureOne", PenTransform::kPressureOne);
+  }
+  if (delta) {
+    PackPenFrameDelta(samples.data(), samples.size(), t0, deltaPacked, mapped);
+    fl_value_set_string_take(map, "samples",
+                             fl_value_new_uint8_list(deltaPacked.data(), deltaPacked.size()));
+  } else {
+    PackPenFrame(samples.data(), samples.size(), t0, packed, mapped);
+    fl_value_set_string_take(map, "samples", fl_value_new_int32_list(packed.data(), packed.size()));
+  }
+  return map;
+}
+
+MethodResult::MethodResult(FlMethodCall* call) : call_(FL_METHOD_CALL(g_object_ref(call))) {}
+
+MethodResult::~MethodResult() { g_object_unref(call_); }
+
+void MethodResult::Success(FlValue* value) {
+  g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(value));
+  fl_method_call_respond(call_, response, nullptr);
+  if (value) fl_value_unref(value);
+}
+
+void MethodResult::Error(const std::string& code, const std::string& message) {
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_error_response_new(code.c_str(), message.c_str(), nullptr));
+  fl_method_call_respond(call_, response, nullptr);
+}
+
+void MethodResult::NotImplemented() {
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  fl_method_call_respond(call_, response, nullptr);
+}
+
+StuPlugin::StuPlugin(FlMethodChannel* channel, FlEventChannel* eventChannel)
+    : channel(FL_METHOD_CHANNEL(g_object_ref(channel))),
+      eventChannel(FL_EVENT_CHANNEL(g_object_ref(eventChannel))) {
+  // Created on the platform thread, so the source runs on its main loop
+  wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeupFd >= 0) wakeupSource = g_unix_fd_add(wakeupFd, G_IO_IN, &StuPlugin::OnWakeupFd, this);
+}
+
+StuPlugin::~StuPlugin() {
+  while (!devices.empty()) DisconnectDevice(devices.begin()->first);
+  if (wakeupSource) g_source_remove(wakeupSource);
+  if (wakeupFd >= 0) close(wakeupFd);
+  g_object_unref(eventChannel);
+  g_object_unref(channel);
+}
+
+gboolean StuPlugin::OnWakeupFd(gint fd, GIOCondition, gpointer user_data) {
+  auto* plugin = static_cast<StuPlugin*>(user_data);
+  uint64_t count;
+  while (read(fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+  if (plugin->wakeupPending.load()) {
+    ++plugin->wakeupsHandled;
+    plugin->DeliverPenEvents();
+  }
+  plugin->RunPlatformTasks();
+  return G_SOURCE_CONTINUE;
+}
+
+// Called by the report loop after each successful push. Only the push that
+// finds no wakeup outstanding signals the main loop, so a burst of samples
+// costs a single wakeup no matter how long the platform thread takes to
+// get to it.
+void StuPlugin::PostWakeup() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (wakeupPending.exchange(true)) return;
+
+  const uint64_t one = 1;
+  if (wakeupFd >= 0 && write(wakeupFd, &one, sizeof(one)) == sizeof(one)) {
+    wakeupsPosted.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    wakeupPending = false;
+  }
+}
+
+// Any thread. Runs |task| on the platform thread, where method calls have
+// to be answered and the devices live.
+void StuPlugin::PostToPlatformThread(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(platformTaskMutex);
+    platformTasks.push_back(std::move(task));
+  }
+  const uint64_t one = 1;
+  if (wakeupFd >= 0 && write(wakeupFd, &one, sizeof(one)) < 0) {
+    // Only fails with the counter full, which is signalled anyway
+  }
+}
+
+void StuPlugin::RunPlatformTasks() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(platformTaskMutex);
+    tasks.swap(platformTasks);
+  }
+  for (auto& task : tasks) task();
+}
+
+void StuPlugin::DeliverPenEvents() {
+  // Re-arm before draining: anything pushed after this point either shows
+  // up in the drains below or signals a fresh wakeup.
+  wakeupPending = false;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  for (auto& [id, device] : devices) {
+    DeliverPenEvents(*device);
+  }
+}
+
+// One pad's ring; a batched listener gets one frame per pad
+void StuPlugin::DeliverPenEvents(StuDevice& device) {
+  if (!batchedEvents) {
+    device.samplesDelivered += device.pipeline.ring.Drain([this, &device](const PenSample& sample) {
+      device.inkStore.Add(sample);
+      if (listening) {
+        SendEvent(EncodePenSample(sample, device.id));
+        ++eventsSent;
+      }
+    });
+    return;
+  }
+
+  drainScratch.clear();
+  device.pipeline.ring.Drain([this, &device](const PenSample& sample) {
+    device.inkStore.Add(sample);
+    drainScratch.push_back(sample);
+  });
+  if (drainScratch.empty() || !listening) return;
+
+  // Mapped here, after the ink store kept the raw sample
+  const PenTransform& penTransform = device.penTransform;
+  PenFrameMapped mapped{};
+  if (penTransform.enabled()) {
+    const size_t count = drainScratch.size();
+    mappedX.resize(count);
+    mappedY.resize(count);
+    mappedPressure.resize(count);
+    penTransform.Apply(drainScratch.data(), count, mappedX.data(), mappedY.data(),
+                       mappedPressure.data());
+    mapped = PenFrameMapped{mappedX.data(), mappedY.data(), mappedPressure.data()};
+  }
+  SendEvent(EncodePenFrame(device.id, drainScratch, deltaFrames, frameScratch, deltaScratch,
+                           penTransform.enabled() ? &mapped : nullptr));
+  ++eventsSent;
+  device.samplesDelivered += drainScratch.size();
+}
+
+void StuPlugin::SendEvent(FlValue* event) {
+  if (listening) {
+    g_autoptr(GError) error = nullptr;
+    if (!fl_event_channel_send(eventChannel, event, nullptr, &error)) {
+      g_warning("wacom_stu_events: %s", error->message);
+    }
+  }
+  fl_value_unref(event);
+}
+
+FlMethodErrorResponse* StuPlugin::OnListen(FlValue* arguments) {
+  listening = true;
+  // {"format": "frames", "delta": bool} switches to batched delivery
+  const char* format = GetStringArg(arguments, "format");
+  batchedEvents = format && std::string(format) == "frames";
+  deltaFrames = GetBoolArg(arguments, "delta", false);
+  return nullptr;
+}
+
+FlMethodErrorResponse* StuPlugin::OnCancel() {
+  listening = false;
+  return nullptr;
+}
+
+StuDevice* StuPlugin::FindDevice(FlValue* arguments) {
+  const char* id = GetStringArg(arguments, "deviceId");
+  auto it = devices.find(id ? std::string(id) : defaultDeviceId);
+  if (it == devices.end() && !id && !devices.empty()) it = devices.begin();
+  return it == devices.end() ? nullptr : it->second.get();
+}
+
+// Platform thread. Stops reading the pad and releases it; a pad that is
+// not connected is ignored.
+void StuPlugin::DisconnectDevice(const std::string& id) {
+  auto it = devices.find(id);
+  if (it == devices.end()) return;
+  StuDevice& device = *it->second;
+
+  device.reconnectCancel = true;
+  if (device.reconnectThread.joinable()) device.reconnectThread.join();
+  if (device.tablet.isOpen()) reportLoop.Remove(device.tablet.fd());
+  device.decryptWorker.reset();
+  device.screenWorker.Cancel();
+  device.screenWorker.WaitIdle();
+  if (device.encrypted && device.tablet.isOpen()) {
+    // Otherwise the pad keeps capturing with no one listening
+    try {
+      device.tablet.EndCapture();
+    } catch (...) {
+      // Already unplugged
+    }
+  }
+  device.tablet.Close();
+  devices.erase(it);
+}
+
+bool StuPlugin::StartReports(StuDevice& device) {
+  device.clockEstimator.Reset();
+  device.pipeline.Reset();
+  return reportLoop.Add(
+      device.tablet.fd(),
+      [this, &device](const uint8_t* data, size_t size, int64_t hostUs) {
+        OnReport(device, data, size, hostUs);
+      },
+      [this, id = device.id](int) { PostToPlatformThread([this, id] { OnDeviceLost(id); }); });
+}
+
+// Platform thread, before the pad's reports are watched. The session the
+// key exchange left goes to a new worker and the key is wiped.
+void StuPlugin::StartDecryptWorker(StuDevice& device) {
+  device.decryptWorker = std::make_unique<DecryptWorker>(
+      device.sessionKey.data(), device.sessionId, &device.clockEstimator,
+      [this, &device](const PenSample& sample) { OnPenSample(device, sample); });
+  device.sessionKey.fill(0);
+}
+
+// Report loop thread
+void StuPlugin::OnReport(StuDevice& device, const uint8_t* data, size_t size, int64_t hostUs) {
+  if (device.recording.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(device.recorderMutex);
+    if (device.recorder) device.recorder->Append(hostUs, data, size);
+  }
+  device.reportsRead.fetch_add(1, std::memory_order_relaxed);
+
+  if (device.decryptWorker) {
+    device.decryptWorker->Push(data, size, hostUs);
+    return;
+  }
+  PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+  const size_t count = device.reportDecoder.Decode(data, size, hostUs, samples);
+  for (size_t i = 0; i < count; ++i) OnPenSample(device, samples[i]);
+}
+
+// Report loop thread, or the decrypt worker in an encrypted capture: runs
+// each decoded sample through the pad's pipeline to the platform thread.
+void StuPlugin::OnPenSample(StuDevice& device, const PenSample& sample) {
+  if (device.pipeline.Process(sample)) PostWakeup();
+}
+
+// Platform thread, from the report loop failing to read the pad
+void StuPlugin::OnDeviceLost(const std::string& id) {
+  auto it = devices.find(id);
+  if (it == devices.end() || it->second->lost) return;
+  StuDevice& device = *it->second;
+
+  device.lost = true;
+  device.lostAtUs = HostTimeUs();
+  {
+    // Waits out an upload failing against the missing pad
+    std::lock_guard<std::mutex> lock(device.screenMutex);
+    device.tablet.Close();
+  }
+  // Decodes what it still holds, for the delivery below
+  device.decryptWorker.reset();
+  // What was read before it went
+  DeliverPenEvents(device);
+  SendDeviceEvent("deviceRemoved", id);
+  StartReconnect(device);
+}
+
+// Platform thread. Polls until the pad's hidraw node is back and opens,
+// then puts back the report mode and the last screen. Capabilities are the
+// ones read at connect; the hot zones, transform and simplifier settings
+// never left.
+void StuPlugin::StartReconnect(StuDevice& device) {
+  if (device.reconnectThread.joinable()) device.reconnectThread.join();
+  device.reconnectCancel = false;
+  device.reconnectThread = std::thread([this, &device]() {
+    while (!device.reconnectCancel) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(kReconnectPollMs));
+      const auto hidDevices = FindStuDevices();
+      auto hidDevice = std::find_if(hidDevices.begin(), hidDevices.end(),
+                                    [&device](const StuHidDevice& candidate) {
+                                      return DeviceIdOf(candidate) == device.id;
+                                    });
+      if (hidDevice == hidDevices.end()) continue;
+
+      const int64_t startUs = HostTimeUs();
+      bool screenRestored = false;
+      std::lock_guard<std::mutex> lock(device.screenMutex);
+      try {
+        // Fails until udev has set the node's permissions
+        device.tablet.Open(hidDevice->devnode);
+      } catch (...) {
+        continue;
+      }
+      try {
+        if (device.info.penDataOptionMode) {
+          device.tablet.SetPenDataOptionMode(kStuPenDataOptionTimeCountSequence);
+        }
+      } catch (...) {
+        // Older firmware; plain PenData reports still work
+      }
+      if (device.encrypted) {
+        // The session went with the pad; the next one has a new key.
+        // Tried again on the next poll if it fails.
+        bool started = false;
+        try {
+          started = StartEncryptedCapture(device.tablet, device.sessionKey, device.sessionId);
+        } catch (...) {
+        }
+        if (!started) {
+          device.tablet.Close();
+          continue;
+        }
+      }
+      try {
+        if (!device.lastScreen.empty()) {
+          device.tablet.WriteImage((uint8_t)device.lastScreenMode, device.lastScreen.data(),
+                                   device.lastScreen.size());
+          screenRestored = true;
+        }
+      } catch (...) {
+        // The pad is back either way; the next upload tries again
+      }
+      const double reconnectMs = (HostTimeUs() - startUs) / 1000.0;
+      PostToPlatformThread([this, id = device.id, screenRestored, reconnectMs] {
+        FinishReconnect(id, screenRestored, reconnectMs);
+      });
+      return;
+    }
+  });
+}
+
+// Platform thread, once the reconnect thread has the pad open
+void StuPlugin::FinishReconnect(const std::string& id, bool screenRestored, double reconnectMs) {
+  auto it = devices.find(id);
+  if (it == devices.end()) return;
+  StuDevice& device = *it->second;
+  if (device.reconnectThread.joinable()) device.reconnectThread.join();
+  if (!device.lost) return;
+
+  device.lost = false;
+  device.reconnects++;
+  device.lastReconnectMs = reconnectMs;
+  if (device.encrypted) StartDecryptWorker(device);
+  if (!StartReports(device)) {
+    OnDeviceLost(id);
+    return;
+  }
+
+  FlValue* fields = fl_value_new_map();
+  SetDouble(fields, "reconnectMs", reconnectMs);
+  SetDouble(fields, "offlineMs", (HostTimeUs() - device.lostAtUs) / 1000.0);
+  SetBool(fields, "screenRestored", screenRestored);
+  SendDeviceEvent("deviceReconnected", id, fields);
+}
+
+void StuPlugin::SendDeviceEvent(const std::string& type, const std::string& id, FlValue* fields) {
+  FlValue* event = fields ? fields : fl_value_new_map();
+  SetString(event, "type", type);
+  SetString(event, "deviceId", id);
+  SendEvent(event);
+}
+
+void StuPlugin::SetSignatureScreen(StuDevice& device, FlValue* arguments,
+                                   std::unique_ptr<MethodResult> result) {
+  if (!arguments || fl_value_get_type(arguments) != FL_VALUE_TYPE_MAP) {
+    result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+    return;
+  }
+  FlValue* data = FindArg(arguments, "data");
+  FlValue* mode_value = FindArg(arguments, "mode");
+  if (!data || !mode_value) {
+    result->Error("INVALID_ARGUMENTS", "Missing 'data' or 'mode'");
+    return;
+  }
+  if (fl_value_get_type(data) != FL_VALUE_TYPE_UINT8_LIST) {
+    result->Error("INVALID_ARGUMENTS", "'data' must be a byte array");
+    return;
+  }
+  const int mode = (int)GetIntArg(arguments, "mode", 0);
+
+  // "bgr24" (default): data is already in the tablet's format for 'mode'.
+  // "rgba8888" / "bgra8888": 32-bit pixels as dart:ui hands them out,
+  // encoded here for 'mode'. Mode -1 picks the cheapest encoding the model
+  // supports and takes "bgr24" as pixels too.
+  ScreenPixelFormat format = ScreenPixelFormat::kBgr24;
+  const char* format_name = GetStringArg(arguments, "format");
+  const std::string formatName = format_name ? format_name : "bgr24";
+  if (formatName == "rgba8888") format = ScreenPixelFormat::kRgba8888;
+  else if (formatName == "bgra8888") format = ScreenPixelFormat::kBgra8888;
+  else if (formatName != "bgr24") {
+    result->Error("INVALID_ARGUMENTS", "Unknown pixel format '" + formatName + "'");
+    return;
+  }
+
+  // Used when pixels are reduced to 16 or 1 bit
+  ScreenDither dither = ScreenDither::kOrdered;
+  const char* dither_name = GetStringArg(arguments, "dither");
+  if (dither_name && std::string(dither_name) == "none") dither = ScreenDither::kNone;
+  else if (dither_name && std::string(dither_name) == "diffusion") dither = ScreenDither::kDiffusion;
+
+  if (device.lost) {
+    result->Error("NO_DEVICE", "Tablet not connected");
+    return;
+  }
+
+  const bool rawPixels = format != ScreenPixelFormat::kBgr24 || mode == -1;
+  const int bytesPerPixel = format == ScreenPixelFormat::kBgr24 ? 3 : 4;
+  const auto& info = device.info;
+  const size_t size = fl_value_get_length(data);
+  if (rawPixels && size != (size_t)info.screenWidth * info.screenHeight * bytesPerPixel) {
+    result->Error("INVALID_ARGUMENTS", "Image must be " + std::to_string(info.screenWidth) + "x" +
+                                           std::to_string(info.screenHeight) + " pixels");
+    return;
+  }
+
+  // Encoding and the USB transfer run on the screen worker, and the reply
+  // comes back through the wakeup fd. A newer screen replaces one still
+  // waiting.
+  auto upload = std::make_shared<ScreenUpload>();
+  const uint8_t* bytes = fl_value_get_uint8_list(data);
+  upload->data.assign(bytes, bytes + size);
+  upload->mode = mode;
+  upload->format = format;
+  upload->dither = dither;
+  std::shared_ptr<MethodResult> pending(std::move(result));
+  device.screenWorker.Submit(
+      [this, &device, upload](const std::atomic<bool>& cancelled) {
+        return UploadScreen(device, *upload, cancelled);
+      },
+      [this, upload, pending](LatestWinsWorker::Outcome outcome) {
+        PostToPlatformThread([upload, pending, outcome] {
+          if (outcome == LatestWinsWorker::Outcome::kReplaced) {
+            pending->Error("REPLACED", "A newer screen replaced this one");
+          } else if (outcome == LatestWinsWorker::Outcome::kCancelled) {
+            pending->Error("CANCELLED", "Screen upload cancelled");
+          } else if (!upload->errorCode.empty()) {
+            pending->Error(upload->errorCode, upload->errorMessage);
+          } else {
+            FlValue* reply = fl_value_new_map();
+            SetInt(reply, "mode", upload->mode);
+            SetInt(reply, "rects", 1);
+            SetBool(reply, "fullFrame", true);
+            SetBool(reply, "cached", upload->cached);
+            SetInt(reply, "bytes", (int64_t)upload->bytes);
+            SetDouble(reply, "encodeMs", upload->encodeMs);
+            SetDouble(reply, "uploadMs", upload->uploadMs);
+            pending->Success(reply);
+          }
+        });
+      });
+}
+
+// Screen worker thread. Whole frames only: there are no area writes here.
+// Returns false if |cancelled| stopped it early.
+bool StuPlugin::UploadScreen(StuDevice& device, ScreenUpload& upload,
+                             const std::atomic<bool>& cancelled) {
+  std::lock_guard<std::mutex> lock(device.screenMutex);
+  if (cancelled) return false;
+  if (!device.tablet.isOpen()) {
+    upload.errorCode = "NO_DEVICE";
+    upload.errorMessage = "Tablet not connected";
+    return true;
+  }
+
+  const std::vector<uint8_t>& data = upload.data;
+  const ScreenPixelFormat format = upload.format;
+  const ScreenDither dither = upload.dither;
+  const bool rawPixels = format != ScreenPixelFormat::kBgr24 || upload.mode == -1;
+  ScreenFrameEncoder::Frame frame;
+  frame.pixels = data.data();
+  frame.size = data.size();
+  frame.format = format;
+  frame.dither = dither;
+  frame.model = device.info.productId;
+  frame.width = device.info.screenWidth;
+  frame.height = device.info.screenHeight;
+  upload.mode = ScreenFrameEncoder::ResolveMode(upload.mode, device.screenCaps, frame);
+  const int mode = upload.mode;
+
+  // Through the screen cache shared with the other pads
+  const int64_t encodeStart = HostTimeUs();
+  const uint8_t* image = data.data();
+  size_t imageSize = data.size();
+  if (rawPixels) {
+    if (!screenEncoder.Encode(frame, mode, device.screenScratch, upload.cached)) {
+      upload.errorCode = "INVALID_ARGUMENTS";
+      upload.errorMessage = "Unknown encoding mode " + std::to_string(mode);
+      return true;
+    }
+    image = device.screenScratch.data();
+    imageSize = device.screenScratch.size();
+  }
+  if (cancelled) return false;
+
+  const int64_t uploadStart = HostTimeUs();
+  try {
+    device.tablet.WriteImage((uint8_t)mode, image, imageSize);
+  } catch (const std::exception& e) {
+    upload.errorCode = "WRITE_IMAGE_FAILED";
+    upload.errorMessage = e.what();
+    return true;
+  }
+  const int64_t uploadEnd = HostTimeUs();
+  device.lastScreen.assign(image, image + imageSize);
+  device.lastScreenMode = mode;
+
+  upload.bytes = imageSize;
+  upload.encodeMs = (uploadStart - encodeStart) / 1000.0;
+  upload.uploadMs = (uploadEnd - uploadStart) / 1000.0;
+  {
+    std::lock_guard<std::mutex> statsLock(device.screenStatsMutex);
+    auto& stats = device.screenUploadStats[mode];
+    stats.uploads++;
+    stats.bytes += imageSize;
+    stats.encodeMs += upload.encodeMs;
+    stats.uploadMs += upload.uploadMs;
+  }
+  return true;
+}
+
+void StuPlugin::HandleMethodCall(FlMethodCall* call) {
+  const std::string method = fl_method_call_get_name(call);
+  FlValue* args = fl_method_call_get_args(call);
+  auto result = std::make_unique<MethodResult>(call);
+
+  // The pad a per-pad call acts on: its 'deviceId', or the first one
+  // connected
+  StuDevice* device = FindDevice(args);
+
+  if (method == "getDevices") {
+    // Every pad plugged in, connected or not
+    FlValue* reply = fl_value_new_list();
+    for (const auto& hidDevice : FindStuDevices()) {
+      const std::string id = DeviceIdOf(hidDevice);
+      FlValue* entry = fl_value_new_map();
+      SetString(entry, "deviceId", id);
+      SetInt(entry, "vendorId", hidDevice.vendorId);
+      SetInt(entry, "productId", hidDevice.productId);
+      SetInt(entry, "firmware", hidDevice.bcdDevice);
+      SetBool(entry, "connected", devices.count(id) != 0);
+      fl_value_append_take(reply, entry);
+    }
+    result->Success(reply);
+  }
+
+  else if (method == "connect") {
+    const int64_t connectStart = HostTimeUs();
+    const char* requestedId = GetStringArg(args, "deviceId");
+    try {
+      // With no 'deviceId', the first pad found, as with a single pad
+      const auto hidDevices = FindStuDevices();
+      auto hidDevice = hidDevices.begin();
+      for (; requestedId && hidDevice != hidDevices.end(); ++hidDevice) {
+        if (DeviceIdOf(*hidDevice) == requestedId) break;
+      }
+      if (hidDevice == hidDevices.end()) {
+        result->Error("NO_DEVICE", requestedId
+                                       ? "No STU device '" + std::string(requestedId) + "'"
+                                       : std::string("No STU device found"));
+        return;
+      }
+      const std::string id = DeviceIdOf(*hidDevice);
+
+      // Connecting again starts the pad over
+      DisconnectDevice(id);
+
+      auto owned = std::make_unique<StuDevice>();
+      StuDevice& newDevice = *owned;
+      newDevice.id = id;
+      try {
+        newDevice.tablet.Open(hidDevice->devnode);
+      } catch (const std::system_error& e) {
+        result->Error("CONNECTION_FAILED", e.what());
+        return;
+      }
+
+      // A pad seen before under the same firmware is not asked again
+      const DeviceInfo* cached =
+          deviceInfoCache.Find(id, hidDevice->productId, hidDevice->bcdDevice);
+      newDevice.infoCached = cached != nullptr;
+      newDevice.info = cached ? *cached : ReadDeviceInfo(newDevice.tablet, *hidDevice);
+      if (!cached) deviceInfoCache.Store(id, newDevice.info);
+      const DeviceInfo& info = newDevice.info;
+
+      newDevice.screenCaps.zlib = (info.encodingFlag & kStuEncodingZlib) != 0;
+      newDevice.screenCaps.color16 = (info.encodingFlag & kStuEncoding16Bit) != 0;
+      newDevice.screenCaps.color24 = (info.encodingFlag & kStuEncoding24Bit) != 0;
+
+      newDevice.pipeline.strokeTracker.SetThresholds(
+          StrokeTracker::ThresholdsForMaxPressure(info.tabletMaxPressure));
+
+      // Ask for PenDataTimeCountSequence reports where the model has them,
+      // so samples carry the device clock and sequence number.
+      try {
+        if (info.penDataOptionMode) {
+          newDevice.tablet.SetPenDataOptionMode(kStuPenDataOptionTimeCountSequence);
+        }
+      } catch (...) {
+        // Older firmware; plain PenData reports still work
+      }
+
+      // Optional 'encrypted' has the pad encrypt its pen data under a key
+      // agreed now; reports are decrypted off the report loop
+      if (GetBoolArg(args, "encrypted", false)) {
+        if (!newDevice.tablet.IsSupported(kStuReportHostPublicKey)) {
+          result->Error("UNSUPPORTED", "The pad has no encrypted pen data");
+          return;
+        }
+        try {
+          if (!StartEncryptedCapture(newDevice.tablet, newDevice.sessionKey,
+                                     newDevice.sessionId)) {
+            result->Error("ENCRYPTION_FAILED", "The pad did not complete the key exchange");
+            return;
+          }
+        } catch (const std::system_error& e) {
+          result->Error("ENCRYPTION_FAILED", e.what());
+          return;
+        }
+        newDevice.encrypted = true;
+        StartDecryptWorker(newDevice);
+      }
+
+      if (!StartReports(newDevice)) {
+        result->Error("CONNECTION_FAILED", "Cannot watch the pad's reports");
+        return;
+      }
+      devices[id] = std::move(owned);
+      if (!devices.count(defaultDeviceId)) defaultDeviceId = id;
+
+      newDevice.connectMs = (HostTimeUs() - connectStart) / 1000.0;
+
+      FlValue* reply = fl_value_new_map();
+      SetString(reply, "status", "Connected");
+      SetString(reply, "deviceId", id);
+      SetInt(reply, "maxX", info.tabletMaxX);
+      SetInt(reply, "maxY", info.tabletMaxY);
+      SetInt(reply, "maxPressure", info.tabletMaxPressure);
+      SetInt(reply, "screenWidth", info.screenWidth);
+      SetInt(reply, "screenHeight", info.screenHeight);
+      SetInt(reply, "maxReportRate", info.maxReportRate);
+      SetInt(reply, "resolution", info.resolution);
+      SetString(reply, "modelName", info.modelName);
+      SetInt(reply, "firmwareMajor", info.firmwareMajor);
+      SetInt(reply, "firmwareMinor", info.firmwareMinor);
+      SetBool(reply, "secureIc", info.secureIc != 0);
+      SetBool(reply, "color", newDevice.screenCaps.color16 || newDevice.screenCaps.color24);
+      // The pad's own inking is Windows only for now
+      SetBool(reply, "hardwareInkingSupported", false);
+      SetBool(reply, "hardwareInking", false);
+      SetBool(reply, "encrypted", newDevice.encrypted);
+      SetDouble(reply, "connectMs", newDevice.connectMs);
+      SetBool(reply, "infoCached", newDevice.infoCached);
+      result->Success(reply);
+    } catch (const std::exception& e) {
+      result->Error("EXCEPTION", e.what());
+    }
+  }
+
+  else if (method == "disconnect") {
+    // A 'deviceId' disconnects that pad; none disconnects them all
+    if (const char* id = GetStringArg(args, "deviceId")) {
+      DisconnectDevice(id);
+    } else {
+      while (!devices.empty()) DisconnectDevice(devices.begin()->first);
+    }
+    result->Success(fl_value_new_string("Disconnected"));
+  }
+
+  else if (method == "setScreenCacheDirectory") {
+    const char* path = GetStringArg(args, "path");
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    // Loads what earlier runs left there, so the first screens hit
+    result->Success(fl_value_new_bool(screenEncoder.Open(path)));
+  }
+
+  else if (method == "setDeviceCacheDirectory") {
+    const char* path = GetStringArg(args, "path");
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    // Loads the pads earlier runs saw, so connecting them skips the reads
+    result->Success(fl_value_new_bool(deviceInfoCache.Open(path)));
+  }
+
+  else if (method == "clearScreen") {
+    try {
+      if (device) {
+        // Waits out a screen write in progress; the tablet takes one
+        // command sequence at a time
+        std::lock_guard<std::mutex> lock(device->screenMutex);
+        if (device->tablet.isOpen()) device->tablet.SetClearScreen();
+        device->lastScreen.clear();
+      }
+      result->Success(fl_value_new_bool(true));
+    } catch (const std::exception& e) {
+      result->Error("CLEAR_FAILED", e.what());
+    }
+  }
+
+  else if (method == "setHardwareInking") {
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    // Nothing to turn off
+    if (!GetBoolArg(args, "enabled", true)) {
+      result->Success(fl_value_new_bool(true));
+      return;
+    }
+    result->Error("UNSUPPORTED", "Hardware inking is not available on Linux");
+  }
+
+  else if (method == "setSignatureScreen") {
+    // Time spent here is time the Flutter UI cannot run
+    const int64_t callStart = HostTimeUs();
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    SetSignatureScreen(*device, args, std::move(result));
+    const double callMs = (HostTimeUs() - callStart) / 1000.0;
+    screenCalls++;
+    screenCallMs += callMs;
+    screenCallMaxMs = std::max(screenCallMaxMs, callMs);
+  }
+
+  else if (method == "cancelScreenUpload") {
+    // The waiting upload is dropped now; the running one stops before it
+    // writes. Both complete their calls with CANCELLED.
+    if (device) device->screenWorker.Cancel();
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "setSimplifier") {
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    StrokeSimplifier::Config config;
+    config.enabled = GetBoolArg(args, "enabled", true);
+    config.minDistance = (float)GetDoubleArg(args, "minDistance", 0.0);
+    config.tolerance = (float)GetDoubleArg(args, "tolerance", 0.0);
+    config.cornerAngleDeg = (float)GetDoubleArg(args, "cornerAngle", 0.0);
+    config.lookahead = (uint32_t)std::clamp<int64_t>(GetIntArg(args, "lookahead", 8), 2,
+                                                     (int64_t)StrokeSimplifier::kMaxLookahead);
+    device->pipeline.strokeSimplifier.SetConfig(config);
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "setHotZones") {
+    FlValue* zones = FindArg(args, "zones");
+    if (!zones || fl_value_get_type(zones) != FL_VALUE_TYPE_LIST) {
+      result->Error("INVALID_ARGUMENTS", "'zones' must be a list");
+      return;
+    }
+    const size_t zoneCount = fl_value_get_length(zones);
+    if (zoneCount > HotZoneTracker::kMaxZones) {
+      result->Error("INVALID_ARGUMENTS",
+                    "At most " + std::to_string(HotZoneTracker::kMaxZones) + " zones");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    // Each zone is {id, x, y, width, height} in screen pixels; ids are
+    // non-zero and come back as a click's strokeId
+    HotZoneTracker::Config config;
+    for (size_t i = 0; i < zoneCount; ++i) {
+      FlValue* zone = fl_value_get_list_value(zones, i);
+      const int64_t id = GetIntArg(zone, "id", 0);
+      if (id <= 0 || id > UINT32_MAX) {
+        result->Error("INVALID_ARGUMENTS", "Every zone needs a positive 'id'");
+        return;
+      }
+      const ScreenRect rect{(int)GetIntArg(zone, "x", 0), (int)GetIntArg(zone, "y", 0),
+                            (int)GetIntArg(zone, "width", 0), (int)GetIntArg(zone, "height", 0)};
+      config.zones[config.count++] = HotZoneTracker::ZoneFromScreen(
+          (uint32_t)id, rect, device->info.screenWidth, device->info.screenHeight,
+          device->info.tabletMaxX, device->info.tabletMaxY);
+    }
+    config.minPressUs = GetIntArg(args, "minPressMs", config.minPressUs / 1000) * 1000;
+    config.refractoryUs = GetIntArg(args, "refractoryMs", config.refractoryUs / 1000) * 1000;
+    device->pipeline.hotZones.SetConfig(config);
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "startReportRecording") {
+    const char* path = GetStringArg(args, "path");
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    // Replaces a recording already running, which is closed first
+    ReportSessionHeader header;
+    header.productId = device->info.productId;
+    header.tabletMaxX = device->info.tabletMaxX;
+    header.tabletMaxY = device->info.tabletMaxY;
+    header.tabletMaxPressure = device->info.tabletMaxPressure;
+    header.screenWidth = device->info.screenWidth;
+    header.screenHeight = device->info.screenHeight;
+    header.startUs = HostTimeUs();
+    auto recorder = std::make_unique<ReportSessionWriter>();
+    if (!recorder->Open(path, header)) {
+      result->Error("RECORDING_FAILED", "Cannot create '" + std::string(path) + "'");
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(device->recorderMutex);
+      device->recorder = std::move(recorder);
+    }
+    device->recording = true;
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "stopReportRecording") {
+    std::unique_ptr<ReportSessionWriter> recorder;
+    if (device) {
+      device->recording = false;
+      std::lock_guard<std::mutex> lock(device->recorderMutex);
+      recorder = std::move(device->recorder);
+    }
+    if (!recorder) {
+      result->Success();
+      return;
+    }
+    if (!recorder->Close()) {
+      result->Error("RECORDING_FAILED", "Session file write failed");
+      return;
+    }
+    FlValue* reply = fl_value_new_map();
+    SetInt(reply, "reports", (int64_t)recorder->reports());
+    SetInt(reply, "bytes", (int64_t)recorder->bytes());
+    result->Success(reply);
+  }
+
+  else if (method == "setPenTransform") {
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!GetBoolArg(args, "enabled", true)) {
+      if (device) device->penTransform.Clear();
+      result->Success(fl_value_new_bool(true));
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    // 'matrix' is [a, b, c, d, e, f]: x' = a*x + b*y + c, y' = d*x + e*y + f
+    FlValue* matrix = FindArg(args, "matrix");
+    if (!matrix || fl_value_get_type(matrix) != FL_VALUE_TYPE_FLOAT_LIST ||
+        fl_value_get_length(matrix) != 6) {
+      result->Error("INVALID_ARGUMENTS", "'matrix' must be 6 doubles");
+      return;
+    }
+    const double* m = fl_value_get_float_list(matrix);
+    PenTransform::Config config;
+    config.a = m[0];
+    config.b = m[1];
+    config.c = m[2];
+    config.d = m[3];
+    config.e = m[4];
+    config.f = m[5];
+    FlValue* curve = FindArg(args, "pressureCurve");
+    if (curve && fl_value_get_type(curve) == FL_VALUE_TYPE_FLOAT_LIST) {
+      const double* points = fl_value_get_float_list(curve);
+      config.pressureCurve.assign(points, points + fl_value_get_length(curve));
+    }
+    // {x, y, width, height} in target units
+    FlValue* clamp = FindArg(args, "clamp");
+    if (clamp && fl_value_get_type(clamp) == FL_VALUE_TYPE_MAP) {
+      config.clamp = true;
+      config.minX = GetDoubleArg(clamp, "x", 0.0);
+      config.minY = GetDoubleArg(clamp, "y", 0.0);
+      config.maxX = config.minX + GetDoubleArg(clamp, "width", 0.0);
+      config.maxY = config.minY + GetDoubleArg(clamp, "height", 0.0);
+    }
+    if (!device->penTransform.Configure(config, device->info.tabletMaxX, device->info.tabletMaxY,
+                                        device->info.tabletMaxPressure)) {
+      result->Error("INVALID_ARGUMENTS", "Transform scales too far for fixed point");
+      return;
+    }
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "clearStrokes") {
+    if (device) device->inkStore.Clear();
+    result->Success(fl_value_new_bool(true));
+  }
+
+  else if (method == "renderSignature") {
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    FlValue* ids = FindArg(args, "strokeIds");
+    if (!ids || fl_value_get_type(ids) != FL_VALUE_TYPE_LIST) {
+      result->Error("INVALID_ARGUMENTS", "'strokeIds' must be a list");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    std::vector<const std::vector<InkPoint>*> strokes;
+    for (size_t i = 0; i < fl_value_get_length(ids); ++i) {
+      FlValue* id = fl_value_get_list_value(ids, i);
+      const int64_t strokeId =
+          fl_value_get_type(id) == FL_VALUE_TYPE_INT ? fl_value_get_int(id) : -1;
+      const auto* points = strokeId >= 0 ? device->inkStore.Find((uint32_t)strokeId) : nullptr;
+      if (!points) {
+        result->Error("UNKNOWN_STROKE", "Stroke " + std::to_string(strokeId) +
+                                            " is not in the native ink store");
+        return;
+      }
+      strokes.push_back(points);
+    }
+
+    // Width/height and stroke widths are logical pixels; dpi scales them
+    const double scale = GetDoubleArg(args, "dpi", 96.0) / 96.0;
+    RasterOptions options;
+    options.width = (int)std::lround(GetDoubleArg(args, "width", 400.0) * scale);
+    options.height = (int)std::lround(GetDoubleArg(args, "height", 200.0) * scale);
+    if (options.width <= 0 || options.height <= 0 || options.width > 8192 ||
+        options.height > 8192) {
+      result->Error("INVALID_ARGUMENTS", "Output size out of range");
+      return;
+    }
+    options.scaleX = (double)options.width / device->info.tabletMaxX;
+    options.scaleY = (double)options.height / device->info.tabletMaxY;
+    options.minRadius = (float)(GetDoubleArg(args, "minWidth", 1.2) * scale / 2.0);
+    options.maxRadius = (float)(GetDoubleArg(args, "maxWidth", 2.8) * scale / 2.0);
+    options.maxPressure = device->info.tabletMaxPressure;
+    options.color = (uint32_t)GetIntArg(args, "color", 0xFF000000);
+
+    // "fast", "balanced" (default) or "smallest"
+    PngOptions pngOptions;
+    const char* preset = GetStringArg(args, "preset");
+    if (preset && std::string(preset) == "fast") pngOptions.preset = PngPreset::kFast;
+    else if (preset && std::string(preset) == "smallest") pngOptions.preset = PngPreset::kSmallest;
+
+    const auto rgba = RasterizeStrokes(strokes, options);
+    const auto png =
+        EncodePng(rgba.data(), options.width, options.height, (size_t)options.width * 4, pngOptions);
+    result->Success(fl_value_new_uint8_list(png.data(), png.size()));
+  }
+
+  else if (method == "getPipelineStats") {
+    FlValue* reply = fl_value_new_map();
+    SetInt(reply, "eventsSent", (int64_t)eventsSent);
+    SetInt(reply, "wakeupsPosted", (int64_t)wakeupsPosted.load());
+    SetInt(reply, "wakeupsHandled", (int64_t)wakeupsHandled);
+
+    // Platform thread time per setSignatureScreen call, i.e. UI stall
+    SetInt(reply, "screenCalls", (int64_t)screenCalls);
+    SetDouble(reply, "screenCallMs", screenCallMs);
+    SetDouble(reply, "screenCallMaxMs", screenCallMaxMs);
+
+    {
+      const auto cacheStats = screenEncoder.stats();
+      SetInt(reply, "screenCacheHits", (int64_t)cacheStats.hits);
+      SetInt(reply, "screenCacheDiskHits", (int64_t)cacheStats.diskHits);
+      SetInt(reply, "screenCacheMisses", (int64_t)cacheStats.misses);
+      SetInt(reply, "screenCacheEntries", (int64_t)cacheStats.entries);
+      SetInt(reply, "screenCacheBytes", (int64_t)cacheStats.bytes);
+    }
+
+    const auto infoStats = deviceInfoCache.stats();
+    SetInt(reply, "deviceInfoCacheHits", (int64_t)infoStats.hits);
+    SetInt(reply, "deviceInfoCacheStale", (int64_t)infoStats.stale);
+    SetInt(reply, "deviceInfoCacheMisses", (int64_t)infoStats.misses);
+
+    // The rest are the pad's; with none connected only the above
+    if (!device) {
+      result->Success(reply);
+      return;
+    }
+    SetString(reply, "deviceId", device->id);
+
+    const auto ringStats = device->pipeline.ring.stats();
+    SetInt(reply, "samplesQueued", (int64_t)ringStats.pushed);
+    SetInt(reply, "samplesDropped", (int64_t)ringStats.dropped);
+    SetInt(reply, "queueHighWater", (int64_t)ringStats.highWater);
+    SetInt(reply, "queueCapacity", (int64_t)PenSampleRing::capacity());
+    SetInt(reply, "samplesDelivered", (int64_t)device->samplesDelivered);
+    SetInt(reply, "reportsRead", (int64_t)device->reportsRead.load());
+    // The report loop is shared by every pad, so these two are all pads'
+    SetInt(reply, "reportWakeups", (int64_t)reportLoop.wakeups());
+    SetDouble(reply, "reportThreadCpuMs", reportLoop.CpuMs());
+    SetDouble(reply, "connectMs", device->connectMs);
+    SetBool(reply, "infoCached", device->infoCached);
+    SetInt(reply, "reconnects", (int64_t)device->reconnects);
+    SetDouble(reply, "lastReconnectMs", device->lastReconnectMs);
+
+    const auto clockStats = device->clockEstimator.stats();
+    SetInt(reply, "clockSamples", (int64_t)clockStats.samples);
+    SetInt(reply, "clockResets", (int64_t)clockStats.resets);
+    SetDouble(reply, "clockDriftPpm", clockStats.driftPpm);
+    SetDouble(reply, "clockMeanDelayUs", clockStats.meanDelayUs);
+
+    // Reports lost between the pad and the report loop, by sequence
+    // number; short gaps come back as synthetic samples. maxReportRate is
+    // the pad's capability, in reports per second.
+    const auto gapStats = device->pipeline.gapFiller.stats();
+    SetInt(reply, "maxReportRate", device->info.maxReportRate);
+    SetInt(reply, "sequenceGaps", (int64_t)gapStats.gaps);
+    SetInt(reply, "reportsMissing", (int64_t)gapStats.missing);
+    SetInt(reply, "samplesInterpolated", (int64_t)gapStats.filled);
+    SetInt(reply, "largestSequenceGap", (int64_t)gapStats.largestGap);
+
+    // Since the session started, i.e. the last connect or reconnect
+    SetBool(reply, "encrypted", device->encrypted);
+    if (device->decryptWorker) {
+      const auto decryptStats = device->decryptWorker->stats();
+      SetInt(reply, "decryptReports", (int64_t)decryptStats.reports);
+      SetInt(reply, "decryptDropped", (int64_t)decryptStats.dropped);
+      SetInt(reply, "decryptBatches", (int64_t)decryptStats.batches);
+      SetInt(reply, "decryptBlocks", (int64_t)decryptStats.blocks);
+      SetInt(reply, "decryptSessionMismatches", (int64_t)decryptStats.sessionMismatches);
+      SetDouble(reply, "decryptMs", decryptStats.decryptMs);
+      SetBool(reply, "decryptHardware", decryptStats.hardware);
+    }
+
+    const auto simplifierStats = device->pipeline.strokeSimplifier.stats();
+    SetInt(reply, "simplifierPointsIn", (int64_t)simplifierStats.pointsIn);
+    SetInt(reply, "simplifierPointsOut", (int64_t)simplifierStats.pointsOut);
+    SetDouble(reply, "simplifierMaxError", simplifierStats.maxError);
+
+    const auto hotZoneStats = device->pipeline.hotZones.stats();
+    SetInt(reply, "hotZoneSamplesDropped", (int64_t)hotZoneStats.dropped);
+    SetInt(reply, "hotZoneClicks", (int64_t)hotZoneStats.clicks);
+    SetInt(reply, "hotZoneBounces", (int64_t)hotZoneStats.bounces);
+
+    // Keyed by encoding name: uploads, partialUploads, bytes, encodeMs,
+    // uploadMs; whole frames only here, so partialUploads stays 0
+    std::lock_guard<std::mutex> statsLock(device->screenStatsMutex);
+    FlValue* screenUploads = fl_value_new_map();
+    for (const auto& [mode, stats] : device->screenUploadStats) {
+      FlValue* entry = fl_value_new_map();
+      SetInt(entry, "uploads", (int64_t)stats.uploads);
+      SetInt(entry, "partialUploads", 0);
+      SetInt(entry, "bytes", (int64_t)stats.bytes);
+      SetDouble(entry, "encodeMs", stats.encodeMs);
+      SetDouble(entry, "uploadMs", stats.uploadMs);
+      fl_value_set_string_take(screenUploads, ScreenEncodingName((ScreenEncoding)mode), entry);
+    }
+    fl_value_set_string_take(reply, "screenUploads", screenUploads);
+    result->Success(reply);
+  }
+
+  else {
+    result->NotImplemented();
+  }
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "decrypt_worker.h"
+#include "device_clock_estimator.h"
+#include "device_info_cache.h"
+#include "hot_zones.h"
+#include "ink_store.h"
+#include "latest_wins_worker.h"
+#include "pen_pipeline.h"
+#include "pen_sample.h"
+#include "pen_transform.h"
+#include "report_decoder.h"
+#include "report_loop.h"
+#include "report_session.h"
+#include "screen_frame_encoder.h"
+#include "screen_image.h"
+#include "session_key_exchange.h"
+#include "stroke_simplifier.h"
+#include "stroke_tracker.h"
+#include "stu_tablet.h"
+
+// The Linux side of the plugin: the same wacom_stu_channel methods and
+// wacom_stu_events events as on Windows, over hidraw instead of the Wacom
+// SDK. The pipeline after decoding (stroke tracker, hot zones, simplifier,
+// ring, frames, ink store) is the shared code from windows/.
+//
+// Threads: the GLib main loop is the platform thread. One ReportLoop
+// thread reads every pad; each pad has a screen worker, and a reconnect
+// thread while it is unplugged.
+
+// A method call's reply, as flutter::MethodResult is on Windows. Holds the
+// call, so a screen upload can reply once it is done.
+class MethodResult {
+ public:
+  explicit MethodResult(FlMethodCall* call);
+  ~MethodResult();
+
+  MethodResult(const MethodResult&) = delete;
+  MethodResult& operator=(const MethodResult&) = delete;
+
+  // Takes |value|; null replies null
+  void Success(FlValue* value = nullptr);
+  void Error(const std::string& code, const std::string& message);
+  void NotImplemented();
+
+ private:
+  FlMethodCall* call_;
+};
+
+// One connected pad. Hardware inking and dirty-rectangle uploads are
+// Windows only for now, so there is no screen shadow or ink state here.
+struct StuDevice {
+  // StuDeviceId; tags the pad's events and picks it in method calls
+  std::string id;
+
+  // Commands go through the tablet under screenMutex: the screen worker's
+  // uploads, clearScreen and the reconnect thread's reopening. Closed
+  // while the pad is gone.
+  StuTablet tablet;
+
+  // Set on the platform thread when the pad goes away, cleared when it is
+  // back. The reconnect thread polls for it in between.
+  bool lost = false;
+  int64_t lostAtUs = 0;
+  std::thread reconnectThread;
+  std::atomic<bool> reconnectCancel{false};
+  uint64_t reconnects = 0;
+  double lastReconnectMs = 0;
+
+  // Capability and information of the pad, read at connect or taken from
+  // the plugin's DeviceInfoCache
+  DeviceInfo info;
+  // Screen encodings the model accepts, for mode 'auto'
+  ScreenCapabilities screenCaps;
+  double connectMs = 0;
+  bool infoCached = false;
+
+  // Screen uploads run here, latest wins, each holding screenMutex
+  LatestWinsWorker screenWorker;
+  std::mutex screenMutex;
+  // Reused buffer for screens encoded natively
+  std::vector<uint8_t> screenScratch;
+  // The last image written, as sent, to put back on a pad that was
+  // unplugged; empty after a clear
+  std::vector<uint8_t> lastScreen;
+  int lastScreenMode = 0;
+
+  // Per encoding mode, for getPipelineStats, under screenStatsMutex
+  std::mutex screenStatsMutex;
+  struct ScreenUploadStats {
+    uint64_t uploads = 0;
+    uint64_t bytes = 0;
+    double encodeMs = 0;
+    double uploadMs = 0;
+  };
+  std::map<int, ScreenUploadStats> screenUploadStats;
+
+  // Encrypted capture, as on Windows: the thread that opens the tablet
+  // runs the key exchange and leaves the session here, and the platform
+  // thread makes it the decrypt worker before reports are watched. While
+  // the worker is set it gets every report and runs the pipeline below.
+  bool encrypted = false;
+  SessionKeyExchange::Key sessionKey{};
+  uint32_t sessionId = 0;
+  std::unique_ptr<DecryptWorker> decryptWorker;
+
+  // Report loop thread from here on
+  std::atomic<uint64_t> reportsRead{0};
+  // Capture mode, as on Windows: every raw report also goes to a session
+  // file. Swapped on the platform thread under recorderMutex.
+  std::mutex recorderMutex;
+  std::unique_ptr<ReportSessionWriter> recorder;
+  std::atomic<bool> recording{false};
+  DeviceClockEstimator clockEstimator;
+  PenReportDecoder reportDecoder{&clockEstimator};
+  // Decoded samples to the platform thread, as on Windows
+  PenPipeline pipeline;
+  uint64_t samplesDelivered = 0;
+
+  // Tablet to drawing space for packed frames, set via setPenTransform
+  PenTransform penTransform;
+
+  // Every ink sample delivered to Dart, for renderSignature
+  InkStore inkStore;
+};
+
+class StuPlugin {
+ public:
+  StuPlugin(FlMethodChannel* channel, FlEventChannel* eventChannel);
+  ~StuPlugin();
+
+  StuPlugin(const StuPlugin&) = delete;
+  StuPlugin& operator=(const StuPlugin&) = delete;
+
+  void HandleMethodCall(FlMethodCall* call);
+
+  // wacom_stu_events listener coming and going
+  FlMethodErrorResponse* OnListen(FlValue* arguments);
+  FlMethodErrorResponse* OnCancel();
+
+ private:
+  // Pads by StuDeviceId, platform thread only
+  std::map<std::string, std::unique_ptr<StuDevice>> devices;
+  // Used by calls that name no deviceId, as on Windows
+  std::string defaultDeviceId;
+  StuDevice* FindDevice(FlValue* arguments);
+  void DisconnectDevice(const std::string& id);
+
+  // Puts the pad's fd on the report loop; false if epoll refused it
+  bool StartReports(StuDevice& device);
+  void StartDecryptWorker(StuDevice& device);
+  void OnReport(StuDevice& device, const uint8_t* data, size_t size, int64_t hostUs);
+  void OnPenSample(StuDevice& device, const PenSample& sample);
+  void DeliverPenEvents();
+  void DeliverPenEvents(StuDevice& device);
+
+  // One setSignatureScreen call, handed to the screen worker
+  struct ScreenUpload {
+    std::vector<uint8_t> data;
+    int mode = 0;
+    ScreenPixelFormat format = ScreenPixelFormat::kBgr24;
+    ScreenDither dither = ScreenDither::kOrdered;
+    // Filled in by UploadScreen; an empty errorCode means success
+    bool cached = false;
+    size_t bytes = 0;
+    double encodeMs = 0;
+    double uploadMs = 0;
+    std::string errorCode;
+    std::string errorMessage;
+  };
+  void SetSignatureScreen(StuDevice& device, FlValue* arguments,
+                          std::unique_ptr<MethodResult> result);
+  bool UploadScreen(StuDevice& device, ScreenUpload& upload, const std::atomic<bool>& cancelled);
+
+  // Hotplug. A pad that goes away stays in |devices| and its reconnect
+  // thread watches for it under /sys/class/hidraw, as there are no device
+  // notifications without udev.
+  void OnDeviceLost(const std::string& id);
+  void StartReconnect(StuDevice& device);
+  void FinishReconnect(const std::string& id, bool screenRestored, double reconnectMs);
+  void SendDeviceEvent(const std::string& type, const std::string& id, FlValue* fields = nullptr);
+  // Sends |event| to the listener, if any, and drops it
+  void SendEvent(FlValue* event);
+
+  // Any thread
+  void PostToPlatformThread(std::function<void()> task);
+  void PostWakeup();
+  // Platform thread, when the wakeup fd is signalled
+  static gboolean OnWakeupFd(gint fd, GIOCondition condition, gpointer user_data);
+  void RunPlatformTasks();
+
+  FlMethodChannel* channel;
+  FlEventChannel* eventChannel;
+  bool listening = false;
+
+  ReportLoop reportLoop;
+  DeviceInfoCache deviceInfoCache;
+
+  // Encoded full frames, shared by every pad's screen worker
+  ScreenFrameEncoder screenEncoder;
+
+  // Platform thread time spent in setSignatureScreen
+  uint64_t screenCalls = 0;
+  double screenCallMs = 0;
+  double screenCallMaxMs = 0;
+
+  // Event delivery format, chosen by the listener's arguments
+  bool batchedEvents = false;
+  bool deltaFrames = false;
+  std::vector<PenSample> drainScratch;
+  std::vector<int32_t> frameScratch;
+  std::vector<uint8_t> deltaScratch;
+  std::vector<int32_t> mappedX;
+  std::vector<int32_t> mappedY;
+  std::vector<int32_t> mappedPressure;
+  uint64_t eventsSent = 0;
+
+  // The main loop watches an eventfd in place of the Windows wakeup
+  // window. The report loop signals it only when no wakeup is outstanding;
+  // posted tasks signal it every time.
+  int wakeupFd = -1;
+  guint wakeupSource = 0;
+  std::atomic<bool> wakeupPending{false};
+  std::atomic<uint64_t> wakeupsPosted{0};
+  uint64_t wakeupsHandled = 0;
+  std::mutex platformTaskMutex;
+  std::vector<std::function<void()>> platformTasks;
+};
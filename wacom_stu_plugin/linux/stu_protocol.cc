@@ -0,0 +1,133 @@
+#include "stu_protocol.h"
+
+#include <algorithm>
+
+namespace {
+
+uint16_t Be16(const uint8_t* p) { return uint16_t(p[0] << 8 | p[1]); }
+
+uint32_t Be32(const uint8_t* p) {
+  return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+// Item tags, prefix bits 4-7, with the type in bits 2-3
+constexpr uint8_t kMainInput = 0x80;
+constexpr uint8_t kMainOutput = 0x90;
+constexpr uint8_t kMainFeature = 0xB0;
+constexpr uint8_t kGlobalReportSize = 0x74;
+constexpr uint8_t kGlobalReportId = 0x84;
+constexpr uint8_t kGlobalReportCount = 0x94;
+constexpr uint8_t kGlobalPush = 0xA4;
+constexpr uint8_t kGlobalPop = 0xB4;
+constexpr uint8_t kLongItem = 0xFE;
+
+}  // namespace
+
+bool ParseStuCapability(const uint8_t* report, size_t size, StuCapability& out) {
+  if (size < 1 + kStuCapabilitySize || report[0] != kStuReportCapability) return false;
+  const uint8_t* p = report + 1;
+  out.tabletMaxX = Be16(p);
+  out.tabletMaxY = Be16(p + 2);
+  out.tabletMaxPressure = Be16(p + 4);
+  out.screenWidth = Be16(p + 6);
+  out.screenHeight = Be16(p + 8);
+  out.maxReportRate = p[10];
+  out.resolution = Be16(p + 11);
+  out.encodingFlag = p[13];
+  return true;
+}
+
+bool ParseStuInformation(const uint8_t* report, size_t size, StuInformation& out) {
+  if (size < 1 + kStuInformationSize || report[0] != kStuReportInformation) return false;
+  const uint8_t* p = report + 1;
+  // Seven characters, NUL padded
+  out.modelName.assign(p, std::find(p, p + 7, '\0'));
+  out.firmwareMajor = p[7];
+  out.firmwareMinor = p[8];
+  out.secureIc = p[9];
+  out.secureIcVersion = Be32(p + 10);
+  return true;
+}
+
+bool ParseStuStatus(const uint8_t* report, size_t size, StuStatus& out) {
+  if (size < 1 + kStuStatusSize || report[0] != kStuReportStatus) return false;
+  out.statusCode = report[1];
+  out.lastResultCode = report[2];
+  out.statusWord = Be16(report + 3);
+  return true;
+}
+
+bool ParseHidReportDescriptor(const uint8_t* descriptor, size_t size, HidReportSizes& sizes) {
+  // Bits per report id as the main items add up, then bytes at the end
+  struct Globals {
+    uint32_t reportSize = 0;
+    uint32_t reportCount = 0;
+    uint8_t reportId = 0;
+  };
+  Globals globals;
+  Globals stack[8];
+  size_t depth = 0;
+  uint32_t inputBits[256] = {};
+  uint32_t outputBits[256] = {};
+  uint32_t featureBits[256] = {};
+  bool numbered = false;
+
+  size_t i = 0;
+  while (i < size) {
+    const uint8_t prefix = descriptor[i];
+    if (prefix == kLongItem) {
+      if (i + 1 >= size) return false;
+      i += 3 + descriptor[i + 1];
+      continue;
+    }
+    const size_t dataSize = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+    if (i + 1 + dataSize > size) return false;
+    uint32_t value = 0;
+    for (size_t b = 0; b < dataSize; ++b) value |= uint32_t(descriptor[i + 1 + b]) << (8 * b);
+    i += 1 + dataSize;
+
+    switch (prefix & 0xFC) {
+      case kGlobalReportSize:
+        globals.reportSize = value;
+        break;
+      case kGlobalReportCount:
+        globals.reportCount = value;
+        break;
+      case kGlobalReportId:
+        globals.reportId = uint8_t(value);
+        numbered = true;
+        break;
+      case kGlobalPush:
+        if (depth < 8) stack[depth++] = globals;
+        break;
+      case kGlobalPop:
+        if (depth > 0) globals = stack[--depth];
+        break;
+      case kMainInput:
+        inputBits[globals.reportId] += globals.reportSize * globals.reportCount;
+        break;
+      case kMainOutput:
+        outputBits[globals.reportId] += globals.reportSize * globals.reportCount;
+        break;
+      case kMainFeature:
+        featureBits[globals.reportId] += globals.reportSize * globals.reportCount;
+        break;
+      default:
+        break;
+    }
+  }
+
+  bool any = false;
+  const uint32_t idBytes = numbered ? 1 : 0;
+  auto bytes = [&any, idBytes](uint32_t bits) -> uint16_t {
+    if (!bits) return 0;
+    any = true;
+    return uint16_t(std::min<uint32_t>((bits + 7) / 8 + idBytes, UINT16_MAX));
+  };
+  for (int id = 0; id < 256; ++id) {
+    sizes.input[id] = bytes(inputBits[id]);
+    sizes.output[id] = bytes(outputBits[id]);
+    sizes.feature[id] = bytes(featureBits[id]);
+  }
+  return any;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The parts of the STU USB protocol the Linux plugin speaks over hidraw.
+// On Windows these come from the Wacom SDK; there is no SDK here, so the
+// report ids and layouts the plugin uses are spelled out. Pen reports are
+// decoded by the shared PenReportDecoder. Multi-byte fields are big-endian
+// unless noted.
+
+enum StuReportId : uint8_t {
+  // Input reports, read from the pad
+  kStuReportPenData = 0x01,
+  kStuReportPenDataEncrypted = 0x10,
+  kStuReportPenDataOption = 0x30,
+  kStuReportPenDataEncryptedOption = 0x31,
+  kStuReportPenDataTimeCountSequenceEncrypted = 0x33,
+  kStuReportPenDataTimeCountSequence = 0x34,
+  // Feature reports
+  kStuReportStatus = 0x03,
+  kStuReportInformation = 0x08,
+  kStuReportCapability = 0x09,
+  // Encrypted capture: the key exchange, then the capture under a session
+  // id
+  kStuReportHostPublicKey = 0x13,
+  kStuReportDevicePublicKey = 0x14,
+  kStuReportStartCapture = 0x15,
+  kStuReportEndCapture = 0x16,
+  kStuReportDHprime = 0x1A,
+  kStuReportDHbase = 0x1B,
+  kStuReportClearScreen = 0x20,
+  kStuReportInkingMode = 0x21,
+  kStuReportStartImageDataArea = 0x22,
+  kStuReportStartImageData = 0x25,
+  kStuReportImageDataBlock = 0x26,
+  kStuReportEndImageData = 0x27,
+  kStuReportPenDataOptionMode = 0x32,
+};
+
+// Status report's statusCode
+enum StuStatusCode : uint8_t {
+  kStuStatusReady = 0x00,
+  kStuStatusImage = 0x01,
+  kStuStatusCapture = 0x02,
+  kStuStatusCalculation = 0x03,
+  kStuStatusImageBoot = 0x04,
+  kStuStatusRomBusy = 0x10,
+  kStuStatusSystemReset = 0xFF,
+};
+
+// Capability's encodingFlag bits
+enum StuEncodingFlag : uint8_t {
+  kStuEncodingZlib = 0x01,
+  kStuEncoding1Bit = 0x02,
+  kStuEncoding16Bit = 0x04,
+  kStuEncoding24Bit = 0x08,
+};
+
+// PenDataOptionMode values; TimeCountSequence makes the pad send
+// kStuReportPenDataTimeCountSequence
+enum StuPenDataOptionMode : uint8_t {
+  kStuPenDataOptionNone = 0x00,
+  kStuPenDataOptionTimeCount = 0x01,
+  kStuPenDataOptionSequenceNumber = 0x02,
+  kStuPenDataOptionTimeCountSequence = 0x03,
+};
+
+// Feature report payloads, after the report id
+struct StuCapability {
+  uint16_t tabletMaxX = 0;
+  uint16_t tabletMaxY = 0;
+  uint16_t tabletMaxPressure = 0;
+  uint16_t screenWidth = 0;
+  uint16_t screenHeight = 0;
+  uint8_t maxReportRate = 0;
+  uint16_t resolution = 0;
+  uint8_t encodingFlag = 0;
+};
+
+struct StuInformation {
+  std::string modelName;
+  uint8_t firmwareMajor = 0;
+  uint8_t firmwareMinor = 0;
+  uint8_t secureIc = 0;
+  uint32_t secureIcVersion = 0;
+};
+
+struct StuStatus {
+  uint8_t statusCode = 0;
+  uint8_t lastResultCode = 0;
+  uint16_t statusWord = 0;
+};
+
+// Payload sizes, report id excluded
+constexpr size_t kStuCapabilitySize = 14;
+constexpr size_t kStuInformationSize = 14;
+constexpr size_t kStuStatusSize = 4;
+constexpr size_t kStuKeySize = 16;
+constexpr size_t kStuDHbaseSize = 2;
+constexpr size_t kStuStartCaptureSize = 4;
+constexpr size_t kStuEndCaptureSize = 1;
+// A public key, or the key exchange's prime
+using StuKey = std::array<uint8_t, kStuKeySize>;
+// ImageDataBlock's header: the block's length, low byte first
+constexpr size_t kStuImageBlockHeader = 2;
+
+// Each takes a whole feature report, report id first; false if it is the
+// wrong report or too short
+bool ParseStuCapability(const uint8_t* report, size_t size, StuCapability& out);
+bool ParseStuInformation(const uint8_t* report, size_t size, StuInformation& out);
+bool ParseStuStatus(const uint8_t* report, size_t size, StuStatus& out);
+
+// Byte size of each report a pad declares in its HID report descriptor,
+// report id included; 0 for a report id it does not declare, i.e. one it
+// does not support. Fixed arrays, so parsing allocates nothing.
+struct HidReportSizes {
+  uint16_t input[256] = {};
+  uint16_t output[256] = {};
+  uint16_t feature[256] = {};
+};
+
+// Short items only, as STU descriptors are; long items are skipped. False
+// if the descriptor is cut short or declares no reports.
+bool ParseHidReportDescriptor(const uint8_t* descriptor, size_t size, HidReportSizes& sizes);
@@ -0,0 +1,295 @@
+#include "stu_tablet.h"
+
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint16_t kWacomVendorId = 0x056A;
+constexpr uint16_t kStuProductMin = 0x00A0;
+constexpr uint16_t kStuProductMax = 0x00AF;
+
+// How long a pad may stay busy before a command gives up. Image writes on
+// the larger colour models take the longest.
+constexpr auto kStatusTimeout = std::chrono::seconds(5);
+constexpr auto kStatusPoll = std::chrono::milliseconds(1);
+
+// EndImageData's flag
+constexpr uint8_t kEndImageCommit = 0x00;
+constexpr uint8_t kEndImageAbandon = 0x01;
+
+std::string ReportName(uint8_t id) {
+  char name[8];
+  std::snprintf(name, sizeof(name), "0x%02x", unsigned(id));
+  return name;
+}
+
+[[noreturn]] void ThrowErrno(int error, const std::string& what) {
+  throw std::system_error(error, std::generic_category(), what);
+}
+
+std::string ReadLine(const fs::path& path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+}  // namespace
+
+std::vector<StuHidDevice> FindStuDevices(const std::string& sysfsRoot) {
+  std::vector<StuHidDevice> found;
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(sysfsRoot, ec)) {
+    StuHidDevice device;
+    bool hasId = false;
+    // HID_ID=0003:0000056A:000000A8 is bus, vendor and product
+    std::ifstream uevent(entry.path() / "device" / "uevent");
+    std::string line;
+    while (std::getline(uevent, line)) {
+      unsigned bus = 0, vendor = 0, product = 0;
+      if (std::sscanf(line.c_str(), "HID_ID=%x:%x:%x", &bus, &vendor, &product) == 3) {
+        device.vendorId = uint16_t(vendor);
+        device.productId = uint16_t(product);
+        hasId = true;
+      } else if (line.rfind("HID_PHYS=", 0) == 0) {
+        device.phys = line.substr(9);
+      }
+    }
+    if (!hasId || device.vendorId != kWacomVendorId || device.productId < kStuProductMin ||
+        device.productId > kStuProductMax) {
+      continue;
+    }
+    device.devnode = "/dev/" + entry.path().filename().string();
+    // The HID device sits under the USB interface, which sits under the
+    // USB device
+    const fs::path hid = fs::canonical(entry.path() / "device", ec);
+    if (!ec) {
+      const std::string bcd = ReadLine(hid.parent_path().parent_path() / "bcdDevice");
+      device.bcdDevice = uint16_t(std::strtoul(bcd.c_str(), nullptr, 16));
+    }
+    if (device.phys.empty()) device.phys = device.devnode;
+    found.push_back(std::move(device));
+  }
+  std::sort(found.begin(), found.end(), [](const StuHidDevice& a, const StuHidDevice& b) {
+    return a.devnode < b.devnode;
+  });
+  return found;
+}
+
+StuTablet::~StuTablet() { Close(); }
+
+void StuTablet::Open(const std::string& devnode) {
+  Close();
+  const int fd = ::open(devnode.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) ThrowErrno(errno, "Cannot open " + devnode);
+
+  int descriptorSize = 0;
+  hidraw_report_descriptor descriptor{};
+  if (::ioctl(fd, HIDIOCGRDESCSIZE, &descriptorSize) < 0 || descriptorSize <= 0 ||
+      descriptorSize > HID_MAX_DESCRIPTOR_SIZE) {
+    const int error = errno ? errno : EPROTO;
+    ::close(fd);
+    ThrowErrno(error, "Cannot read the report descriptor of " + devnode);
+  }
+  descriptor.size = uint32_t(descriptorSize);
+  if (::ioctl(fd, HIDIOCGRDESC, &descriptor) < 0 ||
+      !ParseHidReportDescriptor(descriptor.value, descriptor.size, sizes_)) {
+    const int error = errno ? errno : EPROTO;
+    ::close(fd);
+    ThrowErrno(error, "Cannot read the report descriptor of " + devnode);
+  }
+  fd_ = fd;
+  devnode_ = devnode;
+}
+
+void StuTablet::Close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+bool StuTablet::IsSupported(uint8_t reportId) const {
+  return sizes_.feature[reportId] != 0 || sizes_.input[reportId] != 0;
+}
+
+const std::vector<uint8_t>& StuTablet::GetFeature(uint8_t id) {
+  if (fd_ < 0) ThrowErrno(ENODEV, "Tablet not connected");
+  const size_t size = sizes_.feature[id];
+  if (!size) ThrowErrno(ENOTSUP, "Report " + ReportName(id) + " is not supported");
+  featureScratch_.assign(size, 0);
+  featureScratch_[0] = id;
+  int read;
+  do {
+    read = ::ioctl(fd_, HIDIOCGFEATURE(size), featureScratch_.data());
+  } while (read < 0 && errno == EINTR);
+  if (read < 0) ThrowErrno(errno, "Reading report " + ReportName(id) + " failed");
+  featureScratch_.resize(size_t(read));
+  return featureScratch_;
+}
+
+std::vector<uint8_t>& StuTablet::BeginFeature(uint8_t id) {
+  featureScratch_.assign(1, id);
+  return featureScratch_;
+}
+
+void StuTablet::SetFeature() {
+  if (fd_ < 0) ThrowErrno(ENODEV, "Tablet not connected");
+  const uint8_t id = featureScratch_[0];
+  const size_t size = sizes_.feature[id];
+  if (!size) ThrowErrno(ENOTSUP, "Report " + ReportName(id) + " is not supported");
+  if (featureScratch_.size() > size) ThrowErrno(EMSGSIZE, "Report " + ReportName(id) + " too long");
+  featureScratch_.resize(size, 0);
+  int written;
+  do {
+    written = ::ioctl(fd_, HIDIOCSFEATURE(size), featureScratch_.data());
+  } while (written < 0 && errno == EINTR);
+  if (written < 0) ThrowErrno(errno, "Writing report " + ReportName(id) + " failed");
+}
+
+StuCapability StuTablet::GetCapability() {
+  const auto& report = GetFeature(kStuReportCapability);
+  StuCapability capability;
+  if (!ParseStuCapability(report.data(), report.size(), capability)) {
+    ThrowErrno(EPROTO, "Capability report too short");
+  }
+  return capability;
+}
+
+StuInformation StuTablet::GetInformation() {
+  const auto& report = GetFeature(kStuReportInformation);
+  StuInformation information;
+  if (!ParseStuInformation(report.data(), report.size(), information)) {
+    ThrowErrno(EPROTO, "Information report too short");
+  }
+  return information;
+}
+
+StuStatus StuTablet::GetStatus() {
+  const auto& report = GetFeature(kStuReportStatus);
+  StuStatus status;
+  if (!ParseStuStatus(report.data(), report.size(), status)) {
+    ThrowErrno(EPROTO, "Status report too short");
+  }
+  return status;
+}
+
+void StuTablet::WaitForStatus(uint8_t statusCode) {
+  const auto deadline = std::chrono::steady_clock::now() + kStatusTimeout;
+  while (GetStatus().statusCode != statusCode) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      ThrowErrno(ETIMEDOUT, "Tablet stayed busy");
+    }
+    std::this_thread::sleep_for(kStatusPoll);
+  }
+}
+
+void StuTablet::SetClearScreen() {
+  WaitForStatus(kStuStatusReady);
+  BeginFeature(kStuReportClearScreen).push_back(0);
+  SetFeature();
+}
+
+void StuTablet::SetPenDataOptionMode(uint8_t mode) {
+  BeginFeature(kStuReportPenDataOptionMode).push_back(mode);
+  SetFeature();
+}
+
+void StuTablet::WriteImage(uint8_t encodingMode, const uint8_t* data, size_t size) {
+  const size_t blockSize = sizes_.feature[kStuReportImageDataBlock];
+  if (blockSize <= 1 + kStuImageBlockHeader) {
+    ThrowErrno(ENOTSUP, "Report " + ReportName(kStuReportImageDataBlock) + " is not supported");
+  }
+  const size_t maxBlock = blockSize - 1 - kStuImageBlockHeader;
+
+  WaitForStatus(kStuStatusReady);
+  BeginFeature(kStuReportStartImageData).push_back(encodingMode);
+  SetFeature();
+  try {
+    WaitForStatus(kStuStatusImage);
+    for (size_t offset = 0; offset < size; offset += maxBlock) {
+      const size_t length = std::min(maxBlock, size - offset);
+      auto& report = BeginFeature(kStuReportImageDataBlock);
+      report.push_back(uint8_t(length));
+      report.push_back(uint8_t(length >> 8));
+      report.insert(report.end(), data + offset, data + offset + length);
+      SetFeature();
+    }
+    BeginFeature(kStuReportEndImageData).push_back(kEndImageCommit);
+    SetFeature();
+    WaitForStatus(kStuStatusReady);
+  } catch (...) {
+    // Otherwise the pad waits in image mode for data that never comes
+    try {
+      BeginFeature(kStuReportEndImageData).push_back(kEndImageAbandon);
+      SetFeature();
+    } catch (...) {
+      // Gone; the first error says why
+    }
+    throw;
+  }
+}
+
+StuKey StuTablet::GetKey(uint8_t id) {
+  const auto& report = GetFeature(id);
+  if (report.size() < 1 + kStuKeySize) ThrowErrno(EPROTO, "Report " + ReportName(id) + " too short");
+  StuKey key;
+  std::copy(report.begin() + 1, report.begin() + 1 + kStuKeySize, key.begin());
+  return key;
+}
+
+void StuTablet::SetKey(uint8_t id, const StuKey& key) {
+  BeginFeature(id).insert(featureScratch_.end(), key.begin(), key.end());
+  SetFeature();
+}
+
+StuKey StuTablet::GetDHprime() { return GetKey(kStuReportDHprime); }
+
+void StuTablet::SetDHprime(const StuKey& prime) { SetKey(kStuReportDHprime, prime); }
+
+uint16_t StuTablet::GetDHbase() {
+  const auto& report = GetFeature(kStuReportDHbase);
+  if (report.size() < 1 + kStuDHbaseSize) ThrowErrno(EPROTO, "DHbase report too short");
+  return uint16_t(report[1] << 8 | report[2]);
+}
+
+void StuTablet::SetDHbase(uint16_t base) {
+  BeginFeature(kStuReportDHbase).insert(featureScratch_.end(), {uint8_t(base >> 8), uint8_t(base)});
+  SetFeature();
+}
+
+void StuTablet::SetHostPublicKey(const StuKey& key) {
+  WaitForStatus(kStuStatusReady);
+  SetKey(kStuReportHostPublicKey, key);
+}
+
+StuKey StuTablet::GetDevicePublicKey() {
+  // Calculating until then
+  WaitForStatus(kStuStatusReady);
+  return GetKey(kStuReportDevicePublicKey);
+}
+
+void StuTablet::StartCapture(uint32_t sessionId) {
+  BeginFeature(kStuReportStartCapture)
+      .insert(featureScratch_.end(), {uint8_t(sessionId >> 24), uint8_t(sessionId >> 16),
+                                      uint8_t(sessionId >> 8), uint8_t(sessionId)});
+  SetFeature();
+}
+
+void StuTablet::EndCapture() {
+  BeginFeature(kStuReportEndCapture).push_back(0);
+  SetFeature();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stu_protocol.h"
+
+// A pad as the kernel lists it under /sys/class/hidraw
+struct StuHidDevice {
+  // /dev/hidrawN
+  std::string devnode;
+  // The HID device's physical path, e.g. "usb-0000:00:14.0-2/input0".
+  // Stays put while the pad stays on the same port, so it goes into the
+  // pad's StuDeviceId the way the interface path does on Windows.
+  std::string phys;
+  uint16_t vendorId = 0;
+  uint16_t productId = 0;
+  // 0 where the pad is not on USB, as with a uhid device
+  uint16_t bcdDevice = 0;
+};
+
+// Every STU pad plugged in: Wacom's vendor id and the STU product range,
+// as the SDK's getUsbDevices matches them. |sysfsRoot| is for tests.
+std::vector<StuHidDevice> FindStuDevices(const std::string& sysfsRoot = "/sys/class/hidraw");
+
+// One pad's hidraw node. Commands go out as feature reports, synchronously,
+// and fail by throwing std::system_error, like the SDK's Tablet. Pen
+// reports are read by a ReportLoop off fd(), which is non-blocking.
+// One thread at a time.
+class StuTablet {
+ public:
+  StuTablet() = default;
+  ~StuTablet();
+
+  StuTablet(const StuTablet&) = delete;
+  StuTablet& operator=(const StuTablet&) = delete;
+
+  // Opens |devnode| and reads its report descriptor for the report sizes
+  void Open(const std::string& devnode);
+  void Close();
+  bool isOpen() const { return fd_ >= 0; }
+  int fd() const { return fd_; }
+
+  // Whether the pad declares |reportId| as a feature or input report
+  bool IsSupported(uint8_t reportId) const;
+
+  StuCapability GetCapability();
+  StuInformation GetInformation();
+  StuStatus GetStatus();
+
+  void SetClearScreen();
+  // kStuPenDataOption*
+  void SetPenDataOptionMode(uint8_t mode);
+
+  // Writes a whole screen of |encodingMode| image data: StartImageData,
+  // the data in blocks as big as the pad takes, EndImageData, waiting on
+  // the pad's status around each step.
+  void WriteImage(uint8_t encodingMode, const uint8_t* data, size_t size);
+
+  // Encrypted capture. The prime and base are all zero on a pad that
+  // leaves them to the host.
+  StuKey GetDHprime();
+  void SetDHprime(const StuKey& prime);
+  uint16_t GetDHbase();
+  void SetDHbase(uint16_t base);
+  void SetHostPublicKey(const StuKey& key);
+  // Waits for the pad to work out its key from the host's first
+  StuKey GetDevicePublicKey();
+  // Pen data comes encrypted, each report carrying |sessionId|, until
+  // EndCapture
+  void StartCapture(uint32_t sessionId);
+  void EndCapture();
+
+ private:
+  // Reads feature report |id| into featureScratch_, sized as declared
+  const std::vector<uint8_t>& GetFeature(uint8_t id);
+  // Sends featureScratch_, which holds the report id and payload and is
+  // zero padded here to the declared size
+  void SetFeature();
+  // Starts featureScratch_ as report |id|
+  std::vector<uint8_t>& BeginFeature(uint8_t id);
+  StuKey GetKey(uint8_t id);
+  void SetKey(uint8_t id, const StuKey& key);
+  // Polls the status report until the pad is in |statusCode|
+  void WaitForStatus(uint8_t statusCode);
+
+  int fd_ = -1;
+  std::string devnode_;
+  HidReportSizes sizes_;
+  std::vector<uint8_t> featureScratch_;
+};
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "stu_protocol.h"
+#include "uhid_stu_device.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+TEST(HidReportDescriptor, SizesEveryStuReport) {
+  const auto descriptor = StuReportDescriptor(253);
+  HidReportSizes sizes;
+  ASSERT_TRUE(ParseHidReportDescriptor(descriptor.data(), descriptor.size(), sizes));
+
+  // Report id included
+  EXPECT_EQ(sizes.input[kStuReportPenData], 7);
+  EXPECT_EQ(sizes.input[kStuReportPenDataTimeCountSequence], 11);
+  EXPECT_EQ(sizes.feature[kStuReportCapability], 1 + kStuCapabilitySize);
+  EXPECT_EQ(sizes.feature[kStuReportStatus], 1 + kStuStatusSize);
+  // A two-byte Report Count
+  EXPECT_EQ(sizes.feature[kStuReportImageDataBlock], 256);
+  EXPECT_EQ(sizes.input[kStuReportPenDataEncrypted], 17);
+  EXPECT_EQ(sizes.feature[kStuReportHostPublicKey], 1 + kStuKeySize);
+  // What the pad does not declare, it does not support
+  EXPECT_EQ(sizes.feature[kStuReportInkingMode], 0);
+  EXPECT_EQ(sizes.feature[kStuReportPenData], 0);
+}
+
+TEST(HidReportDescriptor, FollowsPushPopAndSkipsLongItems) {
+  const std::vector<uint8_t> descriptor = {
+      0x75, 0x08,        // Report Size (8)
+      0x85, 0x05,        // Report ID (5)
+      0x95, 0x02,        // Report Count (2)
+      0xA4,              // Push
+      0x75, 0x10,        // Report Size (16)
+      0x81, 0x02,        // Input: 32 bits
+      0xB4,              // Pop
+      0xFE, 0x02, 0x00, 0xAA, 0xBB,  // Long item
+      0x81, 0x02,        // Input: 16 more bits
+      0x85, 0x06,        // Report ID (6)
+      0x95, 0x03,        // Report Count (3)
+      0x75, 0x01,        // Report Size (1)
+      0xB1, 0x02,        // Feature: 3 bits, a byte
+  };
+  HidReportSizes sizes;
+  ASSERT_TRUE(ParseHidReportDescriptor(descriptor.data(), descriptor.size(), sizes));
+  EXPECT_EQ(sizes.input[5], 1 + 6);
+  EXPECT_EQ(sizes.feature[6], 1 + 1);
+
+  // Cut off inside an item
+  EXPECT_FALSE(ParseHidReportDescriptor(descriptor.data(), 4 - 1, sizes));
+  // Nothing but globals
+  EXPECT_FALSE(ParseHidReportDescriptor(descriptor.data(), 6, sizes));
+}
+
+TEST(StuFeatureReports, ParseCapabilityInformationAndStatus) {
+  const uint8_t capability[] = {kStuReportCapability, 0x25, 0x80, 0x17, 0x70, 0x03, 0xFF,
+                                0x03, 0x20, 0x01, 0xE0, 200, 0x09, 0xEC, 0x0F};
+  StuCapability cap;
+  ASSERT_TRUE(ParseStuCapability(capability, sizeof(capability), cap));
+  EXPECT_EQ(cap.tabletMaxX, 9600);
+  EXPECT_EQ(cap.tabletMaxY, 6000);
+  EXPECT_EQ(cap.tabletMaxPressure, 1023);
+  EXPECT_EQ(cap.screenWidth, 800);
+  EXPECT_EQ(cap.screenHeight, 480);
+  EXPECT_EQ(cap.maxReportRate, 200);
+  EXPECT_EQ(cap.resolution, 2540);
+  EXPECT_EQ(cap.encodingFlag, 0x0F);
+  EXPECT_FALSE(ParseStuCapability(capability, sizeof(capability) - 1, cap));
+
+  const uint8_t information[] = {kStuReportInformation, 'S', 'T', 'U', '-', '4', '3', '0',
+                                 1, 7, 1, 0, 0, 1, 2};
+  StuInformation info;
+  ASSERT_TRUE(ParseStuInformation(information, sizeof(information), info));
+  EXPECT_EQ(info.modelName, "STU-430");
+  EXPECT_EQ(info.firmwareMajor, 1);
+  EXPECT_EQ(info.firmwareMinor, 7);
+  EXPECT_EQ(info.secureIc, 1);
+  EXPECT_EQ(info.secureIcVersion, 0x102u);
+  // Shorter names are NUL padded
+  const uint8_t padded[] = {kStuReportInformation, 'S', 'T', 'U', '5', 0, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  ASSERT_TRUE(ParseStuInformation(padded, sizeof(padded), info));
+  EXPECT_EQ(info.modelName, "STU5");
+  // The wrong report
+  EXPECT_FALSE(ParseStuInformation(capability, sizeof(capability), info));
+
+  const uint8_t status[] = {kStuReportStatus, kStuStatusImage, 0x00, 0x01, 0x02};
+  StuStatus stat;
+  ASSERT_TRUE(ParseStuStatus(status, sizeof(status), stat));
+  EXPECT_EQ(stat.statusCode, kStuStatusImage);
+  EXPECT_EQ(stat.statusWord, 0x0102);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
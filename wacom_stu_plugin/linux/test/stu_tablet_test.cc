@@ -0,0 +1,226 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "decrypt_worker.h"
+#include "report_decoder.h"
+#include "report_loop.h"
+#include "session_key_exchange.h"
+#include "stu_tablet.h"
+#include "uhid_stu_device.h"
+
+// Against a virtual pad made through /dev/uhid. Needs uhid and access to
+// it and the hidraw nodes, e.g. root; skipped otherwise.
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+class VirtualPad : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!pad_.Create(UhidStuDevice::Config())) GTEST_SKIP() << "uhid is not available";
+    devnode_ = pad_.WaitForHidraw();
+    ASSERT_FALSE(devnode_.empty()) << "no hidraw node for the virtual pad";
+  }
+
+  UhidStuDevice pad_;
+  std::string devnode_;
+};
+
+std::vector<uint8_t> TimedReport(uint16_t x, uint16_t sequence) {
+  return {kStuReportPenDataTimeCountSequence, 0x81, 0x00, uint8_t(x >> 8), uint8_t(x), 0x00,
+          0x10, 0x00, uint8_t(sequence * 5), uint8_t(sequence >> 8), uint8_t(sequence)};
+}
+
+}  // namespace
+
+TEST_F(VirtualPad, IsFoundAndAnswersFeatureReports) {
+  bool listed = false;
+  for (const auto& device : FindStuDevices()) {
+    if (device.devnode != devnode_) continue;
+    listed = true;
+    EXPECT_EQ(device.vendorId, 0x056A);
+    EXPECT_EQ(device.productId, 0xA8);
+  }
+  EXPECT_TRUE(listed);
+
+  StuTablet tablet;
+  tablet.Open(devnode_);
+  const auto cap = tablet.GetCapability();
+  EXPECT_EQ(cap.tabletMaxX, 9600);
+  EXPECT_EQ(cap.screenWidth, 800);
+  EXPECT_EQ(cap.encodingFlag, 0x0F);
+  EXPECT_EQ(tablet.GetInformation().modelName, "STU-540");
+  EXPECT_EQ(tablet.GetStatus().statusCode, kStuStatusReady);
+  EXPECT_TRUE(tablet.IsSupported(kStuReportPenDataOptionMode));
+  EXPECT_FALSE(tablet.IsSupported(kStuReportInkingMode));
+
+  tablet.SetPenDataOptionMode(kStuPenDataOptionTimeCountSequence);
+  const auto written = pad_.written();
+  ASSERT_FALSE(written.empty());
+  EXPECT_EQ(written.back()[0], kStuReportPenDataOptionMode);
+  EXPECT_EQ(written.back()[1], kStuPenDataOptionTimeCountSequence);
+}
+
+TEST_F(VirtualPad, WritesImagesInBlocks) {
+  StuTablet tablet;
+  tablet.Open(devnode_);
+  std::vector<uint8_t> image(1000);
+  for (size_t i = 0; i < image.size(); ++i) image[i] = uint8_t(i * 7);
+  tablet.WriteImage(0x04, image.data(), image.size());
+  EXPECT_EQ(pad_.image(), image);
+
+  // Start, four blocks of up to 253 bytes, end
+  const auto written = pad_.written();
+  ASSERT_EQ(written.size(), 6u);
+  EXPECT_EQ(written[0][0], kStuReportStartImageData);
+  EXPECT_EQ(written[0][1], 0x04);
+  EXPECT_EQ(written[4][0], kStuReportImageDataBlock);
+  EXPECT_EQ(written[4][1], 1000 - 3 * 253);
+  EXPECT_EQ(written[5][0], kStuReportEndImageData);
+  EXPECT_EQ(tablet.GetStatus().statusCode, kStuStatusReady);
+}
+
+TEST_F(VirtualPad, ReportLoopReadsUntilUnplugged) {
+  StuTablet tablet;
+  tablet.Open(devnode_);
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<PenSample> reports;
+  PenReportDecoder decoder(nullptr);
+  int lostError = 0;
+  ReportLoop loop;
+  ASSERT_TRUE(loop.Add(
+      tablet.fd(),
+      [&](const uint8_t* data, size_t size, int64_t) {
+        PenSample sample;
+        if (!decoder.Decode(data, size, 0, &sample)) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        reports.push_back(sample);
+        changed.notify_all();
+      },
+      [&](int error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        lostError = error;
+        changed.notify_all();
+      }));
+
+  for (uint16_t i = 0; i < 50; ++i) ASSERT_TRUE(pad_.SendInput(TimedReport(100 + i, i)));
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(2),
+                                 [&] { return reports.size() == 50; }));
+    for (uint16_t i = 0; i < 50; ++i) {
+      EXPECT_EQ(reports[i].x, 100 + i);
+      EXPECT_EQ(reports[i].sequence, i);
+    }
+  }
+  // Most of them in a few wakeups
+  EXPECT_LE(loop.wakeups(), 50u);
+
+  pad_.Destroy();
+  std::unique_lock<std::mutex> lock(mutex);
+  EXPECT_TRUE(changed.wait_for(lock, std::chrono::seconds(2), [&] { return lostError != 0; }));
+}
+
+TEST_F(VirtualPad, CapturesEncryptedPenData) {
+  StuTablet tablet;
+  tablet.Open(devnode_);
+  ASSERT_TRUE(tablet.IsSupported(kStuReportHostPublicKey));
+
+  // The plugin's exchange: the pad has no parameters, so it takes the
+  // host's
+  SessionKeyExchange exchange;
+  EXPECT_FALSE(exchange.SetParameters(tablet.GetDHprime(), tablet.GetDHbase()));
+  tablet.SetDHprime(exchange.prime());
+  tablet.SetDHbase(exchange.base());
+  EXPECT_EQ(tablet.GetDHprime(), SessionKeyExchange::kDefaultPrime);
+  tablet.SetHostPublicKey(exchange.GeneratePublicKey());
+  SessionKeyExchange::Key key{};
+  ASSERT_TRUE(exchange.ComputeSessionKey(tablet.GetDevicePublicKey(), key));
+  tablet.StartCapture(0x0BADCAFE);
+  ASSERT_TRUE(pad_.capturing());
+  EXPECT_EQ(pad_.sessionId(), 0x0BADCAFEu);
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<PenSample> samples;
+  DecryptWorker worker(key.data(), 0x0BADCAFE, nullptr, [&](const PenSample& sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    samples.push_back(sample);
+    changed.notify_all();
+  });
+  ReportLoop loop;
+  ASSERT_TRUE(loop.Add(
+      tablet.fd(),
+      [&worker](const uint8_t* data, size_t size, int64_t hostUs) {
+        worker.Push(data, size, hostUs);
+      },
+      nullptr));
+
+  for (uint16_t i = 0; i < 20; ++i) {
+    ASSERT_TRUE(pad_.SendEncryptedInput(
+        {kStuReportPenDataTimeCountSequenceEncrypted, 0x81, 0x00, 0x00, uint8_t(i), 0x00, 0x10,
+         0x00, uint8_t(i * 5), 0x00, uint8_t(i), 0x0B, 0xAD, 0xCA, 0xFE, 0x00, 0x00}));
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(2),
+                                 [&] { return samples.size() == 20; }));
+    for (uint16_t i = 0; i < 20; ++i) {
+      EXPECT_EQ(samples[i].x, i);
+      EXPECT_EQ(samples[i].sequence, i);
+    }
+  }
+  loop.Remove(tablet.fd());
+  EXPECT_EQ(worker.stats().sessionMismatches, 0u);
+
+  tablet.EndCapture();
+  EXPECT_FALSE(pad_.capturing());
+}
+
+TEST(ReportLoop, RemoveStopsCallbacks) {
+  // A pipe stands in for a pad
+  int fds[2];
+  ASSERT_EQ(::pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+  std::mutex mutex;
+  std::condition_variable changed;
+  int reads = 0;
+  ReportLoop loop;
+  ASSERT_TRUE(loop.Add(
+      fds[0],
+      [&](const uint8_t*, size_t, int64_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++reads;
+        changed.notify_all();
+      },
+      nullptr));
+  const uint8_t report[] = {kStuReportPenData, 0, 0, 0, 0, 0, 0};
+  ASSERT_EQ(::write(fds[1], report, sizeof(report)), ssize_t(sizeof(report)));
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(2), [&] { return reads == 1; }));
+  }
+
+  loop.Remove(fds[0]);
+  ASSERT_EQ(::write(fds[1], report, sizeof(report)), ssize_t(sizeof(report)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(reads, 1);
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,314 @@
+#include "uhid_stu_device.h"
+
+#include <fcntl.h>
+#include <linux/uhid.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "aes128.h"
+#include "stu_tablet.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+// Bus type the kernel reports for USB
+constexpr uint16_t kBusUsb = 0x03;
+
+// Report ids and payload sizes, report id excluded
+struct ReportShape {
+  uint8_t id;
+  uint16_t size;
+};
+
+constexpr ReportShape kInputReports[] = {
+    {kStuReportPenData, 6},
+    {kStuReportPenDataOption, 8},
+    {kStuReportPenDataTimeCountSequence, 10},
+    {kStuReportPenDataEncrypted, 16},
+    {kStuReportPenDataEncryptedOption, 20},
+    {kStuReportPenDataTimeCountSequenceEncrypted, 16},
+};
+
+void AppendItem(std::vector<uint8_t>& descriptor, uint8_t prefix, uint32_t value) {
+  if (value <= 0xFF) {
+    descriptor.insert(descriptor.end(), {uint8_t(prefix | 1), uint8_t(value)});
+  } else {
+    descriptor.insert(descriptor.end(), {uint8_t(prefix | 2), uint8_t(value), uint8_t(value >> 8)});
+  }
+}
+
+void AppendReport(std::vector<uint8_t>& descriptor, uint8_t main, ReportShape report) {
+  AppendItem(descriptor, 0x84, report.id);    // Report ID
+  AppendItem(descriptor, 0x08, report.id);    // Usage
+  AppendItem(descriptor, 0x94, report.size);  // Report Count
+  AppendItem(descriptor, main, 0x02);         // Data, Variable, Absolute
+}
+
+void WriteEvent(int fd, const uhid_event& event) {
+  // uhid takes whole events or nothing
+  while (::write(fd, &event, sizeof(event)) < 0 && errno == EINTR) {
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t> StuReportDescriptor(size_t imageBlock) {
+  const ReportShape features[] = {
+      {kStuReportStatus, uint16_t(kStuStatusSize)},
+      {kStuReportInformation, uint16_t(kStuInformationSize)},
+      {kStuReportCapability, uint16_t(kStuCapabilitySize)},
+      {kStuReportClearScreen, 1},
+      {kStuReportStartImageData, 1},
+      {kStuReportImageDataBlock, uint16_t(kStuImageBlockHeader + imageBlock)},
+      {kStuReportEndImageData, 1},
+      {kStuReportPenDataOptionMode, 1},
+      {kStuReportHostPublicKey, uint16_t(kStuKeySize)},
+      {kStuReportDevicePublicKey, uint16_t(kStuKeySize)},
+      {kStuReportStartCapture, uint16_t(kStuStartCaptureSize)},
+      {kStuReportEndCapture, uint16_t(kStuEndCaptureSize)},
+      {kStuReportDHprime, uint16_t(kStuKeySize)},
+      {kStuReportDHbase, uint16_t(kStuDHbaseSize)},
+  };
+  std::vector<uint8_t> descriptor = {
+      0x06, 0x0D, 0xFF,  // Usage Page (vendor)
+      0x09, 0x01,        // Usage
+      0xA1, 0x01,        // Collection (Application)
+      0x15, 0x00,        // Logical Minimum (0)
+      0x26, 0xFF, 0x00,  // Logical Maximum (255)
+      0x75, 0x08,        // Report Size (8)
+  };
+  for (const auto& report : kInputReports) AppendReport(descriptor, 0x80, report);
+  for (const auto& report : features) AppendReport(descriptor, 0xB0, report);
+  descriptor.push_back(0xC0);  // End Collection
+  return descriptor;
+}
+
+UhidStuDevice::~UhidStuDevice() { Destroy(); }
+
+bool UhidStuDevice::Create(const Config& config) {
+  Destroy();
+  fd_ = ::open("/dev/uhid", O_RDWR | O_CLOEXEC);
+  if (fd_ < 0) return false;
+  config_ = config;
+  static std::atomic<int> created{0};
+  phys_ = "wacom-stu-test/" + std::to_string(::getpid()) + "/" + std::to_string(created++);
+
+  const auto descriptor = StuReportDescriptor(config.imageBlock);
+  uhid_event event{};
+  event.type = UHID_CREATE2;
+  std::snprintf(reinterpret_cast<char*>(event.u.create2.name), sizeof(event.u.create2.name),
+                "Wacom %s (virtual)", config.modelName.c_str());
+  std::snprintf(reinterpret_cast<char*>(event.u.create2.phys), sizeof(event.u.create2.phys), "%s",
+                phys_.c_str());
+  event.u.create2.rd_size = uint16_t(descriptor.size());
+  event.u.create2.bus = kBusUsb;
+  event.u.create2.vendor = 0x056A;
+  event.u.create2.product = config.productId;
+  std::memcpy(event.u.create2.rd_data, descriptor.data(), descriptor.size());
+  if (::write(fd_, &event, sizeof(event)) < 0) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  stop_ = false;
+  thread_ = std::thread([this] { Run(); });
+  return true;
+}
+
+void UhidStuDevice::Destroy() {
+  if (fd_ < 0) return;
+  stop_ = true;
+  if (thread_.joinable()) thread_.join();
+  uhid_event event{};
+  event.type = UHID_DESTROY;
+  WriteEvent(fd_, event);
+  ::close(fd_);
+  fd_ = -1;
+}
+
+std::string UhidStuDevice::WaitForHidraw() {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (std::chrono::steady_clock::now() < deadline) {
+    for (const auto& device : FindStuDevices()) {
+      if (device.phys == phys_ && ::access(device.devnode.c_str(), R_OK | W_OK) == 0) {
+        return device.devnode;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return {};
+}
+
+bool UhidStuDevice::SendInput(const std::vector<uint8_t>& report) {
+  if (fd_ < 0 || report.size() > UHID_DATA_MAX) return false;
+  uhid_event event{};
+  event.type = UHID_INPUT2;
+  event.u.input2.size = uint16_t(report.size());
+  std::memcpy(event.u.input2.data, report.data(), report.size());
+  return ::write(fd_, &event, sizeof(event)) == ssize_t(sizeof(event));
+}
+
+bool UhidStuDevice::SendEncryptedInput(std::vector<uint8_t> report) {
+  if (report.size() < 1 + Aes128::kBlockSize) return false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!capturing_) return false;
+    Aes128(sessionKey_.data()).Encrypt(report.data() + 1, report.data() + 1, 1);
+  }
+  return SendInput(report);
+}
+
+bool UhidStuDevice::capturing() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return capturing_;
+}
+
+uint32_t UhidStuDevice::sessionId() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sessionId_;
+}
+
+std::vector<std::vector<uint8_t>> UhidStuDevice::written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
+
+std::vector<uint8_t> UhidStuDevice::image() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return image_;
+}
+
+std::vector<uint8_t> UhidStuDevice::Answer(uint8_t id) {
+  std::vector<uint8_t> report{id};
+  auto be16 = [&report](uint16_t value) {
+    report.push_back(uint8_t(value >> 8));
+    report.push_back(uint8_t(value));
+  };
+  const StuCapability& cap = config_.capability;
+  switch (id) {
+    case kStuReportStatus: {
+      std::lock_guard<std::mutex> lock(mutex_);
+      report.insert(report.end(), {status_, 0, 0, 0});
+      break;
+    }
+    case kStuReportCapability:
+      be16(cap.tabletMaxX);
+      be16(cap.tabletMaxY);
+      be16(cap.tabletMaxPressure);
+      be16(cap.screenWidth);
+      be16(cap.screenHeight);
+      report.push_back(cap.maxReportRate);
+      be16(cap.resolution);
+      report.push_back(cap.encodingFlag);
+      break;
+    case kStuReportInformation:
+      for (size_t i = 0; i < 7; ++i) {
+        report.push_back(i < config_.modelName.size() ? uint8_t(config_.modelName[i]) : 0);
+      }
+      report.insert(report.end(), {1, 2, 0, 0, 0, 0, 0});
+      break;
+    case kStuReportDHprime: {
+      std::lock_guard<std::mutex> lock(mutex_);
+      report.insert(report.end(), prime_.begin(), prime_.end());
+      break;
+    }
+    case kStuReportDHbase: {
+      std::lock_guard<std::mutex> lock(mutex_);
+      be16(base_);
+      break;
+    }
+    case kStuReportDevicePublicKey: {
+      std::lock_guard<std::mutex> lock(mutex_);
+      report.insert(report.end(), devicePublicKey_.begin(), devicePublicKey_.end());
+      break;
+    }
+    default:
+      return {};
+  }
+  return report;
+}
+
+void UhidStuDevice::Apply(const uint8_t* data, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  written_.emplace_back(data, data + size);
+  switch (data[0]) {
+    case kStuReportStartImageData:
+      status_ = kStuStatusImage;
+      image_.clear();
+      break;
+    case kStuReportImageDataBlock: {
+      const size_t length = size >= 3 ? size_t(data[1] | data[2] << 8) : 0;
+      if (3 + length <= size) image_.insert(image_.end(), data + 3, data + 3 + length);
+      break;
+    }
+    case kStuReportEndImageData:
+      status_ = kStuStatusReady;
+      break;
+    case kStuReportDHprime:
+      if (size >= 1 + kStuKeySize) std::copy(data + 1, data + 1 + kStuKeySize, prime_.begin());
+      break;
+    case kStuReportDHbase:
+      if (size >= 1 + kStuDHbaseSize) base_ = uint16_t(data[1] << 8 | data[2]);
+      break;
+    case kStuReportHostPublicKey: {
+      // The pad's half, worked out at once where a pad would be busy
+      // calculating for a while
+      SessionKeyExchange exchange;
+      SessionKeyExchange::Key hostPublicKey;
+      if (size < 1 + kStuKeySize || !exchange.SetParameters(prime_, base_)) break;
+      std::copy(data + 1, data + 1 + kStuKeySize, hostPublicKey.begin());
+      devicePublicKey_ = exchange.GeneratePublicKey();
+      exchange.ComputeSessionKey(hostPublicKey, sessionKey_);
+      break;
+    }
+    case kStuReportStartCapture:
+      if (size >= 1 + kStuStartCaptureSize) {
+        sessionId_ = uint32_t(data[1]) << 24 | uint32_t(data[2]) << 16 |
+                     uint32_t(data[3]) << 8 | data[4];
+        capturing_ = true;
+      }
+      break;
+    case kStuReportEndCapture:
+      capturing_ = false;
+      break;
+    default:
+      break;
+  }
+}
+
+void UhidStuDevice::Run() {
+  pollfd readable{fd_, POLLIN, 0};
+  while (!stop_) {
+    if (::poll(&readable, 1, 20) <= 0) continue;
+    uhid_event event{};
+    if (::read(fd_, &event, sizeof(event)) <= 0) continue;
+
+    uhid_event reply{};
+    if (event.type == UHID_GET_REPORT) {
+      const auto report = Answer(event.u.get_report.rnum);
+      reply.type = UHID_GET_REPORT_REPLY;
+      reply.u.get_report_reply.id = event.u.get_report.id;
+      reply.u.get_report_reply.err = report.empty() ? EIO : 0;
+      reply.u.get_report_reply.size = uint16_t(report.size());
+      std::copy(report.begin(), report.end(), reply.u.get_report_reply.data);
+      WriteEvent(fd_, reply);
+    } else if (event.type == UHID_SET_REPORT) {
+      if (event.u.set_report.size) Apply(event.u.set_report.data, event.u.set_report.size);
+      reply.type = UHID_SET_REPORT_REPLY;
+      reply.u.set_report_reply.id = event.u.set_report.id;
+      reply.u.set_report_reply.err = 0;
+      WriteEvent(fd_, reply);
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_key_exchange.h"
+#include "stu_protocol.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+// The report descriptor of a color STU: the pen reports as input, the
+// commands the plugin uses as feature reports, ImageDataBlock carrying
+// |imageBlock| bytes of image data
+std::vector<uint8_t> StuReportDescriptor(size_t imageBlock = 253);
+
+// A virtual STU pad made through /dev/uhid, so the hidraw side can be
+// tested with no pad plugged in. The kernel gives it a hidraw node like a
+// real pad's; this side answers its feature reports the way the pad does
+// and keeps what it was sent. It takes part in the key exchange like a pad
+// with no prime and base of its own.
+class UhidStuDevice {
+ public:
+  struct Config {
+    uint16_t productId = 0xA8;
+    StuCapability capability{9600, 6000, 1023, 800, 480, 200, 2540,
+                             kStuEncodingZlib | kStuEncoding1Bit | kStuEncoding16Bit |
+                                 kStuEncoding24Bit};
+    std::string modelName = "STU-540";
+    size_t imageBlock = 253;
+  };
+
+  UhidStuDevice() = default;
+  ~UhidStuDevice();
+
+  UhidStuDevice(const UhidStuDevice&) = delete;
+  UhidStuDevice& operator=(const UhidStuDevice&) = delete;
+
+  // False where uhid is not available, as in most containers
+  bool Create(const Config& config);
+  // Unplugs it
+  void Destroy();
+
+  // The pad's hidraw node, once the kernel has made it; empty after a
+  // second without
+  std::string WaitForHidraw();
+
+  // Sends an input report, report id first
+  bool SendInput(const std::vector<uint8_t>& report);
+  // Sends an encrypted pen report given in the clear, i.e. laid out as
+  // PenReportLayout has it: the 16 bytes after the report id go out
+  // encrypted with the session key. False outside a capture.
+  bool SendEncryptedInput(std::vector<uint8_t> report);
+
+  // The capture started by StartCapture, and its session id
+  bool capturing() const;
+  uint32_t sessionId() const;
+
+  // The feature reports set so far, report id first, and the image data
+  // of the last image written
+  std::vector<std::vector<uint8_t>> written() const;
+  std::vector<uint8_t> image() const;
+
+ private:
+  void Run();
+  // Feature report |id|, report id first, as the pad answers it
+  std::vector<uint8_t> Answer(uint8_t id);
+  void Apply(const uint8_t* data, size_t size);
+
+  int fd_ = -1;
+  Config config_;
+  std::string phys_;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  mutable std::mutex mutex_;
+  uint8_t status_ = kStuStatusReady;
+  std::vector<std::vector<uint8_t>> written_;
+  std::vector<uint8_t> image_;
+  // Key exchange and capture, under mutex_
+  SessionKeyExchange::Key prime_{};
+  uint16_t base_ = 0;
+  SessionKeyExchange::Key devicePublicKey_{};
+  SessionKeyExchange::Key sessionKey_{};
+  bool capturing_ = false;
+  uint32_t sessionId_ = 0;
+};
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,65 @@
+#include "include/wacom_stu_plugin/wacom_stu_plugin.h"
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "stu_plugin.h"
+
+// The GObject Flutter registers; everything else is StuPlugin
+struct _WacomStuPlugin {
+  GObject parent_instance;
+  StuPlugin* impl;
+};
+
+G_DEFINE_TYPE(WacomStuPlugin, wacom_stu_plugin, g_object_get_type())
+
+static void wacom_stu_plugin_dispose(GObject* object) {
+  WacomStuPlugin* self = WACOM_STU_PLUGIN(object);
+  delete self->impl;
+  self->impl = nullptr;
+  G_OBJECT_CLASS(wacom_stu_plugin_parent_class)->dispose(object);
+}
+
+static void wacom_stu_plugin_class_init(WacomStuPluginClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = wacom_stu_plugin_dispose;
+}
+
+static void wacom_stu_plugin_init(WacomStuPlugin* self) { self->impl = nullptr; }
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  WacomStuPlugin* plugin = WACOM_STU_PLUGIN(user_data);
+  if (plugin->impl) plugin->impl->HandleMethodCall(method_call);
+}
+
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  WacomStuPlugin* plugin = WACOM_STU_PLUGIN(user_data);
+  return plugin->impl ? plugin->impl->OnListen(args) : nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  WacomStuPlugin* plugin = WACOM_STU_PLUGIN(user_data);
+  return plugin->impl ? plugin->impl->OnCancel() : nullptr;
+}
+
+void wacom_stu_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  WacomStuPlugin* plugin =
+      WACOM_STU_PLUGIN(g_object_new(wacom_stu_plugin_get_type(), nullptr));
+
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel =
+      fl_method_channel_new(messenger, "wacom_stu_channel", FL_METHOD_CODEC(codec));
+  g_autoptr(FlEventChannel) event_channel =
+      fl_event_channel_new(messenger, "wacom_stu_events", FL_METHOD_CODEC(codec));
+  plugin->impl = new StuPlugin(channel, event_channel);
+
+  // The channels hold the plugin until the engine goes away
+  fl_method_channel_set_method_call_handler(channel, method_call_cb, g_object_ref(plugin),
+                                            g_object_unref);
+  fl_event_channel_set_stream_handlers(event_channel, listen_cb, cancel_cb, g_object_ref(plugin),
+                                       g_object_unref);
+
+  g_object_unref(plugin);
+}
@@ -0,0 +1,235 @@
+#include "aes128.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AES128_X86 1
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES128_TARGET
+#else
+#include <cpuid.h>
+#define AES128_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+namespace {
+
+constexpr uint8_t XTime(uint8_t a) { return uint8_t((a << 1) ^ ((a & 0x80) ? 0x1B : 0)); }
+
+constexpr uint8_t RotateLeft(uint8_t value, int shift) {
+  return uint8_t(value << shift | value >> (8 - shift));
+}
+
+// The S-box from its definition, the affine transform of each byte's
+// inverse in GF(2^8). p walks the field by powers of 3 while q walks the
+// inverses by powers of 1/3, so the table takes one pass.
+constexpr std::array<uint8_t, 256> MakeSbox() {
+  std::array<uint8_t, 256> sbox{};
+  uint8_t p = 1, q = 1;
+  do {
+    p = uint8_t(p ^ XTime(p));
+    q = uint8_t(q ^ (q << 1));
+    q = uint8_t(q ^ (q << 2));
+    q = uint8_t(q ^ (q << 4));
+    if (q & 0x80) q ^= 0x09;
+    sbox[p] = uint8_t(q ^ RotateLeft(q, 1) ^ RotateLeft(q, 2) ^ RotateLeft(q, 3) ^
+                      RotateLeft(q, 4) ^ 0x63);
+  } while (p != 1);
+  // Zero has no inverse
+  sbox[0] = 0x63;
+  return sbox;
+}
+
+constexpr std::array<uint8_t, 256> MakeInverse(const std::array<uint8_t, 256>& sbox) {
+  std::array<uint8_t, 256> inverse{};
+  for (int x = 0; x < 256; ++x) inverse[sbox[x]] = uint8_t(x);
+  return inverse;
+}
+
+constexpr std::array<uint8_t, 256> kSbox = MakeSbox();
+constexpr std::array<uint8_t, 256> kInverseSbox = MakeInverse(kSbox);
+
+constexpr uint8_t kRoundConstants[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                                         0x20, 0x40, 0x80, 0x1B, 0x36};
+
+// State bytes are column-major: byte i is row i % 4 of column i / 4
+
+void AddRoundKey(uint8_t* state, const uint8_t* key) {
+  for (int i = 0; i < 16; ++i) state[i] ^= key[i];
+}
+
+void SubBytesShiftRows(uint8_t* state) {
+  uint8_t out[16];
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      out[row + 4 * column] = kSbox[state[row + 4 * ((column + row) % 4)]];
+    }
+  }
+  std::memcpy(state, out, 16);
+}
+
+void InverseSubBytesShiftRows(uint8_t* state) {
+  uint8_t out[16];
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      out[row + 4 * ((column + row) % 4)] = kInverseSbox[state[row + 4 * column]];
+    }
+  }
+  std::memcpy(state, out, 16);
+}
+
+void MixColumns(uint8_t* state) {
+  for (int column = 0; column < 4; ++column) {
+    uint8_t* c = state + 4 * column;
+    const uint8_t a0 = c[0], a1 = c[1], a2 = c[2], a3 = c[3];
+    c[0] = uint8_t(XTime(a0) ^ XTime(a1) ^ a1 ^ a2 ^ a3);
+    c[1] = uint8_t(a0 ^ XTime(a1) ^ XTime(a2) ^ a2 ^ a3);
+    c[2] = uint8_t(a0 ^ a1 ^ XTime(a2) ^ XTime(a3) ^ a3);
+    c[3] = uint8_t(XTime(a0) ^ a0 ^ a1 ^ a2 ^ XTime(a3));
+  }
+}
+
+// InvMixColumns as a cheap premultiply by {04}x^2 + {05} followed by
+// MixColumns, whose product is the inverse matrix
+void InverseMixColumns(uint8_t* state) {
+  for (int column = 0; column < 4; ++column) {
+    uint8_t* c = state + 4 * column;
+    const uint8_t u = XTime(XTime(uint8_t(c[0] ^ c[2])));
+    const uint8_t v = XTime(XTime(uint8_t(c[1] ^ c[3])));
+    c[0] ^= u;
+    c[1] ^= v;
+    c[2] ^= u;
+    c[3] ^= v;
+  }
+  MixColumns(state);
+}
+
+}  // namespace
+
+Aes128::Aes128(const uint8_t key[kBlockSize]) : hardware_(HardwareSupported()) {
+  uint8_t* words = &encryptKeys_[0][0];
+  std::memcpy(words, key, kBlockSize);
+  for (int i = 4; i < 44; ++i) {
+    uint8_t word[4];
+    std::memcpy(word, words + 4 * (i - 1), 4);
+    if (i % 4 == 0) {
+      const uint8_t first = word[0];
+      word[0] = uint8_t(kSbox[word[1]] ^ kRoundConstants[i / 4 - 1]);
+      word[1] = kSbox[word[2]];
+      word[2] = kSbox[word[3]];
+      word[3] = kSbox[first];
+    }
+    for (int b = 0; b < 4; ++b) words[4 * i + b] = uint8_t(words[4 * (i - 4) + b] ^ word[b]);
+  }
+
+  // The equivalent inverse cipher's keys, as aesdec takes them
+  std::memcpy(decryptKeys_[0], encryptKeys_[10], kBlockSize);
+  for (int round = 1; round < 10; ++round) {
+    std::memcpy(decryptKeys_[round], encryptKeys_[10 - round], kBlockSize);
+    InverseMixColumns(decryptKeys_[round]);
+  }
+  std::memcpy(decryptKeys_[10], encryptKeys_[0], kBlockSize);
+}
+
+bool Aes128::HardwareSupported() {
+#if defined(AES128_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 25)) != 0;
+#elif defined(AES128_X86)
+  unsigned int a, b, c, d;
+  return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES) != 0;
+#else
+  return false;
+#endif
+}
+
+void Aes128::Encrypt(const uint8_t* in, uint8_t* out, size_t blocks) const {
+  for (size_t block = 0; block < blocks; ++block, in += kBlockSize, out += kBlockSize) {
+    uint8_t state[kBlockSize];
+    std::memcpy(state, in, kBlockSize);
+    AddRoundKey(state, encryptKeys_[0]);
+    for (int round = 1; round < 10; ++round) {
+      SubBytesShiftRows(state);
+      MixColumns(state);
+      AddRoundKey(state, encryptKeys_[round]);
+    }
+    SubBytesShiftRows(state);
+    AddRoundKey(state, encryptKeys_[10]);
+    std::memcpy(out, state, kBlockSize);
+  }
+}
+
+void Aes128::Decrypt(const uint8_t* in, uint8_t* out, size_t blocks) const {
+  if (hardware_) {
+    DecryptHardware(in, out, blocks);
+  } else {
+    DecryptPortable(in, out, blocks);
+  }
+}
+
+void Aes128::DecryptPortable(const uint8_t* in, uint8_t* out, size_t blocks) const {
+  for (size_t block = 0; block < blocks; ++block, in += kBlockSize, out += kBlockSize) {
+    uint8_t state[kBlockSize];
+    std::memcpy(state, in, kBlockSize);
+    AddRoundKey(state, encryptKeys_[10]);
+    for (int round = 9; round > 0; --round) {
+      InverseSubBytesShiftRows(state);
+      AddRoundKey(state, encryptKeys_[round]);
+      InverseMixColumns(state);
+    }
+    InverseSubBytesShiftRows(state);
+    AddRoundKey(state, encryptKeys_[0]);
+    std::memcpy(out, state, kBlockSize);
+  }
+}
+
+#if defined(AES128_X86)
+
+AES128_TARGET void Aes128::DecryptHardware(const uint8_t* in, uint8_t* out,
+                                           size_t blocks) const {
+  __m128i keys[11];
+  for (int round = 0; round < 11; ++round) {
+    keys[round] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(decryptKeys_[round]));
+  }
+  auto load = [in](size_t block) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + block * kBlockSize));
+  };
+  auto store = [out](size_t block, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + block * kBlockSize), value);
+  };
+
+  // Eight at a time, so each round's aesdec instructions pipeline
+  constexpr size_t kLanes = 8;
+  size_t block = 0;
+  for (; block + kLanes <= blocks; block += kLanes) {
+    __m128i state[kLanes];
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+      state[lane] = _mm_xor_si128(load(block + lane), keys[0]);
+    }
+    for (int round = 1; round < 10; ++round) {
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+        state[lane] = _mm_aesdec_si128(state[lane], keys[round]);
+      }
+    }
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+      store(block + lane, _mm_aesdeclast_si128(state[lane], keys[10]));
+    }
+  }
+  for (; block < blocks; ++block) {
+    __m128i state = _mm_xor_si128(load(block), keys[0]);
+    for (int round = 1; round < 10; ++round) state = _mm_aesdec_si128(state, keys[round]);
+    store(block, _mm_aesdeclast_si128(state, keys[10]));
+  }
+}
+
+#else
+
+void Aes128::DecryptHardware(const uint8_t* in, uint8_t* out, size_t blocks) const {
+  DecryptPortable(in, out, blocks);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// AES-128 on independent 16-byte blocks (ECB), as pads that encrypt pen
+// data encrypt each report's block on its own. The key schedule is
+// expanded once per session.
+//
+// Decrypt uses AES-NI when the CPU has it, eight blocks interleaved so the
+// instruction latencies overlap; a batch of reports costs little more than
+// one. Elsewhere, and on non-x86 builds, a portable byte-wise version runs.
+// Encrypt is portable only: the plugin never encrypts, tests and
+// benchmarks stand in for the pad with it.
+class Aes128 {
+ public:
+  static constexpr size_t kBlockSize = 16;
+
+  explicit Aes128(const uint8_t key[kBlockSize]);
+
+  // |blocks| blocks from |in| to |out|, which may be the same buffer
+  void Encrypt(const uint8_t* in, uint8_t* out, size_t blocks) const;
+  void Decrypt(const uint8_t* in, uint8_t* out, size_t blocks) const;
+
+  // Whether Decrypt runs on AES-NI. UseHardware(false) forces the portable
+  // version, to compare the two.
+  bool hardware() const { return hardware_; }
+  void UseHardware(bool use) { hardware_ = use && HardwareSupported(); }
+
+  // The CPU has AES-NI and this build can use it
+  static bool HardwareSupported();
+
+ private:
+  void DecryptPortable(const uint8_t* in, uint8_t* out, size_t blocks) const;
+  void DecryptHardware(const uint8_t* in, uint8_t* out, size_t blocks) const;
+
+  // Encryption round keys, then the decryption ones in the order the
+  // equivalent inverse cipher uses them
+  uint8_t encryptKeys_[11][kBlockSize];
+  uint8_t decryptKeys_[11][kBlockSize];
+  bool hardware_;
+};
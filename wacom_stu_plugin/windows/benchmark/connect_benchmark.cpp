@@ -0,0 +1,133 @@
+// Time to ready of connect, reading the pad's info vs. taking it from the
+// DeviceInfoCache.
+//
+// A connect opens the interface, gets the info and sets the report mode.
+// Each USB exchange is modelled as a sleep: opening the interface at a
+// fixed cost, and every feature report as one control transfer round trip.
+// Reading the info takes two (capability and information) and the report
+// mode one more. With the cache, the info comes from memory after a lookup
+// that checks the product id and firmware, as the plugin does. The cache
+// is opened from disk first, as on app start, and that is timed too.
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   connect_benchmark [connects] [round trip ms] [open ms]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "device_info_cache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Pads already in the cache file, as on a machine that has seen a few
+constexpr int kKnownPads = 16;
+
+struct Summary {
+  double medianMs;
+  double maxMs;
+};
+
+Summary Summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.back()};
+}
+
+double MsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Transfer(double ms) {
+  std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+DeviceInfo PadInfo(int pad) {
+  DeviceInfo info;
+  info.productId = 0xA8;
+  info.bcdDevice = 0x0102;
+  info.tabletMaxX = 9600;
+  info.tabletMaxY = 6000;
+  info.tabletMaxPressure = 1023;
+  info.screenWidth = 800;
+  info.screenHeight = 480;
+  info.maxReportRate = 200;
+  info.resolution = 2540;
+  info.encodingFlag = 0x0F;
+  info.modelName = "STU-540";
+  info.firmwareMajor = 1;
+  info.firmwareMinor = uint8_t(pad);
+  info.areaWrites = true;
+  info.hardwareInk = true;
+  info.penDataOptionMode = true;
+  return info;
+}
+
+std::string PadId(int pad) {
+  char id[32];
+  std::snprintf(id, sizeof(id), "056a-00a8-%08x", unsigned(pad) * 2654435761u);
+  return id;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int connects = argc > 1 ? std::atoi(argv[1]) : 20;
+  const double roundTripMs = argc > 2 ? std::atof(argv[2]) : 4.0;
+  const double openMs = argc > 3 ? std::atof(argv[3]) : 10.0;
+
+  const auto directory = std::filesystem::temp_directory_path() / "connect_benchmark";
+  std::filesystem::remove_all(directory);
+  {
+    DeviceInfoCache seed;
+    seed.Open(directory.u8string());
+    for (int pad = 0; pad < kKnownPads; ++pad) seed.Store(PadId(pad), PadInfo(pad));
+  }
+
+  std::printf("%d connects, feature report round trip %.1f ms, interface open %.1f ms\n",
+              connects, roundTripMs, openMs);
+
+  DeviceInfoCache cache;
+  auto start = Clock::now();
+  cache.Open(directory.u8string());
+  std::printf("cache open, %d pads: %.3f ms\n\n", kKnownPads, MsSince(start));
+
+  std::printf("%-8s %14s %14s\n", "info", "median ready", "max ready");
+  std::vector<double> ready;
+  for (int i = 0; i < connects; ++i) {
+    start = Clock::now();
+    Transfer(openMs);
+    DeviceInfo info = PadInfo(i % kKnownPads);
+    Transfer(roundTripMs);  // capability
+    Transfer(roundTripMs);  // information
+    Transfer(roundTripMs);  // report mode
+    ready.push_back(MsSince(start));
+  }
+  Summary s = Summarize(ready);
+  std::printf("%-8s %12.3fms %12.3fms\n", "read", s.medianMs, s.maxMs);
+
+  ready.clear();
+  int hits = 0;
+  for (int i = 0; i < connects; ++i) {
+    const int pad = i % kKnownPads;
+    start = Clock::now();
+    Transfer(openMs);
+    const DeviceInfo* cached = cache.Find(PadId(pad), 0xA8, 0x0102);
+    DeviceInfo info = cached ? *cached : PadInfo(pad);
+    hits += cached != nullptr;
+    Transfer(roundTripMs);  // report mode
+    ready.push_back(MsSince(start));
+  }
+  s = Summarize(ready);
+  std::printf("%-8s %12.3fms %12.3fms   %d/%d hits\n", "cached", s.medianMs, s.maxMs, hits,
+              connects);
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
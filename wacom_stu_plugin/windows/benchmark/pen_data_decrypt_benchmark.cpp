@@ -0,0 +1,247 @@
+// Encrypted pen data against plain, on what the host pays for it.
+//
+// AES: portable and AES-NI decryption, one block per call as a decrypt on
+// the report thread would go, and in the DecryptWorker's batches.
+//
+// Report thread: time per report to decode a plain PenDataTimeCountSequence
+// report in place, against handing its encrypted twin to the DecryptWorker.
+//
+// End to end: reports pushed at the pad's 200 Hz and the time from read to
+// decoded sample, plain and through the worker.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "aes128.h"
+#include "decrypt_worker.h"
+#include "host_clock.h"
+#include "report_decoder.h"
+#include "session_key_exchange.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kPasses = 5;
+constexpr size_t kReports = 1 << 16;
+constexpr uint32_t kSessionId = 0x5EC0DE01;
+constexpr int kRateHz = 200;
+constexpr auto kRealTime = std::chrono::seconds(2);
+
+double NsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// A stroke's worth of reports, plain and as the pad encrypts them
+struct Reports {
+  std::vector<std::array<uint8_t, 11>> plain;
+  std::vector<std::array<uint8_t, 17>> encrypted;
+};
+
+Reports MakeReports(const Aes128& aes) {
+  Reports reports;
+  for (size_t i = 0; i < kReports; ++i) {
+    const uint16_t x = uint16_t(1000 + i % 8000);
+    const uint16_t y = uint16_t(2000 + i % 5000);
+    const uint16_t timeCount = uint16_t(i * 5);
+    const uint16_t sequence = uint16_t(i);
+    reports.plain.push_back({kPenReportDataTimeCountSequence, 0x81, 0x00, uint8_t(x >> 8),
+                             uint8_t(x), uint8_t(y >> 8), uint8_t(y), uint8_t(timeCount >> 8),
+                             uint8_t(timeCount), uint8_t(sequence >> 8), uint8_t(sequence)});
+    std::array<uint8_t, 17> encrypted{kPenReportDataTimeCountSequenceEncrypted};
+    std::copy(reports.plain.back().begin() + 1, reports.plain.back().end(),
+              encrypted.begin() + 1);
+    encrypted[11] = uint8_t(kSessionId >> 24);
+    encrypted[12] = uint8_t(kSessionId >> 16);
+    encrypted[13] = uint8_t(kSessionId >> 8);
+    encrypted[14] = uint8_t(kSessionId);
+    aes.Encrypt(encrypted.data() + 1, encrypted.data() + 1, 1);
+    reports.encrypted.push_back(encrypted);
+  }
+  return reports;
+}
+
+void TimeKeyExchange() {
+  const auto start = Clock::now();
+  SessionKeyExchange host;
+  SessionKeyExchange pad;
+  const auto hostPublic = host.GeneratePublicKey();
+  const auto padPublic = pad.GeneratePublicKey();
+  SessionKeyExchange::Key hostKey{}, padKey{};
+  host.ComputeSessionKey(padPublic, hostKey);
+  pad.ComputeSessionKey(hostPublic, padKey);
+  std::printf("key exchange:  %8.2f ms for both sides, keys %s\n", NsSince(start) / 2e6,
+              hostKey == padKey ? "agree" : "DIFFER");
+}
+
+// Best of kPasses over every report's block, in ns per block
+double TimeDecrypt(Aes128& aes, const Reports& reports, size_t batch) {
+  std::vector<uint8_t> blocks(kReports * Aes128::kBlockSize);
+  double best = 1e30;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (size_t i = 0; i < kReports; ++i) {
+      std::copy(reports.encrypted[i].begin() + 1, reports.encrypted[i].end(),
+                blocks.begin() + i * Aes128::kBlockSize);
+    }
+    const auto start = Clock::now();
+    for (size_t i = 0; i < kReports; i += batch) {
+      aes.Decrypt(blocks.data() + i * Aes128::kBlockSize, blocks.data() + i * Aes128::kBlockSize,
+                  std::min(batch, kReports - i));
+    }
+    best = std::min(best, NsSince(start) / kReports);
+  }
+  return best;
+}
+
+void CompareAes(Aes128& aes, const Reports& reports) {
+  for (bool hardware : {false, true}) {
+    aes.UseHardware(hardware);
+    if (hardware && !aes.hardware()) {
+      std::printf("aes-ni:        not on this CPU\n");
+      continue;
+    }
+    const double single = TimeDecrypt(aes, reports, 1);
+    const double batched = TimeDecrypt(aes, reports, DecryptWorker::kMaxBatch);
+    std::printf("%-14s %7.1f ns/block single, %7.1f ns/block in batches of %zu\n",
+                hardware ? "aes-ni:" : "aes portable:", single, batched,
+                DecryptWorker::kMaxBatch);
+  }
+}
+
+// Report thread time per report, plain decoding in place against a push to
+// the worker. Pushes go in runs the queue can hold, the worker catching up
+// between runs outside the timing.
+void CompareReportThread(const uint8_t* key, const Reports& reports) {
+  double plainBest = 1e30;
+  uint64_t plainSamples = 0;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    DeviceClockEstimator clock;
+    PenReportDecoder decoder(&clock);
+    PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+    plainSamples = 0;
+    const auto start = Clock::now();
+    for (size_t i = 0; i < kReports; ++i) {
+      plainSamples += decoder.Decode(reports.plain[i].data(), reports.plain[i].size(),
+                                     int64_t(i) * 5000, samples);
+    }
+    plainBest = std::min(plainBest, NsSince(start) / kReports);
+  }
+  std::printf("report thread plain:     %6.1f ns/report, %llu samples\n", plainBest,
+              (unsigned long long)plainSamples);
+
+  constexpr size_t kRun = 256;
+  double pushBest = 1e30;
+  uint64_t encryptedSamples = 0;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    DeviceClockEstimator clock;
+    uint64_t count = 0;
+    DecryptWorker worker(key, kSessionId, &clock, [&count](const PenSample&) { ++count; });
+    double ns = 0;
+    for (size_t run = 0; run < kReports; run += kRun) {
+      const auto start = Clock::now();
+      for (size_t i = run; i < run + kRun; ++i) {
+        worker.Push(reports.encrypted[i].data(), reports.encrypted[i].size(), int64_t(i) * 5000);
+      }
+      ns += NsSince(start);
+      worker.WaitIdle();
+    }
+    pushBest = std::min(pushBest, ns / kReports);
+    encryptedSamples = count;
+  }
+  std::printf("report thread encrypted: %6.1f ns/report, %llu samples\n", pushBest,
+              (unsigned long long)encryptedSamples);
+}
+
+struct Latency {
+  double p50Us = 0;
+  double p99Us = 0;
+  double maxUs = 0;
+};
+
+Latency Summarize(std::vector<double> latencies) {
+  Latency latency;
+  if (latencies.empty()) return latency;
+  std::sort(latencies.begin(), latencies.end());
+  latency.p50Us = latencies[latencies.size() / 2];
+  latency.p99Us = latencies[latencies.size() * 99 / 100];
+  latency.maxUs = latencies.back();
+  return latency;
+}
+
+// Pushes reports at the pad's rate and measures read to decoded sample.
+// |handle| gets each report with its read time.
+template <typename Handle>
+void PaceReports(const Reports& reports, bool encrypted, Handle handle) {
+  const auto period = std::chrono::microseconds(1000000 / kRateHz);
+  const auto end = Clock::now() + kRealTime;
+  auto next = Clock::now();
+  for (size_t i = 0; next < end; ++i) {
+    std::this_thread::sleep_until(next);
+    const size_t at = i % kReports;
+    if (encrypted) {
+      handle(reports.encrypted[at].data(), reports.encrypted[at].size(), HostTimeUs());
+    } else {
+      handle(reports.plain[at].data(), reports.plain[at].size(), HostTimeUs());
+    }
+    next += period;
+  }
+}
+
+void PrintLatency(const char* name, const Latency& latency) {
+  std::printf("%-24s p50 %6.1f us, p99 %6.1f us, max %7.1f us\n", name, latency.p50Us,
+              latency.p99Us, latency.maxUs);
+}
+
+void CompareEndToEnd(const uint8_t* key, const Reports& reports) {
+  {
+    DeviceClockEstimator clock;
+    PenReportDecoder decoder(&clock);
+    std::vector<double> latencies;
+    PaceReports(reports, false, [&](const uint8_t* report, size_t size, int64_t readUs) {
+      PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+      const size_t count = decoder.Decode(report, size, readUs, samples);
+      for (size_t i = 0; i < count; ++i) {
+        latencies.push_back(double(HostTimeUs() - samples[i].timestampUs));
+      }
+    });
+    PrintLatency("end to end plain:", Summarize(latencies));
+  }
+
+  for (bool hardware : {false, true}) {
+    if (hardware && !Aes128::HardwareSupported()) continue;
+    DeviceClockEstimator clock;
+    std::vector<double> latencies;
+    {
+      DecryptWorker worker(
+          key, kSessionId, &clock,
+          [&latencies](const PenSample& sample) {
+            latencies.push_back(double(HostTimeUs() - sample.timestampUs));
+          },
+          hardware);
+      PaceReports(reports, true, [&worker](const uint8_t* report, size_t size, int64_t readUs) {
+        worker.Push(report, size, readUs);
+      });
+    }
+    PrintLatency(hardware ? "end to end aes-ni:" : "end to end portable:",
+                 Summarize(latencies));
+  }
+}
+
+}  // namespace
+
+int main() {
+  uint8_t key[Aes128::kBlockSize];
+  for (size_t i = 0; i < sizeof(key); ++i) key[i] = uint8_t(i * 37 + 11);
+  Aes128 aes(key);
+  const Reports reports = MakeReports(aes);
+
+  TimeKeyExchange();
+  CompareAes(aes, reports);
+  CompareReportThread(key, reports);
+  CompareEndToEnd(key, reports);
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Compares enqueue latency on the report thread for the old
+// std::queue + mutex hand-off against SpscRing.
+//
+// The consumer mimics the platform thread: it wakes up periodically and
+// spends a fixed amount of time per sample "in eventSink->Success". With the
+// mutex queue that time is spent holding the lock the producer needs.
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   pen_sample_ring_benchmark [samples_per_rate]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "pen_sample.h"
+#include "spsc_ring.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Rough cost of encoding and sending one event through the codec
+constexpr auto kDeliverCost = std::chrono::microseconds(40);
+// How often the platform thread gets around to the wakeup message
+constexpr auto kConsumerPeriod = std::chrono::milliseconds(4);
+
+void SpinFor(Clock::duration d) {
+  const auto end = Clock::now() + d;
+  while (Clock::now() < end) {
+  }
+}
+
+class MutexQueue {
+ public:
+  void Push(const PenSample& s) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push(s);
+  }
+
+  void Drain() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!queue_.empty()) {
+      SpinFor(kDeliverCost);
+      queue_.pop();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::queue<PenSample> queue_;
+};
+
+class RingQueue {
+ public:
+  void Push(const PenSample& s) { ring_.TryPush(s); }
+
+  void Drain() {
+    ring_.Drain([](const PenSample&) { SpinFor(kDeliverCost); });
+  }
+
+  uint64_t dropped() const { return ring_.stats().dropped; }
+
+ private:
+  SpscRing<PenSample, 4096> ring_;
+};
+
+struct Result {
+  double p50Us;
+  double p99Us;
+  double maxUs;
+};
+
+template <typename Queue>
+Result Run(Queue& queue, int rateHz, int samples) {
+  std::atomic<bool> running{true};
+  std::thread consumer([&] {
+    while (running.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(kConsumerPeriod);
+      queue.Drain();
+    }
+    queue.Drain();
+  });
+
+  std::vector<double> latencies;
+  latencies.reserve(samples);
+  const auto period = std::chrono::nanoseconds(1000000000LL / rateHz);
+  auto next = Clock::now();
+
+  for (int i = 0; i < samples; ++i) {
+    next += period;
+    while (Clock::now() < next) {
+      std::this_thread::yield();
+    }
+
+    PenSample s;
+    s.x = static_cast<uint16_t>(i);
+    s.y = static_cast<uint16_t>(i * 3);
+    s.pressure = 512;
+
+    const auto start = Clock::now();
+    queue.Push(s);
+    const auto end = Clock::now();
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  running = false;
+  consumer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  Result r;
+  r.p50Us = latencies[latencies.size() / 2];
+  r.p99Us = latencies[(latencies.size() * 99) / 100];
+  r.maxUs = latencies.back();
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int samples = argc > 1 ? std::atoi(argv[1]) : 4000;
+  const int rates[] = {200, 500, 1000, 2000};
+
+  std::printf("%-8s %-12s %10s %10s %10s %8s\n", "rate", "queue", "p50(us)",
+              "p99(us)", "max(us)", "dropped");
+  for (int rate : rates) {
+    MutexQueue mutexQueue;
+    const Result m = Run(mutexQueue, rate, samples);
+    std::printf("%-8d %-12s %10.2f %10.2f %10.2f %8s\n", rate, "mutex", m.p50Us,
+                m.p99Us, m.maxUs, "-");
+
+    auto ringQueue = std::make_unique<RingQueue>();
+    const Result r = Run(*ringQueue, rate, samples);
+    std::printf("%-8d %-12s %10.2f %10.2f %10.2f %8llu\n", rate, "spsc_ring",
+                r.p50Us, r.p99Us, r.maxUs,
+                static_cast<unsigned long long>(ringQueue->dropped()));
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Cost of mapping a drained batch to drawing coordinates: the plugin's
+// fixed-point PenTransform against the per-sample double arithmetic the
+// Dart listener used to do (two divisions per axis, screen then canvas).
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   pen_transform_benchmark [batches] [batch size]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "pen_sample.h"
+#include "pen_transform.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t kMaxX = 9600;
+constexpr uint16_t kMaxY = 6000;
+constexpr double kCanvasWidth = 400;
+constexpr double kCanvasHeight = 250;
+
+double NsPerSample(Clock::duration elapsed, size_t samples) {
+  return std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int batches = argc > 1 ? std::atoi(argv[1]) : 20000;
+  const size_t batchSize = argc > 2 ? size_t(std::atoi(argv[2])) : 32;
+
+  std::vector<PenSample> samples(batchSize);
+  for (size_t i = 0; i < batchSize; ++i) {
+    samples[i].x = uint16_t((i * 577) % kMaxX);
+    samples[i].y = uint16_t((i * 311) % kMaxY);
+    samples[i].pressure = uint16_t(i * 7 % 1024);
+  }
+  std::vector<int32_t> x(batchSize), y(batchSize), pressure(batchSize);
+  std::vector<double> dx(batchSize), dy(batchSize), dp(batchSize);
+  volatile double maxX = kMaxX, maxY = kMaxY;
+
+  auto start = Clock::now();
+  for (int b = 0; b < batches; ++b) {
+    for (size_t i = 0; i < batchSize; ++i) {
+      const double screenX = samples[i].x / maxX * 800;
+      const double screenY = samples[i].y / maxY * 480;
+      (void)screenX;
+      (void)screenY;
+      dx[i] = samples[i].x / maxX * kCanvasWidth;
+      dy[i] = samples[i].y / maxY * kCanvasHeight;
+      dp[i] = samples[i].pressure / 1023.0;
+    }
+  }
+  const double doubleNs = NsPerSample(Clock::now() - start, size_t(batches) * batchSize);
+
+  PenTransform transform;
+  PenTransform::Config config;
+  config.a = kCanvasWidth / kMaxX;
+  config.e = kCanvasHeight / kMaxY;
+  config.pressureCurve = {0.0, 0.6, 0.85, 1.0};
+  config.clamp = true;
+  config.maxX = kCanvasWidth;
+  config.maxY = kCanvasHeight;
+  transform.Configure(config, kMaxX, kMaxY, 1023);
+
+  start = Clock::now();
+  for (int b = 0; b < batches; ++b) {
+    transform.Apply(samples.data(), batchSize, x.data(), y.data(), pressure.data());
+  }
+  const double fixedNs = NsPerSample(Clock::now() - start, size_t(batches) * batchSize);
+
+  std::printf("%d batches of %zu samples\n", batches, batchSize);
+  std::printf("%-26s %8.2f ns/sample\n", "double, per sample", doubleNs);
+  std::printf("%-26s %8.2f ns/sample\n", "PenTransform fixed point", fixedNs);
+  std::printf("check %d %d %d %.1f\n", x[batchSize - 1], y[batchSize - 1], pressure[batchSize - 1],
+              dx[batchSize - 1] + dy[batchSize - 1] + dp[batchSize - 1]);
+  return 0;
+}
@@ -0,0 +1,183 @@
+// Encodes a corpus of rendered signatures with each PNG preset and compares
+// size and encode time against an RGBA baseline.
+//
+// The baseline stands in for the Dart path's ImageByteFormat.png: the engine
+// always writes 8-bit RGBA with per-row adaptive filters, which is what
+// EncodePng produces with reduceColorType off. The engine itself cannot run
+// here, so its zlib level is not reproduced; the color type is where most of
+// the difference comes from.
+//
+// With no arguments a built-in set of synthetic signatures is used. Recorded
+// signatures can be passed as CSV files of "strokeId,x,y,pressure" rows in
+// tablet units (9600 x 6000, pressure 0-1023).
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   png_encoder_benchmark [signature.csv ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "png_encoder.h"
+#include "signature_rasterizer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kTabletWidth = 9600;
+constexpr double kTabletHeight = 6000;
+constexpr uint16_t kMaxPressure = 1023;
+constexpr auto kMinRunTime = std::chrono::milliseconds(200);
+
+using Signature = std::vector<std::vector<InkPoint>>;
+
+// Cursive-looking strokes: a baseline drift with loops, pressure swelling
+// in the middle of each stroke
+Signature SyntheticSignature(unsigned seed) {
+  Signature signature;
+  unsigned state = seed * 2654435761u + 1;
+  auto random = [&state] {
+    state = state * 1664525u + 1013904223u;
+    return double(state >> 8) / double(1u << 24);
+  };
+
+  const int strokes = 2 + int(random() * 4);
+  double x = 600 + random() * 800;
+  for (int s = 0; s < strokes; ++s) {
+    std::vector<InkPoint> points;
+    const int count = 120 + int(random() * 300);
+    const double loops = 3 + random() * 6;
+    const double height = 900 + random() * 1400;
+    const double advance = (7800 - x) / (strokes - s) / count;
+    const double baseline = 2600 + random() * 1000;
+    for (int i = 0; i < count; ++i) {
+      const double t = double(i) / (count - 1);
+      const double phase = t * loops * 6.283185307;
+      x += advance * (1.0 + 0.8 * std::cos(phase));
+      const double y = baseline - height * std::sin(phase) * (0.6 + 0.4 * std::sin(t * 3.14159));
+      const double pressure = kMaxPressure * (0.25 + 0.6 * std::sin(t * 3.14159));
+      points.push_back({uint16_t(std::clamp(x, 0.0, kTabletWidth)),
+                        uint16_t(std::clamp(y, 0.0, kTabletHeight)),
+                        uint16_t(pressure)});
+    }
+    signature.push_back(std::move(points));
+    x += 200 + random() * 400;
+  }
+  return signature;
+}
+
+bool LoadSignature(const char* path, Signature& signature) {
+  FILE* file = std::fopen(path, "r");
+  if (!file) return false;
+  std::map<long, std::vector<InkPoint>> strokes;
+  long id;
+  unsigned x, y, pressure;
+  while (std::fscanf(file, "%ld,%u,%u,%u", &id, &x, &y, &pressure) == 4) {
+    strokes[id].push_back({uint16_t(x), uint16_t(y), uint16_t(pressure)});
+  }
+  std::fclose(file);
+  for (auto& entry : strokes) signature.push_back(std::move(entry.second));
+  return !signature.empty();
+}
+
+// Same mapping as the plugin's renderSignature: 400 x 200 logical pixels
+// with 1.2 - 2.8 px stroke width, scaled by the device pixel ratio
+std::vector<uint8_t> Render(const Signature& signature, double pixelRatio,
+                            int& width, int& height) {
+  RasterOptions options;
+  options.width = width = int(400 * pixelRatio);
+  options.height = height = int(200 * pixelRatio);
+  options.scaleX = width / kTabletWidth;
+  options.scaleY = height / kTabletHeight;
+  options.minRadius = float(0.6 * pixelRatio);
+  options.maxRadius = float(1.4 * pixelRatio);
+  options.maxPressure = kMaxPressure;
+  options.color = 0xFF2563EB;
+
+  std::vector<const std::vector<InkPoint>*> strokes;
+  for (const auto& s : signature) strokes.push_back(&s);
+  return RasterizeStrokes(strokes, options);
+}
+
+struct Config {
+  const char* name;
+  PngOptions options;
+};
+
+struct Totals {
+  size_t bytes = 0;
+  double us = 0;
+  std::map<int, int> colorTypes;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<Signature> corpus;
+  for (int i = 1; i < argc; ++i) {
+    Signature signature;
+    if (LoadSignature(argv[i], signature)) {
+      corpus.push_back(std::move(signature));
+    } else {
+      std::fprintf(stderr, "skipping %s\n", argv[i]);
+    }
+  }
+  if (corpus.empty()) {
+    for (unsigned seed = 1; seed <= 24; ++seed) corpus.push_back(SyntheticSignature(seed));
+  }
+
+  Config configs[4];
+  configs[0].name = "rgba-baseline";
+  configs[0].options.reduceColorType = false;
+  configs[1].name = "fast";
+  configs[1].options.preset = PngPreset::kFast;
+  configs[2].name = "balanced";
+  configs[2].options.preset = PngPreset::kBalanced;
+  configs[3].name = "smallest";
+  configs[3].options.preset = PngPreset::kSmallest;
+
+  std::printf("%zu signatures\n", corpus.size());
+  std::printf("%-6s %-14s %12s %10s %12s %s\n", "ratio", "config", "avg bytes",
+              "vs base", "avg us", "color types");
+  for (double pixelRatio : {1.0, 2.0, 3.0}) {
+    Totals totals[4];
+    for (const Signature& signature : corpus) {
+      int width, height;
+      const auto rgba = Render(signature, pixelRatio, width, height);
+      for (int c = 0; c < 4; ++c) {
+        std::vector<uint8_t> png;
+        int runs = 0;
+        const auto start = Clock::now();
+        auto now = start;
+        do {
+          png = EncodePng(rgba.data(), width, height, size_t(width) * 4,
+                          configs[c].options);
+          ++runs;
+          now = Clock::now();
+        } while (now - start < kMinRunTime / int(corpus.size()));
+        totals[c].bytes += png.size();
+        totals[c].us +=
+            std::chrono::duration<double, std::micro>(now - start).count() / runs;
+        ++totals[c].colorTypes[png[25]];
+      }
+    }
+
+    const double n = double(corpus.size());
+    for (int c = 0; c < 4; ++c) {
+      std::string types;
+      for (const auto& entry : totals[c].colorTypes) {
+        types += std::to_string(entry.first) + ":" + std::to_string(entry.second) + " ";
+      }
+      std::printf("%-6.0f %-14s %12.0f %9.1f%% %12.1f %s\n", pixelRatio,
+                  configs[c].name, totals[c].bytes / n,
+                  100.0 * totals[c].bytes / totals[0].bytes, totals[c].us / n,
+                  types.c_str());
+    }
+  }
+  return 0;
+}
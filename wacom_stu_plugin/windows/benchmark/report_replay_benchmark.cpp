@@ -0,0 +1,268 @@
+// Report thread cost per report, replayed from a recorded session with no
+// pad attached.
+//
+// Each report goes through the path the report thread takes:
+// PenReportDecoder, then the PenPipeline both plugins run, into the ring
+// the platform thread drains, drained here every few reports. Fast
+// replay gives reports per second; real-time replay also gives how late
+// each report was handed over against its recorded spacing.
+//
+// Decoding alone is also timed: the table decoder one report at a time and
+// over the whole session in one pass. With WACOM_STU_REPLAY_SDK, i.e. the
+// SDK's protocol sources found at configure time, also the SDK's virtual
+// report handler dispatching to PenHandler, as the report thread used to.
+//
+// Record a session with startReportRecording, or leave the path out for a
+// synthetic one: a minute of signing at 200 reports/s.
+//
+// Builds without a pad, Flutter or the SDK from benchmark/CMakeLists.txt;
+// pass -DWACOM_SDK_DIR=<sdk>/cpp for the SDK comparison. Run
+//   report_replay_benchmark [session] [realtime speed]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "pen_pipeline.h"
+#include "report_decoder.h"
+#include "report_session.h"
+
+#ifdef WACOM_STU_REPLAY_SDK
+#include "pen_handler.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kReportRate = 200;
+constexpr int kPasses = 20;
+// Reports between drains, about one wakeup's worth
+constexpr int kDrainEvery = 8;
+
+// PenDataTimeCountSequence: report id, then rdy, switch and the pressure's
+// high bits, pressure low, x, y, time count and sequence, big-endian
+std::vector<uint8_t> TimeCountSequenceReport(bool rdy, uint16_t pressure, uint16_t x,
+                                             uint16_t y, uint16_t timeCount,
+                                             uint16_t sequence) {
+  return {kPenReportDataTimeCountSequence,
+          uint8_t((rdy ? 0x80 : 0) | ((pressure >> 8) & 0x0F)),
+          uint8_t(pressure),
+          uint8_t(x >> 8),
+          uint8_t(x),
+          uint8_t(y >> 8),
+          uint8_t(y),
+          uint8_t(timeCount >> 8),
+          uint8_t(timeCount),
+          uint8_t(sequence >> 8),
+          uint8_t(sequence)};
+}
+
+// A minute of loops, pen down for a second and up for a fifth
+bool WriteSyntheticSession(const std::string& path) {
+  ReportSessionHeader header;
+  header.productId = 0xA8;
+  header.tabletMaxX = 9600;
+  header.tabletMaxY = 6000;
+  header.tabletMaxPressure = 1023;
+  header.screenWidth = 800;
+  header.screenHeight = 480;
+  header.startUs = 1'000'000;
+  ReportSessionWriter writer;
+  if (!writer.Open(path, header)) return false;
+  const int periodUs = 1'000'000 / kReportRate;
+  for (int i = 0; i < 60 * kReportRate; ++i) {
+    const double t = double(i) / kReportRate;
+    const bool down = std::fmod(t, 1.2) < 1.0;
+    const auto report = TimeCountSequenceReport(
+        true, down ? uint16_t(300 + 200 * std::sin(t * 7)) : 0,
+        uint16_t(4800 + 3000 * std::cos(t * 3) + 400 * std::sin(t * 31)),
+        uint16_t(3000 + 1500 * std::sin(t * 5)), uint16_t(i * periodUs / 1000),
+        uint16_t(i));
+    // Some jitter in when the host read each one
+    writer.Append(header.startUs + int64_t(i) * periodUs + (i * 37 % 500), report.data(),
+                  report.size());
+  }
+  return writer.Close();
+}
+
+struct Pipeline {
+  explicit Pipeline(const ReportSessionHeader& header) : decoder(&clock) {
+    pen.strokeTracker.SetThresholds(
+        StrokeTracker::ThresholdsForMaxPressure(header.tabletMaxPressure));
+    StrokeSimplifier::Config config;
+    config.enabled = true;
+    config.minDistance = 4;
+    config.tolerance = 2;
+    pen.strokeSimplifier.SetConfig(config);
+  }
+
+  // As the report thread
+  void Handle(const ReportRecord& record) {
+    PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+    const size_t count = decoder.Decode(record.data, record.size, record.hostUs, samples);
+    for (size_t i = 0; i < count; ++i) pen.Process(samples[i]);
+  }
+
+  void Drain() {
+    drained += pen.ring.Drain([](const PenSample&) {});
+  }
+
+  DeviceClockEstimator clock;
+  PenPipeline pen;
+  PenReportDecoder decoder;
+  uint64_t drained = 0;
+};
+
+// Best of kPasses runs of |decode| over the session, in ns per report.
+// |decode| returns the samples it produced, which are summed into |samples|
+// so the work cannot be optimized away.
+template <typename Decode>
+double TimeDecode(const ReportSession& session, Decode decode, uint64_t& samples) {
+  double bestNs = 1e30;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    DeviceClockEstimator clock;
+    const auto start = Clock::now();
+    samples = decode(clock);
+    bestNs = std::min(
+        bestNs,
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count() / session.size());
+  }
+  return bestNs;
+}
+
+void CompareDecoders(const ReportSession& session) {
+  uint64_t samples = 0;
+
+#ifdef WACOM_STU_REPLAY_SDK
+  // The SDK path: a Report per read, the virtual handleReport, and one of
+  // six onReport overloads
+  const double sdkNs = TimeDecode(
+      session,
+      [&session](DeviceClockEstimator& clock) {
+        uint64_t count = 0;
+        PenHandler handler([&count](const PenSample&) { ++count; }, &clock);
+        WacomGSS::STU::Report report;
+        for (size_t i = 0; i < session.size(); ++i) {
+          const ReportRecord& record = session[i];
+          report.assign(record.data, record.data + record.size);
+          handler.SetReportTime(record.hostUs);
+          handler.handleReport(report.begin(), report.end(), false);
+        }
+        return count;
+      },
+      samples);
+  std::printf("decode sdk:       %6.1f ns/report, %6.1fM reports/s, %llu samples\n", sdkNs,
+              1e3 / sdkNs, (unsigned long long)samples);
+#endif
+
+  const double tableNs = TimeDecode(
+      session,
+      [&session](DeviceClockEstimator& clock) {
+        uint64_t count = 0;
+        PenReportDecoder decoder(&clock);
+        PenSample out[PenReportDecoder::kMaxSamplesPerReport];
+        for (size_t i = 0; i < session.size(); ++i) {
+          const ReportRecord& record = session[i];
+          count += decoder.Decode(record.data, record.size, record.hostUs, out);
+        }
+        return count;
+      },
+      samples);
+  std::printf("decode table:     %6.1f ns/report, %6.1fM reports/s, %llu samples\n", tableNs,
+              1e3 / tableNs, (unsigned long long)samples);
+
+  // Allocated once, outside the timing
+  std::vector<PenSample> flat(session.size() * PenReportDecoder::kMaxSamplesPerReport);
+  const double passNs = TimeDecode(
+      session,
+      [&session, &flat](DeviceClockEstimator& clock) {
+        PenReportDecoder decoder(&clock);
+        return uint64_t(decoder.Decode(&session[0], session.size(), flat.data(), flat.size()));
+      },
+      samples);
+  std::printf("decode one pass:  %6.1f ns/report, %6.1fM reports/s, %llu samples\n", passNs,
+              1e3 / passNs, (unsigned long long)samples);
+#ifdef WACOM_STU_REPLAY_SDK
+  std::printf("table vs sdk:     x%.1f, one pass x%.1f\n", sdkNs / tableNs, sdkNs / passNs);
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string path = argc > 1 ? argv[1] : "";
+  const double realTimeSpeed = argc > 2 ? std::atof(argv[2]) : 0.0;
+
+  const bool synthetic = path.empty();
+  if (synthetic) {
+    path = (std::filesystem::temp_directory_path() / "report_replay_benchmark.stureport")
+               .u8string();
+    if (!WriteSyntheticSession(path)) {
+      std::fprintf(stderr, "cannot write %s\n", path.c_str());
+      return 1;
+    }
+  }
+  ReportSession session;
+  if (!session.Load(path)) {
+    std::fprintf(stderr, "cannot read session %s\n", path.c_str());
+    return 1;
+  }
+  if (synthetic) std::filesystem::remove(path);
+  if (session.size() == 0) {
+    std::fprintf(stderr, "empty session\n");
+    return 1;
+  }
+  const double seconds = (session[session.size() - 1].hostUs - session[0].hostUs) / 1e6;
+  std::printf("%zu reports, %.1f s recorded%s\n", session.size(), seconds,
+              synthetic ? " (synthetic)" : "");
+
+  // As fast as possible, a fresh pipeline per pass
+  double bestNs = 1e30;
+  uint64_t samplesOut = 0;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    Pipeline pipeline(session.header());
+    ReportReplay replay(session, {});
+    ReportRecord record;
+    const auto start = Clock::now();
+    for (int n = 1; replay.Next(record); ++n) {
+      pipeline.Handle(record);
+      if (n % kDrainEvery == 0) pipeline.Drain();
+    }
+    pipeline.Drain();
+    const double ns =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count() / session.size();
+    bestNs = std::min(bestNs, ns);
+    samplesOut = pipeline.drained;
+  }
+  std::printf("fast:      %8.1f ns/report, %.2fM reports/s, %llu samples out\n", bestNs,
+              1e3 / bestNs, (unsigned long long)samplesOut);
+
+  CompareDecoders(session);
+
+  if (realTimeSpeed > 0) {
+    Pipeline pipeline(session.header());
+    ReportReplay replay(session, {true, realTimeSpeed, 0});
+    ReportRecord record;
+    std::vector<double> lateUs;
+    lateUs.reserve(session.size());
+    const auto start = Clock::now();
+    for (int n = 1; replay.Next(record); ++n) {
+      const double dueUs = (record.hostUs - session[0].hostUs) / realTimeSpeed;
+      lateUs.push_back(
+          std::chrono::duration<double, std::micro>(Clock::now() - start).count() - dueUs);
+      pipeline.Handle(record);
+      if (n % kDrainEvery == 0) pipeline.Drain();
+    }
+    std::sort(lateUs.begin(), lateUs.end());
+    std::printf("real time: x%.1f, late by median %.0f us, p99 %.0f us, max %.0f us\n",
+                realTimeSpeed, lateUs[lateUs.size() / 2], lateUs[lateUs.size() * 99 / 100],
+                lateUs.back());
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+// Models the report thread's read loop to compare the old 2 ms sleep poll
+// against a blocking wait on the interface queue.
+//
+// A producer stands in for the SDK's USB reader: it stamps each report with
+// its arrival time and pushes at the tablet's report rate for a while, then
+// goes quiet as if the pen had left the pad. For each strategy we report the
+// arrival-to-read latency while the pen is active, and the wakeups and CPU
+// time spent while it is idle.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRateHz = 200;
+constexpr auto kActiveTime = std::chrono::seconds(2);
+constexpr auto kIdleTime = std::chrono::seconds(2);
+
+// Stand-in for WacomGSS::STU::InterfaceQueue
+class ReportQueue {
+ public:
+  void Push(Clock::time_point arrival) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reports_.push_back(arrival);
+    }
+    cv_.notify_one();
+  }
+
+  bool TryGet(Clock::time_point& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reports_.empty()) return false;
+    out = reports_.front();
+    reports_.pop_front();
+    return true;
+  }
+
+  template <typename Predicate>
+  bool WaitGet(Clock::time_point& out, Predicate stop) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !reports_.empty() || stop(); });
+    if (reports_.empty()) return false;
+    out = reports_.front();
+    reports_.pop_front();
+    return true;
+  }
+
+  void NotifyAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Clock::time_point> reports_;
+};
+
+struct Result {
+  double p50Us = 0;
+  double p99Us = 0;
+  long idleWakeups = 0;
+  double idleCpuMs = 0;
+};
+
+template <typename ReadLoop>
+Result Run(ReadLoop readLoop) {
+  ReportQueue queue;
+  std::atomic<bool> running{true};
+  std::atomic<bool> idle{false};
+  std::atomic<long> idleWakeups{0};
+  std::vector<double> latencies;
+  latencies.reserve(1024);
+
+  std::thread reader([&] {
+    readLoop(queue, running, [&](Clock::time_point arrival, bool gotReport) {
+      if (idle.load(std::memory_order_relaxed)) {
+        idleWakeups.fetch_add(1, std::memory_order_relaxed);
+      } else if (gotReport) {
+        latencies.push_back(std::chrono::duration<double, std::micro>(
+                                Clock::now() - arrival)
+                                .count());
+      }
+    });
+  });
+
+  const auto period = std::chrono::microseconds(1000000 / kRateHz);
+  const auto activeEnd = Clock::now() + kActiveTime;
+  auto next = Clock::now();
+  while (next < activeEnd) {
+    std::this_thread::sleep_until(next);
+    queue.Push(Clock::now());
+    next += period;
+  }
+
+  // Let the reader drain, then measure an idle stretch
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  idle = true;
+  const std::clock_t cpuStart = std::clock();
+  std::this_thread::sleep_for(kIdleTime);
+  const std::clock_t cpuEnd = std::clock();
+
+  running = false;
+  queue.NotifyAll();
+  reader.join();
+
+  Result r;
+  std::sort(latencies.begin(), latencies.end());
+  if (!latencies.empty()) {
+    r.p50Us = latencies[latencies.size() / 2];
+    r.p99Us = latencies[(latencies.size() * 99) / 100];
+  }
+  r.idleWakeups = idleWakeups.load();
+  r.idleCpuMs = 1000.0 * (cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+  return r;
+}
+
+void Print(const char* name, const Result& r) {
+  std::printf("%-10s %12.1f %12.1f %14ld %14.2f\n", name, r.p50Us, r.p99Us,
+              r.idleWakeups, r.idleCpuMs);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-10s %12s %12s %14s %14s\n", "read", "p50(us)", "p99(us)",
+              "idle wakeups", "idle cpu(ms)");
+
+  Print("poll-2ms", Run([](ReportQueue& queue, std::atomic<bool>& running,
+                           auto onRead) {
+          while (running) {
+            Clock::time_point arrival;
+            if (queue.TryGet(arrival)) {
+              onRead(arrival, true);
+            } else {
+              onRead(arrival, false);
+              std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+          }
+        }));
+
+  Print("blocking", Run([](ReportQueue& queue, std::atomic<bool>& running,
+                           auto onRead) {
+          while (running) {
+            Clock::time_point arrival;
+            const bool got =
+                queue.WaitGet(arrival, [&] { return !running.load(); });
+            onRead(arrival, got);
+          }
+        }));
+  return 0;
+}
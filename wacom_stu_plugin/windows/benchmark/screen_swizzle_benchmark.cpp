@@ -0,0 +1,197 @@
+// Times the RGBA -> BGR24 conversion for one 800 x 480 signature screen
+// with each swizzle kernel, next to the copy setSignatureScreen used to make
+// of the codec buffer before writeImage.
+//
+// Then times each native screen encoding on a synthetic signature screen
+// (flat background, text-like strokes, a few coloured buttons) and prints
+// the bytes each one puts on the wire, and finally what a partial update
+// costs when only one button changes: the shadow diff, and the bytes of the
+// dirty rectangles against a full frame.
+//
+// "indexed" mirrors the per-pixel loop the Dart side used to run (two index
+// multiplications and three separate byte moves per pixel), compiled here,
+// so it is a lower bound on what that loop cost in the VM.
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   screen_swizzle_benchmark [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "screen_image.h"
+#include "screen_shadow.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kWidth = 800;
+constexpr int kHeight = 480;
+constexpr size_t kPixels = size_t(kWidth) * kHeight;
+
+struct Result {
+  double medianUs;
+  double minUs;
+};
+
+Result Time(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  fn();  // warm caches and page in the buffers
+  for (int i = 0; i < iterations; ++i) {
+    const auto start = Clock::now();
+    fn();
+    samples.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.front()};
+}
+
+// White screen, dark strokes and three coloured buttons along the bottom,
+// roughly what the signature dialog draws
+std::vector<uint8_t> SignatureScreen() {
+  std::vector<uint8_t> rgba(kPixels * 4, 255);
+  auto fill = [&](int x0, int y0, int x1, int y1, uint8_t r, uint8_t g, uint8_t b) {
+    for (int y = y0; y < y1; ++y) {
+      for (int x = x0; x < x1; ++x) {
+        uint8_t* p = &rgba[(size_t(y) * kWidth + x) * 4];
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+      }
+    }
+  };
+  for (int line = 0; line < 6; ++line) {
+    for (int x = 40; x < kWidth - 40; x += 7) {
+      fill(x, 40 + line * 50, x + 3, 40 + line * 50 + 12 + (x % 9), 30, 30, 30);
+    }
+  }
+  fill(0, 400, kWidth / 3, kHeight, 220, 38, 38);
+  fill(kWidth / 3, 400, 2 * kWidth / 3, kHeight, 100, 116, 139);
+  fill(2 * kWidth / 3, 400, kWidth, kHeight, 5, 150, 105);
+  return rgba;
+}
+
+void IndexedLoop(const uint8_t* rgba, uint8_t* bgr) {
+  for (size_t i = 0; i < kPixels; ++i) {
+    const size_t rgbaIndex = i * 4;
+    const size_t rgbIndex = i * 3;
+    bgr[rgbIndex] = rgba[rgbaIndex + 2];
+    bgr[rgbIndex + 1] = rgba[rgbaIndex + 1];
+    bgr[rgbIndex + 2] = rgba[rgbaIndex];
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+  std::vector<uint8_t> rgba(kPixels * 4);
+  for (size_t i = 0; i < rgba.size(); ++i) rgba[i] = uint8_t(i * 31 + (i >> 9));
+  std::vector<uint8_t> bgr(kPixels * 3);
+  std::vector<uint8_t> reference(kPixels * 3);
+  IndexedLoop(rgba.data(), reference.data());
+
+  std::printf("%dx%d, %d iterations, detected kernel: %s\n", kWidth, kHeight,
+              iterations, SwizzleKernelName(SwizzleKernel::kAuto));
+  std::printf("%-22s %12s %12s %10s\n", "conversion", "median(us)", "min(us)",
+              "GB/s in");
+
+  auto report = [&](const char* name, const Result& r, size_t bytesIn) {
+    std::printf("%-22s %12.1f %12.1f %10.2f\n", name, r.medianUs, r.minUs,
+                bytesIn / (r.medianUs * 1000.0));
+  };
+
+  report("indexed loop", Time(iterations, [&] { IndexedLoop(rgba.data(), bgr.data()); }),
+         rgba.size());
+
+  const SwizzleKernel kernels[] = {SwizzleKernel::kScalar, SwizzleKernel::kSsse3,
+                                   SwizzleKernel::kAvx2};
+  for (SwizzleKernel kernel : kernels) {
+    if (kernel > DetectSwizzleKernel()) {
+      std::printf("%-22s %12s\n", SwizzleKernelName(kernel), "unsupported");
+      continue;
+    }
+    std::fill(bgr.begin(), bgr.end(), uint8_t(0));
+    const Result r = Time(iterations, [&] {
+      SwizzleToBgr24(rgba.data(), ScreenPixelFormat::kRgba8888, kPixels, bgr.data(), kernel);
+    });
+    report(SwizzleKernelName(kernel), r, rgba.size());
+    if (bgr != reference) {
+      std::printf("  output mismatch!\n");
+      return 1;
+    }
+  }
+
+  // What setSignatureScreen used to spend copying the BGR vector it was
+  // handed before writeImage
+  std::vector<uint8_t> copy;
+  report("old vector copy", Time(iterations, [&] { copy = std::vector<uint8_t>(bgr); }),
+         bgr.size());
+
+  const std::vector<uint8_t> screen = SignatureScreen();
+  std::printf("\n%-22s %12s %12s %10s\n", "encoding", "median(us)", "min(us)", "bytes");
+  std::vector<uint8_t> encoded;
+  const ScreenEncoding encodings[] = {ScreenEncoding::k24Bit, ScreenEncoding::k16Bit,
+                                      ScreenEncoding::k1Bit, ScreenEncoding::k1BitZlib};
+  const std::pair<ScreenDither, const char*> dithers[] = {
+      {ScreenDither::kNone, "none"},
+      {ScreenDither::kOrdered, "ordered"},
+      {ScreenDither::kDiffusion, "diffusion"}};
+  for (ScreenEncoding encoding : encodings) {
+    for (const auto& [dither, ditherName] : dithers) {
+      if (encoding == ScreenEncoding::k24Bit && dither != ScreenDither::kNone) continue;
+      const Result r = Time(iterations, [&] {
+        EncodeScreen(screen.data(), ScreenPixelFormat::kRgba8888, kWidth, kHeight, encoding,
+                     dither, encoded);
+      });
+      char name[64];
+      std::snprintf(name, sizeof(name), "%s %s", ScreenEncodingName(encoding),
+                    encoding == ScreenEncoding::k24Bit ? "" : ditherName);
+      std::printf("%-22s %12.1f %12.1f %10zu\n", name, r.medianUs, r.minUs, encoded.size());
+    }
+  }
+
+  // One button relabelled: alternate two frames that differ in its area
+  std::vector<uint8_t> relabelled = screen;
+  for (int y = 430; y < 450; ++y) {
+    for (int x = 60; x < 200; x += 3) relabelled[(size_t(y) * kWidth + x) * 4 + 1] ^= 0xFF;
+  }
+  ScreenShadow shadow;
+  shadow.Update(screen.data(), kWidth, kHeight, 4, 0);
+  std::printf("\n%-22s %12s %12s %10s\n", "shadow diff", "median(us)", "min(us)", "rects");
+  const Result same = Time(iterations, [&] { shadow.Update(screen.data(), kWidth, kHeight, 4, 0); });
+  std::printf("%-22s %12.1f %12.1f %10d\n", "unchanged", same.medianUs, same.minUs, 0);
+  bool flip = false;
+  std::vector<ScreenRect> rects;
+  const Result changed = Time(iterations, [&] {
+    flip = !flip;
+    rects = shadow.Update(flip ? relabelled.data() : screen.data(), kWidth, kHeight, 4, 0);
+  });
+  std::printf("%-22s %12.1f %12.1f %10zu\n", "one button", changed.medianUs, changed.minUs,
+              rects.size());
+
+  std::printf("\n%-22s %12s %12s\n", "one button", "full bytes", "area bytes");
+  std::vector<uint8_t> area;
+  for (ScreenEncoding encoding : encodings) {
+    EncodeScreen(relabelled.data(), ScreenPixelFormat::kRgba8888, kWidth, kHeight, encoding,
+                 ScreenDither::kOrdered, encoded);
+    const size_t fullBytes = encoded.size();
+    size_t areaBytes = 0;
+    for (const ScreenRect& rect : rects) {
+      CopyScreenRect(relabelled.data(), kWidth, 4, rect, area);
+      EncodeScreen(area.data(), ScreenPixelFormat::kRgba8888, rect.width, rect.height, encoding,
+                   ScreenDither::kOrdered, encoded);
+      areaBytes += encoded.size();
+    }
+    std::printf("%-22s %12zu %12zu\n", ScreenEncodingName(encoding), fullBytes, areaBytes);
+  }
+  return 0;
+}
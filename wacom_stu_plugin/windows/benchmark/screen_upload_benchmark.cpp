@@ -0,0 +1,151 @@
+// Platform-thread stall of setSignatureScreen, synchronous vs. the screen
+// worker.
+//
+// Each call takes an 800 x 480 RGBA screen. The synchronous path encodes it
+// to RGB565 and then blocks for the USB transfer, modelled as a sleep at a
+// fixed link rate, which is what HandleMethodCall used to do. The worker
+// path copies the pixels and submits a job that does the same on the
+// LatestWinsWorker. Calls arrive back to back, as when the dialog swaps
+// screens, so later ones replace waiting ones instead of queueing.
+//
+// Then screens per second with several pads uploading at once, each on its
+// own link: one worker per pad, as the plugin runs them, vs. one worker
+// shared by all.
+//
+// Build with -DWACOM_STU_PLUGIN_BUILD_BENCHMARKS=ON, then run
+//   screen_upload_benchmark [calls] [link KB/s] [max pads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "latest_wins_worker.h"
+#include "screen_image.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kWidth = 800;
+constexpr int kHeight = 480;
+
+struct Summary {
+  double medianMs;
+  double maxMs;
+};
+
+Summary Summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.back()};
+}
+
+double MsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Encode and "transfer" one screen
+void Upload(const std::vector<uint8_t>& rgba, std::vector<uint8_t>& scratch, int linkKBps) {
+  EncodeScreen(rgba.data(), ScreenPixelFormat::kRgba8888, kWidth, kHeight, ScreenEncoding::k16Bit,
+               ScreenDither::kOrdered, scratch);
+  std::this_thread::sleep_for(std::chrono::microseconds(scratch.size() * 1000 / linkKBps));
+}
+
+// Every pad uploads |calls| screens back to back, each waiting for its last
+// to finish, through |workers| workers. Returns screens per second.
+double PadThroughput(int pads, int workers, int calls, int linkKBps,
+                     const std::vector<uint8_t>& rgba) {
+  std::vector<std::unique_ptr<LatestWinsWorker>> pool;
+  for (int i = 0; i < workers; ++i) pool.push_back(std::make_unique<LatestWinsWorker>());
+  // One worker runs one job at a time, so pads sharing it share its scratch
+  std::vector<std::vector<uint8_t>> scratch(workers);
+
+  const auto start = Clock::now();
+  std::vector<std::thread> drivers;
+  for (int pad = 0; pad < pads; ++pad) {
+    drivers.emplace_back([&, pad] {
+      LatestWinsWorker& worker = *pool[pad % workers];
+      std::vector<uint8_t>& padScratch = scratch[pad % workers];
+      for (int i = 0; i < calls; ++i) {
+        // A newer job would replace this one, so retry until it runs
+        std::atomic<bool> done{false};
+        while (!done) {
+          std::atomic<bool> finished{false};
+          worker.Submit(
+              [&](const std::atomic<bool>&) {
+                Upload(rgba, padScratch, linkKBps);
+                done = true;
+                return true;
+              },
+              [&finished](LatestWinsWorker::Outcome) { finished = true; });
+          while (!finished) std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& driver : drivers) driver.join();
+  return pads * calls / (MsSince(start) / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int calls = argc > 1 ? std::atoi(argv[1]) : 20;
+  const int linkKBps = argc > 2 ? std::atoi(argv[2]) : 4000;
+  const int maxPads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+  std::vector<uint8_t> rgba(size_t(kWidth) * kHeight * 4);
+  for (size_t i = 0; i < rgba.size(); ++i) rgba[i] = uint8_t(i * 13 + (i >> 11));
+  std::vector<uint8_t> scratch;
+
+  std::printf("%d calls, 16-bit screens, link %d KB/s\n", calls, linkKBps);
+  std::printf("%-12s %14s %14s %12s %10s\n", "path", "median stall", "max stall",
+              "uploads run", "total ms");
+
+  std::vector<double> stalls;
+  auto start = Clock::now();
+  for (int i = 0; i < calls; ++i) {
+    const auto callStart = Clock::now();
+    Upload(rgba, scratch, linkKBps);
+    stalls.push_back(MsSince(callStart));
+  }
+  Summary s = Summarize(stalls);
+  std::printf("%-12s %12.3fms %12.3fms %12d %10.1f\n", "synchronous", s.medianMs, s.maxMs, calls,
+              MsSince(start));
+
+  stalls.clear();
+  std::atomic<int> ran{0};
+  start = Clock::now();
+  {
+    LatestWinsWorker worker;
+    for (int i = 0; i < calls; ++i) {
+      const auto callStart = Clock::now();
+      // The plugin copies the codec's buffer the same way
+      auto pixels = std::make_shared<std::vector<uint8_t>>(rgba);
+      worker.Submit(
+          [pixels, &scratch, &ran, linkKBps](const std::atomic<bool>&) {
+            Upload(*pixels, scratch, linkKBps);
+            ran++;
+            return true;
+          },
+          [](LatestWinsWorker::Outcome) {});
+      stalls.push_back(MsSince(callStart));
+    }
+    worker.WaitIdle();
+  }
+  s = Summarize(stalls);
+  std::printf("%-12s %12.3fms %12.3fms %12d %10.1f\n", "worker", s.medianMs, s.maxMs, ran.load(),
+              MsSince(start));
+
+  std::printf("\n%-6s %18s %18s\n", "pads", "worker per pad/s", "shared worker/s");
+  for (int pads = 1; pads <= maxPads; pads *= 2) {
+    const double perPad = PadThroughput(pads, pads, calls, linkKBps, rgba);
+    const double shared = PadThroughput(pads, 1, calls, linkKBps, rgba);
+    std::printf("%-6d %18.1f %18.1f\n", pads, perPad, shared);
+  }
+  return 0;
+}
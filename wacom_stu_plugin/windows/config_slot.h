@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+// Hands configuration from the platform thread to the report thread.
+//
+// Publish() may block briefly on the platform thread. TryTake() never
+// blocks: if the platform thread is mid-publish it simply returns false and
+// the report thread keeps its current settings until the next check.
+template <typename T>
+class ConfigSlot {
+ public:
+  void Publish(const T& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ = value;
+    dirty_.store(true, std::memory_order_release);
+  }
+
+  // Copies the newest published value into |out| if there is one that has
+  // not been taken yet.
+  bool TryTake(T& out) {
+    if (!dirty_.load(std::memory_order_acquire)) return false;
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) return false;
+    out = pending_;
+    dirty_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  T pending_{};
+  std::atomic<bool> dirty_{false};
+};
@@ -0,0 +1,116 @@
+#include "decrypt_worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+DecryptWorker::DecryptWorker(const uint8_t key[Aes128::kBlockSize], uint32_t sessionId,
+                             DeviceClockEstimator* clock, SampleFn onSample, bool hardware)
+    : aes_(key), decoder_(clock), onSample_(std::move(onSample)) {
+  aes_.UseHardware(hardware);
+  decoder_.SetSessionId(sessionId);
+  thread_ = std::thread([this] { Run(); });
+}
+
+DecryptWorker::~DecryptWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+bool DecryptWorker::Push(const uint8_t* report, size_t size, int64_t hostUs) {
+  QueuedReport queued;
+  queued.hostUs = hostUs;
+  queued.size = uint8_t(std::min(size, kMaxReportSize));
+  std::memcpy(queued.data, report, queued.size);
+  if (!queue_.TryPush(queued)) return false;
+  // Only the push that finds the worker idle pays for the lock
+  if (!pending_.exchange(true)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_one();
+  }
+  return true;
+}
+
+void DecryptWorker::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return !busy_ && !pending_; });
+}
+
+DecryptWorker::Stats DecryptWorker::stats() const {
+  const auto queue = queue_.stats();
+  Stats s;
+  s.reports = queue.pushed;
+  s.dropped = queue.dropped;
+  s.batches = batches_.load(std::memory_order_relaxed);
+  s.blocks = blocksDecrypted_.load(std::memory_order_relaxed);
+  s.sessionMismatches = sessionMismatches_.load(std::memory_order_relaxed);
+  s.decryptMs = decryptNs_.load(std::memory_order_relaxed) / 1e6;
+  s.hardware = aes_.hardware();
+  return s;
+}
+
+void DecryptWorker::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this] { return stopping_ || pending_; });
+    busy_ = true;
+    // An exchange rather than a store, so it reads Push's flag and sees the
+    // report queued before it
+    pending_.exchange(false);
+    lock.unlock();
+
+    ProcessQueued();
+
+    lock.lock();
+    busy_ = false;
+    idle_.notify_all();
+    if (stopping_) break;
+  }
+}
+
+void DecryptWorker::ProcessQueued() {
+  for (;;) {
+    size_t count = 0;
+    while (count < kMaxBatch && queue_.TryPop(batch_[count])) ++count;
+    if (count == 0) return;
+
+    // Gather the encrypted blocks, decrypt them in one call, put them back
+    size_t blocks = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const QueuedReport& report = batch_[i];
+      if (!PenReportDecoder::IsEncrypted(report.data, report.size)) continue;
+      std::memcpy(blocks_ + blocks++ * Aes128::kBlockSize,
+                  report.data + PenReportDecoder::kEncryptedBlock, Aes128::kBlockSize);
+    }
+    if (blocks) {
+      const auto start = std::chrono::steady_clock::now();
+      aes_.Decrypt(blocks_, blocks_, blocks);
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      decryptNs_.fetch_add(
+          uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+          std::memory_order_relaxed);
+      blocksDecrypted_.fetch_add(blocks, std::memory_order_relaxed);
+    }
+
+    size_t block = 0;
+    for (size_t i = 0; i < count; ++i) {
+      QueuedReport& report = batch_[i];
+      if (PenReportDecoder::IsEncrypted(report.data, report.size)) {
+        std::memcpy(report.data + PenReportDecoder::kEncryptedBlock,
+                    blocks_ + block++ * Aes128::kBlockSize, Aes128::kBlockSize);
+      }
+      PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+      const size_t decoded =
+          decoder_.Decode(report.data, report.size, report.hostUs, samples, true);
+      for (size_t s = 0; s < decoded; ++s) onSample_(samples[s]);
+    }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    sessionMismatches_.store(decoder_.sessionMismatches(), std::memory_order_relaxed);
+    if (count < kMaxBatch) return;
+  }
+}
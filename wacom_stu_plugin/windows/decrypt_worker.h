@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "aes128.h"
+#include "device_clock_estimator.h"
+#include "pen_sample.h"
+#include "report_decoder.h"
+#include "spsc_ring.h"
+
+// Decodes an encrypted capture off the report thread. The report thread
+// only copies each report into a lock-free queue and, if the worker sleeps,
+// wakes it; the worker takes what has queued up in batches, decrypts every
+// encrypted block of a batch with one Aes128::Decrypt call (AES-NI where
+// the CPU has it) and decodes the batch in report order.
+//
+// All of a capture's reports go through here, plain ones included, so
+// samples keep their order and |onSample| stays the only producer for what
+// it feeds.
+class DecryptWorker {
+ public:
+  // Only this much of a report is kept, past every pen data layout
+  static constexpr size_t kMaxReportSize = 32;
+  // Reports per Decrypt call, at most
+  static constexpr size_t kMaxBatch = 32;
+
+  // Called on the worker thread
+  using SampleFn = std::function<void(const PenSample& sample)>;
+
+  struct Stats {
+    uint64_t reports = 0;
+    // Queue full; about 2.5 s of reports at 200 Hz
+    uint64_t dropped = 0;
+    uint64_t batches = 0;
+    uint64_t blocks = 0;
+    // Encrypted reports of another session, or decrypted with the wrong key
+    uint64_t sessionMismatches = 0;
+    // Time inside Aes128::Decrypt
+    double decryptMs = 0;
+    bool hardware = false;
+  };
+
+  // |clock| maps timed reports onto the host clock and is the worker's
+  // while it runs. |hardware| false keeps AES-NI off, for comparisons.
+  DecryptWorker(const uint8_t key[Aes128::kBlockSize], uint32_t sessionId,
+                DeviceClockEstimator* clock, SampleFn onSample, bool hardware = true);
+  // Decodes what is still queued, then joins the thread
+  ~DecryptWorker();
+
+  DecryptWorker(const DecryptWorker&) = delete;
+  DecryptWorker& operator=(const DecryptWorker&) = delete;
+
+  // Report thread, one producer only. Never blocks; false if the queue was
+  // full and the report dropped.
+  bool Push(const uint8_t* report, size_t size, int64_t hostUs);
+
+  // Blocks until everything pushed so far is decoded
+  void WaitIdle();
+
+  // Safe from any thread
+  Stats stats() const;
+
+ private:
+  struct QueuedReport {
+    int64_t hostUs;
+    uint8_t size;
+    uint8_t data[kMaxReportSize];
+  };
+
+  void Run();
+  void ProcessQueued();
+
+  Aes128 aes_;
+  PenReportDecoder decoder_;
+  SampleFn onSample_;
+
+  SpscRing<QueuedReport, 512> queue_;
+  // Set by Push when it finds the worker idle; the worker clears it before
+  // each drain, so a report pushed meanwhile wakes it again
+  std::atomic<bool> pending_{false};
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  bool busy_ = false;
+  bool stopping_ = false;
+
+  // The worker's own
+  QueuedReport batch_[kMaxBatch];
+  uint8_t blocks_[kMaxBatch * Aes128::kBlockSize];
+
+  std::atomic<uint64_t> batches_{0};
+  std::atomic<uint64_t> blocksDecrypted_{0};
+  std::atomic<uint64_t> sessionMismatches_{0};
+  std::atomic<uint64_t> decryptNs_{0};
+
+  std::thread thread_;
+};
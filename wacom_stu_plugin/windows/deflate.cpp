@@ -0,0 +1,554 @@
+#include "deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr int kHashBits = 15;
+constexpr size_t kHashSize = size_t(1) << kHashBits;
+// Matches at least this long are taken without looking one byte ahead
+constexpr size_t kLazyLimit = 32;
+// Positions skipped in a match longer than kInsertGap are not hashed,
+// apart from the last kInsertTail
+constexpr size_t kInsertGap = 32;
+constexpr size_t kInsertTail = 8;
+// Tokens per block; each block gets its own Huffman tables
+constexpr size_t kBlockTokens = size_t(1) << 16;
+
+constexpr int kLitLenSymbols = 286;
+constexpr int kDistSymbols = 30;
+constexpr int kCodeLengthSymbols = 19;
+constexpr int kMaxCodeBits = 15;
+constexpr int kMaxCodeLengthBits = 7;
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,   7,   8,   9,   10,  11,  13,
+                                      15, 17, 19, 23,  27,  31,  35,  43,  51,  59,
+                                      67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,
+                                    17,   25,   33,   49,   65,   97,    129,   193,
+                                    257,  385,  513,  769,  1025, 1537,  2049,  3073,
+                                    4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order code length code lengths are stored in (RFC 1951 3.2.7)
+constexpr uint8_t kCodeLengthOrder[kCodeLengthSymbols] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// LSB-first bit packer as required by deflate
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+  // |count| is at most 16
+  void Put(uint32_t value, int count) {
+    bits_ |= uint64_t(value) << count_;
+    count_ += count;
+    if (count_ >= 32) {
+      const uint8_t bytes[4] = {uint8_t(bits_), uint8_t(bits_ >> 8),
+                                uint8_t(bits_ >> 16), uint8_t(bits_ >> 24)};
+      out_.insert(out_.end(), bytes, bytes + 4);
+      bits_ >>= 32;
+      count_ -= 32;
+    }
+  }
+
+  void Flush() {
+    for (; count_ > 0; count_ -= 8) {
+      out_.push_back(uint8_t(bits_));
+      bits_ >>= 8;
+    }
+    bits_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  std::vector<uint8_t>& out_;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+struct HuffmanCode {
+  // Bit-reversed, since Huffman codes are defined MSB-first
+  uint16_t code;
+  uint8_t length;
+};
+
+// Canonical codes from code lengths (RFC 1951 3.2.2)
+void AssignCodes(const uint8_t* lengths, int count, HuffmanCode* codes) {
+  uint16_t lengthCount[kMaxCodeBits + 1] = {};
+  for (int i = 0; i < count; ++i) {
+    if (lengths[i]) ++lengthCount[lengths[i]];
+  }
+  uint16_t next[kMaxCodeBits + 1] = {};
+  uint16_t code = 0;
+  for (int bits = 1; bits <= kMaxCodeBits; ++bits) {
+    code = uint16_t((code + lengthCount[bits - 1]) << 1);
+    next[bits] = code;
+  }
+  for (int i = 0; i < count; ++i) {
+    const int length = lengths[i];
+    codes[i].length = uint8_t(length);
+    codes[i].code = 0;
+    if (!length) continue;
+    const uint16_t c = next[length]++;
+    for (int b = 0; b < length; ++b) {
+      codes[i].code = uint16_t((codes[i].code << 1) | ((c >> b) & 1));
+    }
+  }
+}
+
+// Huffman code lengths for |freq|, no longer than |maxBits|. A plain
+// Huffman tree is built first; overlong levels are then folded back in
+// (JPEG Annex K.3), which keeps the code complete.
+void BuildLengths(const uint32_t* freq, int count, int maxBits,
+                  uint8_t* lengths) {
+  std::fill(lengths, lengths + count, uint8_t(0));
+  std::vector<int> symbols;
+  for (int i = 0; i < count; ++i) {
+    if (freq[i]) symbols.push_back(i);
+  }
+  if (symbols.empty()) return;
+  if (symbols.size() == 1) {
+    lengths[symbols[0]] = 1;
+    return;
+  }
+
+  // Leaves first, then internal nodes; a parent always has a higher index
+  const int leaves = int(symbols.size());
+  std::vector<int> parent(size_t(2 * leaves - 1), -1);
+  using Node = std::pair<uint64_t, int>;
+  std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+  for (int i = 0; i < leaves; ++i) heap.push({freq[symbols[i]], i});
+  int next = leaves;
+  while (heap.size() > 1) {
+    const Node a = heap.top();
+    heap.pop();
+    const Node b = heap.top();
+    heap.pop();
+    parent[a.second] = next;
+    parent[b.second] = next;
+    heap.push({a.first + b.first, next++});
+  }
+
+  std::vector<int> depth(parent.size(), 0);
+  std::vector<int> levelCount(size_t(std::max(leaves, maxBits)) + 1, 0);
+  int maxDepth = 0;
+  for (int n = next - 2; n >= 0; --n) depth[n] = depth[parent[n]] + 1;
+  for (int i = 0; i < leaves; ++i) {
+    ++levelCount[depth[i]];
+    maxDepth = std::max(maxDepth, depth[i]);
+  }
+  for (int i = maxDepth; i > maxBits; --i) {
+    while (levelCount[i] > 0) {
+      int j = i - 2;
+      while (levelCount[j] == 0) --j;
+      levelCount[i] -= 2;
+      levelCount[i - 1] += 1;
+      levelCount[j + 1] += 2;
+      levelCount[j] -= 1;
+    }
+  }
+
+  // Most frequent symbols get the shortest codes
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [&](int a, int b) { return freq[a] > freq[b]; });
+  size_t s = 0;
+  for (int length = 1; length <= maxBits; ++length) {
+    for (int k = 0; k < levelCount[length]; ++k) {
+      lengths[symbols[s++]] = uint8_t(length);
+    }
+  }
+}
+
+const std::array<uint8_t, kMaxMatch + 1>& LengthSymbols() {
+  static const std::array<uint8_t, kMaxMatch + 1> table = [] {
+    std::array<uint8_t, kMaxMatch + 1> t{};
+    int code = 0;
+    for (size_t length = kMinMatch; length <= kMaxMatch; ++length) {
+      while (code < 28 && kLengthBase[code + 1] <= length) ++code;
+      t[length] = uint8_t(code);
+    }
+    return t;
+  }();
+  return table;
+}
+
+inline int DistSymbol(size_t distance) {
+  if (distance <= 4) return int(distance) - 1;
+  const uint32_t d = uint32_t(distance - 1);
+  int msb = 0;
+  while ((d >> (msb + 1)) != 0) ++msb;
+  return 2 * msb + int((d >> (msb - 1)) & 1);
+}
+
+struct FixedCodes {
+  HuffmanCode litLen[288];
+  HuffmanCode dist[kDistSymbols];
+};
+
+const FixedCodes& Fixed() {
+  static const FixedCodes codes = [] {
+    FixedCodes c{};
+    uint8_t lengths[288];
+    for (int i = 0; i < 288; ++i) {
+      lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    }
+    AssignCodes(lengths, 288, c.litLen);
+    uint8_t distLengths[kDistSymbols];
+    std::fill(distLengths, distLengths + kDistSymbols, uint8_t(5));
+    AssignCodes(distLengths, kDistSymbols, c.dist);
+    return c;
+  }();
+  return codes;
+}
+
+inline uint32_t Hash3(const uint8_t* p) {
+  const uint32_t v = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+  return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+// Collects LZ77 tokens and writes them out a block at a time
+class BlockEncoder {
+ public:
+  BlockEncoder(std::vector<uint8_t>& out, bool dynamicHuffman)
+      : writer_(out), dynamicHuffman_(dynamicHuffman) {
+    tokens_.reserve(kBlockTokens);
+  }
+
+  void Literal(uint8_t value) {
+    tokens_.push_back({value, 0});
+    ++litLenFreq_[value];
+    if (tokens_.size() == kBlockTokens) FlushBlock(false);
+  }
+
+  void Match(size_t length, size_t distance) {
+    tokens_.push_back({uint16_t(length), uint16_t(distance)});
+    ++litLenFreq_[257 + LengthSymbols()[length]];
+    ++distFreq_[DistSymbol(distance)];
+    if (tokens_.size() == kBlockTokens) FlushBlock(false);
+  }
+
+  void Finish() {
+    FlushBlock(true);
+    writer_.Flush();
+  }
+
+ private:
+  struct Token {
+    uint16_t lengthOrLiteral;
+    // 0 for a literal
+    uint16_t distance;
+  };
+
+  template <typename Codes>
+  uint64_t Cost(const uint32_t* freq, int count, const Codes* codes) const {
+    uint64_t bits = 0;
+    for (int i = 0; i < count; ++i) bits += uint64_t(freq[i]) * codes[i].length;
+    return bits;
+  }
+
+  void FlushBlock(bool final) {
+    ++litLenFreq_[256];  // end of block
+
+    const FixedCodes& fixed = Fixed();
+    // Extra bits are the same under both tables, so they are left out
+    const uint64_t fixedBits = Cost(litLenFreq_, kLitLenSymbols, fixed.litLen) +
+                               Cost(distFreq_, kDistSymbols, fixed.dist);
+
+    bool useDynamic = false;
+    uint8_t litLenLengths[kLitLenSymbols];
+    uint8_t distLengths[kDistSymbols];
+    HuffmanCode litLen[kLitLenSymbols];
+    HuffmanCode dist[kDistSymbols];
+    uint8_t clLengths[kCodeLengthSymbols];
+    HuffmanCode cl[kCodeLengthSymbols];
+    std::vector<uint8_t> clSymbols;
+    std::vector<uint8_t> clExtra;
+    int hlit = 257;
+    int hdist = 1;
+    int hclen = 4;
+
+    if (dynamicHuffman_) {
+      BuildLengths(litLenFreq_, kLitLenSymbols, kMaxCodeBits, litLenLengths);
+      BuildLengths(distFreq_, kDistSymbols, kMaxCodeBits, distLengths);
+      // A block of literals still needs one distance code
+      if (std::all_of(distLengths, distLengths + kDistSymbols,
+                      [](uint8_t l) { return l == 0; })) {
+        distLengths[0] = 1;
+      }
+      AssignCodes(litLenLengths, kLitLenSymbols, litLen);
+      AssignCodes(distLengths, kDistSymbols, dist);
+
+      while (hlit < kLitLenSymbols && std::any_of(litLenLengths + hlit,
+                                                  litLenLengths + kLitLenSymbols,
+                                                  [](uint8_t l) { return l; })) {
+        ++hlit;
+      }
+      for (int i = kDistSymbols; i > 0; --i) {
+        if (distLengths[i - 1]) {
+          hdist = i;
+          break;
+        }
+      }
+
+      uint8_t all[kLitLenSymbols + kDistSymbols];
+      std::memcpy(all, litLenLengths, hlit);
+      std::memcpy(all + hlit, distLengths, hdist);
+      RunLengthEncode(all, hlit + hdist, clSymbols, clExtra);
+
+      uint32_t clFreq[kCodeLengthSymbols] = {};
+      for (uint8_t s : clSymbols) ++clFreq[s];
+      BuildLengths(clFreq, kCodeLengthSymbols, kMaxCodeLengthBits, clLengths);
+      AssignCodes(clLengths, kCodeLengthSymbols, cl);
+      for (int i = kCodeLengthSymbols; i > 4; --i) {
+        if (clLengths[kCodeLengthOrder[i - 1]]) {
+          hclen = i;
+          break;
+        }
+      }
+
+      uint64_t dynamicBits = 14 + 3 * uint64_t(hclen) +
+                             Cost(clFreq, kCodeLengthSymbols, cl) +
+                             2 * clFreq[16] + 3 * clFreq[17] + 7 * clFreq[18] +
+                             Cost(litLenFreq_, kLitLenSymbols, litLen) +
+                             Cost(distFreq_, kDistSymbols, dist);
+      useDynamic = dynamicBits < fixedBits;
+    }
+
+    writer_.Put(final ? 1 : 0, 1);
+    writer_.Put(useDynamic ? 2 : 1, 2);
+    const HuffmanCode* litCodes = useDynamic ? litLen : fixed.litLen;
+    const HuffmanCode* distCodes = useDynamic ? dist : fixed.dist;
+
+    if (useDynamic) {
+      writer_.Put(uint32_t(hlit - 257), 5);
+      writer_.Put(uint32_t(hdist - 1), 5);
+      writer_.Put(uint32_t(hclen - 4), 4);
+      for (int i = 0; i < hclen; ++i) writer_.Put(clLengths[kCodeLengthOrder[i]], 3);
+      for (size_t i = 0; i < clSymbols.size(); ++i) {
+        const uint8_t s = clSymbols[i];
+        writer_.Put(cl[s].code, cl[s].length);
+        if (s == 16) writer_.Put(clExtra[i], 2);
+        if (s == 17) writer_.Put(clExtra[i], 3);
+        if (s == 18) writer_.Put(clExtra[i], 7);
+      }
+    }
+
+    const auto& lengthSymbols = LengthSymbols();
+    for (const Token& t : tokens_) {
+      if (!t.distance) {
+        writer_.Put(litCodes[t.lengthOrLiteral].code, litCodes[t.lengthOrLiteral].length);
+        continue;
+      }
+      const int ls = lengthSymbols[t.lengthOrLiteral];
+      writer_.Put(litCodes[257 + ls].code, litCodes[257 + ls].length);
+      writer_.Put(uint32_t(t.lengthOrLiteral - kLengthBase[ls]), kLengthExtra[ls]);
+      const int ds = DistSymbol(t.distance);
+      writer_.Put(distCodes[ds].code, distCodes[ds].length);
+      writer_.Put(uint32_t(t.distance - kDistBase[ds]), kDistExtra[ds]);
+    }
+    writer_.Put(litCodes[256].code, litCodes[256].length);
+
+    tokens_.clear();
+    std::fill(std::begin(litLenFreq_), std::end(litLenFreq_), 0u);
+    std::fill(std::begin(distFreq_), std::end(distFreq_), 0u);
+  }
+
+  // Code length alphabet: 0-15 literal, 16 repeat previous 3-6 times,
+  // 17 zero 3-10 times, 18 zero 11-138 times
+  static void RunLengthEncode(const uint8_t* lengths, int count,
+                              std::vector<uint8_t>& symbols,
+                              std::vector<uint8_t>& extra) {
+    auto emit = [&](int symbol, int e) {
+      symbols.push_back(uint8_t(symbol));
+      extra.push_back(uint8_t(e));
+    };
+    int i = 0;
+    while (i < count) {
+      const uint8_t value = lengths[i];
+      int run = 1;
+      while (i + run < count && lengths[i + run] == value) ++run;
+      i += run;
+      if (value == 0) {
+        while (run >= 11) {
+          const int n = std::min(run, 138);
+          emit(18, n - 11);
+          run -= n;
+        }
+        if (run >= 3) {
+          emit(17, run - 3);
+          run = 0;
+        }
+      } else {
+        emit(value, 0);
+        --run;
+        while (run >= 3) {
+          const int n = std::min(run, 6);
+          emit(16, n - 3);
+          run -= n;
+        }
+      }
+      while (run-- > 0) emit(value, 0);
+    }
+  }
+
+  BitWriter writer_;
+  bool dynamicHuffman_;
+  std::vector<Token> tokens_;
+  uint32_t litLenFreq_[kLitLenSymbols] = {};
+  uint32_t distFreq_[kDistSymbols] = {};
+};
+
+// Hash chains over the window. Positions are inserted lazily, so a search
+// at |pos| only ever sees earlier positions.
+class MatchFinder {
+ public:
+  MatchFinder(const uint8_t* data, size_t size, int maxChain)
+      : data_(data), size_(size), maxChain_(maxChain),
+        head_(kHashSize, -1), prev_(kWindowSize, -1) {}
+
+  struct Result {
+    size_t length = 0;
+    size_t distance = 0;
+  };
+
+  Result Find(size_t pos) {
+    Insert(pos);
+    Result best;
+    if (pos + kMinMatch > size_) return best;
+
+    const size_t maxLength = std::min(kMaxMatch, size_ - pos);
+    const uint8_t* b = data_ + pos;
+    int32_t candidate = head_[Hash3(b)];
+    for (int chain = 0; chain < maxChain_ && candidate >= 0; ++chain) {
+      const size_t distance = pos - size_t(candidate);
+      if (distance > kWindowSize - 1) break;
+      const uint8_t* a = data_ + candidate;
+      if (a[best.length] == b[best.length]) {
+        size_t length = 0;
+        while (length < maxLength && a[length] == b[length]) ++length;
+        if (length > best.length) {
+          best.length = length;
+          best.distance = distance;
+          if (length == maxLength) break;
+        }
+      }
+      candidate = prev_[size_t(candidate) & (kWindowSize - 1)];
+    }
+    return best;
+  }
+
+ private:
+  // Adds positions before |pos| to the chains. Only the tail of a long
+  // match is hashed; that is enough to keep finding runs, which is what
+  // long matches in filtered image rows mostly are.
+  void Insert(size_t pos) {
+    if (pos - inserted_ > kInsertGap) inserted_ = pos - kInsertTail;
+    for (; inserted_ < pos; ++inserted_) {
+      if (inserted_ + kMinMatch > size_) continue;
+      const uint32_t h = Hash3(data_ + inserted_);
+      prev_[inserted_ & (kWindowSize - 1)] = head_[h];
+      head_[h] = int32_t(inserted_);
+    }
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  int maxChain_;
+  size_t inserted_ = 0;
+  std::vector<int32_t> head_;
+  std::vector<int32_t> prev_;
+};
+
+}  // namespace
+
+uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (size) {
+    // Largest block that cannot overflow 32 bits before the modulo
+    size_t block = std::min<size_t>(size, 5552);
+    size -= block;
+    while (block--) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void ZlibCompress(const uint8_t* data, size_t size,
+                  const DeflateOptions& options, std::vector<uint8_t>& out) {
+  // CMF/FLG: deflate, 32 KB window, check bits make the pair a multiple of 31
+  out.reserve(out.size() + size / 4 + 64);
+  out.push_back(0x78);
+  out.push_back(0x01);
+
+  BlockEncoder encoder(out, options.dynamicHuffman);
+  if (options.maxChain <= 0) {
+    for (size_t i = 0; i < size; ++i) encoder.Literal(data[i]);
+  } else {
+    MatchFinder finder(data, size, options.maxChain);
+    MatchFinder::Result match;
+    bool haveMatch = false;
+    size_t pos = 0;
+    while (pos < size) {
+      if (!haveMatch) match = finder.Find(pos);
+      haveMatch = false;
+
+      if (options.lazy && match.length >= kMinMatch &&
+          match.length < kLazyLimit && pos + 1 < size) {
+        const MatchFinder::Result next = finder.Find(pos + 1);
+        if (next.length > match.length) {
+          encoder.Literal(data[pos++]);
+          match = next;
+          haveMatch = true;
+          continue;
+        }
+      }
+
+      if (match.length >= kMinMatch) {
+        encoder.Match(match.length, match.distance);
+        pos += match.length;
+      } else {
+        encoder.Literal(data[pos++]);
+      }
+    }
+  }
+  encoder.Finish();
+
+  const uint32_t adler = Adler32(data, size);
+  out.push_back(uint8_t(adler >> 24));
+  out.push_back(uint8_t(adler >> 16));
+  out.push_back(uint8_t(adler >> 8));
+  out.push_back(uint8_t(adler));
+}
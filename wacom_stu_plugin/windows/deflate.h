@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small self-contained zlib (RFC 1950/1951) compressor, so the plugin can
+// produce PNG and compressed screen data without linking zlib.
+//
+// Matching is LZ77 over a 32 KB window using a hash of the next three bytes.
+// Tokens are emitted in blocks of up to 64K, each coded with whichever of the
+// fixed or a per-block dynamic Huffman table is smaller.
+struct DeflateOptions {
+  // Hash chain entries probed per position; 0 emits literals only
+  int maxChain = 1;
+  // Defer a match by one byte when the next position has a longer one
+  bool lazy = false;
+  // Consider per-block dynamic Huffman tables; off always uses fixed codes
+  bool dynamicHuffman = true;
+};
+
+// Appends a complete zlib stream for |data| to |out|.
+void ZlibCompress(const uint8_t* data, size_t size,
+                  const DeflateOptions& options, std::vector<uint8_t>& out);
+
+uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
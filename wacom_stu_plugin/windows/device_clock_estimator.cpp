@@ -0,0 +1,102 @@
+#include "device_clock_estimator.h"
+
+#include <cmath>
+
+namespace {
+
+// Per-sample weight decay; ~1000 samples (5 s at 200 Hz) of memory
+constexpr double kForget = 0.999;
+// Samples needed before trusting the fitted rate over the nominal one
+constexpr uint64_t kMinFitSamples = 64;
+// How fast the envelope may rise per sample, so it can follow a rate error
+// instead of latching onto a single unusually early read
+constexpr double kEnvelopeRiseUs = 0.5;
+// A prediction this far off means the device or the stream restarted
+constexpr double kResetThresholdUs = 500000.0;
+
+}  // namespace
+
+DeviceClockEstimator::DeviceClockEstimator(double nominalTickUs)
+    : nominalTickUs_(nominalTickUs), rate_(nominalTickUs) {}
+
+void DeviceClockEstimator::Reset() {
+  started_ = false;
+  samples_.store(0, std::memory_order_relaxed);
+  driftPpm_.store(0.0, std::memory_order_relaxed);
+  meanDelayUs_.store(0.0, std::memory_order_relaxed);
+}
+
+void DeviceClockEstimator::Restart(int64_t hostUs) {
+  started_ = true;
+  ticks_ = 0;
+  originUs_ = hostUs;
+  sw_ = sx_ = sy_ = sxx_ = sxy_ = 0;
+  rate_ = nominalTickUs_;
+  envelope_ = 0;
+  meanDelay_ = 0;
+}
+
+int64_t DeviceClockEstimator::Update(uint16_t timeCount, int64_t hostUs) {
+  if (!started_) {
+    Restart(hostUs);
+    lastTimeCount_ = timeCount;
+  } else {
+    // Unsigned 16-bit subtraction handles the wrap
+    ticks_ += static_cast<uint16_t>(timeCount - lastTimeCount_);
+    lastTimeCount_ = timeCount;
+  }
+
+  const double x = static_cast<double>(ticks_);
+  const double y = static_cast<double>(hostUs - originUs_);
+
+  const double predicted = rate_ * x + envelope_;
+  if (std::fabs(y - predicted) > kResetThresholdUs) {
+    // Long gap (pen away long enough to wrap several times) or a device
+    // reset; the old fit says nothing about the new stream.
+    resets_.fetch_add(1, std::memory_order_relaxed);
+    Restart(hostUs);
+    lastTimeCount_ = timeCount;
+    return hostUs;
+  }
+
+  sw_ = sw_ * kForget + 1.0;
+  sx_ = sx_ * kForget + x;
+  sy_ = sy_ * kForget + y;
+  sxx_ = sxx_ * kForget + x * x;
+  sxy_ = sxy_ * kForget + x * y;
+
+  const uint64_t n = samples_.load(std::memory_order_relaxed) + 1;
+  samples_.store(n, std::memory_order_relaxed);
+
+  const double varX = sxx_ * sw_ - sx_ * sx_;
+  if (n >= kMinFitSamples && varX > 0) {
+    const double fitted = (sxy_ * sw_ - sx_ * sy_) / varX;
+    // Reject fits that are clearly not a clock (e.g. all samples in a burst)
+    if (fitted > nominalTickUs_ * 0.9 && fitted < nominalTickUs_ * 1.1) {
+      rate_ = fitted;
+    }
+  }
+
+  const double residual = y - rate_ * x;
+  if (n == 1 || residual < envelope_) {
+    envelope_ = residual;
+  } else {
+    envelope_ += kEnvelopeRiseUs;
+  }
+  meanDelay_ += ((residual - envelope_) - meanDelay_) * 0.01;
+
+  driftPpm_.store((rate_ / nominalTickUs_ - 1.0) * 1e6,
+                  std::memory_order_relaxed);
+  meanDelayUs_.store(meanDelay_, std::memory_order_relaxed);
+
+  return originUs_ + static_cast<int64_t>(std::llround(rate_ * x + envelope_));
+}
+
+DeviceClockEstimator::Stats DeviceClockEstimator::stats() const {
+  Stats s;
+  s.samples = samples_.load(std::memory_order_relaxed);
+  s.resets = resets_.load(std::memory_order_relaxed);
+  s.driftPpm = driftPpm_.load(std::memory_order_relaxed);
+  s.meanDelayUs = meanDelayUs_.load(std::memory_order_relaxed);
+  return s;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Maps the tablet's 16-bit timeCount onto the host microsecond clock.
+//
+// Each report gives a pair (device ticks, host read time). The host time is
+// the true sample time plus a variable USB/queueing delay that is always
+// positive, so:
+//   - the rate (host microseconds per device tick) comes from an
+//     exponentially weighted least-squares fit, which tracks crystal drift;
+//   - the offset follows the lower envelope of the residuals, which strips
+//     out the delay instead of averaging it in.
+//
+// Update() is called on the report thread only. stats() may be read from
+// any thread.
+class DeviceClockEstimator {
+ public:
+  struct Stats {
+    uint64_t samples = 0;
+    uint64_t resets = 0;
+    // Measured rate vs. the nominal tick period, in parts per million
+    double driftPpm = 0.0;
+    // Mean distance of host read times above the lower envelope
+    double meanDelayUs = 0.0;
+  };
+
+  explicit DeviceClockEstimator(double nominalTickUs = 1000.0);
+
+  void Reset();
+
+  // Feeds one observation and returns the device time mapped onto the host
+  // clock, in microseconds.
+  int64_t Update(uint16_t timeCount, int64_t hostUs);
+
+  Stats stats() const;
+
+ private:
+  void Restart(int64_t hostUs);
+
+  const double nominalTickUs_;
+
+  bool started_ = false;
+  uint16_t lastTimeCount_ = 0;
+  int64_t ticks_ = 0;       // unwrapped, relative to the first observation
+  int64_t originUs_ = 0;    // host time of the first observation
+
+  // Exponentially weighted regression sums over (ticks, host - origin)
+  double sw_ = 0, sx_ = 0, sy_ = 0, sxx_ = 0, sxy_ = 0;
+  double rate_ = 0;
+  double envelope_ = 0;
+  double meanDelay_ = 0;
+
+  std::atomic<uint64_t> samples_{0};
+  std::atomic<uint64_t> resets_{0};
+  std::atomic<double> driftPpm_{0.0};
+  std::atomic<double> meanDelayUs_{0.0};
+};
@@ -0,0 +1,16 @@
+#include "device_id.h"
+
+#include <cstdio>
+
+std::string StuDeviceId(uint16_t vendorId, uint16_t productId, const std::wstring& path) {
+  // FNV-1a over the path, ASCII case folded
+  uint32_t hash = 2166136261u;
+  for (wchar_t c : path) {
+    if (c >= L'A' && c <= L'Z') c += L'a' - L'A';
+    hash = (hash ^ uint32_t(c)) * 16777619u;
+  }
+  char id[24];
+  std::snprintf(id, sizeof(id), "%04x-%04x-%08x", unsigned(vendorId), unsigned(productId),
+                unsigned(hash));
+  return id;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Names a pad for as long as it stays on the same USB port: across
+// enumerations, reconnects and runs. Vendor and product id, then a hash of
+// the device interface path, e.g. "056a-00a8-1f3c5d7e". Windows hands the
+// path out in varying case, so case is ignored.
+std::string StuDeviceId(uint16_t vendorId, uint16_t productId, const std::wstring& path);
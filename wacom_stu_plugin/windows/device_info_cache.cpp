@@ -0,0 +1,137 @@
+#include "device_info_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// One line per pad after the magic line: the id, the numeric fields in
+// declaration order, then the model name, which runs to the end of the line
+constexpr const char* kMagic = "STUDEV1";
+constexpr const char* kFileName = "devices.txt";
+
+template <typename T>
+bool ReadField(std::istream& in, T& field) {
+  unsigned long value;
+  if (!(in >> value) || value > T(~T(0))) return false;
+  field = T(value);
+  return true;
+}
+
+bool ReadFlag(std::istream& in, bool& flag) {
+  uint8_t value;
+  if (!ReadField(in, value) || value > 1) return false;
+  flag = value != 0;
+  return true;
+}
+
+bool ParseLine(const std::string& line, std::string& id, DeviceInfo& info) {
+  std::istringstream in(line);
+  if (!(in >> id)) return false;
+  bool ok = ReadField(in, info.productId) && ReadField(in, info.bcdDevice) &&
+            ReadField(in, info.tabletMaxX) && ReadField(in, info.tabletMaxY) &&
+            ReadField(in, info.tabletMaxPressure) && ReadField(in, info.screenWidth) &&
+            ReadField(in, info.screenHeight) && ReadField(in, info.maxReportRate) &&
+            ReadField(in, info.resolution) && ReadField(in, info.encodingFlag) &&
+            ReadField(in, info.firmwareMajor) && ReadField(in, info.firmwareMinor) &&
+            ReadField(in, info.secureIc) && ReadFlag(in, info.areaWrites) &&
+            ReadFlag(in, info.hardwareInk) && ReadFlag(in, info.penDataOptionMode);
+  if (!ok) return false;
+  // One space separates the name, which may itself hold spaces or be empty
+  std::string name;
+  std::getline(in, name);
+  info.modelName = name.empty() ? name : name.substr(1);
+  return true;
+}
+
+}  // namespace
+
+bool DeviceInfo::operator==(const DeviceInfo& other) const {
+  return productId == other.productId && bcdDevice == other.bcdDevice &&
+         tabletMaxX == other.tabletMaxX && tabletMaxY == other.tabletMaxY &&
+         tabletMaxPressure == other.tabletMaxPressure && screenWidth == other.screenWidth &&
+         screenHeight == other.screenHeight && maxReportRate == other.maxReportRate &&
+         resolution == other.resolution && encodingFlag == other.encodingFlag &&
+         modelName == other.modelName && firmwareMajor == other.firmwareMajor &&
+         firmwareMinor == other.firmwareMinor && secureIc == other.secureIc &&
+         areaWrites == other.areaWrites && hardwareInk == other.hardwareInk &&
+         penDataOptionMode == other.penDataOptionMode;
+}
+
+bool DeviceInfoCache::Open(const std::string& directory) {
+  path_.clear();
+
+  const fs::path root = fs::u8path(directory);
+  std::error_code ec;
+  fs::create_directories(root, ec);
+  if (!fs::is_directory(root, ec)) return false;
+  path_ = (root / kFileName).u8string();
+
+  // Records stored before Open stay unless the file has the same pad
+  std::ifstream file(fs::u8path(path_));
+  std::string line;
+  if (!std::getline(file, line) || line != kMagic) return true;
+  while (std::getline(file, line)) {
+    std::string id;
+    DeviceInfo info;
+    if (ParseLine(line, id, info)) entries_[id] = info;
+  }
+  return true;
+}
+
+const DeviceInfo* DeviceInfoCache::Find(const std::string& deviceId, uint16_t productId,
+                                        uint16_t bcdDevice) {
+  auto it = entries_.find(deviceId);
+  if (it == entries_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  if (it->second.productId != productId || it->second.bcdDevice != bcdDevice) {
+    ++stats_.stale;
+    return nullptr;
+  }
+  ++stats_.hits;
+  return &it->second;
+}
+
+void DeviceInfoCache::Store(const std::string& deviceId, const DeviceInfo& info) {
+  auto it = entries_.find(deviceId);
+  if (it != entries_.end() && it->second == info) return;
+  entries_[deviceId] = info;
+  Save();
+}
+
+DeviceInfoCache::Stats DeviceInfoCache::stats() const {
+  Stats stats = stats_;
+  stats.entries = entries_.size();
+  return stats;
+}
+
+void DeviceInfoCache::Save() const {
+  if (path_.empty()) return;
+  // Written aside and renamed over, so a crash leaves the old file whole
+  const fs::path path = fs::u8path(path_);
+  fs::path temp = path;
+  temp += ".tmp";
+  bool written;
+  {
+    std::ofstream out(temp, std::ios::trunc);
+    out << kMagic << '\n';
+    for (const auto& [id, info] : entries_) {
+      out << id << ' ' << info.productId << ' ' << info.bcdDevice << ' ' << info.tabletMaxX << ' '
+          << info.tabletMaxY << ' ' << info.tabletMaxPressure << ' ' << info.screenWidth << ' '
+          << info.screenHeight << ' ' << unsigned(info.maxReportRate) << ' ' << info.resolution
+          << ' ' << unsigned(info.encodingFlag) << ' ' << unsigned(info.firmwareMajor) << ' '
+          << unsigned(info.firmwareMinor) << ' ' << unsigned(info.secureIc) << ' '
+          << info.areaWrites << ' ' << info.hardwareInk << ' ' << info.penDataOptionMode << ' '
+          << info.modelName << '\n';
+    }
+    written = bool(out.flush());
+  }
+  std::error_code ec;
+  if (written) fs::rename(temp, path, ec);
+  if (!written || ec) fs::remove(temp, ec);
+}
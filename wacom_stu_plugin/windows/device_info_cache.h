@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Everything connect reads from a pad before it can use it: the capability
+// and information reports, and the report ids it cares about. None of it
+// changes unless the model or the firmware does.
+struct DeviceInfo {
+  // USB descriptor the record was read under. A pad whose descriptor
+  // differs, e.g. after a firmware update, is read again.
+  uint16_t productId = 0;
+  uint16_t bcdDevice = 0;
+
+  // Capability
+  uint16_t tabletMaxX = 0;
+  uint16_t tabletMaxY = 0;
+  uint16_t tabletMaxPressure = 0;
+  uint16_t screenWidth = 0;
+  uint16_t screenHeight = 0;
+  uint8_t maxReportRate = 0;
+  uint16_t resolution = 0;
+  // As filled in from the product id for firmware that reports none
+  uint8_t encodingFlag = 0;
+
+  // Information
+  std::string modelName;
+  uint8_t firmwareMajor = 0;
+  uint8_t firmwareMinor = 0;
+  uint8_t secureIc = 0;
+
+  // Supported report ids
+  bool areaWrites = false;
+  bool hardwareInk = false;
+  bool penDataOptionMode = false;
+
+  bool operator==(const DeviceInfo& other) const;
+  bool operator!=(const DeviceInfo& other) const { return !(*this == other); }
+};
+
+// DeviceInfo by StuDeviceId, so a pad that was connected before skips the
+// feature report round trips. Mirrored to one file so records survive
+// restarts. Not thread safe; the plugin uses it on the platform thread.
+class DeviceInfoCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    // Found, but read under another product id or firmware
+    uint64_t stale = 0;
+    uint64_t misses = 0;
+    size_t entries = 0;
+  };
+
+  // Mirrors records to a file in |directory|, creating it, and loads what
+  // is there. Returns false if the directory is unusable; the cache then
+  // stays memory-only.
+  bool Open(const std::string& directory);
+
+  // Record for |deviceId| if it was read under |productId| and |bcdDevice|,
+  // else nullptr. Valid until the next Store.
+  const DeviceInfo* Find(const std::string& deviceId, uint16_t productId, uint16_t bcdDevice);
+
+  // Replaces the record for |deviceId|; writes the file only if it changed
+  void Store(const std::string& deviceId, const DeviceInfo& info);
+
+  Stats stats() const;
+
+ private:
+  void Save() const;
+
+  std::string path_;
+  std::map<std::string, DeviceInfo> entries_;
+  Stats stats_;
+};
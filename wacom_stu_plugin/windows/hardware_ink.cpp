@@ -0,0 +1,40 @@
+#include "hardware_ink.h"
+
+#include <algorithm>
+
+bool ResolveHardwareInk(const HardwareInkConfig& config, int screenWidth,
+                        int screenHeight, uint16_t maxPressure,
+                        const StrokeTracker::Thresholds& tracker,
+                        HardwareInkSettings& out) {
+  ScreenRect area = config.area;
+  if (area.width <= 0 || area.height <= 0) {
+    area = ScreenRect{0, 0, screenWidth, screenHeight};
+  }
+  const int left = std::max(area.x, 0);
+  const int top = std::max(area.y, 0);
+  const int right = std::min(area.x + area.width, screenWidth) - 1;
+  const int bottom = std::min(area.y + area.height, screenHeight) - 1;
+  if (right < left || bottom < top) return false;
+
+  out.color565 = InkColorRgb565(config.color);
+  out.thickness = uint8_t(std::clamp(config.thickness, 0, kMaxHardwareInkThickness));
+  out.left = uint16_t(left);
+  out.top = uint16_t(top);
+  out.right = uint16_t(right);
+  out.bottom = uint16_t(bottom);
+
+  // Off has to stay below on, or the pad never lifts the pen
+  const int topPressure = std::max<int>(maxPressure, 2);
+  const int on = config.onPressure > 0 ? config.onPressure : tracker.pressureOn;
+  out.onPressure = uint16_t(std::clamp(on, 2, topPressure));
+  const int off = config.offPressure > 0 ? config.offPressure : tracker.pressureOff;
+  out.offPressure = uint16_t(std::clamp(off, 1, out.onPressure - 1));
+  return true;
+}
+
+uint16_t InkColorRgb565(uint32_t argb) {
+  const uint32_t r = (argb >> 16) & 0xFF;
+  const uint32_t g = (argb >> 8) & 0xFF;
+  const uint32_t b = argb & 0xFF;
+  return uint16_t((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "screen_shadow.h"
+#include "stroke_tracker.h"
+
+// What setHardwareInking asks for. The pad then draws strokes on its own
+// display as the pen moves, with no host round trip.
+struct HardwareInkConfig {
+  uint32_t color = 0xFF000000;  // ARGB; alpha is ignored
+  int thickness = 1;
+  // Where the pad inks, in screen pixels; empty means the whole screen
+  ScreenRect area;
+  // Pressure marks in tablet units; 0 takes the stroke tracker's, so the
+  // pad and the host agree on where strokes start and end
+  int onPressure = 0;
+  int offPressure = 0;
+};
+
+// The same, checked and converted to what the tablet's reports carry
+struct HardwareInkSettings {
+  uint16_t color565 = 0;
+  uint8_t thickness = 0;
+  // Inclusive corners, as in Protocol::Rectangle
+  uint16_t left = 0;
+  uint16_t top = 0;
+  uint16_t right = 0;
+  uint16_t bottom = 0;
+  uint16_t onPressure = 0;
+  uint16_t offPressure = 0;
+
+  ScreenRect rect() const {
+    return ScreenRect{left, top, right - left + 1, bottom - top + 1};
+  }
+};
+
+// Widest pen the inking firmware draws
+constexpr int kMaxHardwareInkThickness = 3;
+
+// Clamps |config| to the screen and the pressure range. Returns false if
+// nothing of the area is on screen.
+bool ResolveHardwareInk(const HardwareInkConfig& config, int screenWidth,
+                        int screenHeight, uint16_t maxPressure,
+                        const StrokeTracker::Thresholds& tracker,
+                        HardwareInkSettings& out);
+
+// 8-bit-per-channel ARGB to RGB565
+uint16_t InkColorRgb565(uint32_t argb);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+// Monotonic host time in microseconds. On Windows this reads the
+// performance counter directly, which is cheaper and finer grained than
+// steady_clock on older runtimes.
+inline int64_t HostTimeUs() {
+#ifdef _WIN32
+  static const int64_t frequency = [] {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    return f.QuadPart;
+  }();
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  // Split to avoid overflowing the multiply on long uptimes
+  const int64_t seconds = now.QuadPart / frequency;
+  const int64_t remainder = now.QuadPart % frequency;
+  return seconds * 1000000 + (remainder * 1000000) / frequency;
+#else
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
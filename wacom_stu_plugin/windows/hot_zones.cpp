@@ -0,0 +1,92 @@
+#include "hot_zones.h"
+
+#include <algorithm>
+
+HotZoneTracker::Zone HotZoneTracker::ZoneFromScreen(uint32_t id, const ScreenRect& rect,
+                                                    int screenWidth, int screenHeight,
+                                                    uint16_t maxX, uint16_t maxY) {
+  const int left = std::clamp(rect.x, 0, screenWidth);
+  const int top = std::clamp(rect.y, 0, screenHeight);
+  const int right = std::clamp(rect.x + rect.width, left, screenWidth);
+  const int bottom = std::clamp(rect.y + rect.height, top, screenHeight);
+
+  // Pixel edges to tablet units; the far edge belongs to the next pixel
+  auto scale = [](int pixels, int screen, uint16_t max) {
+    return int((int64_t)pixels * max / std::max(screen, 1));
+  };
+  Zone zone;
+  zone.id = id;
+  zone.left = uint16_t(scale(left, screenWidth, maxX));
+  zone.top = uint16_t(scale(top, screenHeight, maxY));
+  zone.right = uint16_t(std::max(scale(right, screenWidth, maxX) - 1, int(zone.left)));
+  zone.bottom = uint16_t(std::max(scale(bottom, screenHeight, maxY) - 1, int(zone.top)));
+  if (right == left || bottom == top) zone.id = 0;
+  return zone;
+}
+
+const HotZoneTracker::Zone* HotZoneTracker::ZoneAt(uint16_t x, uint16_t y) const {
+  for (size_t i = 0; i < config_.count; ++i) {
+    const Zone& zone = config_.zones[i];
+    if (zone.id && zone.Contains(x, y)) return &zone;
+  }
+  return nullptr;
+}
+
+HotZoneTracker::Result HotZoneTracker::Process(PenSample& sample) {
+  if (!pressing_) configSlot_.TryTake(config_);
+  if (config_.count == 0 && !pressing_) return Result::kPass;
+  const int64_t time = sample.deviceTimeUs;
+
+  if (pressing_) {
+    if (sample.flags & kPenSampleInk) {
+      inside_ = pressed_.Contains(sample.x, sample.y);
+    } else if ((sample.flags & kPenSampleStrokeEnd) && sample.strokeId == pressStrokeId_) {
+      pressing_ = false;
+      const bool held = time - pressStartUs_ >= config_.minPressUs;
+      if (armed_ && inside_ && held) {
+        lastClickUs_ = time;
+        sample.flags = kPenSampleHotZone | (sample.flags & kPenSampleProximity);
+        sample.strokeId = pressed_.id;
+        clicks_.fetch_add(1, std::memory_order_relaxed);
+        return Result::kClick;
+      }
+      if (!held) bounces_.fetch_add(1, std::memory_order_relaxed);
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return Result::kDrop;
+  }
+
+  if (sample.flags & kPenSampleStrokeBegin) {
+    const Zone* zone = ZoneAt(sample.x, sample.y);
+    if (!zone) return Result::kPass;
+    pressing_ = true;
+    armed_ = time - lastClickUs_ >= config_.refractoryUs;
+    inside_ = true;
+    pressed_ = *zone;
+    pressStrokeId_ = sample.strokeId;
+    pressStartUs_ = time;
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return Result::kDrop;
+  }
+
+  // Ink and stroke ends from strokes begun outside the zones always pass
+  if (sample.flags & (kPenSampleInk | kPenSampleStrokeEnd)) return Result::kPass;
+  if ((sample.flags & kPenSampleProximity) && ZoneAt(sample.x, sample.y)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return Result::kDrop;
+  }
+  return Result::kPass;
+}
+
+void HotZoneTracker::Reset() {
+  pressing_ = false;
+  inside_ = false;
+}
+
+HotZoneTracker::Stats HotZoneTracker::stats() const {
+  Stats stats;
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.clicks = clicks_.load(std::memory_order_relaxed);
+  stats.bounces = bounces_.load(std::memory_order_relaxed);
+  return stats;
+}
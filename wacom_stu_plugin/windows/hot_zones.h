@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "config_slot.h"
+#include "pen_sample.h"
+#include "screen_shadow.h"
+
+// On-pad buttons, hit-tested on the report thread after StrokeTracker.
+//
+// A stroke that starts inside a zone is a press: none of its samples are
+// passed on, and lifting the pen inside the same zone turns the end sample
+// into one click. Presses shorter than minPressUs are bounces, and presses
+// within refractoryUs of the last click are swallowed without one. Strokes
+// that start elsewhere are ink wherever they go and never reach the zones;
+// hover over a zone is dropped.
+class HotZoneTracker {
+ public:
+  static constexpr size_t kMaxZones = 16;
+
+  // Tablet units, corners inclusive
+  struct Zone {
+    uint32_t id = 0;
+    uint16_t left = 0;
+    uint16_t top = 0;
+    uint16_t right = 0;
+    uint16_t bottom = 0;
+
+    bool Contains(uint16_t x, uint16_t y) const {
+      return x >= left && x <= right && y >= top && y <= bottom;
+    }
+  };
+
+  struct Config {
+    std::array<Zone, kMaxZones> zones{};
+    size_t count = 0;
+    int64_t minPressUs = 20000;
+    int64_t refractoryUs = 150000;
+  };
+
+  struct Stats {
+    uint64_t dropped = 0;
+    uint64_t clicks = 0;
+    uint64_t bounces = 0;
+  };
+
+  enum class Result {
+    kPass,
+    kDrop,
+    // The sample now is the click: kPenSampleHotZone set, strokeId the
+    // zone's id
+    kClick,
+  };
+
+  // Maps |rect| in screen pixels onto the tablet's coordinate range
+  static Zone ZoneFromScreen(uint32_t id, const ScreenRect& rect, int screenWidth,
+                             int screenHeight, uint16_t maxX, uint16_t maxY);
+
+  // Platform thread. Takes effect once no press is in progress.
+  void SetConfig(const Config& config) { configSlot_.Publish(config); }
+
+  // Report thread
+  Result Process(PenSample& sample);
+
+  // Forgets a press in progress
+  void Reset();
+
+  Stats stats() const;
+
+ private:
+  const Zone* ZoneAt(uint16_t x, uint16_t y) const;
+
+  ConfigSlot<Config> configSlot_;
+  Config config_;
+
+  bool pressing_ = false;
+  // The press may click: it started outside the refractory period
+  bool armed_ = false;
+  // The pen was inside the pressed zone at its last ink sample
+  bool inside_ = false;
+  Zone pressed_;
+  uint32_t pressStrokeId_ = 0;
+  int64_t pressStartUs_ = 0;
+  int64_t lastClickUs_ = INT64_MIN / 2;
+
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> clicks_{0};
+  std::atomic<uint64_t> bounces_{0};
+};
@@ -0,0 +1,30 @@
+#include "ink_store.h"
+
+void InkStore::Add(const PenSample& sample) {
+  if (!(sample.flags & kPenSampleInk)) return;
+
+  if (strokes_.empty() || strokes_.back().first != sample.strokeId) {
+    strokes_.emplace_back(sample.strokeId, std::vector<InkPoint>());
+  }
+  strokes_.back().second.push_back({sample.x, sample.y, sample.pressure});
+  ++points_;
+
+  while (points_ > kMaxPoints && strokes_.size() > 1) {
+    points_ -= strokes_.front().second.size();
+    strokes_.erase(strokes_.begin());
+  }
+}
+
+void InkStore::Clear() {
+  strokes_.clear();
+  points_ = 0;
+}
+
+const std::vector<InkPoint>* InkStore::Find(uint32_t strokeId) const {
+  // Lookups happen once per stroke at render time; a scan from the back
+  // finds recent strokes first.
+  for (auto it = strokes_.rbegin(); it != strokes_.rend(); ++it) {
+    if (it->first == strokeId) return &it->second;
+  }
+  return nullptr;
+}
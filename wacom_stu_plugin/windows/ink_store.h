@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "pen_sample.h"
+
+struct InkPoint {
+  uint16_t x;
+  uint16_t y;
+  uint16_t pressure;
+};
+
+// Ink delivered to Dart, kept natively by stroke id so a finished signature
+// can be rendered without sending the points back over the channel.
+// Platform thread only.
+class InkStore {
+ public:
+  // Records |sample| if it is ink; everything else is ignored.
+  void Add(const PenSample& sample);
+
+  void Clear();
+
+  // Points of |strokeId|, or nullptr if it is unknown or was evicted
+  const std::vector<InkPoint>* Find(uint32_t strokeId) const;
+
+  size_t pointCount() const { return points_; }
+
+ private:
+  // Old strokes are evicted past this many points, so a pad left in
+  // capture mode cannot grow the store without bound.
+  static constexpr size_t kMaxPoints = 1 << 20;
+
+  std::vector<std::pair<uint32_t, std::vector<InkPoint>>> strokes_;
+  size_t points_ = 0;
+};
@@ -0,0 +1,72 @@
+#include "latest_wins_worker.h"
+
+#include <utility>
+
+LatestWinsWorker::LatestWinsWorker() : thread_([this] { Run(); }) {}
+
+LatestWinsWorker::~LatestWinsWorker() {
+  std::optional<Pending> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    cancelRunning_ = true;
+    dropped.swap(waiting_);
+  }
+  wake_.notify_all();
+  if (dropped) dropped->finished(Outcome::kCancelled);
+  thread_.join();
+}
+
+void LatestWinsWorker::Submit(Job job, Finished finished) {
+  std::optional<Pending> replaced;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    replaced.swap(waiting_);
+    waiting_ = Pending{std::move(job), std::move(finished)};
+  }
+  wake_.notify_one();
+  if (replaced) replaced->finished(Outcome::kReplaced);
+}
+
+void LatestWinsWorker::Cancel() {
+  std::optional<Pending> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropped.swap(waiting_);
+    if (running_) cancelRunning_ = true;
+  }
+  if (dropped) dropped->finished(Outcome::kCancelled);
+}
+
+void LatestWinsWorker::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return !running_ && !waiting_; });
+}
+
+bool LatestWinsWorker::busy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_ || waiting_.has_value();
+}
+
+void LatestWinsWorker::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this] { return stopping_ || waiting_.has_value(); });
+    if (stopping_) break;
+
+    Pending pending = std::move(*waiting_);
+    waiting_.reset();
+    running_ = true;
+    cancelRunning_ = false;
+    lock.unlock();
+
+    const bool completed = pending.job(cancelRunning_);
+    pending.finished(completed ? Outcome::kDone : Outcome::kCancelled);
+
+    lock.lock();
+    running_ = false;
+    if (!waiting_) idle_.notify_all();
+  }
+  running_ = false;
+  idle_.notify_all();
+}
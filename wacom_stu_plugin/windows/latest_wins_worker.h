@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// One background thread that runs jobs in submission order but keeps at
+// most one waiting: a newer Submit replaces a job that has not started. For
+// device writes where only the latest request matters, such as screen
+// uploads.
+class LatestWinsWorker {
+ public:
+  enum class Outcome {
+    // Ran to the end
+    kDone,
+    // Replaced by a newer job before it started
+    kReplaced,
+    // Dropped before it started, or stopped early at a checkpoint
+    kCancelled,
+  };
+
+  // |cancelled| turns true when Cancel is called while the job runs; jobs
+  // poll it between steps and return false if they stopped early.
+  using Job = std::function<bool(const std::atomic<bool>& cancelled)>;
+  // Called exactly once per job, on the worker thread for jobs that ran and
+  // on the caller's thread for ones dropped by Submit or Cancel. Never
+  // called with the worker's lock held.
+  using Finished = std::function<void(Outcome)>;
+
+  LatestWinsWorker();
+  // Cancels whatever is waiting and joins the thread
+  ~LatestWinsWorker();
+
+  LatestWinsWorker(const LatestWinsWorker&) = delete;
+  LatestWinsWorker& operator=(const LatestWinsWorker&) = delete;
+
+  void Submit(Job job, Finished finished);
+
+  // Drops the waiting job and asks the running one to stop
+  void Cancel();
+
+  // Blocks until nothing runs or waits
+  void WaitIdle();
+
+  bool busy() const;
+
+ private:
+  struct Pending {
+    Job job;
+    Finished finished;
+  };
+
+  void Run();
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::optional<Pending> waiting_;
+  bool running_ = false;
+  bool stopping_ = false;
+  std::atomic<bool> cancelRunning_{false};
+  std::thread thread_;
+};
@@ -0,0 +1,68 @@
+#include "pen_frame.h"
+
+namespace {
+
+void WriteVarint(std::vector<uint8_t>& out, int32_t value) {
+  uint32_t zigzag = (static_cast<uint32_t>(value) << 1) ^
+                    static_cast<uint32_t>(value >> 31);
+  while (zigzag >= 0x80) {
+    out.push_back(static_cast<uint8_t>(zigzag | 0x80));
+    zigzag >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(zigzag));
+}
+
+}  // namespace
+
+void PackPenFrame(const PenSample* samples, size_t count, int64_t t0,
+                  std::vector<int32_t>& out, const PenFrameMapped* mapped) {
+  out.resize(count * kFrameStride);
+  int32_t* dst = out.data();
+  for (size_t i = 0; i < count; ++i, dst += kFrameStride) {
+    const PenSample& s = samples[i];
+    dst[kFrameX] = mapped ? mapped->x[i] : s.x;
+    dst[kFrameY] = mapped ? mapped->y[i] : s.y;
+    dst[kFramePressure] = mapped ? mapped->pressure[i] : s.pressure;
+    dst[kFrameSw] = s.sw;
+    dst[kFrameTime] = static_cast<int32_t>(s.timestampUs - t0);
+    dst[kFrameSequence] = (s.flags & kPenSampleHasSequence) ? s.sequence : -1;
+    dst[kFrameDeviceTime] = static_cast<int32_t>(s.deviceTimeUs - t0);
+    dst[kFrameStrokeId] = static_cast<int32_t>(s.strokeId);
+    dst[kFrameFlags] = s.flags;
+  }
+}
+
+void PackPenFrameDelta(const PenSample* samples, size_t count, int64_t t0,
+                       std::vector<uint8_t>& out, const PenFrameMapped* mapped) {
+  out.clear();
+  out.reserve(count * kFrameStride * 2);
+
+  int32_t prevX = 0, prevY = 0, prevPressure = 0;
+  int64_t prevTime = t0;
+  int64_t prevDeviceTime = t0;
+  int32_t prevSequence = 0;
+  uint32_t prevStrokeId = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const PenSample& s = samples[i];
+    const int32_t x = mapped ? mapped->x[i] : s.x;
+    const int32_t y = mapped ? mapped->y[i] : s.y;
+    const int32_t pressure = mapped ? mapped->pressure[i] : s.pressure;
+    WriteVarint(out, x - prevX);
+    WriteVarint(out, y - prevY);
+    WriteVarint(out, pressure - prevPressure);
+    WriteVarint(out, s.sw);
+    WriteVarint(out, static_cast<int32_t>(s.timestampUs - prevTime));
+    const int32_t sequence = (s.flags & kPenSampleHasSequence) ? s.sequence : -1;
+    WriteVarint(out, sequence - prevSequence);
+    WriteVarint(out, static_cast<int32_t>(s.deviceTimeUs - prevDeviceTime));
+    WriteVarint(out, static_cast<int32_t>(s.strokeId - prevStrokeId));
+    WriteVarint(out, s.flags);
+    prevX = x;
+    prevY = y;
+    prevPressure = pressure;
+    prevTime = s.timestampUs;
+    prevDeviceTime = s.deviceTimeUs;
+    prevSequence = sequence;
+    prevStrokeId = s.strokeId;
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pen_sample.h"
+
+// Column layout of a packed pen frame. The Dart decoder in
+// lib/core/services/wacom_service.dart mirrors this; keep the two in sync.
+enum PenFrameColumn : int {
+  kFrameX = 0,
+  kFrameY,
+  kFramePressure,
+  kFrameSw,
+  kFrameTime,        // host read time, microseconds since the frame's t0
+  kFrameSequence,    // device sequence number, -1 when the model has none
+  kFrameDeviceTime,  // device clock mapped to host, microseconds since t0
+  kFrameStrokeId,    // see PenSample::strokeId
+  kFrameFlags,       // PenSampleFlags
+  kFrameStride
+};
+
+// Values that replace the samples' own x, y and pressure columns, one per
+// sample, e.g. from PenTransform
+struct PenFrameMapped {
+  const int32_t* x;
+  const int32_t* y;
+  const int32_t* pressure;
+};
+
+// Packs |count| samples into |out| as kFrameStride int32 values per sample.
+// Times are stored relative to |t0| so they fit in 32 bits.
+void PackPenFrame(const PenSample* samples, size_t count, int64_t t0,
+                  std::vector<int32_t>& out,
+                  const PenFrameMapped* mapped = nullptr);
+
+// Same layout, but every column except sw and flags is stored as the difference from
+// the previous sample and written as a zigzag varint. Typical pen motion
+// fits in one byte per column.
+void PackPenFrameDelta(const PenSample* samples, size_t count, int64_t t0,
+                       std::vector<uint8_t>& out,
+                       const PenFrameMapped* mapped = nullptr);
@@ -0,0 +1,61 @@
+#include "pen_handler.h"
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenData& penData) {
+    Notify(penData.rdy, penData.x, penData.y, penData.pressure, penData.sw);
+}
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenDataOption& penData) {
+    Notify(penData.rdy, penData.x, penData.y, penData.pressure, penData.sw);
+}
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequence& penData) {
+    NotifyTimed(penData.rdy, penData.x, penData.y, penData.pressure, penData.sw,
+                penData.timeCount, penData.sequence);
+}
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenDataEncrypted& penData) {
+    // Encrypted data contains 2 pen data points
+    for (const auto& p : penData.penData) {
+        Notify(p.rdy, p.x, p.y, p.pressure, p.sw);
+    }
+}
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenDataEncryptedOption& penData) {
+    // EncryptedOption inherits from Encrypted, so it also has penData[2]
+    for (const auto& p : penData.penData) {
+        Notify(p.rdy, p.x, p.y, p.pressure, p.sw);
+    }
+}
+
+void PenHandler::onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequenceEncrypted& penData) {
+    // This one inherits from PenDataTimeCountSequence, so it has x,y directly
+    NotifyTimed(penData.rdy, penData.x, penData.y, penData.pressure, penData.sw,
+                penData.timeCount, penData.sequence);
+}
+
+void PenHandler::Notify(bool rdy, uint16_t x, uint16_t y, uint16_t p, uint16_t sw) {
+    PenSample sample;
+    sample.flags = rdy ? kPenSampleProximity : 0;
+    sample.x = x;
+    sample.y = y;
+    sample.pressure = p;
+    sample.sw = sw;
+    sample.timestampUs = reportTimeUs_;
+    sample.deviceTimeUs = reportTimeUs_;
+    callback_(sample);
+}
+
+void PenHandler::NotifyTimed(bool rdy, uint16_t x, uint16_t y, uint16_t p, uint16_t sw,
+                             uint16_t timeCount, uint16_t sequence) {
+    PenSample sample;
+    sample.x = x;
+    sample.y = y;
+    sample.pressure = p;
+    sample.sw = sw;
+    sample.timeCount = timeCount;
+    sample.sequence = sequence;
+    sample.flags = kPenSampleHasSequence | (rdy ? kPenSampleProximity : 0);
+    sample.timestampUs = reportTimeUs_;
+    sample.deviceTimeUs = clock_->Update(timeCount, reportTimeUs_);
+    callback_(sample);
+}
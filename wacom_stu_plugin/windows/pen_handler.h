@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <WacomGSS/STU/ProtocolHelper.hpp>
+#include <WacomGSS/STU/ReportHandler.hpp>
+
+#include "device_clock_estimator.h"
+#include "pen_sample.h"
+
+// Turns the SDK's decoded pen reports into PenSamples. The plugin decodes
+// with PenReportDecoder; this is the SDK path it is measured against in
+// report_replay_benchmark. Only needs the SDK's protocol sources, not a
+// device.
+class PenHandler : public WacomGSS::STU::ProtocolHelper::ReportHandler {
+public:
+    PenHandler(std::function<void(const PenSample&)> callback,
+               DeviceClockEstimator* clock)
+        : callback_(callback), clock_(clock) {}
+
+    // Host time of the report about to be handled; every sample decoded from
+    // it carries this timestamp.
+    void SetReportTime(int64_t hostUs) { reportTimeUs_ = hostUs; }
+
+    void onReport(WacomGSS::STU::Protocol::PenData& penData) override;
+    void onReport(WacomGSS::STU::Protocol::PenDataOption& penData) override;
+    void onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequence& penData) override;
+    void onReport(WacomGSS::STU::Protocol::PenDataEncrypted& penData) override;
+    void onReport(WacomGSS::STU::Protocol::PenDataEncryptedOption& penData) override;
+    void onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequenceEncrypted& penData) override;
+
+private:
+    void Notify(bool rdy, uint16_t x, uint16_t y, uint16_t p, uint16_t sw);
+    void NotifyTimed(bool rdy, uint16_t x, uint16_t y, uint16_t p, uint16_t sw,
+                     uint16_t timeCount, uint16_t sequence);
+
+    std::function<void(const PenSample&)> callback_;
+    DeviceClockEstimator* clock_;
+    int64_t reportTimeUs_ = 0;
+};
@@ -0,0 +1,43 @@
+#include "pen_pipeline.h"
+
+bool PenPipeline::Process(const PenSample& sample) {
+  PenSample filled[SequenceGapFiller::kMaxOutput];
+  const size_t count = gapFiller.Process(sample, filled);
+  bool pushed = false;
+  for (size_t i = 0; i < count; ++i) pushed |= ProcessOne(filled[i]);
+  return pushed;
+}
+
+void PenPipeline::Reset() {
+  gapFiller.Reset();
+  strokeTracker.Reset();
+  hotZones.Reset();
+  strokeSimplifier.Reset();
+}
+
+bool PenPipeline::ProcessOne(PenSample sample) {
+  strokeTracker.Process(sample);
+
+  // Past the pad's own ink mark, the pad has drawn on its screen
+  const uint32_t inkPressure = hardwareInkPressure.load(std::memory_order_relaxed);
+  if (inkPressure && sample.pressure >= inkPressure) {
+    screenInked.store(true, std::memory_order_relaxed);
+  }
+
+  // Presses on the pad's buttons never reach the simplifier or Dart; a
+  // click goes out as one sample of its own
+  switch (hotZones.Process(sample)) {
+    case HotZoneTracker::Result::kDrop:
+      return false;
+    case HotZoneTracker::Result::kClick:
+      return ring.TryPush(sample);
+    case HotZoneTracker::Result::kPass:
+      break;
+  }
+
+  PenSample simplified[StrokeSimplifier::kMaxOutput];
+  const size_t count = strokeSimplifier.Process(sample, simplified);
+  bool pushed = false;
+  for (size_t i = 0; i < count; ++i) pushed |= ring.TryPush(simplified[i]);
+  return pushed;
+}
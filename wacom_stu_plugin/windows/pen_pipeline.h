@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "hot_zones.h"
+#include "pen_sample.h"
+#include "sequence_gap_filler.h"
+#include "spsc_ring.h"
+#include "stroke_simplifier.h"
+#include "stroke_tracker.h"
+
+// Room for several seconds of pen data at the fastest report rate, so the
+// ring only overflows if the platform thread stalls for a long time.
+using PenSampleRing = SpscRing<PenSample, 4096>;
+
+// One pad's decoded samples on their way to the platform thread, the same
+// on every platform: SequenceGapFiller, StrokeTracker, the hot zones and
+// StrokeSimplifier, into the ring the platform thread drains. Process runs
+// on the report thread, or the decrypt worker in an encrypted capture;
+// the stages are configured from the platform thread as their headers say.
+struct PenPipeline {
+  // Runs |sample|, and any samples the gap filler puts in front of it,
+  // through every stage. Never blocks; a full ring drops the sample and
+  // counts it. True if anything was queued, i.e. the platform thread
+  // wants a wakeup.
+  bool Process(const PenSample& sample);
+
+  // Platform thread, before reports start
+  void Reset();
+
+  SequenceGapFiller gapFiller;
+  StrokeTracker strokeTracker;
+  // Configured via setHotZones
+  HotZoneTracker hotZones;
+  // Configured via setSimplifier
+  StrokeSimplifier strokeSimplifier;
+
+  // Lock-free hand-off to the platform thread
+  PenSampleRing ring;
+
+  // The pad's own ink mark, set from the platform thread, 0 while the pad
+  // does not ink. A sample past it means the pad drew on its screen and
+  // sets screenInked, so the next upload resends the ink area.
+  std::atomic<uint32_t> hardwareInkPressure{0};
+  std::atomic<bool> screenInked{false};
+
+ private:
+  bool ProcessOne(PenSample sample);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// PenSample::flags
+enum PenSampleFlags : uint8_t {
+  // timeCount/sequence came from the device (PenDataTimeCountSequence)
+  kPenSampleHasSequence = 1 << 0,
+  // Raw rdy bit: the pen is within sensing range of the pad
+  kPenSampleProximity = 1 << 1,
+  // Set by StrokeTracker: the sample is part of a stroke
+  kPenSampleInk = 1 << 2,
+  // Set by StrokeTracker on the first ink sample of a stroke
+  kPenSampleStrokeBegin = 1 << 3,
+  // Set by StrokeTracker on the first sample after a stroke; the sample
+  // itself is not ink and strokeId names the stroke that ended
+  kPenSampleStrokeEnd = 1 << 4,
+  // Set by HotZoneTracker on a click; strokeId is the zone's id and the
+  // sample carries no ink
+  kPenSampleHotZone = 1 << 5,
+  // Set by SequenceGapFiller: the pad sent a report here that the host
+  // never read, and this sample is interpolated from its neighbours
+  kPenSampleSynthetic = 1 << 6,
+};
+
+// A single decoded pen report as it travels from the report thread to the
+// platform thread. Kept trivially copyable and fixed-size so it can live in
+// a preallocated ring without any per-sample allocation.
+struct PenSample {
+  uint16_t x = 0;
+  uint16_t y = 0;
+  uint16_t pressure = 0;
+  uint16_t sw = 0;
+  // Raw device counters, valid when kPenSampleHasSequence is set
+  uint16_t timeCount = 0;
+  uint16_t sequence = 0;
+  uint8_t flags = 0;
+  // Stroke this sample belongs to (or just ended), 0 for hover samples
+  uint32_t strokeId = 0;
+  // Host time in microseconds, taken on the report thread when the report
+  // was read
+  int64_t timestampUs = 0;
+  // Device timeCount mapped onto the host clock by DeviceClockEstimator.
+  // Falls back to timestampUs when the device sends no timeCount.
+  int64_t deviceTimeUs = 0;
+};
@@ -0,0 +1,154 @@
+#include "pen_transform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define WACOM_STU_TRANSFORM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Samples past 32767 are not real positions; like the SIMD path, they read
+// as negative and clamp to 0
+inline int32_t ClampInput(uint16_t value, int16_t max) {
+  return std::clamp<int32_t>(int16_t(value), 0, max);
+}
+
+#ifdef WACOM_STU_TRANSFORM_SSE2
+// x and y of one sample as adjacent 16-bit lanes
+inline int LoadXY(const PenSample& sample) {
+  static_assert(offsetof(PenSample, y) == offsetof(PenSample, x) + 2,
+                "x and y must be adjacent");
+  int xy;
+  std::memcpy(&xy, &sample.x, 4);
+  return xy;
+}
+
+inline __m128i Clamp32(__m128i v, __m128i lo, __m128i hi) {
+  __m128i below = _mm_cmplt_epi32(v, lo);
+  v = _mm_or_si128(_mm_and_si128(below, lo), _mm_andnot_si128(below, v));
+  __m128i above = _mm_cmpgt_epi32(v, hi);
+  return _mm_or_si128(_mm_and_si128(above, hi), _mm_andnot_si128(above, v));
+}
+#endif
+
+}  // namespace
+
+bool PenTransform::Configure(const Config& config, uint16_t tabletMaxX,
+                             uint16_t tabletMaxY, uint16_t maxPressure) {
+  const double inMaxX = std::min<int>(tabletMaxX, INT16_MAX);
+  const double inMaxY = std::min<int>(tabletMaxY, INT16_MAX);
+  const double rows[2][3] = {{config.a * kCoordOne, config.b * kCoordOne, config.c * kCoordOne},
+                             {config.d * kCoordOne, config.e * kCoordOne, config.f * kCoordOne}};
+
+  // The largest shift that keeps coefficients in 16 bits and every row's
+  // sum over the input range in 32
+  int shift = -1;
+  for (int s = 30; s >= 0; --s) {
+    const double scale = std::ldexp(1.0, s);
+    bool fits = true;
+    for (const auto& row : rows) {
+      const double bound = std::fabs(row[0]) * inMaxX + std::fabs(row[1]) * inMaxY +
+                           std::fabs(row[2]) + 1.0;
+      fits = fits && std::fabs(row[0]) * scale <= INT16_MAX &&
+             std::fabs(row[1]) * scale <= INT16_MAX && bound * scale < INT32_MAX;
+    }
+    if (fits) {
+      shift = s;
+      break;
+    }
+  }
+  if (shift < 0) return false;
+
+  const double scale = std::ldexp(1.0, shift);
+  const int32_t half = shift > 0 ? 1 << (shift - 1) : 0;
+  inMaxX_ = int16_t(inMaxX);
+  inMaxY_ = int16_t(inMaxY);
+  a_ = int16_t(std::lround(rows[0][0] * scale));
+  b_ = int16_t(std::lround(rows[0][1] * scale));
+  c_ = int32_t(std::lround(rows[0][2] * scale)) + half;
+  d_ = int16_t(std::lround(rows[1][0] * scale));
+  e_ = int16_t(std::lround(rows[1][1] * scale));
+  f_ = int32_t(std::lround(rows[1][2] * scale)) + half;
+  shift_ = shift;
+
+  if (config.clamp) {
+    minX_ = int32_t(std::lround(config.minX * kCoordOne));
+    minY_ = int32_t(std::lround(config.minY * kCoordOne));
+    maxX_ = std::max(minX_, int32_t(std::lround(config.maxX * kCoordOne)));
+    maxY_ = std::max(minY_, int32_t(std::lround(config.maxY * kCoordOne)));
+  } else {
+    minX_ = minY_ = INT32_MIN;
+    maxX_ = maxY_ = INT32_MAX;
+  }
+
+  const auto& curve = config.pressureCurve;
+  pressureTable_.resize(size_t(maxPressure) + 1);
+  for (size_t level = 0; level < pressureTable_.size(); ++level) {
+    const double t = maxPressure ? double(level) / maxPressure : 0.0;
+    double out = t;
+    if (curve.size() == 1) {
+      out = curve[0];
+    } else if (curve.size() > 1) {
+      const double position = t * (curve.size() - 1);
+      const size_t i = std::min(size_t(position), curve.size() - 2);
+      out = curve[i] + (curve[i + 1] - curve[i]) * (position - i);
+    }
+    pressureTable_[level] = int32_t(std::lround(std::clamp(out, 0.0, 1.0) * kPressureOne));
+  }
+
+  enabled_ = true;
+  return true;
+}
+
+void PenTransform::Apply(const PenSample* samples, size_t count, int32_t* x,
+                         int32_t* y, int32_t* pressure) const {
+  size_t i = 0;
+#ifdef WACOM_STU_TRANSFORM_SSE2
+  // Coefficient pairs in the lane order of LoadXY
+  auto pair = [](int16_t low, int16_t high) {
+    return int(uint32_t(uint16_t(low)) | uint32_t(uint16_t(high)) << 16);
+  };
+  const __m128i inMax = _mm_set1_epi32(pair(inMaxX_, inMaxY_));
+  const __m128i rowX = _mm_set1_epi32(pair(a_, b_));
+  const __m128i rowY = _mm_set1_epi32(pair(d_, e_));
+  const __m128i offsetX = _mm_set1_epi32(c_);
+  const __m128i offsetY = _mm_set1_epi32(f_);
+  const __m128i shift = _mm_cvtsi32_si128(shift_);
+  const __m128i minX = _mm_set1_epi32(minX_), maxX = _mm_set1_epi32(maxX_);
+  const __m128i minY = _mm_set1_epi32(minY_), maxY = _mm_set1_epi32(maxY_);
+  for (; i + 4 <= count; i += 4) {
+    // Built from registers; _mm_set_epi32 goes through the stack and
+    // stalls on the store forward
+    const __m128i xy01 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(LoadXY(samples[i])),
+                                            _mm_cvtsi32_si128(LoadXY(samples[i + 1])));
+    const __m128i xy23 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(LoadXY(samples[i + 2])),
+                                            _mm_cvtsi32_si128(LoadXY(samples[i + 3])));
+    __m128i xy = _mm_unpacklo_epi64(xy01, xy23);
+    xy = _mm_max_epi16(_mm_min_epi16(xy, inMax), _mm_setzero_si128());
+    __m128i mx = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(xy, rowX), offsetX), shift);
+    __m128i my = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(xy, rowY), offsetY), shift);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(x + i), Clamp32(mx, minX, maxX));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i), Clamp32(my, minY, maxY));
+  }
+#endif
+  ApplyScalar(samples + i, count - i, x + i, y + i);
+
+  const size_t top = pressureTable_.size() - 1;
+  for (size_t j = 0; j < count; ++j) {
+    pressure[j] = pressureTable_[std::min<size_t>(samples[j].pressure, top)];
+  }
+}
+
+void PenTransform::ApplyScalar(const PenSample* samples, size_t count, int32_t* x,
+                               int32_t* y) const {
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t sx = ClampInput(samples[i].x, inMaxX_);
+    const int32_t sy = ClampInput(samples[i].y, inMaxY_);
+    x[i] = std::clamp((a_ * sx + b_ * sy + c_) >> shift_, minX_, maxX_);
+    y[i] = std::clamp((d_ * sx + e_ * sy + f_) >> shift_, minY_, maxY_);
+  }
+}
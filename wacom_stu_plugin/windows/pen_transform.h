@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pen_sample.h"
+
+// Maps tablet coordinates and pressure to what the listener draws with.
+// Runs on the platform thread over each drained batch, after the ink store
+// has kept the raw sample, so the report thread never sees it.
+//
+// Fixed point throughout: the matrix is held as 16-bit coefficients with a
+// shift chosen so every product and sum fits 32 bits, which lets SSE2 do
+// x and y for four samples in two multiply-adds. Pressure goes through a
+// lookup table with one entry per device level.
+class PenTransform {
+ public:
+  // Coordinates come out in 1/16 of a target unit
+  static constexpr int kCoordFractionBits = 4;
+  static constexpr int32_t kCoordOne = 1 << kCoordFractionBits;
+  // Pressure comes out in 0..kPressureOne
+  static constexpr int32_t kPressureOne = 1 << 12;
+
+  struct Config {
+    // target = [a b c; d e f] * [x y 1], tablet units to target units
+    double a = 1, b = 0, c = 0;
+    double d = 0, e = 1, f = 0;
+    // Output pressure, 0..1, at evenly spaced input levels from 0 to the
+    // model's maximum; linear in between. Empty is the identity.
+    std::vector<double> pressureCurve;
+    // Target-space bounds mapped points are clamped to
+    bool clamp = false;
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+  };
+
+  // Replaces the transform. Returns false, leaving the old one, if the
+  // matrix scales too far to be held in fixed point.
+  bool Configure(const Config& config, uint16_t tabletMaxX, uint16_t tabletMaxY,
+                 uint16_t maxPressure);
+
+  // Back to passing samples through untouched
+  void Clear() { enabled_ = false; }
+
+  bool enabled() const { return enabled_; }
+
+  // Writes the mapped x, y and pressure of |count| samples
+  void Apply(const PenSample* samples, size_t count, int32_t* x, int32_t* y,
+             int32_t* pressure) const;
+
+ private:
+  void ApplyScalar(const PenSample* samples, size_t count, int32_t* x,
+                   int32_t* y) const;
+
+  bool enabled_ = false;
+  int16_t inMaxX_ = 0;
+  int16_t inMaxY_ = 0;
+  // Row coefficients in units of 2^-shift_ output steps
+  int16_t a_ = 0, b_ = 0, d_ = 0, e_ = 0;
+  // Offsets with the rounding half step folded in
+  int32_t c_ = 0, f_ = 0;
+  int shift_ = 0;
+  int32_t minX_ = INT32_MIN, minY_ = INT32_MIN;
+  int32_t maxX_ = INT32_MAX, maxY_ = INT32_MAX;
+  std::vector<int32_t> pressureTable_;
+};
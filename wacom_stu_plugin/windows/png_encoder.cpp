@@ -0,0 +1,392 @@
+#include "png_encoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "deflate.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WACOM_STU_PNG_SSE2 1
+#endif
+
+namespace {
+
+enum ColorType : uint8_t {
+  kGray = 0,
+  kRgb = 2,
+  kPalette = 3,
+  kGrayAlpha = 4,
+  kRgba = 6,
+};
+
+// Zero bytes kept in front of each row, so the "left" pixel of the first
+// one reads as zero as the filters require
+constexpr size_t kRowPad = 16;
+
+inline uint32_t PixelKey(const uint8_t* p) {
+  if (p[3] == 0) return 0;
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+         (uint32_t(p[3]) << 24);
+}
+
+struct ImageFormat {
+  uint8_t colorType = kRgba;
+  uint8_t bitDepth = 8;
+  // Palette entries as PixelKey values, in index order
+  std::vector<uint32_t> palette;
+  // Palette index per pixel, row-major, when colorType is kPalette
+  std::vector<uint8_t> indices;
+};
+
+// One pass over the image: collects up to 256 distinct colours (with each
+// pixel's index) and whether everything is gray and/or opaque.
+ImageFormat ChooseFormat(const uint8_t* rgba, int width, int height,
+                         size_t stride, bool reduce) {
+  ImageFormat format;
+  if (!reduce) return format;
+
+  constexpr int kTableBits = 10;
+  constexpr uint32_t kTableMask = (1u << kTableBits) - 1;
+  uint32_t keys[1 << kTableBits];
+  int16_t slots[1 << kTableBits];
+  std::fill(slots, slots + (1 << kTableBits), int16_t(-1));
+
+  bool paletteFits = true;
+  bool gray = true;
+  bool opaque = true;
+  format.indices.resize(size_t(width) * height);
+  uint8_t* index = format.indices.data();
+  // Most of a signature is runs of one pixel value; those skip everything
+  uint32_t lastRaw = 0;
+  uint8_t lastIndex = 0;
+  bool haveLast = false;
+
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* row = rgba + stride * y;
+    for (int x = 0; x < width; ++x, ++index) {
+      const uint8_t* p = row + x * 4;
+      uint32_t raw;
+      std::memcpy(&raw, p, 4);
+      if (haveLast && raw == lastRaw) {
+        *index = lastIndex;
+        continue;
+      }
+      gray = gray && p[0] == p[1] && p[1] == p[2];
+      opaque = opaque && p[3] == 255;
+      if (!paletteFits) continue;
+
+      const uint32_t key = PixelKey(p);
+
+      uint32_t slot = (key * 2654435761u) >> (32 - kTableBits);
+      while (slots[slot] >= 0 && keys[slot] != key) slot = (slot + 1) & kTableMask;
+      if (slots[slot] < 0) {
+        if (format.palette.size() == 256) {
+          paletteFits = false;
+          continue;
+        }
+        keys[slot] = key;
+        slots[slot] = int16_t(format.palette.size());
+        format.palette.push_back(key);
+      }
+      lastRaw = raw;
+      lastIndex = uint8_t(slots[slot]);
+      haveLast = true;
+      *index = lastIndex;
+    }
+  }
+
+  const size_t colors = format.palette.size();
+  // An opaque gray ramp filters better as gray than as palette indices
+  if (paletteFits && !(gray && opaque && colors > 16)) {
+    // Translucent entries first so tRNS can stop at the last of them
+    std::vector<uint8_t> order(colors);
+    for (size_t i = 0; i < colors; ++i) order[i] = uint8_t(i);
+    std::stable_sort(order.begin(), order.end(), [&](uint8_t a, uint8_t b) {
+      return (format.palette[a] >> 24) < (format.palette[b] >> 24);
+    });
+    uint8_t remap[256];
+    std::vector<uint32_t> sorted(colors);
+    for (size_t i = 0; i < colors; ++i) {
+      remap[order[i]] = uint8_t(i);
+      sorted[i] = format.palette[order[i]];
+    }
+    format.palette.swap(sorted);
+    for (uint8_t& i : format.indices) i = remap[i];
+
+    format.colorType = kPalette;
+    format.bitDepth = colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+    return format;
+  }
+
+  format.palette.clear();
+  format.indices.clear();
+  format.indices.shrink_to_fit();
+  if (gray) {
+    format.colorType = opaque ? kGray : kGrayAlpha;
+  } else {
+    format.colorType = opaque ? kRgb : kRgba;
+  }
+  return format;
+}
+
+int BytesPerPixel(uint8_t colorType) {
+  switch (colorType) {
+    case kGrayAlpha:
+      return 2;
+    case kRgb:
+      return 3;
+    case kRgba:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+void ConvertRow(const uint8_t* src, const uint8_t* indices, int width,
+                const ImageFormat& format, uint8_t* dst) {
+  switch (format.colorType) {
+    case kPalette:
+      if (format.bitDepth == 8) {
+        std::memcpy(dst, indices, size_t(width));
+      } else {
+        const int depth = format.bitDepth;
+        const int perByte = 8 / depth;
+        std::memset(dst, 0, size_t((width * depth + 7) / 8));
+        for (int x = 0; x < width; ++x) {
+          const int shift = 8 - depth * (x % perByte + 1);
+          dst[x / perByte] |= uint8_t(indices[x] << shift);
+        }
+      }
+      break;
+    case kGray:
+      for (int x = 0; x < width; ++x) dst[x] = src[x * 4];
+      break;
+    case kGrayAlpha:
+      for (int x = 0; x < width; ++x) {
+        const uint8_t a = src[x * 4 + 3];
+        dst[x * 2] = a ? src[x * 4] : 0;
+        dst[x * 2 + 1] = a;
+      }
+      break;
+    case kRgb:
+      for (int x = 0; x < width; ++x) {
+        dst[x * 3] = src[x * 4];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + 2];
+      }
+      break;
+    default:
+      for (int x = 0; x < width; ++x) {
+        const uint32_t key = PixelKey(src + x * 4);
+        dst[x * 4] = uint8_t(key);
+        dst[x * 4 + 1] = uint8_t(key >> 8);
+        dst[x * 4 + 2] = uint8_t(key >> 16);
+        dst[x * 4 + 3] = uint8_t(key >> 24);
+      }
+      break;
+  }
+}
+
+inline uint8_t PaethPredict(int a, int b, int c) {
+  const int pa = std::abs(b - c);
+  const int pb = std::abs(a - c);
+  const int pc = std::abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) return uint8_t(a);
+  return uint8_t(pb <= pc ? b : c);
+}
+
+// Residual cost used to rank filters: bytes read as signed, summed by
+// magnitude (the "minimum sum of absolute differences" heuristic)
+inline uint32_t SignedMagnitude(uint8_t v) { return v < 128 ? v : 256 - v; }
+
+// Applies Sub, Up, Average and Paeth to |cur| (previous row |prev|, both
+// preceded by kRowPad zero bytes) into out[1..4] and returns the heuristic
+// cost of each in sums[0..4], None included.
+void EvaluateFilters(const uint8_t* cur, const uint8_t* prev, size_t n, int bpp,
+                     uint8_t* const out[5], uint64_t sums[5]) {
+  std::fill(sums, sums + 5, uint64_t(0));
+  size_t i = 0;
+
+#ifdef WACOM_STU_PNG_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i acc[5] = {zero, zero, zero, zero, zero};
+  auto magnitude = [&](__m128i v) {
+    return _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero);
+  };
+  auto abs16 = [&](__m128i v) { return _mm_max_epi16(v, _mm_sub_epi16(zero, v)); };
+  auto paeth16 = [&](__m128i a, __m128i b, __m128i c) {
+    const __m128i pa = abs16(_mm_sub_epi16(b, c));
+    const __m128i pb = abs16(_mm_sub_epi16(a, c));
+    const __m128i pc = abs16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+    const __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+    const __m128i notB = _mm_cmpgt_epi16(pb, pc);
+    const __m128i bc = _mm_or_si128(_mm_and_si128(notB, c), _mm_andnot_si128(notB, b));
+    return _mm_or_si128(_mm_and_si128(notA, bc), _mm_andnot_si128(notA, a));
+  };
+
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i - bpp));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i - bpp));
+
+    const __m128i sub = _mm_sub_epi8(x, a);
+    const __m128i up = _mm_sub_epi8(x, b);
+    // _mm_avg_epu8 rounds up; PNG's average rounds down
+    const __m128i avgFloor =
+        _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    const __m128i avg = _mm_sub_epi8(x, avgFloor);
+    const __m128i predLo = paeth16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+                                   _mm_unpacklo_epi8(c, zero));
+    const __m128i predHi = paeth16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+                                   _mm_unpackhi_epi8(c, zero));
+    const __m128i paeth = _mm_sub_epi8(x, _mm_packus_epi16(predLo, predHi));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out[1] + i), sub);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out[2] + i), up);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out[3] + i), avg);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out[4] + i), paeth);
+    acc[0] = _mm_add_epi64(acc[0], magnitude(x));
+    acc[1] = _mm_add_epi64(acc[1], magnitude(sub));
+    acc[2] = _mm_add_epi64(acc[2], magnitude(up));
+    acc[3] = _mm_add_epi64(acc[3], magnitude(avg));
+    acc[4] = _mm_add_epi64(acc[4], magnitude(paeth));
+  }
+  for (int f = 0; f < 5; ++f) {
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc[f]);
+    sums[f] = lanes[0] + lanes[1];
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const uint8_t x = cur[i];
+    const uint8_t a = cur[i - bpp];
+    const uint8_t b = prev[i];
+    const uint8_t c = prev[i - bpp];
+    out[1][i] = uint8_t(x - a);
+    out[2][i] = uint8_t(x - b);
+    out[3][i] = uint8_t(x - ((a + b) >> 1));
+    out[4][i] = uint8_t(x - PaethPredict(a, b, c));
+    sums[0] += SignedMagnitude(x);
+    for (int f = 1; f < 5; ++f) sums[f] += SignedMagnitude(out[f][i]);
+  }
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t v) {
+  out.push_back(uint8_t(v >> 24));
+  out.push_back(uint8_t(v >> 16));
+  out.push_back(uint8_t(v >> 8));
+  out.push_back(uint8_t(v));
+}
+
+void PutChunk(std::vector<uint8_t>& out, const char type[4],
+              const uint8_t* data, size_t size) {
+  PutU32(out, uint32_t(size));
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  if (size) out.insert(out.end(), data, data + size);
+  PutU32(out, Crc32(out.data() + start, size + 4));
+}
+
+}  // namespace
+
+std::vector<uint8_t> EncodePng(const uint8_t* rgba, int width, int height,
+                               size_t stride, const PngOptions& options) {
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+  const ImageFormat format =
+      ChooseFormat(rgba, width, height, stride, options.reduceColorType);
+  const int bpp = BytesPerPixel(format.colorType);
+  const size_t rowBytes = (size_t(width) * bpp * format.bitDepth + 7) / 8;
+
+  // Sub-byte rows are left unfiltered, as filters rarely help them. Palette
+  // entries are sorted by alpha, so 8-bit indices follow the anti-aliased
+  // edge much like an alpha channel and are filtered like one.
+  const bool filterable = format.bitDepth == 8;
+
+  std::vector<uint8_t> rows(2 * (kRowPad + rowBytes), 0);
+  uint8_t* cur = rows.data() + kRowPad;
+  uint8_t* prev = rows.data() + 2 * kRowPad + rowBytes;
+  std::vector<uint8_t> candidates(4 * rowBytes);
+  uint8_t* out[5] = {cur, candidates.data(), candidates.data() + rowBytes,
+                     candidates.data() + 2 * rowBytes,
+                     candidates.data() + 3 * rowBytes};
+
+  std::vector<uint8_t> filtered((rowBytes + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    ConvertRow(rgba + stride * y,
+               format.indices.empty() ? nullptr : format.indices.data() + size_t(width) * y,
+               width, format, cur);
+    uint8_t* dst = filtered.data() + (rowBytes + 1) * y;
+
+    // Filter with the smallest residual magnitude (libpng's heuristic);
+    // ties go to the simpler filter
+    int filter = 0;
+    if (filterable) {
+      uint64_t sums[5];
+      EvaluateFilters(cur, prev, rowBytes, bpp, out, sums);
+      for (int f = 1; f < 5; ++f) {
+        if (sums[f] < sums[filter]) filter = f;
+      }
+    }
+    std::memcpy(dst + 1, out[filter], rowBytes);
+    dst[0] = uint8_t(filter);
+    std::swap(cur, prev);
+    out[0] = cur;
+  }
+
+  DeflateOptions deflate;
+  switch (options.preset) {
+    case PngPreset::kFast:
+      deflate.maxChain = 4;
+      break;
+    case PngPreset::kBalanced:
+      deflate.maxChain = 16;
+      break;
+    case PngPreset::kSmallest:
+      deflate.maxChain = 128;
+      deflate.lazy = true;
+      break;
+  }
+  std::vector<uint8_t> idat;
+  ZlibCompress(filtered.data(), filtered.size(), deflate, idat);
+
+  uint8_t ihdr[13];
+  ihdr[0] = uint8_t(width >> 24);
+  ihdr[1] = uint8_t(width >> 16);
+  ihdr[2] = uint8_t(width >> 8);
+  ihdr[3] = uint8_t(width);
+  ihdr[4] = uint8_t(height >> 24);
+  ihdr[5] = uint8_t(height >> 16);
+  ihdr[6] = uint8_t(height >> 8);
+  ihdr[7] = uint8_t(height);
+  ihdr[8] = format.bitDepth;
+  ihdr[9] = format.colorType;
+  ihdr[10] = 0;  // deflate
+  ihdr[11] = 0;  // adaptive filtering
+  ihdr[12] = 0;  // no interlace
+
+  std::vector<uint8_t> png(kSignature, kSignature + 8);
+  png.reserve(idat.size() + 64 + format.palette.size() * 4);
+  PutChunk(png, "IHDR", ihdr, sizeof(ihdr));
+  if (format.colorType == kPalette) {
+    std::vector<uint8_t> plte;
+    std::vector<uint8_t> trns;
+    for (uint32_t key : format.palette) {
+      plte.push_back(uint8_t(key));
+      plte.push_back(uint8_t(key >> 8));
+      plte.push_back(uint8_t(key >> 16));
+      // Entries are sorted by alpha, so opaque ones only ever trail
+      if ((key >> 24) != 255) trns.push_back(uint8_t(key >> 24));
+    }
+    PutChunk(png, "PLTE", plte.data(), plte.size());
+    if (!trns.empty()) PutChunk(png, "tRNS", trns.data(), trns.size());
+  }
+  PutChunk(png, "IDAT", idat.data(), idat.size());
+  PutChunk(png, "IEND", nullptr, 0);
+  return png;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Presets only trade deflate effort; colour type and per-row filter
+// choice are the same for all of them.
+enum class PngPreset {
+  // Short hash chains
+  kFast,
+  // Moderate hash chains
+  kBalanced,
+  // Long hash chains and lazy matching
+  kSmallest,
+};
+
+struct PngOptions {
+  PngPreset preset = PngPreset::kBalanced;
+  // Write palette, grayscale or RGB when that is lossless; off always
+  // writes RGBA
+  bool reduceColorType = true;
+};
+
+// Encodes straight (non-premultiplied) RGBA8 pixels as a PNG.
+// |stride| is the distance between rows in bytes. Fully transparent pixels
+// are written as transparent black whatever their colour channels hold.
+//
+// Each row gets the filter with the smallest residual, evaluated with SSE2
+// where available. Signatures are a single ink colour over transparency, so
+// they fit a palette (with a tRNS chunk) and encode at one byte per pixel.
+std::vector<uint8_t> EncodePng(const uint8_t* rgba, int width, int height,
+                               size_t stride,
+                               const PngOptions& options = PngOptions());
@@ -0,0 +1,15 @@
+#include "report_decoder.h"
+
+// Built at compile time; no static initialization runs for it
+constexpr PenReportDecoder::Table PenReportDecoder::kTable = PenReportDecoder::MakeTable();
+
+size_t PenReportDecoder::Decode(const ReportRecord* records, size_t count, PenSample* out,
+                                size_t capacity, size_t* decoded) {
+  size_t samples = 0;
+  size_t i = 0;
+  for (; i < count && capacity - samples >= kMaxSamplesPerReport; ++i) {
+    samples += Decode(records[i].data, records[i].size, records[i].hostUs, out + samples);
+  }
+  if (decoded) *decoded = i;
+  return samples;
+}
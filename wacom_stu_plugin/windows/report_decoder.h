@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "device_clock_estimator.h"
+#include "pen_sample.h"
+#include "report_session.h"
+
+// Decodes STU pen reports straight into PenSamples, without the SDK's
+// virtual report handler and its per-variant callbacks. Each pen data
+// variant has its layout fixed at compile time; a 256-entry table keyed by
+// report id picks the decoder built for it, so a report costs one table
+// load and one call. Nothing allocates. Shared by both platforms.
+//
+// Encrypted variants decode once their AES block has been decrypted in
+// place (see DecryptWorker); their session id must match the capture's.
+
+// Report ids of the pen data variants
+enum PenReportId : uint8_t {
+  kPenReportData = 0x01,
+  kPenReportDataEncrypted = 0x10,
+  kPenReportDataOption = 0x30,
+  kPenReportDataEncryptedOption = 0x31,
+  kPenReportDataTimeCountSequenceEncrypted = 0x33,
+  kPenReportDataTimeCountSequence = 0x34,
+};
+
+// Byte layout of a pen data report, report id at offset 0. A report holds
+// kPoints points of 6 bytes from offset kPoint: rdy in bit 7 of the first
+// byte, the switch in bits 4-6 and the pressure's high bits in 0-3, then
+// pressure low, x and y, big-endian. Variants only differ in what else they
+// carry.
+template <uint8_t Id>
+struct PenReportLayout;
+
+template <>
+struct PenReportLayout<kPenReportData> {
+  static constexpr size_t kSize = 7;
+  static constexpr size_t kPoint = 1;
+  static constexpr size_t kPoints = 1;
+  static constexpr bool kTimed = false;
+  static constexpr bool kEncrypted = false;
+};
+
+// Adds a 16-bit option the pipeline does not use
+template <>
+struct PenReportLayout<kPenReportDataOption> {
+  static constexpr size_t kSize = 9;
+  static constexpr size_t kPoint = 1;
+  static constexpr size_t kPoints = 1;
+  static constexpr bool kTimed = false;
+  static constexpr bool kEncrypted = false;
+};
+
+template <>
+struct PenReportLayout<kPenReportDataTimeCountSequence> {
+  static constexpr size_t kSize = 11;
+  static constexpr size_t kPoint = 1;
+  static constexpr size_t kPoints = 1;
+  static constexpr bool kTimed = true;
+  static constexpr bool kEncrypted = false;
+  static constexpr size_t kTimeCount = 7;
+  static constexpr size_t kSequence = 9;
+};
+
+// The encrypted variants, as they read once the 16 bytes from offset 1
+// are decrypted: a 32-bit session id, then two points
+template <>
+struct PenReportLayout<kPenReportDataEncrypted> {
+  static constexpr size_t kSize = 17;
+  static constexpr size_t kPoint = 5;
+  static constexpr size_t kPoints = 2;
+  static constexpr bool kTimed = false;
+  static constexpr bool kEncrypted = true;
+  static constexpr size_t kSessionId = 1;
+};
+
+// Plus a 32-bit option after the block, left in the clear
+template <>
+struct PenReportLayout<kPenReportDataEncryptedOption> {
+  static constexpr size_t kSize = 21;
+  static constexpr size_t kPoint = 5;
+  static constexpr size_t kPoints = 2;
+  static constexpr bool kTimed = false;
+  static constexpr bool kEncrypted = true;
+  static constexpr size_t kSessionId = 1;
+};
+
+// One point with its count and sequence, then the session id and 2 bytes
+// of padding
+template <>
+struct PenReportLayout<kPenReportDataTimeCountSequenceEncrypted> {
+  static constexpr size_t kSize = 17;
+  static constexpr size_t kPoint = 1;
+  static constexpr size_t kPoints = 1;
+  static constexpr bool kTimed = true;
+  static constexpr bool kEncrypted = true;
+  static constexpr size_t kTimeCount = 7;
+  static constexpr size_t kSequence = 9;
+  static constexpr size_t kSessionId = 11;
+};
+
+class PenReportDecoder {
+ public:
+  // Room a caller leaves in |out| for a single report
+  static constexpr size_t kMaxSamplesPerReport = 2;
+  // Where an encrypted report's AES block starts; it is 16 bytes long
+  static constexpr size_t kEncryptedBlock = 1;
+
+  // Timed reports are mapped onto the host clock through |clock|, which
+  // may be null to leave deviceTimeUs at the report's host time
+  explicit PenReportDecoder(DeviceClockEstimator* clock) : clock_(clock) {}
+
+  // One report as read, report id first. It may be longer than its layout,
+  // as Windows pads every read to the longest input report. Returns the
+  // samples written to |out|: none for reports that are not plain pen data
+  // or are cut short. Encrypted reports only decode with |decrypted| set,
+  // i.e. their block already decrypted in place, and only if they carry
+  // the session id; the others are counted in sessionMismatches().
+  size_t Decode(const uint8_t* report, size_t size, int64_t hostUs, PenSample* out,
+                bool decrypted = false);
+
+  // True for an encrypted pen data report long enough to decode
+  static bool IsEncrypted(const uint8_t* report, size_t size);
+
+  // The id the pad was told at the start of an encrypted capture
+  void SetSessionId(uint32_t sessionId) { sessionId_ = sessionId; }
+  uint64_t sessionMismatches() const { return sessionMismatches_; }
+
+  // A run of reports in one pass, e.g. a recorded session. Stops early when
+  // |out| has no room for another report's samples; |decoded|, if given,
+  // gets the number of records used up.
+  size_t Decode(const ReportRecord* records, size_t count, PenSample* out, size_t capacity,
+                size_t* decoded = nullptr);
+
+ private:
+  using DecodeFn = size_t (*)(const uint8_t* report, int64_t hostUs, PenReportDecoder& decoder,
+                              PenSample* out);
+  struct Entry {
+    // Smallest report that holds the layout; 0 for ids that are not decoded
+    uint8_t size = 0;
+    bool encrypted = false;
+    DecodeFn decode = nullptr;
+  };
+  using Table = std::array<Entry, 256>;
+
+  template <uint8_t Id>
+  static size_t DecodeLayout(const uint8_t* report, int64_t hostUs, PenReportDecoder& decoder,
+                             PenSample* out);
+  template <uint8_t Id>
+  static constexpr void Register(Table& table);
+  static constexpr Table MakeTable();
+
+  static const Table kTable;
+
+  DeviceClockEstimator* clock_;
+  uint32_t sessionId_ = 0;
+  uint64_t sessionMismatches_ = 0;
+};
+
+template <uint8_t Id>
+size_t PenReportDecoder::DecodeLayout(const uint8_t* report, int64_t hostUs,
+                                      PenReportDecoder& decoder, PenSample* out) {
+  using Layout = PenReportLayout<Id>;
+  if constexpr (Layout::kEncrypted) {
+    const uint8_t* id = report + Layout::kSessionId;
+    const uint32_t sessionId = uint32_t(id[0]) << 24 | uint32_t(id[1]) << 16 |
+                               uint32_t(id[2]) << 8 | id[3];
+    if (sessionId != decoder.sessionId_) {
+      ++decoder.sessionMismatches_;
+      return 0;
+    }
+  }
+  for (size_t i = 0; i < Layout::kPoints; ++i) {
+    const uint8_t* point = report + Layout::kPoint + 6 * i;
+    PenSample sample;
+    sample.flags = (point[0] & 0x80) ? kPenSampleProximity : 0;
+    sample.sw = (point[0] >> 4) & 0x07;
+    sample.pressure = uint16_t((point[0] & 0x0F) << 8 | point[1]);
+    sample.x = uint16_t(point[2] << 8 | point[3]);
+    sample.y = uint16_t(point[4] << 8 | point[5]);
+    sample.timestampUs = hostUs;
+    sample.deviceTimeUs = hostUs;
+    if constexpr (Layout::kTimed) {
+      sample.timeCount =
+          uint16_t(report[Layout::kTimeCount] << 8 | report[Layout::kTimeCount + 1]);
+      sample.sequence = uint16_t(report[Layout::kSequence] << 8 | report[Layout::kSequence + 1]);
+      sample.flags |= kPenSampleHasSequence;
+      if (decoder.clock_) sample.deviceTimeUs = decoder.clock_->Update(sample.timeCount, hostUs);
+    }
+    out[i] = sample;
+  }
+  return Layout::kPoints;
+}
+
+template <uint8_t Id>
+constexpr void PenReportDecoder::Register(Table& table) {
+  static_assert(PenReportLayout<Id>::kPoints <= kMaxSamplesPerReport, "raise kMaxSamplesPerReport");
+  table[Id].size = uint8_t(PenReportLayout<Id>::kSize);
+  table[Id].encrypted = PenReportLayout<Id>::kEncrypted;
+  table[Id].decode = &DecodeLayout<Id>;
+}
+
+constexpr PenReportDecoder::Table PenReportDecoder::MakeTable() {
+  Table table{};
+  Register<kPenReportData>(table);
+  Register<kPenReportDataOption>(table);
+  Register<kPenReportDataTimeCountSequence>(table);
+  Register<kPenReportDataEncrypted>(table);
+  Register<kPenReportDataEncryptedOption>(table);
+  Register<kPenReportDataTimeCountSequenceEncrypted>(table);
+  return table;
+}
+
+inline size_t PenReportDecoder::Decode(const uint8_t* report, size_t size, int64_t hostUs,
+                                       PenSample* out, bool decrypted) {
+  if (size == 0) return 0;
+  const Entry& entry = kTable[report[0]];
+  if (size < entry.size || !entry.decode || (entry.encrypted && !decrypted)) return 0;
+  return entry.decode(report, hostUs, *this, out);
+}
+
+inline bool PenReportDecoder::IsEncrypted(const uint8_t* report, size_t size) {
+  if (size == 0) return false;
+  const Entry& entry = kTable[report[0]];
+  return entry.encrypted && size >= entry.size;
+}
@@ -0,0 +1,170 @@
+#include "report_session.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'T', 'U', 'R', 'E', 'P', 'T', '1'};
+constexpr size_t kHeaderSize = 8 + 6 * 2 + 8;
+// The writer's buffer is written out past this
+constexpr size_t kFlushBytes = 64 << 10;
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(uint8_t(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(uint8_t(value));
+}
+
+// False if the varint runs past |end| or over 64 bits
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    const uint8_t byte = *p++;
+    value |= uint64_t(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+void Put16(uint8_t* p, uint16_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+}
+
+uint16_t Get16(const uint8_t* p) { return uint16_t(p[0] | p[1] << 8); }
+
+int64_t SteadyUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+ReportSessionWriter::~ReportSessionWriter() { Close(); }
+
+bool ReportSessionWriter::Open(const std::string& path, const ReportSessionHeader& header) {
+  Close();
+  file_.open(fs::u8path(path), std::ios::binary | std::ios::trunc);
+  if (!file_) return false;
+  failed_ = false;
+  reports_ = 0;
+  lastUs_ = header.startUs;
+
+  uint8_t packed[kHeaderSize];
+  std::memcpy(packed, kMagic, 8);
+  Put16(packed + 8, header.productId);
+  Put16(packed + 10, header.tabletMaxX);
+  Put16(packed + 12, header.tabletMaxY);
+  Put16(packed + 14, header.tabletMaxPressure);
+  Put16(packed + 16, header.screenWidth);
+  Put16(packed + 18, header.screenHeight);
+  for (int i = 0; i < 8; ++i) packed[20 + i] = uint8_t(uint64_t(header.startUs) >> (8 * i));
+  buffer_.assign(packed, packed + kHeaderSize);
+  buffer_.reserve(kFlushBytes + 64);
+  bytes_ = kHeaderSize;
+  return true;
+}
+
+void ReportSessionWriter::Append(int64_t hostUs, const uint8_t* data, size_t size) {
+  if (!file_.is_open()) return;
+  const size_t before = buffer_.size();
+  PutVarint(buffer_, uint64_t(hostUs > lastUs_ ? hostUs - lastUs_ : 0));
+  PutVarint(buffer_, size);
+  buffer_.insert(buffer_.end(), data, data + size);
+  if (hostUs > lastUs_) lastUs_ = hostUs;
+  bytes_ += buffer_.size() - before;
+  ++reports_;
+  if (buffer_.size() >= kFlushBytes) Flush();
+}
+
+bool ReportSessionWriter::Close() {
+  if (!file_.is_open()) return !failed_;
+  Flush();
+  file_.close();
+  failed_ |= file_.fail();
+  return !failed_;
+}
+
+void ReportSessionWriter::Flush() {
+  if (buffer_.empty()) return;
+  file_.write(reinterpret_cast<const char*>(buffer_.data()), std::streamsize(buffer_.size()));
+  failed_ |= !file_;
+  buffer_.clear();
+}
+
+bool ReportSession::Load(const std::string& path) {
+  std::ifstream file(fs::u8path(path), std::ios::binary);
+  if (!file) return false;
+  return Parse(std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                    std::istreambuf_iterator<char>()));
+}
+
+bool ReportSession::Parse(std::vector<uint8_t> bytes) {
+  records_.clear();
+  bytes_ = std::move(bytes);
+  if (bytes_.size() < kHeaderSize || std::memcmp(bytes_.data(), kMagic, 8) != 0) {
+    bytes_.clear();
+    return false;
+  }
+  const uint8_t* p = bytes_.data();
+  header_.productId = Get16(p + 8);
+  header_.tabletMaxX = Get16(p + 10);
+  header_.tabletMaxY = Get16(p + 12);
+  header_.tabletMaxPressure = Get16(p + 14);
+  header_.screenWidth = Get16(p + 16);
+  header_.screenHeight = Get16(p + 18);
+  uint64_t start = 0;
+  for (int i = 0; i < 8; ++i) start |= uint64_t(p[20 + i]) << (8 * i);
+  header_.startUs = int64_t(start);
+
+  p += kHeaderSize;
+  const uint8_t* end = bytes_.data() + bytes_.size();
+  int64_t hostUs = header_.startUs;
+  while (p < end) {
+    uint64_t delta, size;
+    if (!GetVarint(p, end, delta) || !GetVarint(p, end, size) || size > uint64_t(end - p)) break;
+    hostUs += int64_t(delta);
+    records_.push_back(ReportRecord{hostUs, p, size_t(size)});
+    p += size;
+  }
+  return true;
+}
+
+ReportReplay::ReportReplay(const ReportSession& session, Options options)
+    : session_(session), options_(options) {}
+
+bool ReportReplay::Next(ReportRecord& record) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (cancelled_ || next_ >= session_.size()) return false;
+  record = session_[next_];
+
+  if (options_.realTime) {
+    const int64_t firstUs = session_[0].hostUs;
+    if (next_ == 0) startUs_ = SteadyUs();
+    const double speed = options_.speed > 0 ? options_.speed : 1.0;
+    const int64_t dueUs = startUs_ + int64_t((record.hostUs - firstUs) / speed);
+    const auto due = std::chrono::steady_clock::time_point(std::chrono::microseconds(dueUs));
+    wake_.wait_until(lock, due, [this] { return cancelled_; });
+    if (cancelled_) return false;
+  }
+
+  record.hostUs += options_.timeOffsetUs;
+  ++next_;
+  return true;
+}
+
+void ReportReplay::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+  }
+  wake_.notify_all();
+}
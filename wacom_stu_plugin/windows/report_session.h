@@ -0,0 +1,131 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Raw pad reports with the host time each was read, as written by the
+// report thread in capture mode. A session replays through PenReportDecoder
+// and the rest of the pipeline with no pad attached, on any platform.
+//
+// File layout: magic, header, then one record per report: the host time
+// since the previous record and the report size as LEB128 varints, then the
+// report bytes, report id first. Little-endian throughout. A pen report
+// takes about a dozen bytes, so an hour at 200 reports/s is under 10 MB.
+
+// What replay needs to know about the pad that was recorded
+struct ReportSessionHeader {
+  uint16_t productId = 0;
+  uint16_t tabletMaxX = 0;
+  uint16_t tabletMaxY = 0;
+  uint16_t tabletMaxPressure = 0;
+  uint16_t screenWidth = 0;
+  uint16_t screenHeight = 0;
+  // Host time of the session's start; records count from it
+  int64_t startUs = 0;
+};
+
+struct ReportRecord {
+  int64_t hostUs = 0;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// Appends records to a session file. Buffered, so the report thread only
+// touches the file every few thousand reports. Not thread safe.
+class ReportSessionWriter {
+ public:
+  ReportSessionWriter() = default;
+  ~ReportSessionWriter();
+
+  ReportSessionWriter(const ReportSessionWriter&) = delete;
+  ReportSessionWriter& operator=(const ReportSessionWriter&) = delete;
+
+  // Creates |path|, replacing any file there, and writes the header.
+  // Returns false if it cannot be created.
+  bool Open(const std::string& path, const ReportSessionHeader& header);
+
+  // |hostUs| never goes back; a smaller one is recorded as no time passing
+  void Append(int64_t hostUs, const uint8_t* data, size_t size);
+
+  // Flushes and closes; false if any write failed
+  bool Close();
+
+  uint64_t reports() const { return reports_; }
+  uint64_t bytes() const { return bytes_; }
+
+ private:
+  void Flush();
+
+  std::ofstream file_;
+  std::vector<uint8_t> buffer_;
+  int64_t lastUs_ = 0;
+  uint64_t reports_ = 0;
+  uint64_t bytes_ = 0;
+  bool failed_ = false;
+};
+
+// A whole session, read into memory
+class ReportSession {
+ public:
+  ReportSession() = default;
+  // Records point into the bytes, so moves only
+  ReportSession(const ReportSession&) = delete;
+  ReportSession& operator=(const ReportSession&) = delete;
+  ReportSession(ReportSession&&) = default;
+  ReportSession& operator=(ReportSession&&) = default;
+
+  // False if |path| is unreadable or not a session
+  bool Load(const std::string& path);
+  // Same, from a file's bytes
+  bool Parse(std::vector<uint8_t> bytes);
+
+  const ReportSessionHeader& header() const { return header_; }
+
+  // Records in order. A record cut short, as when the app died mid-write,
+  // ends the session.
+  size_t size() const { return records_.size(); }
+  const ReportRecord& operator[](size_t i) const { return records_[i]; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  ReportSessionHeader header_;
+  std::vector<ReportRecord> records_;
+};
+
+// Transport that hands out a session's reports in place of the pad's
+// interface queue: either as fast as they are taken, or spaced as they were
+// recorded. Reports always carry their recorded host time plus
+// |timeOffsetUs|, so a replay decodes the same way at any speed.
+class ReportReplay {
+ public:
+  struct Options {
+    bool realTime = false;
+    // Real-time playback rate; 2 plays twice as fast
+    double speed = 1.0;
+    int64_t timeOffsetUs = 0;
+  };
+
+  ReportReplay(const ReportSession& session, Options options);
+
+  // Next report, in real time waiting until it is due. False at the end of
+  // the session or once Cancel is called.
+  bool Next(ReportRecord& record);
+
+  // Wakes a waiting Next; any thread
+  void Cancel();
+
+ private:
+  const ReportSession& session_;
+  Options options_;
+  size_t next_ = 0;
+  // Steady clock time the first report is due, set by the first Next
+  int64_t startUs_ = 0;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool cancelled_ = false;
+};
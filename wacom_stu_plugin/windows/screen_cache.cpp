@@ -0,0 +1,266 @@
+#include "screen_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "deflate.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+
+// File layout: magic, key, payload size, Adler-32 of the payload, payload.
+// Little-endian throughout.
+constexpr char kMagic[8] = {'S', 'T', 'U', 'S', 'C', 'R', 'N', '1'};
+constexpr size_t kHeaderSize = 8 + 8 + 4 + 4;
+constexpr const char* kExtension = ".screen";
+
+inline uint64_t Rotl(uint64_t v, int bits) {
+  return (v << bits) | (v >> (64 - bits));
+}
+
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  return Rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+void Put32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+uint32_t Get32(const uint8_t* p) {
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 |
+         uint32_t(p[3]) << 24;
+}
+
+int64_t WriteTime(const fs::path& path) {
+  std::error_code ec;
+  const auto time = fs::last_write_time(path, ec);
+  return ec ? 0 : int64_t(time.time_since_epoch().count());
+}
+
+}  // namespace
+
+uint64_t HashScreenBytes(const uint8_t* data, size_t size, uint64_t seed) {
+  // Four independent lanes so the multiplies pipeline
+  uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed,
+                       seed - kPrime1};
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    lanes[0] = Round(lanes[0], Read64(data + i));
+    lanes[1] = Round(lanes[1], Read64(data + i + 8));
+    lanes[2] = Round(lanes[2], Read64(data + i + 16));
+    lanes[3] = Round(lanes[3], Read64(data + i + 24));
+  }
+  uint64_t h = Rotl(lanes[0], 1) + Rotl(lanes[1], 7) + Rotl(lanes[2], 12) +
+               Rotl(lanes[3], 18) + uint64_t(size);
+  for (; i + 8 <= size; i += 8) h = Rotl(h ^ Round(0, Read64(data + i)), 27) * kPrime1;
+  for (; i < size; ++i) h = Rotl(h ^ (data[i] * kPrime3), 11) * kPrime1;
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t ScreenCacheKey::Digest() const {
+  uint8_t packed[17];
+  std::memcpy(packed, &pixels, 8);
+  std::memcpy(packed + 8, &model, 2);
+  std::memcpy(packed + 10, &width, 2);
+  std::memcpy(packed + 12, &height, 2);
+  packed[14] = mode;
+  packed[15] = format;
+  packed[16] = dither;
+  return HashScreenBytes(packed, sizeof(packed));
+}
+
+ScreenCache::ScreenCache(size_t memoryBytes, size_t diskBytes)
+    : memoryLimit_(memoryBytes), diskLimit_(diskBytes) {}
+
+bool ScreenCache::Open(const std::string& directory) {
+  directory_.clear();
+  disk_.clear();
+  diskBytes_ = 0;
+
+  const fs::path root = fs::u8path(directory);
+  std::error_code ec;
+  fs::create_directories(root, ec);
+  if (!fs::is_directory(root, ec)) return false;
+  directory_ = directory;
+
+  for (const auto& file : fs::directory_iterator(root, ec)) {
+    const fs::path& path = file.path();
+    if (path.extension() != kExtension) continue;
+    const std::string stem = path.stem().string();
+    char* end = nullptr;
+    const uint64_t key = std::strtoull(stem.c_str(), &end, 16);
+    std::error_code sizeError;
+    const auto bytes = fs::file_size(path, sizeError);
+    if (stem.size() != 16 || *end != '\0' || sizeError) continue;
+    disk_.push_back(DiskEntry{key, size_t(bytes), WriteTime(path)});
+    diskBytes_ += size_t(bytes);
+  }
+  std::sort(disk_.begin(), disk_.end(), [](const DiskEntry& a, const DiskEntry& b) {
+    return a.writeTime < b.writeTime;
+  });
+  while (diskBytes_ > diskLimit_ && !disk_.empty()) {
+    fs::remove(fs::u8path(PathFor(disk_.front().key)), ec);
+    diskBytes_ -= disk_.front().bytes;
+    disk_.erase(disk_.begin());
+  }
+
+  // Newest first until memory is full; corrupt files are dropped
+  size_t loaded = 0;
+  for (auto it = disk_.rbegin(); it != disk_.rend();) {
+    if (index_.count(it->key)) {
+      ++it;
+      continue;
+    }
+    if (loaded + it->bytes > memoryLimit_) break;
+    std::vector<uint8_t> payload;
+    if (!Load(it->key, payload)) {
+      fs::remove(fs::u8path(PathFor(it->key)), ec);
+      diskBytes_ -= it->bytes;
+      it = decltype(it)(disk_.erase(std::next(it).base()));
+      continue;
+    }
+    loaded += it->bytes;
+    // Inserting at the back keeps the newest entries most recently used
+    const uint64_t key = it->key;
+    bytes_ += payload.size();
+    entries_.push_back(Entry{key, std::move(payload)});
+    index_[key] = std::prev(entries_.end());
+    ++it;
+  }
+  return true;
+}
+
+const std::vector<uint8_t>* ScreenCache::Find(uint64_t key) {
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, found->second);
+    stats_.hits++;
+    return &found->second->payload;
+  }
+
+  const bool onDisk = std::any_of(disk_.begin(), disk_.end(),
+                                  [key](const DiskEntry& e) { return e.key == key; });
+  std::vector<uint8_t> payload;
+  if (onDisk && Load(key, payload)) {
+    Insert(key, std::move(payload));
+    stats_.diskHits++;
+    found = index_.find(key);
+    if (found != index_.end()) return &found->second->payload;
+  }
+  stats_.misses++;
+  return nullptr;
+}
+
+void ScreenCache::Store(uint64_t key, const std::vector<uint8_t>& payload) {
+  Insert(key, payload);
+  Write(key, payload);
+}
+
+ScreenCache::Stats ScreenCache::stats() const {
+  Stats stats = stats_;
+  stats.entries = entries_.size();
+  stats.bytes = bytes_;
+  return stats;
+}
+
+std::string ScreenCache::PathFor(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key, kExtension);
+  return (fs::u8path(directory_) / name).u8string();
+}
+
+bool ScreenCache::Load(uint64_t key, std::vector<uint8_t>& payload) const {
+  const fs::path path = fs::u8path(PathFor(key));
+  std::ifstream in(path, std::ios::binary);
+  uint8_t header[kHeaderSize];
+  if (!in.read(reinterpret_cast<char*>(header), kHeaderSize)) return false;
+  if (std::memcmp(header, kMagic, 8) != 0 || Read64(header + 8) != key) return false;
+  // Checked against the file before trusting it with an allocation
+  std::error_code ec;
+  const uint32_t size = Get32(header + 16);
+  if (fs::file_size(path, ec) != kHeaderSize + size || ec) return false;
+  payload.resize(size);
+  if (!in.read(reinterpret_cast<char*>(payload.data()), payload.size())) return false;
+  return Adler32(payload.data(), payload.size()) == Get32(header + 20);
+}
+
+void ScreenCache::Write(uint64_t key, const std::vector<uint8_t>& payload) {
+  if (directory_.empty()) return;
+  const fs::path path = fs::u8path(PathFor(key));
+  fs::path temp = path;
+  temp += ".tmp";
+
+  uint8_t header[kHeaderSize];
+  std::memcpy(header, kMagic, 8);
+  std::memcpy(header + 8, &key, 8);
+  Put32(header + 16, uint32_t(payload.size()));
+  Put32(header + 20, Adler32(payload.data(), payload.size()));
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), kHeaderSize);
+    out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    if (!out) return;
+  }
+  // Readers only ever see whole files
+  std::error_code ec;
+  fs::rename(temp, path, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+    return;
+  }
+
+  auto existing = std::find_if(disk_.begin(), disk_.end(),
+                               [key](const DiskEntry& e) { return e.key == key; });
+  if (existing != disk_.end()) {
+    diskBytes_ -= existing->bytes;
+    disk_.erase(existing);
+  }
+  const size_t bytes = kHeaderSize + payload.size();
+  disk_.push_back(DiskEntry{key, bytes, WriteTime(path)});
+  diskBytes_ += bytes;
+  while (diskBytes_ > diskLimit_ && disk_.size() > 1) {
+    fs::remove(fs::u8path(PathFor(disk_.front().key)), ec);
+    diskBytes_ -= disk_.front().bytes;
+    disk_.erase(disk_.begin());
+  }
+}
+
+void ScreenCache::Insert(uint64_t key, std::vector<uint8_t> payload) {
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    bytes_ -= found->second->payload.size();
+    entries_.erase(found->second);
+    index_.erase(found);
+  }
+  if (payload.size() > memoryLimit_) return;
+
+  bytes_ += payload.size();
+  entries_.push_front(Entry{key, std::move(payload)});
+  index_[key] = entries_.begin();
+  while (bytes_ > memoryLimit_) {
+    bytes_ -= entries_.back().payload.size();
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 64-bit hash of |size| bytes, 32 bytes a step. For cache keys only; not
+// collision resistant against anyone trying.
+uint64_t HashScreenBytes(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+// Everything that decides an encoded screen payload
+struct ScreenCacheKey {
+  uint64_t pixels = 0;  // HashScreenBytes of the source pixels
+  uint16_t model = 0;   // USB product id
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t mode = 0;
+  uint8_t format = 0;
+  uint8_t dither = 0;
+
+  uint64_t Digest() const;
+};
+
+// Fully encoded screen payloads by ScreenCacheKey::Digest, kept in memory
+// (least recently used out first) and mirrored to a directory so they
+// survive restarts. Not thread safe; the plugin locks around it, since
+// every pad's screen worker shares one.
+class ScreenCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t diskHits = 0;
+    uint64_t misses = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  static constexpr size_t kDefaultMemoryBytes = 16 << 20;
+  static constexpr size_t kDefaultDiskBytes = 64 << 20;
+
+  explicit ScreenCache(size_t memoryBytes = kDefaultMemoryBytes,
+                       size_t diskBytes = kDefaultDiskBytes);
+
+  // Mirrors entries to |directory|, creating it, and loads the newest ones
+  // that fit in memory so the cache is warm straight away. Returns false if
+  // the directory is unusable; the cache then stays memory-only.
+  bool Open(const std::string& directory);
+
+  // Payload for |key| from memory or disk, or nullptr. Valid until the next
+  // Store.
+  const std::vector<uint8_t>* Find(uint64_t key);
+
+  void Store(uint64_t key, const std::vector<uint8_t>& payload);
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    uint64_t key;
+    std::vector<uint8_t> payload;
+  };
+  struct DiskEntry {
+    uint64_t key;
+    size_t bytes;
+    int64_t writeTime;
+  };
+
+  std::string PathFor(uint64_t key) const;
+  bool Load(uint64_t key, std::vector<uint8_t>& payload) const;
+  void Write(uint64_t key, const std::vector<uint8_t>& payload);
+  void Insert(uint64_t key, std::vector<uint8_t> payload);
+
+  size_t memoryLimit_;
+  size_t diskLimit_;
+  std::string directory_;
+
+  // Front is most recently used
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  size_t bytes_ = 0;
+
+  // Files in |directory_|, oldest first
+  std::vector<DiskEntry> disk_;
+  size_t diskBytes_ = 0;
+
+  Stats stats_;
+};
@@ -0,0 +1,48 @@
+#include "screen_frame_encoder.h"
+
+int ScreenFrameEncoder::ResolveMode(int mode, const ScreenCapabilities& caps,
+                                    const Frame& frame) {
+  if (mode != -1) return mode;
+  return (int)ChooseScreenEncoding(
+      caps, IsBlackAndWhite(frame.pixels, frame.format, (size_t)frame.width * frame.height));
+}
+
+bool ScreenFrameEncoder::Encode(const Frame& frame, int mode, std::vector<uint8_t>& out,
+                                bool& cached) {
+  ScreenCacheKey key;
+  key.pixels = HashScreenBytes(frame.pixels, frame.size);
+  key.model = frame.model;
+  key.width = (uint16_t)frame.width;
+  key.height = (uint16_t)frame.height;
+  key.mode = (uint8_t)mode;
+  key.format = (uint8_t)frame.format;
+  key.dither = (uint8_t)frame.dither;
+  const uint64_t digest = key.Digest();
+  {
+    // A hit is copied out rather than held; the next Store may drop it
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const auto* payload = cache_.Find(digest)) {
+      out = *payload;
+      cached = true;
+      return true;
+    }
+  }
+  cached = false;
+  if (!EncodeScreen(frame.pixels, frame.format, frame.width, frame.height, (ScreenEncoding)mode,
+                    frame.dither, out)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.Store(digest, out);
+  return true;
+}
+
+bool ScreenFrameEncoder::Open(const std::string& directory) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cache_.Open(directory);
+}
+
+ScreenCache::Stats ScreenFrameEncoder::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cache_.stats();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "screen_cache.h"
+#include "screen_image.h"
+
+// Whole screen frames encoded for a pad, through the ScreenCache every
+// pad's screen worker shares, so screens the dialog shows over and over
+// skip encoding. Safe from any thread; only the cache is locked, never the
+// encoding.
+class ScreenFrameEncoder {
+ public:
+  // A frame of pixels and what it is encoded for
+  struct Frame {
+    const uint8_t* pixels = nullptr;
+    size_t size = 0;
+    ScreenPixelFormat format = ScreenPixelFormat::kBgr24;
+    ScreenDither dither = ScreenDither::kOrdered;
+    // USB product id, part of the cache key
+    uint16_t model = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // |mode| as given to setSignatureScreen: an encoding, or -1 for the
+  // cheapest |caps| allow for the frame
+  static int ResolveMode(int mode, const ScreenCapabilities& caps, const Frame& frame);
+
+  // Writes |frame| encoded with |mode| to |out|, copied from the cache if
+  // it was there (|cached|), else encoded and stored. False if |mode| is
+  // no encoding.
+  bool Encode(const Frame& frame, int mode, std::vector<uint8_t>& out, bool& cached);
+
+  // See ScreenCache::Open
+  bool Open(const std::string& directory);
+
+  ScreenCache::Stats stats() const;
+
+ private:
+  mutable std::mutex mutex_;
+  ScreenCache cache_;
+};
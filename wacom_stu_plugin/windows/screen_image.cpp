@@ -0,0 +1,431 @@
+#include "screen_image.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "deflate.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WACOM_STU_SWIZZLE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic without flags; GCC and Clang need the target
+// enabled per function so the rest of the file stays baseline x86-64.
+#if defined(WACOM_STU_SWIZZLE_X86) && !defined(_MSC_VER)
+#define WACOM_STU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WACOM_STU_TARGET(isa)
+#endif
+
+namespace {
+
+// Source byte offsets of B, G and R within a pixel
+struct ChannelOrder {
+  int b, g, r;
+};
+
+ChannelOrder OrderOf(ScreenPixelFormat format) {
+  return format == ScreenPixelFormat::kRgba8888 ? ChannelOrder{2, 1, 0}
+                                                : ChannelOrder{0, 1, 2};
+}
+
+int BytesPerPixel(ScreenPixelFormat format) {
+  return format == ScreenPixelFormat::kBgr24 ? 3 : 4;
+}
+
+// 8x8 Bayer index matrix, 0..63
+constexpr uint8_t kBayer8[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+// BT.601 luma in 8.8 fixed point
+inline uint8_t Luma(const uint8_t* p, ChannelOrder o) {
+  return uint8_t((p[o.r] * 77 + p[o.g] * 150 + p[o.b] * 29 + 128) >> 8);
+}
+
+void LumaRow(const uint8_t* src, ChannelOrder order, int bpp, int width,
+             uint8_t* luma) {
+  for (int x = 0; x < width; ++x, src += bpp) luma[x] = Luma(src, order);
+}
+
+// Level |value| lands on with |levels| - 1 steps, pushed up by |bias|/255 of
+// a step. bias 127 rounds to nearest; a Bayer bias in 0..254 dithers.
+inline int Quantize(int value, int steps, int bias) {
+  return (value * steps + bias) / 255;
+}
+
+// 255 * (2i + 1) / 128, rounded: the luma a Bayer cell needs to turn white.
+// Pure black stays black and pure white stays white.
+inline uint8_t MonoThreshold(int index) {
+  return uint8_t(((2 * index + 1) * 255 + 64) / 128);
+}
+
+uint8_t ReverseBits(uint8_t b) {
+  b = uint8_t((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+  b = uint8_t((b & 0xCC) >> 2 | (b & 0x33) << 2);
+  return uint8_t((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+void SwizzleScalar(const uint8_t* src, ChannelOrder order, size_t count,
+                   uint8_t* dst) {
+  for (size_t i = 0; i < count; ++i, src += 4, dst += 3) {
+    dst[0] = src[order.b];
+    dst[1] = src[order.g];
+    dst[2] = src[order.r];
+  }
+}
+
+#ifdef WACOM_STU_SWIZZLE_X86
+
+// pshufb mask taking four 32-bit pixels to 12 packed BGR bytes; the top
+// four bytes are zeroed
+WACOM_STU_TARGET("ssse3")
+__m128i PackMask(ChannelOrder o) {
+  return _mm_setr_epi8(char(o.b), char(o.g), char(o.r), char(4 + o.b), char(4 + o.g),
+                       char(4 + o.r), char(8 + o.b), char(8 + o.g), char(8 + o.r),
+                       char(12 + o.b), char(12 + o.g), char(12 + o.r), -1, -1, -1, -1);
+}
+
+// 16 pixels in, three full 16-byte stores out
+WACOM_STU_TARGET("ssse3")
+size_t SwizzleSsse3(const uint8_t* src, ChannelOrder order, size_t count,
+                    uint8_t* dst) {
+  const __m128i mask = PackMask(order);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 64, dst += 48) {
+    const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), mask);
+    const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), mask);
+    const __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32)), mask);
+    const __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48)), mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(a, _mm_slli_si128(b, 12)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+                     _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32),
+                     _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+  }
+  return i;
+}
+
+// 32 pixels in, 96 bytes out. Each lane packs to 12 bytes, vpermd closes
+// the gap between lanes, and the four 24-byte results are stitched into
+// three full 32-byte stores.
+WACOM_STU_TARGET("avx2")
+size_t SwizzleAvx2(const uint8_t* src, ChannelOrder order, size_t count,
+                   uint8_t* dst) {
+  const __m128i mask128 = _mm_setr_epi8(
+      char(order.b), char(order.g), char(order.r), char(4 + order.b), char(4 + order.g),
+      char(4 + order.r), char(8 + order.b), char(8 + order.g), char(8 + order.r),
+      char(12 + order.b), char(12 + order.g), char(12 + order.r), -1, -1, -1, -1);
+  const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+  const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32, src += 128, dst += 96) {
+    // Each holds 24 packed bytes in its low end, zeros above
+    const __m256i a = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), mask), compact);
+    const __m256i b = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32)), mask), compact);
+    const __m256i c = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64)), mask), compact);
+    const __m256i d = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96)), mask), compact);
+
+    // out0 = a[0..23] b[0..7], out1 = b[8..23] c[0..15], out2 = c[16..23] d[0..23]
+    const __m256i b0 = _mm256_permute4x64_epi64(b, 0x00);   // b.q0 to qword 3
+    const __m256i b1 = _mm256_permute4x64_epi64(b, 0xF9);   // b.q1 b.q2 to qwords 0, 1
+    const __m256i c1 = _mm256_permute4x64_epi64(c, 0x4F);   // c.q0 c.q1 to qwords 2, 3
+    const __m256i c2 = _mm256_permute4x64_epi64(c, 0xFE);   // c.q2 to qword 0
+    const __m256i d2 = _mm256_permute4x64_epi64(d, 0x90);   // d.q0-2 to qwords 1-3
+    const __m256i out0 = _mm256_blend_epi32(a, b0, 0xC0);
+    const __m256i out1 = _mm256_blend_epi32(b1, c1, 0xF0);
+    const __m256i out2 = _mm256_blend_epi32(c2, d2, 0xFC);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), out1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 64), out2);
+  }
+  return i;
+}
+
+SwizzleKernel DetectCpu() {
+  bool ssse3 = false;
+  bool avx2 = false;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  const int maxLeaf = info[0];
+  __cpuid(info, 1);
+  ssse3 = (info[2] & (1 << 9)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  ssse3 = __builtin_cpu_supports("ssse3");
+  avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (avx2) return SwizzleKernel::kAvx2;
+  if (ssse3) return SwizzleKernel::kSsse3;
+  return SwizzleKernel::kScalar;
+}
+
+#endif  // WACOM_STU_SWIZZLE_X86
+
+// Sets the bit of every pixel in |luma| at or above its |threshold| (the
+// 16-entry row of the dither matrix), 16 pixels per step. Returns how many
+// pixels it handled; the caller finishes the tail.
+int PackMonoRow(const uint8_t* luma, const uint8_t* threshold,
+                const uint8_t* reversed, int width, uint8_t* dst) {
+  int x = 0;
+#ifdef WACOM_STU_SWIZZLE_X86
+  // Bias both sides so the signed compare orders unsigned bytes
+  const __m128i bias = _mm_set1_epi8(char(0x80));
+  const __m128i t = _mm_xor_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(threshold)), bias);
+  for (; x + 16 <= width; x += 16) {
+    const __m128i v = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(luma + x)), bias);
+    // movemask puts pixel 0 in bit 0; the tablet wants it in the MSB
+    const int black = _mm_movemask_epi8(_mm_cmplt_epi8(v, t));
+    const int white = ~black & 0xFFFF;
+    dst[x >> 3] = reversed[white & 0xFF];
+    dst[(x >> 3) + 1] = reversed[white >> 8];
+  }
+#else
+  (void)luma;
+  (void)threshold;
+  (void)reversed;
+  (void)width;
+  (void)dst;
+#endif
+  return x;
+}
+
+}  // namespace
+
+SwizzleKernel DetectSwizzleKernel() {
+#ifdef WACOM_STU_SWIZZLE_X86
+  static const SwizzleKernel kernel = DetectCpu();
+  return kernel;
+#else
+  return SwizzleKernel::kScalar;
+#endif
+}
+
+const char* SwizzleKernelName(SwizzleKernel kernel) {
+  switch (kernel) {
+    case SwizzleKernel::kAuto:
+      return SwizzleKernelName(DetectSwizzleKernel());
+    case SwizzleKernel::kScalar:
+      return "scalar";
+    case SwizzleKernel::kSsse3:
+      return "ssse3";
+    case SwizzleKernel::kAvx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+void SwizzleToBgr24(const uint8_t* src, ScreenPixelFormat format,
+                    size_t pixelCount, uint8_t* dst, SwizzleKernel kernel) {
+  const ChannelOrder order = OrderOf(format);
+  const SwizzleKernel best = DetectSwizzleKernel();
+  if (kernel == SwizzleKernel::kAuto || kernel > best) kernel = best;
+
+  size_t done = 0;
+#ifdef WACOM_STU_SWIZZLE_X86
+  if (kernel == SwizzleKernel::kAvx2) {
+    done = SwizzleAvx2(src, order, pixelCount, dst);
+  }
+  if (kernel >= SwizzleKernel::kSsse3) {
+    done += SwizzleSsse3(src + done * 4, order, pixelCount - done, dst + done * 3);
+  }
+#endif
+  SwizzleScalar(src + done * 4, order, pixelCount - done, dst + done * 3);
+}
+
+const char* ScreenEncodingName(ScreenEncoding encoding) {
+  switch (encoding) {
+    case ScreenEncoding::k1Bit:
+      return "1bit";
+    case ScreenEncoding::k1BitZlib:
+      return "1bit_zlib";
+    case ScreenEncoding::k16Bit:
+      return "16bit";
+    case ScreenEncoding::k24Bit:
+      return "24bit";
+  }
+  return "unknown";
+}
+
+ScreenEncoding ChooseScreenEncoding(const ScreenCapabilities& caps,
+                                    bool blackAndWhite) {
+  if (blackAndWhite || (!caps.color16 && !caps.color24)) {
+    return caps.zlib ? ScreenEncoding::k1BitZlib : ScreenEncoding::k1Bit;
+  }
+  return caps.color16 ? ScreenEncoding::k16Bit : ScreenEncoding::k24Bit;
+}
+
+bool IsBlackAndWhite(const uint8_t* src, ScreenPixelFormat format,
+                     size_t pixelCount) {
+  const ChannelOrder o = OrderOf(format);
+  const int bpp = BytesPerPixel(format);
+  for (size_t i = 0; i < pixelCount; ++i, src += bpp) {
+    const uint8_t v = src[o.r];
+    if ((v != 0 && v != 255) || src[o.g] != v || src[o.b] != v) return false;
+  }
+  return true;
+}
+
+void EncodeRgb565(const uint8_t* src, ScreenPixelFormat format, int width,
+                  int height, ScreenDither dither, std::vector<uint8_t>& out) {
+  const ChannelOrder o = OrderOf(format);
+  const int bpp = BytesPerPixel(format);
+  out.resize(size_t(width) * height * 2);
+  uint8_t* dst = out.data();
+
+  auto put = [&dst](int r, int g, int b) {
+    const unsigned word = unsigned(r) << 11 | unsigned(g) << 5 | unsigned(b);
+    dst[0] = uint8_t(word);
+    dst[1] = uint8_t(word >> 8);
+    dst += 2;
+  };
+
+  if (dither != ScreenDither::kDiffusion) {
+    for (int y = 0; y < height; ++y) {
+      const uint8_t* p = src + size_t(y) * width * bpp;
+      for (int x = 0; x < width; ++x, p += bpp) {
+        const int bias = dither == ScreenDither::kOrdered
+                             ? (kBayer8[y & 7][x & 7] * 255 + 32) / 64
+                             : 127;
+        put(Quantize(p[o.r], 31, bias), Quantize(p[o.g], 63, bias),
+            Quantize(p[o.b], 31, bias));
+      }
+    }
+    return;
+  }
+
+  // Per-channel error rows with a guard column either side
+  const size_t stride = size_t(width) + 2;
+  std::vector<int16_t> cur(stride * 3, 0), next(stride * 3, 0);
+  const int steps[3] = {31, 63, 31};
+  for (int y = 0; y < height; ++y) {
+    const bool forward = (y & 1) == 0;
+    const int dir = forward ? 1 : -1;
+    const uint8_t* row = src + size_t(y) * width * bpp;
+    uint8_t* rowOut = out.data() + size_t(y) * width * 2;
+    for (int i = 0; i < width; ++i) {
+      const int x = forward ? i : width - 1 - i;
+      const uint8_t* p = row + size_t(x) * bpp;
+      const int source[3] = {p[o.r], p[o.g], p[o.b]};
+      int level[3];
+      for (int c = 0; c < 3; ++c) {
+        const size_t at = c * stride + x + 1;
+        const int v = std::clamp(source[c] + cur[at], 0, 255);
+        level[c] = Quantize(v, steps[c], 127);
+        const int err = v - level[c] * 255 / steps[c];
+        cur[at + dir] += int16_t(err * 7 / 16);
+        next[at - dir] += int16_t(err * 3 / 16);
+        next[at] += int16_t(err * 5 / 16);
+        next[at + dir] += int16_t(err / 16);
+      }
+      const unsigned word = unsigned(level[0]) << 11 | unsigned(level[1]) << 5 |
+                            unsigned(level[2]);
+      rowOut[x * 2] = uint8_t(word);
+      rowOut[x * 2 + 1] = uint8_t(word >> 8);
+    }
+    cur.swap(next);
+    std::fill(next.begin(), next.end(), int16_t(0));
+  }
+}
+
+void EncodeMono(const uint8_t* src, ScreenPixelFormat format, int width,
+                int height, ScreenDither dither, std::vector<uint8_t>& out) {
+  const ChannelOrder o = OrderOf(format);
+  const int bpp = BytesPerPixel(format);
+  const size_t rowBytes = (size_t(width) + 7) / 8;
+  out.assign(rowBytes * height, 0);
+  std::vector<uint8_t> luma(width);
+
+  if (dither != ScreenDither::kDiffusion) {
+    uint8_t reversed[256];
+    for (int i = 0; i < 256; ++i) reversed[i] = ReverseBits(uint8_t(i));
+    for (int y = 0; y < height; ++y) {
+      LumaRow(src + size_t(y) * width * bpp, o, bpp, width, luma.data());
+      uint8_t threshold[16];
+      for (int i = 0; i < 16; ++i) {
+        threshold[i] = dither == ScreenDither::kOrdered
+                           ? MonoThreshold(kBayer8[y & 7][i & 7])
+                           : 128;
+      }
+      uint8_t* dst = out.data() + rowBytes * y;
+      int x = PackMonoRow(luma.data(), threshold, reversed, width, dst);
+      for (; x < width; ++x) {
+        if (luma[x] >= threshold[x & 15]) dst[x >> 3] |= uint8_t(0x80 >> (x & 7));
+      }
+    }
+    return;
+  }
+
+  std::vector<int16_t> cur(size_t(width) + 2, 0), next(size_t(width) + 2, 0);
+  for (int y = 0; y < height; ++y) {
+    LumaRow(src + size_t(y) * width * bpp, o, bpp, width, luma.data());
+    const bool forward = (y & 1) == 0;
+    const int dir = forward ? 1 : -1;
+    uint8_t* dst = out.data() + rowBytes * y;
+    for (int i = 0; i < width; ++i) {
+      const int x = forward ? i : width - 1 - i;
+      const int v = luma[x] + cur[x + 1];
+      const bool white = v >= 128;
+      if (white) dst[x >> 3] |= uint8_t(0x80 >> (x & 7));
+      const int err = v - (white ? 255 : 0);
+      cur[x + 1 + dir] += int16_t(err * 7 / 16);
+      next[x + 1 - dir] += int16_t(err * 3 / 16);
+      next[x + 1] += int16_t(err * 5 / 16);
+      next[x + 1 + dir] += int16_t(err / 16);
+    }
+    cur.swap(next);
+    std::fill(next.begin(), next.end(), int16_t(0));
+  }
+}
+
+bool EncodeScreen(const uint8_t* src, ScreenPixelFormat format, int width,
+                  int height, ScreenEncoding encoding, ScreenDither dither,
+                  std::vector<uint8_t>& out) {
+  const size_t pixels = size_t(width) * height;
+  switch (encoding) {
+    case ScreenEncoding::k24Bit:
+      if (format == ScreenPixelFormat::kBgr24) {
+        out.assign(src, src + pixels * 3);
+      } else {
+        out.resize(pixels * 3);
+        SwizzleToBgr24(src, format, pixels, out.data());
+      }
+      return true;
+    case ScreenEncoding::k16Bit:
+      EncodeRgb565(src, format, width, height, dither, out);
+      return true;
+    case ScreenEncoding::k1Bit:
+      EncodeMono(src, format, width, height, dither, out);
+      return true;
+    case ScreenEncoding::k1BitZlib: {
+      // Default effort: these screens are mostly flat and compress to a few
+      // KB at the fastest setting
+      std::vector<uint8_t> mono;
+      EncodeMono(src, format, width, height, dither, mono);
+      out.clear();
+      ZlibCompress(mono.data(), mono.size(), DeflateOptions(), out);
+      return true;
+    }
+  }
+  return false;
+}
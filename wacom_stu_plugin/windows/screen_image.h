@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pixel layouts setSignatureScreen accepts. kBgr24 is the tablet's own
+// 24-bit layout; the 32-bit layouts are what dart:ui hands out.
+enum class ScreenPixelFormat {
+  kBgr24,
+  kRgba8888,
+  kBgra8888,
+};
+
+enum class SwizzleKernel {
+  // Best kernel the CPU supports
+  kAuto,
+  kScalar,
+  kSsse3,
+  kAvx2,
+};
+
+// Best kernel this CPU supports, detected once
+SwizzleKernel DetectSwizzleKernel();
+const char* SwizzleKernelName(SwizzleKernel kernel);
+
+// Packs |pixelCount| 32-bit |format| pixels from |src| into BGR24 at |dst|
+// (3 * pixelCount bytes), the layout of the tablet's 24-bit encoding mode.
+// Alpha is dropped. A kernel the CPU lacks falls back to the best it has.
+void SwizzleToBgr24(const uint8_t* src, ScreenPixelFormat format,
+                    size_t pixelCount, uint8_t* dst,
+                    SwizzleKernel kernel = SwizzleKernel::kAuto);
+
+// Screen encodings of the STU protocol. Values match
+// WacomGSS::STU::Protocol::EncodingMode and the 'mode' argument of
+// setSignatureScreen.
+enum class ScreenEncoding {
+  k1Bit = 0x00,
+  k1BitZlib = 0x01,
+  k16Bit = 0x02,
+  k24Bit = 0x04,
+};
+
+const char* ScreenEncodingName(ScreenEncoding encoding);
+
+// What the connected model's encoding flags allow. 1-bit always works.
+struct ScreenCapabilities {
+  bool zlib = false;
+  bool color16 = false;
+  bool color24 = false;
+};
+
+// Cheapest encoding |caps| allow for an image: 1-bit (zlib-packed where
+// possible) on monochrome models and for pure black-and-white content,
+// RGB565 otherwise. 24-bit is never chosen automatically unless it is the
+// only colour mode.
+ScreenEncoding ChooseScreenEncoding(const ScreenCapabilities& caps,
+                                    bool blackAndWhite);
+
+// True when every pixel is pure black or pure white, so 1-bit is lossless
+bool IsBlackAndWhite(const uint8_t* src, ScreenPixelFormat format,
+                     size_t pixelCount);
+
+enum class ScreenDither {
+  // Nearest level
+  kNone,
+  // 8x8 Bayer matrix; the 1-bit threshold and bit packing run 16 pixels at
+  // a time with SSE2
+  kOrdered,
+  // Serpentine Floyd-Steinberg
+  kDiffusion,
+};
+
+// Little-endian RGB565 words, row-major, for the 16-bit mode
+void EncodeRgb565(const uint8_t* src, ScreenPixelFormat format, int width,
+                  int height, ScreenDither dither, std::vector<uint8_t>& out);
+
+// 1 bit per pixel of luminance, MSB first, rows padded to a whole byte,
+// 1 = white. For the 1-bit modes; zlib-compress the result for 1-bit Zlib.
+void EncodeMono(const uint8_t* src, ScreenPixelFormat format, int width,
+                int height, ScreenDither dither, std::vector<uint8_t>& out);
+
+// Encodes |width| x |height| |format| pixels for |encoding| into |out|:
+// BGR24 for 24-bit, RGB565, 1-bit, or zlib-compressed 1-bit. Returns false
+// for an encoding it does not know.
+bool EncodeScreen(const uint8_t* src, ScreenPixelFormat format, int width,
+                  int height, ScreenEncoding encoding, ScreenDither dither,
+                  std::vector<uint8_t>& out);
@@ -0,0 +1,150 @@
+#include "screen_shadow.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define WACOM_STU_SHADOW_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// True if the |size| bytes at |a| and |b| differ. Tiles are 48 or 64 bytes
+// a row, so the 16-byte loop covers them without a tail.
+bool BytesDiffer(const uint8_t* a, const uint8_t* b, size_t size) {
+  size_t i = 0;
+#ifdef WACOM_STU_SHADOW_SSE2
+  for (; i + 16 <= size; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) return true;
+  }
+#endif
+  return std::memcmp(a + i, b + i, size - i) != 0;
+}
+
+}  // namespace
+
+void ScreenShadow::Reset() {
+  pixels_.clear();
+  width_ = 0;
+  height_ = 0;
+  invalid_.clear();
+}
+
+void ScreenShadow::Invalidate(const ScreenRect& rect) {
+  if (valid() && rect.width > 0 && rect.height > 0) invalid_.push_back(rect);
+}
+
+std::vector<ScreenRect> ScreenShadow::Update(const uint8_t* frame, int width,
+                                             int height, int bytesPerPixel,
+                                             uint32_t tag) {
+  const size_t rowBytes = size_t(width) * bytesPerPixel;
+  if (!valid() || width != width_ || height != height_ ||
+      bytesPerPixel != bytesPerPixel_ || tag != tag_) {
+    pixels_.assign(frame, frame + rowBytes * height);
+    width_ = width;
+    height_ = height;
+    bytesPerPixel_ = bytesPerPixel;
+    tag_ = tag;
+    invalid_.clear();
+    return {ScreenRect{0, 0, width, height}};
+  }
+
+  const int tilesX = (width + kTileSize - 1) / kTileSize;
+  const int tilesY = (height + kTileSize - 1) / kTileSize;
+  const size_t tileBytes = size_t(kTileSize) * bytesPerPixel;
+  dirtyTiles_.assign(size_t(tilesX) * tilesY, 0);
+  for (const ScreenRect& r : invalid_) {
+    const int x0 = std::max(r.x, 0) / kTileSize;
+    const int y0 = std::max(r.y, 0) / kTileSize;
+    const int x1 = std::min((r.x + r.width - 1) / kTileSize, tilesX - 1);
+    const int y1 = std::min((r.y + r.height - 1) / kTileSize, tilesY - 1);
+    for (int ty = y0; ty <= y1; ++ty) {
+      for (int tx = x0; tx <= x1; ++tx) dirtyTiles_[size_t(ty) * tilesX + tx] = 1;
+    }
+  }
+  invalid_.clear();
+
+  // Rows are compared tile by tile; a tile found dirty is skipped for the
+  // rest of its band
+  for (int y = 0; y < height; ++y) {
+    uint8_t* dirty = &dirtyTiles_[size_t(y / kTileSize) * tilesX];
+    const uint8_t* a = frame + rowBytes * y;
+    const uint8_t* b = pixels_.data() + rowBytes * y;
+    for (int tx = 0; tx < tilesX; ++tx) {
+      if (dirty[tx]) continue;
+      const size_t offset = tileBytes * tx;
+      if (BytesDiffer(a + offset, b + offset, std::min(tileBytes, rowBytes - offset))) {
+        dirty[tx] = 1;
+      }
+    }
+  }
+
+  // Runs of dirty tiles along each band, in tile units; a run with the
+  // same span as one ending on the band above extends it downwards
+  std::vector<ScreenRect> tiles;
+  for (int ty = 0; ty < tilesY; ++ty) {
+    const uint8_t* dirty = &dirtyTiles_[size_t(ty) * tilesX];
+    for (int tx = 0; tx < tilesX;) {
+      if (!dirty[tx]) {
+        ++tx;
+        continue;
+      }
+      const int start = tx;
+      while (tx < tilesX && dirty[tx]) ++tx;
+      auto above = std::find_if(tiles.begin(), tiles.end(), [&](const ScreenRect& r) {
+        return r.x == start && r.width == tx - start && r.y + r.height == ty;
+      });
+      if (above != tiles.end()) {
+        above->height++;
+      } else {
+        tiles.push_back(ScreenRect{start, ty, tx - start, 1});
+      }
+    }
+  }
+  if (tiles.empty()) return {};
+
+  if (tiles.size() > kMaxRects) {
+    ScreenRect box = tiles.front();
+    int right = box.x + box.width;
+    int bottom = box.y + box.height;
+    for (const ScreenRect& r : tiles) {
+      box.x = std::min(box.x, r.x);
+      box.y = std::min(box.y, r.y);
+      right = std::max(right, r.x + r.width);
+      bottom = std::max(bottom, r.y + r.height);
+    }
+    box.width = right - box.x;
+    box.height = bottom - box.y;
+    tiles.assign(1, box);
+  }
+
+  std::vector<ScreenRect> rects;
+  rects.reserve(tiles.size());
+  for (const ScreenRect& t : tiles) {
+    ScreenRect r;
+    r.x = t.x * kTileSize;
+    r.y = t.y * kTileSize;
+    r.width = std::min((t.x + t.width) * kTileSize, width) - r.x;
+    r.height = std::min((t.y + t.height) * kTileSize, height) - r.y;
+    rects.push_back(r);
+
+    for (int y = r.y; y < r.y + r.height; ++y) {
+      const size_t offset = rowBytes * y + size_t(r.x) * bytesPerPixel;
+      std::memcpy(pixels_.data() + offset, frame + offset, size_t(r.width) * bytesPerPixel);
+    }
+  }
+  return rects;
+}
+
+void CopyScreenRect(const uint8_t* frame, int width, int bytesPerPixel,
+                    const ScreenRect& rect, std::vector<uint8_t>& out) {
+  const size_t rowBytes = size_t(rect.width) * bytesPerPixel;
+  out.resize(rowBytes * rect.height);
+  for (int y = 0; y < rect.height; ++y) {
+    std::memcpy(out.data() + rowBytes * y,
+                frame + (size_t(rect.y + y) * width + rect.x) * bytesPerPixel, rowBytes);
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pixel rectangle on the tablet screen
+struct ScreenRect {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+
+  bool operator==(const ScreenRect& other) const {
+    return x == other.x && y == other.y && width == other.width &&
+           height == other.height;
+  }
+};
+
+// Copy of the last frame written to the tablet screen, so the next one can
+// go out as the rectangles that changed. Frames are compared in source
+// pixels, tile by tile; rectangles start on tile boundaries, so an ordered
+// dither lines up with what a full-frame encode would produce. Used under
+// the pad's screen lock.
+class ScreenShadow {
+ public:
+  static constexpr int kTileSize = 16;
+
+  // Past this many rectangles they collapse to their bounding box, since
+  // every area write costs a round trip of its own
+  static constexpr size_t kMaxRects = 8;
+
+  // Forget the frame, so the next Update reports all of it. For anything
+  // that changes the screen behind the shadow's back.
+  void Reset();
+
+  // Forget |rect| only, so the next Update reports the tiles under it as
+  // dirty whatever they hold. For the pad drawing ink there itself.
+  void Invalidate(const ScreenRect& rect);
+
+  bool valid() const { return !pixels_.empty(); }
+
+  // The last frame as passed to Update, so a pad that lost its screen can
+  // be given it back
+  const std::vector<uint8_t>& pixels() const { return pixels_; }
+  int bytesPerPixel() const { return bytesPerPixel_; }
+  uint32_t tag() const { return tag_; }
+
+  // Diffs |frame| (|width| x |height| pixels of |bytesPerPixel| bytes,
+  // tightly packed) against the shadow and makes it the new shadow.
+  // Returns the merged dirty rectangles: none when nothing changed, the
+  // whole frame when there was no comparable shadow. Frames with different
+  // |tag|s (encoding mode, pixel format) are never compared.
+  std::vector<ScreenRect> Update(const uint8_t* frame, int width, int height,
+                                 int bytesPerPixel, uint32_t tag);
+
+ private:
+  std::vector<uint8_t> pixels_;
+  int width_ = 0;
+  int height_ = 0;
+  int bytesPerPixel_ = 0;
+  uint32_t tag_ = 0;
+  std::vector<uint8_t> dirtyTiles_;
+  std::vector<ScreenRect> invalid_;
+};
+
+// Copies |rect| out of a tightly packed |frame| |width| pixels wide into
+// |out|, tightly packed.
+void CopyScreenRect(const uint8_t* frame, int width, int bytesPerPixel,
+                    const ScreenRect& rect, std::vector<uint8_t>& out);
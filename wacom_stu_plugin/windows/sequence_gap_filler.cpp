@@ -0,0 +1,89 @@
+#include "sequence_gap_filler.h"
+
+#include <cmath>
+
+namespace {
+
+// The pen's state a fill must not cross
+constexpr uint8_t kStateFlags = kPenSampleHasSequence | kPenSampleProximity;
+
+uint16_t Lerp(uint16_t a, uint16_t b, double t) {
+  return uint16_t(std::lround(a + (double(b) - a) * t));
+}
+
+int64_t Lerp(int64_t a, int64_t b, double t) {
+  return a + int64_t(std::llround(double(b - a) * t));
+}
+
+}  // namespace
+
+void SequenceGapFiller::Reset() {
+  hasLast_ = false;
+}
+
+size_t SequenceGapFiller::Process(const PenSample& sample, PenSample* out) {
+  if (!(sample.flags & kPenSampleHasSequence)) {
+    out[0] = sample;
+    return 1;
+  }
+
+  size_t n = 0;
+  if (hasLast_) {
+    // Wraps at 16 bits; a step back or none at all is the pad starting
+    // over, not a gap
+    const uint16_t step = uint16_t(sample.sequence - last_.sequence);
+    if (step > 1 && step < 0x8000) {
+      const size_t missing = step - 1u;
+      gaps_.fetch_add(1, std::memory_order_relaxed);
+      missing_.fetch_add(missing, std::memory_order_relaxed);
+      if (missing > largestGap_.load(std::memory_order_relaxed)) {
+        largestGap_.store(missing, std::memory_order_relaxed);
+      }
+
+      if (CanFill(sample, missing)) {
+        const uint16_t elapsed = uint16_t(sample.timeCount - last_.timeCount);
+        for (size_t i = 1; i <= missing; ++i) {
+          const double t = double(i) / step;
+          PenSample& filled = out[n++];
+          filled = sample;
+          filled.x = Lerp(last_.x, sample.x, t);
+          filled.y = Lerp(last_.y, sample.y, t);
+          filled.pressure = Lerp(last_.pressure, sample.pressure, t);
+          filled.timeCount = uint16_t(last_.timeCount + std::lround(elapsed * t));
+          filled.sequence = uint16_t(last_.sequence + i);
+          filled.timestampUs = Lerp(last_.timestampUs, sample.timestampUs, t);
+          filled.deviceTimeUs = Lerp(last_.deviceTimeUs, sample.deviceTimeUs, t);
+          filled.flags |= kPenSampleSynthetic;
+        }
+        filled_.fetch_add(missing, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  last_ = sample;
+  hasLast_ = true;
+  out[n++] = sample;
+  return n;
+}
+
+bool SequenceGapFiller::CanFill(const PenSample& sample, size_t missing) const {
+  if (missing > kMaxFill) return false;
+  if ((sample.flags & kStateFlags) != (last_.flags & kStateFlags)) return false;
+  if (sample.sw != last_.sw) return false;
+  // Touching on one side and not the other is a stroke edge, which a
+  // fill would move
+  if ((sample.pressure == 0) != (last_.pressure == 0)) return false;
+  // The pad's clock ticks at least once per report; much more than the
+  // fill window is the pen idle or the counter reset
+  const uint16_t elapsed = uint16_t(sample.timeCount - last_.timeCount);
+  return elapsed > missing && elapsed <= kMaxFillMs;
+}
+
+SequenceGapFiller::Stats SequenceGapFiller::stats() const {
+  Stats s;
+  s.gaps = gaps_.load(std::memory_order_relaxed);
+  s.missing = missing_.load(std::memory_order_relaxed);
+  s.filled = filled_.load(std::memory_order_relaxed);
+  s.largestGap = largestGap_.load(std::memory_order_relaxed);
+  return s;
+}
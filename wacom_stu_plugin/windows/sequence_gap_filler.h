@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "pen_sample.h"
+
+// Finds reports the pad sent but the host never read, from the sequence
+// number of PenDataTimeCountSequence, and fills short gaps in the pen's
+// path so ink does not jump across them. Runs on the report thread ahead
+// of StrokeTracker.
+//
+// Each missing report is placed on the pad's own clock: the timeCount gap
+// is split evenly over the missing reports, and x, y, pressure and both
+// host times are interpolated to those times. Filled samples carry
+// kPenSampleSynthetic. A gap is only counted, not filled, when it is long,
+// when the pen changed state across it (proximity, a button, touching the
+// pad or not) or when the device clock makes no sense for it.
+class SequenceGapFiller {
+ public:
+  // Most reports one gap is filled with; 40 ms at 200 reports/s
+  static constexpr size_t kMaxFill = 8;
+  // And the longest device time one fill may span
+  static constexpr uint16_t kMaxFillMs = 50;
+  // Most samples a single Process() call can write
+  static constexpr size_t kMaxOutput = kMaxFill + 1;
+
+  struct Stats {
+    uint64_t gaps = 0;
+    // Reports the sequence numbers say were lost, over all gaps
+    uint64_t missing = 0;
+    // Synthetic samples written
+    uint64_t filled = 0;
+    // Most reports lost in one gap
+    uint64_t largestGap = 0;
+  };
+
+  // Report thread. Writes the interpolated samples, then |sample|, to |out|
+  // (room for kMaxOutput) and returns how many were written. Samples
+  // without a sequence number pass through alone.
+  size_t Process(const PenSample& sample, PenSample* out);
+
+  // Forgets the last sample, e.g. when a new session starts and the
+  // pad's sequence starts over
+  void Reset();
+
+  // Safe from any thread
+  Stats stats() const;
+
+ private:
+  bool CanFill(const PenSample& sample, size_t missing) const;
+
+  PenSample last_;
+  bool hasLast_ = false;
+
+  std::atomic<uint64_t> gaps_{0};
+  std::atomic<uint64_t> missing_{0};
+  std::atomic<uint64_t> filled_{0};
+  std::atomic<uint64_t> largestGap_{0};
+};
@@ -0,0 +1,133 @@
+#include "session_key_exchange.h"
+
+#include <random>
+
+namespace {
+
+// A 128-bit number as two halves; the exchange only needs add, compare
+// and shift, so it builds the same on compilers without a 128-bit type
+struct U128 {
+  uint64_t hi = 0;
+  uint64_t lo = 0;
+};
+
+U128 FromKey(const SessionKeyExchange::Key& key) {
+  U128 value;
+  for (int i = 0; i < 8; ++i) value.hi = value.hi << 8 | key[i];
+  for (int i = 8; i < 16; ++i) value.lo = value.lo << 8 | key[i];
+  return value;
+}
+
+SessionKeyExchange::Key ToKey(U128 value) {
+  SessionKeyExchange::Key key;
+  for (int i = 7; i >= 0; --i, value.hi >>= 8) key[i] = uint8_t(value.hi);
+  for (int i = 15; i >= 8; --i, value.lo >>= 8) key[i] = uint8_t(value.lo);
+  return key;
+}
+
+bool Less(const U128& a, const U128& b) { return a.hi != b.hi ? a.hi < b.hi : a.lo < b.lo; }
+
+bool Bit(const U128& value, int bit) {
+  return ((bit >= 64 ? value.hi >> (bit - 64) : value.lo >> bit) & 1) != 0;
+}
+
+// (a + b) mod m for a, b < m. The sum may carry out of 128 bits, in which
+// case it is certainly past m and wraps back below it.
+U128 AddMod(const U128& a, const U128& b, const U128& m) {
+  U128 sum;
+  sum.lo = a.lo + b.lo;
+  const uint64_t carryLo = sum.lo < a.lo;
+  sum.hi = a.hi + b.hi + carryLo;
+  const bool carry = sum.hi < a.hi || (sum.hi == a.hi && carryLo);
+  if (carry || !Less(sum, m)) {
+    const uint64_t borrow = sum.lo < m.lo;
+    sum.lo -= m.lo;
+    sum.hi -= m.hi + borrow;
+  }
+  return sum;
+}
+
+// a * b mod m by doubling and adding, a bit of b at a time
+U128 MulMod(const U128& a, const U128& b, const U128& m) {
+  U128 product;
+  for (int bit = 127; bit >= 0; --bit) {
+    product = AddMod(product, product, m);
+    if (Bit(b, bit)) product = AddMod(product, a, m);
+  }
+  return product;
+}
+
+// value mod m, for any value
+U128 Reduce(const U128& value, const U128& m) {
+  const U128 one{0, 1};
+  U128 rest;
+  for (int bit = 127; bit >= 0; --bit) {
+    rest = AddMod(rest, rest, m);
+    if (Bit(value, bit)) rest = AddMod(rest, one, m);
+  }
+  return rest;
+}
+
+}  // namespace
+
+const SessionKeyExchange::Key SessionKeyExchange::kDefaultPrime = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xC3, 0xA7};
+
+SessionKeyExchange::SessionKeyExchange() : prime_(kDefaultPrime), base_(kDefaultBase) {}
+
+bool SessionKeyExchange::SetParameters(const Key& prime, uint16_t base) {
+  const U128 p = FromKey(prime);
+  if (!(p.lo & 1) || p.hi == 0 || base < 2) return false;
+  if (!Less(U128{0, uint64_t(base) + 1}, p)) return false;
+  prime_ = prime;
+  base_ = base;
+  Clear();
+  return true;
+}
+
+SessionKeyExchange::Key SessionKeyExchange::GeneratePublicKey() {
+  const U128 p = FromKey(prime_);
+  std::random_device random;
+  U128 exponent;
+  do {
+    U128 draw;
+    draw.hi = uint64_t(random()) << 32 | random();
+    draw.lo = uint64_t(random()) << 32 | random();
+    exponent = Reduce(draw, p);
+  } while (exponent.hi == 0 && exponent.lo < 2);
+  private_ = ToKey(exponent);
+
+  Key base{};
+  base[14] = uint8_t(base_ >> 8);
+  base[15] = uint8_t(base_);
+  return PowMod(base, private_, prime_);
+}
+
+bool SessionKeyExchange::ComputeSessionKey(const Key& devicePublicKey, Key& sessionKey) const {
+  const U128 p = FromKey(prime_);
+  const U128 key = FromKey(devicePublicKey);
+  // 0, 1 and p - 1 are their own powers
+  U128 last = p;
+  last.lo -= 1;
+  if (!Less(U128{0, 1}, key) || !Less(key, last)) return false;
+  sessionKey = PowMod(devicePublicKey, private_, prime_);
+  return true;
+}
+
+void SessionKeyExchange::Clear() {
+  private_.fill(0);
+}
+
+SessionKeyExchange::Key SessionKeyExchange::PowMod(const Key& base, const Key& exponent,
+                                                   const Key& modulus) {
+  const U128 m = FromKey(modulus);
+  const U128 b = Reduce(FromKey(base), m);
+  const U128 e = FromKey(exponent);
+  U128 result = Reduce(U128{0, 1}, m);
+  for (int bit = 127; bit >= 0; --bit) {
+    result = MulMod(result, result, m);
+    if (Bit(e, bit)) result = MulMod(result, b, m);
+  }
+  return ToKey(result);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// The host's half of the key exchange that starts an encrypted capture,
+// the same Diffie-Hellman the SDK's EncryptionHandler runs: both sides
+// raise the 16-bit base to a private exponent modulo a 128-bit prime, swap
+// the results as public keys, and the shared value is the AES-128 key the
+// pad encrypts pen data with.
+//
+// Pads either come with the prime and base or take them from the host;
+// kDefaultPrime and kDefaultBase are what the host hands out. Numbers go
+// over the wire as 16 big-endian bytes.
+class SessionKeyExchange {
+ public:
+  using Key = std::array<uint8_t, 16>;
+
+  // 2^128 - 15449, a safe prime; 2 generates its subgroup of prime order
+  static const Key kDefaultPrime;
+  static constexpr uint16_t kDefaultBase = 2;
+
+  SessionKeyExchange();
+
+  // False for parameters that cannot make a key: an even or tiny modulus,
+  // or a base outside 2..prime-2
+  bool SetParameters(const Key& prime, uint16_t base);
+  const Key& prime() const { return prime_; }
+  uint16_t base() const { return base_; }
+
+  // Picks a fresh private exponent and returns base^private mod prime
+  Key GeneratePublicKey();
+
+  // devicePublicKey^private mod prime, the session key. Call after
+  // GeneratePublicKey. False if the device's key is out of range, which
+  // would force a guessable session key.
+  bool ComputeSessionKey(const Key& devicePublicKey, Key& sessionKey) const;
+
+  // Wipes the private exponent
+  void Clear();
+
+  // Modular exponentiation on the 128-bit numbers above, exposed for the
+  // pad emulation in tests
+  static Key PowMod(const Key& base, const Key& exponent, const Key& modulus);
+
+ private:
+  Key prime_;
+  uint16_t base_;
+  Key private_{};
+};
@@ -0,0 +1,126 @@
+#include "signature_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WACOM_STU_RASTER_SSE2 1
+#endif
+
+namespace {
+
+struct Capsule {
+  float ax, ay, bx, by;
+  float ra, rb;
+};
+
+// Coverage of the pixel centred at (px, py); max-combined into |dst| so
+// overlapping segments of one stroke do not darken the joints.
+inline void ShadeScalar(const Capsule& c, float px, float py, float* dst) {
+  const float vx = c.bx - c.ax, vy = c.by - c.ay;
+  const float len2 = vx * vx + vy * vy;
+  const float wx = px - c.ax, wy = py - c.ay;
+  float t = len2 > 0 ? (wx * vx + wy * vy) / len2 : 0.0f;
+  t = std::min(std::max(t, 0.0f), 1.0f);
+  const float dx = wx - t * vx, dy = wy - t * vy;
+  const float d = std::sqrt(dx * dx + dy * dy);
+  const float r = c.ra + (c.rb - c.ra) * t;
+  const float coverage = std::min(std::max(r + 0.5f - d, 0.0f), 1.0f);
+  *dst = std::max(*dst, coverage);
+}
+
+void ShadeSpan(const Capsule& c, int y, int x0, int x1, float* row) {
+  const float py = y + 0.5f;
+  int x = x0;
+#ifdef WACOM_STU_RASTER_SSE2
+  const __m128 ax = _mm_set1_ps(c.ax), ay = _mm_set1_ps(c.ay);
+  const __m128 vx = _mm_set1_ps(c.bx - c.ax), vy = _mm_set1_ps(c.by - c.ay);
+  const float len2s = (c.bx - c.ax) * (c.bx - c.ax) + (c.by - c.ay) * (c.by - c.ay);
+  const __m128 invLen2 = _mm_set1_ps(len2s > 0 ? 1.0f / len2s : 0.0f);
+  const __m128 ra = _mm_set1_ps(c.ra), dr = _mm_set1_ps(c.rb - c.ra);
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+  const __m128 wy = _mm_sub_ps(_mm_set1_ps(py), ay);
+  const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+  for (; x + 4 <= x1; x += 4) {
+    const __m128 wx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(float(x)), lane), ax);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(wx, vx), _mm_mul_ps(wy, vy)), invLen2);
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+    const __m128 dx = _mm_sub_ps(wx, _mm_mul_ps(t, vx));
+    const __m128 dy = _mm_sub_ps(wy, _mm_mul_ps(t, vy));
+    const __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    const __m128 r = _mm_add_ps(ra, _mm_mul_ps(dr, t));
+    __m128 coverage = _mm_sub_ps(_mm_add_ps(r, half), d);
+    coverage = _mm_min_ps(_mm_max_ps(coverage, zero), one);
+    _mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), coverage));
+  }
+#endif
+  for (; x < x1; ++x) {
+    ShadeScalar(c, x + 0.5f, py, row + x);
+  }
+}
+
+void ShadeCapsule(const Capsule& c, int width, int height, float* coverage) {
+  const float r = std::max(c.ra, c.rb) + 1.0f;
+  const int x0 = std::max(0, int(std::floor(std::min(c.ax, c.bx) - r)));
+  const int x1 = std::min(width, int(std::ceil(std::max(c.ax, c.bx) + r)));
+  const int y0 = std::max(0, int(std::floor(std::min(c.ay, c.by) - r)));
+  const int y1 = std::min(height, int(std::ceil(std::max(c.ay, c.by) + r)));
+  for (int y = y0; y < y1; ++y) {
+    ShadeSpan(c, y, x0, x1, coverage + size_t(y) * width);
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t> RasterizeStrokes(
+    const std::vector<const std::vector<InkPoint>*>& strokes,
+    const RasterOptions& options) {
+  const int width = options.width;
+  const int height = options.height;
+  std::vector<uint8_t> rgba(size_t(width) * height * 4, 0);
+  if (width <= 0 || height <= 0) return rgba;
+
+  std::vector<float> coverage(size_t(width) * height, 0.0f);
+  const float pressureScale =
+      options.maxPressure ? 1.0f / options.maxPressure : 0.0f;
+  auto radius = [&](uint16_t pressure) {
+    const float p = std::min(1.0f, pressure * pressureScale);
+    return options.minRadius + (options.maxRadius - options.minRadius) * p;
+  };
+
+  for (const auto* stroke : strokes) {
+    if (!stroke || stroke->empty()) continue;
+    const InkPoint* points = stroke->data();
+    const size_t count = stroke->size();
+
+    for (size_t i = 0; i < count; ++i) {
+      const InkPoint& a = points[i == 0 ? 0 : i - 1];
+      const InkPoint& b = points[i];
+      Capsule c;
+      c.ax = float(a.x * options.scaleX);
+      c.ay = float(a.y * options.scaleY);
+      c.bx = float(b.x * options.scaleX);
+      c.by = float(b.y * options.scaleY);
+      c.ra = radius(a.pressure);
+      c.rb = radius(b.pressure);
+      // The first "segment" is a dot, so single-point strokes still show
+      ShadeCapsule(c, width, height, coverage.data());
+    }
+  }
+
+  const uint8_t r = uint8_t(options.color >> 16);
+  const uint8_t g = uint8_t(options.color >> 8);
+  const uint8_t b = uint8_t(options.color);
+  const float alpha = float(options.color >> 24);
+  for (size_t i = 0; i < coverage.size(); ++i) {
+    if (coverage[i] <= 0.0f) continue;
+    uint8_t* px = rgba.data() + i * 4;
+    px[0] = r;
+    px[1] = g;
+    px[2] = b;
+    px[3] = uint8_t(coverage[i] * alpha + 0.5f);
+  }
+  return rgba;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ink_store.h"
+
+struct RasterOptions {
+  // Output size in pixels
+  int width = 0;
+  int height = 0;
+  // Tablet units to output pixels
+  double scaleX = 1.0;
+  double scaleY = 1.0;
+  // Stroke radius in pixels at zero and at full pressure
+  float minRadius = 0.5f;
+  float maxRadius = 1.5f;
+  uint16_t maxPressure = 1023;
+  // Straight ARGB ink colour
+  uint32_t color = 0xFF000000;
+};
+
+// Renders strokes as anti-aliased, pressure-width ink on a transparent
+// background. Each segment is a tapered capsule whose coverage is evaluated
+// per pixel from the exact distance to the segment, four pixels at a time
+// where SSE2 is available. Returns straight RGBA8, width * 4 bytes per row.
+std::vector<uint8_t> RasterizeStrokes(
+    const std::vector<const std::vector<InkPoint>*>& strokes,
+    const RasterOptions& options);
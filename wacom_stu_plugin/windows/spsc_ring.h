@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Size used to keep the producer and consumer indices on separate cache lines
+// so the report thread and the platform thread never false-share.
+constexpr size_t kCacheLineSize = 64;
+
+// Bounded, lock-free single-producer/single-consumer ring.
+//
+// The producer (the report thread) never blocks: when the ring is full the
+// item is dropped and counted as an overflow. The consumer (the platform
+// thread) drains everything that is available in one pass.
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscRing slots are copied without constructors");
+
+ public:
+  struct Stats {
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;
+    uint64_t highWater = 0;
+  };
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  // Producer side. Returns false when the ring is full.
+  bool TryPush(const T& item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - cachedTail_ >= Capacity) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head - cachedTail_ >= Capacity) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+        return false;
+      }
+    }
+
+    slots_[head & kMask] = item;
+    head_.store(head + 1, std::memory_order_release);
+
+    pushed_.store(pushed_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    // Depth against the cached tail is an upper bound, which is what we want
+    // for a high-water mark.
+    const uint64_t depth = head + 1 - cachedTail_;
+    if (depth > highWater_.load(std::memory_order_relaxed)) {
+      highWater_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side. Pops a single item, returns false when empty.
+  bool TryPop(T& out) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cachedHead_) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail == cachedHead_) return false;
+    }
+    out = slots_[tail & kMask];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Hands every item available at the time of the call to
+  // |fn| and releases the slots once at the end. Returns the item count.
+  template <typename Fn>
+  size_t Drain(Fn&& fn) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    cachedHead_ = head_.load(std::memory_order_acquire);
+    const size_t count = cachedHead_ - tail;
+    for (size_t i = 0; i < count; ++i) {
+      fn(slots_[(tail + i) & kMask]);
+    }
+    if (count) tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Safe from any thread; values are monotonic but not a single snapshot.
+  Stats stats() const {
+    Stats s;
+    s.pushed = pushed_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.highWater = highWater_.load(std::memory_order_relaxed);
+    return s;
+  }
+
+ private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  // Producer-owned line.
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t cachedTail_ = 0;
+  std::atomic<uint64_t> pushed_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> highWater_{0};
+
+  // Consumer-owned line.
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t cachedHead_ = 0;
+
+  alignas(kCacheLineSize) T slots_[Capacity];
+};
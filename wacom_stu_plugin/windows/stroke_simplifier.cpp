@@ -0,0 +1,197 @@
+#include "stroke_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+double Distance(const PenSample& a, const PenSample& b) {
+  const double dx = double(b.x) - a.x;
+  const double dy = double(b.y) - a.y;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+// Distance from |p| to the segment a-b
+double SegmentDistance(const PenSample& p, const PenSample& a,
+                       const PenSample& b) {
+  const double vx = double(b.x) - a.x;
+  const double vy = double(b.y) - a.y;
+  const double wx = double(p.x) - a.x;
+  const double wy = double(p.y) - a.y;
+  const double len2 = vx * vx + vy * vy;
+  double t = len2 > 0 ? (wx * vx + wy * vy) / len2 : 0.0;
+  t = std::clamp(t, 0.0, 1.0);
+  const double dx = wx - t * vx;
+  const double dy = wy - t * vy;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+// Turning angle at b, in degrees, for the path a -> b -> c
+double TurnAngleDeg(const PenSample& a, const PenSample& b,
+                    const PenSample& c) {
+  const double ux = double(b.x) - a.x, uy = double(b.y) - a.y;
+  const double vx = double(c.x) - b.x, vy = double(c.y) - b.y;
+  const double lu = std::sqrt(ux * ux + uy * uy);
+  const double lv = std::sqrt(vx * vx + vy * vy);
+  if (lu == 0 || lv == 0) return 0.0;
+  const double cosine = std::clamp((ux * vx + uy * vy) / (lu * lv), -1.0, 1.0);
+  return std::acos(cosine) * 180.0 / kPi;
+}
+
+}  // namespace
+
+void StrokeSimplifier::Reset() {
+  active_ = false;
+  count_ = 0;
+  hasDropped_ = false;
+}
+
+size_t StrokeSimplifier::Process(const PenSample& sample, PenSample* out) {
+  if (!(sample.flags & kPenSampleInk)) {
+    size_t n = 0;
+    if ((sample.flags & kPenSampleStrokeEnd) && active_) {
+      n = Reduce(out, true);
+      // Keep the true end of the stroke even if the radial filter ate it
+      if (hasDropped_) {
+        out[n++] = lastDropped_;
+        CountOut(1);
+      }
+      active_ = false;
+    }
+    out[n++] = sample;
+    return n;
+  }
+
+  pointsIn_.fetch_add(1, std::memory_order_relaxed);
+
+  if (sample.flags & kPenSampleStrokeBegin) {
+    configSlot_.TryTake(config_);
+    active_ = config_.enabled;
+    count_ = 0;
+    hasDropped_ = false;
+    anchor_ = sample;
+    lastAccepted_ = sample;
+    out[0] = sample;
+    CountOut(1);
+    return 1;
+  }
+
+  if (!active_) {
+    out[0] = sample;
+    CountOut(1);
+    return 1;
+  }
+
+  const double moved = Distance(lastAccepted_, sample);
+  if (moved < config_.minDistance) {
+    RecordError(moved);
+    lastDropped_ = sample;
+    hasDropped_ = true;
+    return 0;
+  }
+
+  hasDropped_ = false;
+  lastAccepted_ = sample;
+  window_[count_++] = sample;
+  const size_t lookahead =
+      std::clamp<size_t>(config_.lookahead, 2, kMaxLookahead);
+  return count_ >= lookahead ? Reduce(out, false) : 0;
+}
+
+size_t StrokeSimplifier::Reduce(PenSample* out, bool final) {
+  if (count_ == 0) return 0;
+
+  // points[0] is the last emitted sample, points[1..m] the window
+  PenSample points[kMaxLookahead + 1];
+  bool keep[kMaxLookahead + 1] = {};
+  const size_t m = count_;
+  points[0] = anchor_;
+  std::copy(window_, window_ + count_, points + 1);
+  keep[0] = keep[m] = true;
+
+  // Iterative Douglas-Peucker
+  struct Range {
+    size_t first, last;
+  };
+  Range stack[kMaxLookahead + 1];
+  size_t depth = 0;
+  stack[depth++] = {0, m};
+  while (depth) {
+    const Range r = stack[--depth];
+    double worst = 0.0;
+    size_t index = 0;
+    for (size_t i = r.first + 1; i < r.last; ++i) {
+      const double d = SegmentDistance(points[i], points[r.first], points[r.last]);
+      if (d > worst) {
+        worst = d;
+        index = i;
+      }
+    }
+    if (index && worst > config_.tolerance) {
+      keep[index] = true;
+      stack[depth++] = {r.first, index};
+      stack[depth++] = {index, r.last};
+    }
+  }
+
+  if (config_.cornerAngleDeg > 0) {
+    for (size_t i = 1; i < m; ++i) {
+      if (TurnAngleDeg(points[i - 1], points[i], points[i + 1]) >
+          config_.cornerAngleDeg) {
+        keep[i] = true;
+      }
+    }
+  }
+
+  // Only points up to the last interior keep are final; the window end is
+  // kept merely because the window ends there. With no interior keep the
+  // window end is emitted anyway so the lag stays bounded.
+  size_t emitUpTo = m;
+  if (!final) {
+    size_t lastInterior = 0;
+    for (size_t i = m - 1; i > 0; --i) {
+      if (keep[i]) {
+        lastInterior = i;
+        break;
+      }
+    }
+    if (lastInterior) emitUpTo = lastInterior;
+  }
+
+  size_t n = 0;
+  size_t prev = 0;
+  for (size_t i = 1; i <= emitUpTo; ++i) {
+    if (!keep[i] && i != emitUpTo) continue;
+    for (size_t j = prev + 1; j < i; ++j) {
+      RecordError(SegmentDistance(points[j], points[prev], points[i]));
+    }
+    out[n++] = points[i];
+    prev = i;
+  }
+  CountOut(n);
+
+  anchor_ = points[emitUpTo];
+  count_ = m - emitUpTo;
+  std::copy(points + emitUpTo + 1, points + m + 1, window_);
+  return n;
+}
+
+void StrokeSimplifier::CountOut(size_t n) {
+  pointsOut_.fetch_add(n, std::memory_order_relaxed);
+}
+
+void StrokeSimplifier::RecordError(double error) {
+  if (error > maxError_.load(std::memory_order_relaxed)) {
+    maxError_.store(error, std::memory_order_relaxed);
+  }
+}
+
+StrokeSimplifier::Stats StrokeSimplifier::stats() const {
+  Stats s;
+  s.pointsIn = pointsIn_.load(std::memory_order_relaxed);
+  s.pointsOut = pointsOut_.load(std::memory_order_relaxed);
+  s.maxError = maxError_.load(std::memory_order_relaxed);
+  return s;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "config_slot.h"
+#include "pen_sample.h"
+
+// Streaming point decimation for ink samples, run on the report thread
+// after StrokeTracker.
+//
+// Two stages:
+//   1. A radial filter drops samples closer than minDistance to the last
+//      accepted one (jitter while the pen rests or moves slowly).
+//   2. Douglas-Peucker over a window of at most |lookahead| samples keeps
+//      points that deviate more than |tolerance| from the simplified line,
+//      plus any corner sharper than cornerAngleDeg.
+// Stroke begin and end points always pass, as do all non-ink samples, so
+// stroke segmentation is unchanged. A dropped point deviates from the
+// emitted polyline by at most minDistance + tolerance; stats() reports the
+// largest deviation actually measured.
+class StrokeSimplifier {
+ public:
+  struct Config {
+    bool enabled = false;
+    // All distances are in tablet units
+    float minDistance = 0.0f;
+    float tolerance = 0.0f;
+    // Turning angle above which a point is always kept; 0 disables
+    float cornerAngleDeg = 0.0f;
+    // Window size in samples, which is also the most ink can lag behind
+    uint32_t lookahead = 8;
+  };
+
+  static constexpr size_t kMaxLookahead = 64;
+  // Most samples a single Process() call can write
+  static constexpr size_t kMaxOutput = kMaxLookahead + 3;
+
+  struct Stats {
+    uint64_t pointsIn = 0;
+    uint64_t pointsOut = 0;
+    double maxError = 0.0;
+  };
+
+  // Platform thread. Takes effect at the start of the next stroke.
+  void SetConfig(const Config& config) { configSlot_.Publish(config); }
+
+  // Report thread. Writes the samples to pass on, in order, to |out|
+  // (room for kMaxOutput) and returns how many were written.
+  size_t Process(const PenSample& sample, PenSample* out);
+
+  // Drops any buffered ink without emitting it.
+  void Reset();
+
+  Stats stats() const;
+
+ private:
+  size_t Reduce(PenSample* out, bool final);
+  void CountOut(size_t n);
+  void RecordError(double error);
+
+  ConfigSlot<Config> configSlot_;
+  Config config_;
+  bool active_ = false;
+
+  PenSample anchor_;
+  PenSample lastAccepted_;
+  PenSample lastDropped_;
+  bool hasDropped_ = false;
+  PenSample window_[kMaxLookahead];
+  size_t count_ = 0;
+
+  std::atomic<uint64_t> pointsIn_{0};
+  std::atomic<uint64_t> pointsOut_{0};
+  std::atomic<double> maxError_{0.0};
+};
@@ -0,0 +1,52 @@
+#include "stroke_tracker.h"
+
+#include <algorithm>
+
+StrokeTracker::Thresholds StrokeTracker::ThresholdsForMaxPressure(
+    uint16_t maxPressure) {
+  Thresholds t;
+  // ~1.5% of full scale to start a stroke, half of that to end it
+  t.pressureOn = static_cast<uint16_t>(std::max(2, maxPressure * 3 / 200));
+  t.pressureOff = static_cast<uint16_t>(std::max(1, t.pressureOn / 2));
+  return t;
+}
+
+void StrokeTracker::Reset() {
+  inking_ = false;
+  inProximity_ = false;
+  missingRdy_ = 0;
+  strokeId_ = 0;
+}
+
+void StrokeTracker::Process(PenSample& sample) {
+  sample.flags &= ~(kPenSampleInk | kPenSampleStrokeBegin | kPenSampleStrokeEnd);
+  sample.strokeId = 0;
+
+  if (sample.flags & kPenSampleProximity) {
+    inProximity_ = true;
+    missingRdy_ = 0;
+  } else if (inProximity_ && ++missingRdy_ >= thresholds_.proximityOutSamples) {
+    inProximity_ = false;
+  }
+
+  if (inking_) {
+    const bool lifted =
+        sample.pressure < thresholds_.pressureOff || !inProximity_;
+    if (lifted) {
+      inking_ = false;
+      sample.flags |= kPenSampleStrokeEnd;
+      sample.strokeId = strokeId_;
+      return;
+    }
+    sample.flags |= kPenSampleInk;
+    sample.strokeId = strokeId_;
+    return;
+  }
+
+  if (inProximity_ && sample.pressure >= thresholds_.pressureOn) {
+    inking_ = true;
+    strokeId_ = nextStrokeId_++;
+    sample.flags |= kPenSampleInk | kPenSampleStrokeBegin;
+    sample.strokeId = strokeId_;
+  }
+}
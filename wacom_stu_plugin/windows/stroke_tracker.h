@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "pen_sample.h"
+
+// Pen state machine that splits the raw sample stream into strokes.
+//
+// Pressure uses hysteresis so a stroke does not flicker on and off around a
+// single threshold, and the pen only counts as out of range after a few
+// consecutive samples without the rdy bit. Runs on the report thread.
+class StrokeTracker {
+ public:
+  struct Thresholds {
+    // Pressure at or above which a stroke begins
+    uint16_t pressureOn = 16;
+    // Pressure below which a stroke ends
+    uint16_t pressureOff = 8;
+    // Consecutive samples without rdy before the pen counts as away
+    uint8_t proximityOutSamples = 2;
+  };
+
+  // Scales the default thresholds to the model's pressure range.
+  static Thresholds ThresholdsForMaxPressure(uint16_t maxPressure);
+
+  void SetThresholds(const Thresholds& thresholds) { thresholds_ = thresholds; }
+  const Thresholds& thresholds() const { return thresholds_; }
+
+  // Forgets any open stroke; ids keep counting up.
+  void Reset();
+
+  // Sets the ink/stroke flags and strokeId on |sample|.
+  void Process(PenSample& sample);
+
+ private:
+  Thresholds thresholds_;
+  bool inking_ = false;
+  bool inProximity_ = false;
+  uint8_t missingRdy_ = 0;
+  uint32_t strokeId_ = 0;
+  uint32_t nextStrokeId_ = 1;
+};
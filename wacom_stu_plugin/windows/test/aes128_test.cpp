@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "aes128.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+// FIPS-197 appendix C.1
+constexpr uint8_t kKey[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                              0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+constexpr uint8_t kPlain[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+constexpr uint8_t kCipher[16] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+
+}  // namespace
+
+TEST(Aes128, MatchesTheStandardVector) {
+  Aes128 aes(kKey);
+  uint8_t block[16];
+  aes.Encrypt(kPlain, block, 1);
+  EXPECT_EQ(std::memcmp(block, kCipher, 16), 0);
+
+  aes.UseHardware(false);
+  aes.Decrypt(kCipher, block, 1);
+  EXPECT_EQ(std::memcmp(block, kPlain, 16), 0);
+
+  aes.UseHardware(true);
+  if (!aes.hardware()) GTEST_SKIP() << "no AES-NI";
+  aes.Decrypt(kCipher, block, 1);
+  EXPECT_EQ(std::memcmp(block, kPlain, 16), 0);
+}
+
+TEST(Aes128, BatchesDecryptInPlaceOnBothPaths) {
+  uint8_t key[16];
+  for (int i = 0; i < 16; ++i) key[i] = uint8_t(i * 29 + 7);
+  Aes128 aes(key);
+
+  // Past one run of eight lanes and into the tail
+  const size_t blocks = 19;
+  std::vector<uint8_t> plain(blocks * 16);
+  for (size_t i = 0; i < plain.size(); ++i) plain[i] = uint8_t(i * 13);
+  std::vector<uint8_t> cipher(plain.size());
+  aes.Encrypt(plain.data(), cipher.data(), blocks);
+
+  for (bool hardware : {false, true}) {
+    aes.UseHardware(hardware);
+    std::vector<uint8_t> buffer = cipher;
+    aes.Decrypt(buffer.data(), buffer.data(), blocks);
+    EXPECT_EQ(buffer, plain) << (aes.hardware() ? "AES-NI" : "portable");
+  }
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
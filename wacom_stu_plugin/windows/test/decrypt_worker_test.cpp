@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "decrypt_worker.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+constexpr uint32_t kSessionId = 0xCAFE0042;
+
+constexpr uint8_t kKey[16] = {0x10, 0x21, 0x32, 0x43, 0x54, 0x65, 0x76, 0x87,
+                              0x98, 0xA9, 0xBA, 0xCB, 0xDC, 0xED, 0xFE, 0x0F};
+
+// A two-point encrypted report as the pad sends it, points at x and x + 1
+std::vector<uint8_t> EncryptedReport(uint16_t x, uint32_t sessionId = kSessionId) {
+  uint8_t plain[16] = {uint8_t(sessionId >> 24), uint8_t(sessionId >> 16),
+                       uint8_t(sessionId >> 8), uint8_t(sessionId),
+                       0x80, 0x10, uint8_t(x >> 8), uint8_t(x), 0x00, 0x01,
+                       0x80, 0x10, uint8_t((x + 1) >> 8), uint8_t(x + 1), 0x00, 0x01};
+  std::vector<uint8_t> report(17);
+  report[0] = kPenReportDataEncrypted;
+  Aes128(kKey).Encrypt(plain, report.data() + 1, 1);
+  return report;
+}
+
+class Collected {
+ public:
+  DecryptWorker::SampleFn Fn() {
+    return [this](const PenSample& sample) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      samples_.push_back(sample);
+    };
+  }
+  std::vector<PenSample> samples() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<PenSample> samples_;
+};
+
+}  // namespace
+
+TEST(DecryptWorker, DecodesEncryptedAndPlainReportsInOrder) {
+  for (bool hardware : {false, true}) {
+    Collected collected;
+    DecryptWorker worker(kKey, kSessionId, nullptr, collected.Fn(), hardware);
+    // Enough for several batches, with a plain report among them
+    for (uint16_t i = 0; i < 100; ++i) {
+      if (i == 50) {
+        const uint8_t plain[] = {kPenReportData, 0x80, 0x10, 0x7F, 0xFF, 0x00, 0x01};
+        ASSERT_TRUE(worker.Push(plain, sizeof(plain), 0));
+      }
+      const auto report = EncryptedReport(uint16_t(i * 2));
+      ASSERT_TRUE(worker.Push(report.data(), report.size(), i));
+    }
+    worker.WaitIdle();
+
+    const auto samples = collected.samples();
+    ASSERT_EQ(samples.size(), 201u);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      const size_t index = i > 100 ? i - 1 : i;
+      if (i == 100) {
+        EXPECT_EQ(samples[i].x, 0x7FFF);
+        continue;
+      }
+      EXPECT_EQ(samples[i].x, index) << i;
+      EXPECT_EQ(samples[i].pressure, 0x10);
+      EXPECT_EQ(samples[i].timestampUs, int64_t(index / 2));
+    }
+    const auto stats = worker.stats();
+    EXPECT_EQ(stats.reports, 101u);
+    EXPECT_EQ(stats.blocks, 100u);
+    EXPECT_GE(stats.batches, 4u);
+    EXPECT_EQ(stats.sessionMismatches, 0u);
+    EXPECT_EQ(stats.hardware, hardware && Aes128::HardwareSupported());
+  }
+}
+
+TEST(DecryptWorker, DropsReportsOfAnotherSession) {
+  Collected collected;
+  DecryptWorker worker(kKey, kSessionId, nullptr, collected.Fn());
+  const auto other = EncryptedReport(10, kSessionId + 1);
+  worker.Push(other.data(), other.size(), 0);
+  // Same session id, another key
+  auto garbled = EncryptedReport(20);
+  garbled[5] ^= 0x01;
+  worker.Push(garbled.data(), garbled.size(), 0);
+  worker.WaitIdle();
+  EXPECT_TRUE(collected.samples().empty());
+  EXPECT_EQ(worker.stats().sessionMismatches, 2u);
+}
+
+TEST(DecryptWorker, FinishesTheQueueWhenDestroyed) {
+  Collected collected;
+  {
+    DecryptWorker worker(kKey, kSessionId, nullptr, collected.Fn());
+    for (uint16_t i = 0; i < 40; ++i) {
+      const auto report = EncryptedReport(i);
+      worker.Push(report.data(), report.size(), 0);
+    }
+  }
+  EXPECT_EQ(collected.samples().size(), 80u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include "device_clock_estimator.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+TEST(DeviceClockEstimator, TracksDriftAndStripsDelay) {
+  DeviceClockEstimator estimator(1000.0);
+  // Device crystal runs 200 ppm fast relative to the host
+  const double tickUs = 1000.0 * (1.0 + 200e-6);
+  const int64_t start = 5000000;
+
+  std::srand(42);
+  double worstError = 0;
+  for (int i = 0; i < 4000; ++i) {
+    const int64_t ticks = i * 5;  // 200 Hz
+    const int64_t trueUs = start + static_cast<int64_t>(ticks * tickUs);
+    // 0.2 - 2.2 ms of always-positive transport delay
+    const int64_t delay = 200 + std::rand() % 2000;
+    const int64_t mapped =
+        estimator.Update(static_cast<uint16_t>(ticks), trueUs + delay);
+    if (i > 1000) {
+      const double error = static_cast<double>(mapped - trueUs);
+      if (std::abs(error) > worstError) worstError = std::abs(error);
+    }
+  }
+
+  EXPECT_NEAR(estimator.stats().driftPpm, 200.0, 50.0);
+  EXPECT_LT(worstError, 500.0);
+}
+
+TEST(DeviceClockEstimator, RestartsAfterLongGap) {
+  DeviceClockEstimator estimator(1000.0);
+  for (int i = 0; i < 100; ++i) {
+    estimator.Update(static_cast<uint16_t>(i * 5), 1000000 + i * 5000);
+  }
+  // Pen away for ~100 s: the 16-bit counter wrapped and cannot be unwrapped
+  const int64_t later = 101000000;
+  EXPECT_EQ(estimator.Update(123, later), later);
+  EXPECT_EQ(estimator.stats().resets, 1u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
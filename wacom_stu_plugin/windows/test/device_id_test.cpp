@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+
+#include "device_id.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+const wchar_t kPath[] =
+    L"\\\\?\\usb#vid_056a&pid_00a8#6&2b8c1a3e&0&3#{a5dcbf10-6530-11d2-901f-00c04fb951ed}";
+
+}  // namespace
+
+TEST(DeviceId, NamesModelThenPath) {
+  const std::string id = StuDeviceId(0x056a, 0x00a8, kPath);
+  EXPECT_EQ(id.size(), 18u);
+  EXPECT_EQ(id.substr(0, 10), "056a-00a8-");
+  EXPECT_EQ(id, StuDeviceId(0x056a, 0x00a8, kPath));
+}
+
+TEST(DeviceId, IgnoresPathCase) {
+  std::wstring upper = kPath;
+  for (auto& c : upper) {
+    if (c >= L'a' && c <= L'z') c -= L'a' - L'A';
+  }
+  EXPECT_EQ(StuDeviceId(0x056a, 0x00a8, kPath), StuDeviceId(0x056a, 0x00a8, upper));
+}
+
+TEST(DeviceId, PortsOfTheSameModelDiffer) {
+  std::wstring otherPort = kPath;
+  otherPort[otherPort.find(L"&3#") + 1] = L'4';
+  EXPECT_NE(StuDeviceId(0x056a, 0x00a8, kPath), StuDeviceId(0x056a, 0x00a8, otherPort));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "device_info_cache.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+class DeviceInfoCacheDisk : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = fs::temp_directory_path() /
+           ("device_info_cache_test_" +
+            std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(dir_);
+  }
+  void TearDown() override { fs::remove_all(dir_); }
+
+  fs::path dir_;
+};
+
+DeviceInfo Stu540() {
+  DeviceInfo info;
+  info.productId = 0xA8;
+  info.bcdDevice = 0x0102;
+  info.tabletMaxX = 9600;
+  info.tabletMaxY = 6000;
+  info.tabletMaxPressure = 1023;
+  info.screenWidth = 800;
+  info.screenHeight = 480;
+  info.maxReportRate = 200;
+  info.resolution = 2540;
+  info.encodingFlag = 0x0F;
+  info.modelName = "STU-540";
+  info.firmwareMajor = 1;
+  info.firmwareMinor = 2;
+  info.secureIc = 1;
+  info.areaWrites = true;
+  info.hardwareInk = true;
+  info.penDataOptionMode = true;
+  return info;
+}
+
+}  // namespace
+
+TEST(DeviceInfoCache, HitsOnlyUnderTheSameDescriptor) {
+  DeviceInfoCache cache;
+  EXPECT_EQ(cache.Find("056a-00a8-00000001", 0xA8, 0x0102), nullptr);
+
+  cache.Store("056a-00a8-00000001", Stu540());
+  const DeviceInfo* found = cache.Find("056a-00a8-00000001", 0xA8, 0x0102);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(*found, Stu540());
+
+  // New firmware, or another pad in the same port
+  EXPECT_EQ(cache.Find("056a-00a8-00000001", 0xA8, 0x0103), nullptr);
+  EXPECT_EQ(cache.Find("056a-00a8-00000001", 0xA5, 0x0102), nullptr);
+  EXPECT_EQ(cache.Find("056a-00a8-00000002", 0xA8, 0x0102), nullptr);
+
+  const auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.stale, 2u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.entries, 1u);
+}
+
+TEST_F(DeviceInfoCacheDisk, SurvivesReopen) {
+  DeviceInfo spaced = Stu540();
+  spaced.modelName = "STU 430 V";
+  spaced.productId = 0xA5;
+  DeviceInfo unnamed = Stu540();
+  unnamed.modelName.clear();
+  {
+    DeviceInfoCache cache;
+    ASSERT_TRUE(cache.Open(dir_.u8string()));
+    cache.Store("056a-00a8-00000001", Stu540());
+    cache.Store("056a-00a5-00000002", spaced);
+    cache.Store("056a-00a8-00000003", unnamed);
+  }
+
+  DeviceInfoCache reopened;
+  ASSERT_TRUE(reopened.Open(dir_.u8string()));
+  EXPECT_EQ(reopened.stats().entries, 3u);
+  const DeviceInfo* found = reopened.Find("056a-00a8-00000001", 0xA8, 0x0102);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(*found, Stu540());
+  found = reopened.Find("056a-00a5-00000002", 0xA5, 0x0102);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(found->modelName, "STU 430 V");
+  found = reopened.Find("056a-00a8-00000003", 0xA8, 0x0102);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(*found, unnamed);
+}
+
+TEST_F(DeviceInfoCacheDisk, SkipsDamagedLines) {
+  {
+    DeviceInfoCache cache;
+    ASSERT_TRUE(cache.Open(dir_.u8string()));
+    cache.Store("056a-00a8-00000001", Stu540());
+  }
+  {
+    std::ofstream file(dir_ / "devices.txt", std::ios::app);
+    file << "056a-00a8-00000002 168 258 9600\n";
+    file << "056a-00a8-00000003 168 258 9600 6000 1023 800 480 999 2540 15 1 2 1 1 1 1 x\n";
+  }
+
+  DeviceInfoCache reopened;
+  ASSERT_TRUE(reopened.Open(dir_.u8string()));
+  EXPECT_EQ(reopened.stats().entries, 1u);
+  EXPECT_NE(reopened.Find("056a-00a8-00000001", 0xA8, 0x0102), nullptr);
+
+  // A file from another format is ignored, not misread
+  {
+    std::ofstream file(dir_ / "devices.txt", std::ios::trunc);
+    file << "STUDEV0\n";
+  }
+  DeviceInfoCache other;
+  ASSERT_TRUE(other.Open(dir_.u8string()));
+  EXPECT_EQ(other.stats().entries, 0u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
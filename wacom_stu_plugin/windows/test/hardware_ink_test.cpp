@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "hardware_ink.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+TEST(HardwareInk, PacksColorAsRgb565) {
+  EXPECT_EQ(InkColorRgb565(0xFF000000), 0x0000);
+  EXPECT_EQ(InkColorRgb565(0x00FFFFFF), 0xFFFF);
+  EXPECT_EQ(InkColorRgb565(0xFF1E3A8A), (0x1E >> 3) << 11 | (0x3A >> 2) << 5 | (0x8A >> 3));
+}
+
+TEST(HardwareInk, EmptyAreaCoversScreenAndPressureFollowsTracker) {
+  StrokeTracker::Thresholds tracker;
+  tracker.pressureOn = 15;
+  tracker.pressureOff = 7;
+  HardwareInkSettings out;
+  ASSERT_TRUE(ResolveHardwareInk(HardwareInkConfig{}, 800, 480, 1023, tracker, out));
+  EXPECT_EQ(out.left, 0);
+  EXPECT_EQ(out.top, 0);
+  EXPECT_EQ(out.right, 799);
+  EXPECT_EQ(out.bottom, 479);
+  EXPECT_EQ(out.rect(), (ScreenRect{0, 0, 800, 480}));
+  EXPECT_EQ(out.onPressure, 15);
+  EXPECT_EQ(out.offPressure, 7);
+  EXPECT_EQ(out.thickness, 1);
+}
+
+TEST(HardwareInk, ClampsToScreenAndRanges) {
+  HardwareInkConfig config;
+  config.area = ScreenRect{-10, 100, 900, 50};
+  config.thickness = 9;
+  config.onPressure = 5000;
+  config.offPressure = 6000;
+  HardwareInkSettings out;
+  ASSERT_TRUE(ResolveHardwareInk(config, 800, 480, 1023, {}, out));
+  EXPECT_EQ(out.rect(), (ScreenRect{0, 100, 800, 50}));
+  EXPECT_EQ(out.thickness, kMaxHardwareInkThickness);
+  EXPECT_EQ(out.onPressure, 1023);
+  EXPECT_EQ(out.offPressure, 1022);
+
+  config.area = ScreenRect{800, 0, 10, 10};
+  EXPECT_FALSE(ResolveHardwareInk(config, 800, 480, 1023, {}, out));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include "hot_zones.h"
+#include "pen_sample.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+using Result = HotZoneTracker::Result;
+
+// A 100 x 100 zone at the origin; sample times are in ms
+void Configure(HotZoneTracker& tracker) {
+  HotZoneTracker::Config config;
+  config.zones[0] = HotZoneTracker::Zone{7, 0, 0, 99, 99};
+  config.count = 1;
+  config.minPressUs = 20000;
+  config.refractoryUs = 150000;
+  tracker.SetConfig(config);
+}
+
+PenSample Sample(uint8_t flags, uint16_t x, uint16_t y, uint32_t strokeId, int64_t ms) {
+  PenSample s;
+  s.flags = flags | kPenSampleProximity;
+  s.x = x;
+  s.y = y;
+  s.strokeId = strokeId;
+  s.deviceTimeUs = ms * 1000;
+  return s;
+}
+
+PenSample Begin(uint16_t x, uint16_t y, uint32_t id, int64_t ms) {
+  return Sample(kPenSampleInk | kPenSampleStrokeBegin, x, y, id, ms);
+}
+
+PenSample Ink(uint16_t x, uint16_t y, uint32_t id, int64_t ms) {
+  return Sample(kPenSampleInk, x, y, id, ms);
+}
+
+PenSample End(uint16_t x, uint16_t y, uint32_t id, int64_t ms) {
+  return Sample(kPenSampleStrokeEnd, x, y, id, ms);
+}
+
+}  // namespace
+
+TEST(HotZoneTracker, PressInsideZoneClicksOnce) {
+  HotZoneTracker tracker;
+  Configure(tracker);
+  PenSample hover = Sample(0, 50, 50, 0, 0);
+  EXPECT_EQ(tracker.Process(hover), Result::kDrop);
+
+  PenSample down = Begin(50, 50, 1, 10);
+  EXPECT_EQ(tracker.Process(down), Result::kDrop);
+  PenSample move = Ink(60, 52, 1, 30);
+  EXPECT_EQ(tracker.Process(move), Result::kDrop);
+  PenSample up = End(60, 52, 1, 50);
+  ASSERT_EQ(tracker.Process(up), Result::kClick);
+  EXPECT_EQ(up.strokeId, 7u);
+  EXPECT_TRUE(up.flags & kPenSampleHotZone);
+  EXPECT_FALSE(up.flags & (kPenSampleInk | kPenSampleStrokeEnd));
+
+  const auto stats = tracker.stats();
+  EXPECT_EQ(stats.clicks, 1u);
+  EXPECT_EQ(stats.dropped, 3u);
+}
+
+TEST(HotZoneTracker, InkStrokesNeverPress) {
+  HotZoneTracker tracker;
+  Configure(tracker);
+  PenSample down = Begin(500, 500, 1, 0);
+  EXPECT_EQ(tracker.Process(down), Result::kPass);
+  // Wandering through the zone is still ink
+  PenSample move = Ink(50, 50, 1, 20);
+  EXPECT_EQ(tracker.Process(move), Result::kPass);
+  PenSample up = End(50, 50, 1, 40);
+  EXPECT_EQ(tracker.Process(up), Result::kPass);
+  EXPECT_EQ(tracker.stats().clicks, 0u);
+}
+
+TEST(HotZoneTracker, BouncesSlideOffsAndRepeatsDoNotClick) {
+  HotZoneTracker tracker;
+  Configure(tracker);
+
+  // Too short
+  PenSample s = Begin(10, 10, 1, 0);
+  tracker.Process(s);
+  s = End(10, 10, 1, 5);
+  EXPECT_EQ(tracker.Process(s), Result::kDrop);
+  EXPECT_EQ(tracker.stats().bounces, 1u);
+
+  // Released outside the zone
+  s = Begin(10, 10, 2, 100);
+  tracker.Process(s);
+  s = Ink(300, 10, 2, 140);
+  tracker.Process(s);
+  s = End(300, 10, 2, 160);
+  EXPECT_EQ(tracker.Process(s), Result::kDrop);
+
+  s = Begin(10, 10, 3, 200);
+  tracker.Process(s);
+  s = End(10, 10, 3, 240);
+  EXPECT_EQ(tracker.Process(s), Result::kClick);
+
+  // Within the refractory period of that click
+  s = Begin(10, 10, 4, 300);
+  tracker.Process(s);
+  s = End(10, 10, 4, 340);
+  EXPECT_EQ(tracker.Process(s), Result::kDrop);
+  EXPECT_EQ(tracker.stats().clicks, 1u);
+}
+
+TEST(HotZoneTracker, MapsScreenRectsToTabletUnits) {
+  // Bottom fifth of an 800 x 480 screen, split in three
+  const auto zone = HotZoneTracker::ZoneFromScreen(3, ScreenRect{533, 384, 267, 96}, 800, 480,
+                                                   9600, 6000);
+  EXPECT_EQ(zone.id, 3u);
+  EXPECT_EQ(zone.left, 6396);
+  EXPECT_EQ(zone.right, 9599);
+  EXPECT_EQ(zone.top, 4800);
+  EXPECT_EQ(zone.bottom, 5999);
+
+  EXPECT_EQ(HotZoneTracker::ZoneFromScreen(4, ScreenRect{900, 0, 10, 10}, 800, 480, 9600, 6000).id,
+            0u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
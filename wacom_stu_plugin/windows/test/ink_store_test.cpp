@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "ink_store.h"
+#include "pen_sample.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+PenSample Ink(uint32_t strokeId, uint16_t x) {
+  PenSample s;
+  s.x = x;
+  s.y = uint16_t(x + 1);
+  s.pressure = 300;
+  s.flags = kPenSampleProximity | kPenSampleInk;
+  s.strokeId = strokeId;
+  return s;
+}
+
+}  // namespace
+
+TEST(InkStore, KeepsInkByStroke) {
+  InkStore store;
+  PenSample hover = Ink(0, 5);
+  hover.flags = kPenSampleProximity;
+  store.Add(hover);
+  store.Add(Ink(1, 10));
+  store.Add(Ink(1, 11));
+  store.Add(Ink(2, 20));
+
+  EXPECT_EQ(store.pointCount(), 3u);
+  ASSERT_NE(store.Find(1), nullptr);
+  ASSERT_EQ(store.Find(1)->size(), 2u);
+  EXPECT_EQ((*store.Find(1))[1].x, 11);
+  EXPECT_EQ((*store.Find(1))[1].y, 12);
+  EXPECT_EQ((*store.Find(1))[1].pressure, 300);
+  ASSERT_NE(store.Find(2), nullptr);
+  EXPECT_EQ(store.Find(2)->size(), 1u);
+  EXPECT_EQ(store.Find(0), nullptr);
+  EXPECT_EQ(store.Find(3), nullptr);
+}
+
+TEST(InkStore, EvictsOldestStrokesPastTheBound) {
+  constexpr size_t kBound = size_t(1) << 20;
+  constexpr size_t kStroke = kBound / 4;
+  InkStore store;
+  for (uint32_t id = 1; id <= 4; ++id) {
+    for (size_t i = 0; i < kStroke; ++i) store.Add(Ink(id, uint16_t(i)));
+  }
+  EXPECT_EQ(store.pointCount(), kBound);
+  EXPECT_NE(store.Find(1), nullptr);
+
+  // One point over drops all of stroke 1
+  store.Add(Ink(5, 0));
+  EXPECT_EQ(store.pointCount(), kBound - kStroke + 1);
+  EXPECT_EQ(store.Find(1), nullptr);
+  ASSERT_NE(store.Find(2), nullptr);
+  EXPECT_EQ(store.Find(2)->size(), kStroke);
+  EXPECT_NE(store.Find(5), nullptr);
+}
+
+TEST(InkStore, KeepsAStrokeLongerThanTheBound) {
+  InkStore store;
+  const size_t count = (size_t(1) << 20) + 10;
+  for (size_t i = 0; i < count; ++i) store.Add(Ink(9, uint16_t(i)));
+  EXPECT_EQ(store.pointCount(), count);
+  ASSERT_NE(store.Find(9), nullptr);
+  EXPECT_EQ(store.Find(9)->size(), count);
+}
+
+// What clearStrokes does
+TEST(InkStore, ClearForgetsEverything) {
+  InkStore store;
+  store.Add(Ink(1, 10));
+  store.Add(Ink(2, 20));
+  store.Clear();
+  EXPECT_EQ(store.pointCount(), 0u);
+  EXPECT_EQ(store.Find(1), nullptr);
+  EXPECT_EQ(store.Find(2), nullptr);
+
+  store.Add(Ink(3, 30));
+  EXPECT_EQ(store.pointCount(), 1u);
+  ASSERT_NE(store.Find(3), nullptr);
+  EXPECT_EQ((*store.Find(3))[0].x, 30);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
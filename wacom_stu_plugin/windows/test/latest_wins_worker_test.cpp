@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "latest_wins_worker.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+using Outcome = LatestWinsWorker::Outcome;
+
+// Collects outcomes by job number from any thread
+class Outcomes {
+ public:
+  LatestWinsWorker::Finished For(int job) {
+    return [this, job](Outcome outcome) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      seen_.push_back({job, outcome});
+    };
+  }
+
+  std::vector<std::pair<int, Outcome>> seen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seen_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::pair<int, Outcome>> seen_;
+};
+
+}  // namespace
+
+TEST(LatestWinsWorker, NewerJobReplacesWaitingOne) {
+  LatestWinsWorker worker;
+  Outcomes outcomes;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::promise<void> started;
+
+  worker.Submit([&](const std::atomic<bool>&) {
+    started.set_value();
+    released.wait();
+    return true;
+  }, outcomes.For(1));
+  started.get_future().wait();
+
+  std::vector<int> ran;
+  worker.Submit([&](const std::atomic<bool>&) { ran.push_back(2); return true; }, outcomes.For(2));
+  worker.Submit([&](const std::atomic<bool>&) { ran.push_back(3); return true; }, outcomes.For(3));
+  release.set_value();
+  worker.WaitIdle();
+
+  EXPECT_EQ(ran, std::vector<int>{3});
+  const auto seen = outcomes.seen();
+  ASSERT_EQ(seen.size(), 3u);
+  EXPECT_EQ(seen[0], std::make_pair(2, Outcome::kReplaced));
+  EXPECT_EQ(seen[1], std::make_pair(1, Outcome::kDone));
+  EXPECT_EQ(seen[2], std::make_pair(3, Outcome::kDone));
+}
+
+TEST(LatestWinsWorker, CancelStopsRunningJobAtCheckpoint) {
+  LatestWinsWorker worker;
+  Outcomes outcomes;
+  std::promise<void> started;
+
+  worker.Submit([&](const std::atomic<bool>& cancelled) {
+    started.set_value();
+    while (!cancelled) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return false;
+  }, outcomes.For(1));
+  started.get_future().wait();
+  worker.Submit([](const std::atomic<bool>&) { return true; }, outcomes.For(2));
+
+  worker.Cancel();
+  worker.WaitIdle();
+  EXPECT_FALSE(worker.busy());
+  const auto seen = outcomes.seen();
+  ASSERT_EQ(seen.size(), 2u);
+  EXPECT_EQ(seen[0], std::make_pair(2, Outcome::kCancelled));
+  EXPECT_EQ(seen[1], std::make_pair(1, Outcome::kCancelled));
+
+  // The flag is cleared for the next job
+  bool cancelledAtStart = true;
+  worker.Submit([&](const std::atomic<bool>& cancelled) {
+    cancelledAtStart = cancelled;
+    return true;
+  }, outcomes.For(3));
+  worker.WaitIdle();
+  EXPECT_FALSE(cancelledAtStart);
+}
+
+TEST(LatestWinsWorker, DestructorFinishesWaitingJob) {
+  Outcomes outcomes;
+  {
+    LatestWinsWorker worker;
+    std::promise<void> started;
+    worker.Submit([&](const std::atomic<bool>& cancelled) {
+      started.set_value();
+      while (!cancelled) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return false;
+    }, outcomes.For(1));
+    started.get_future().wait();
+    worker.Submit([](const std::atomic<bool>&) { return true; }, outcomes.For(2));
+  }
+  const auto seen = outcomes.seen();
+  ASSERT_EQ(seen.size(), 2u);
+  EXPECT_EQ(seen[0], std::make_pair(2, Outcome::kCancelled));
+  EXPECT_EQ(seen[1], std::make_pair(1, Outcome::kCancelled));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
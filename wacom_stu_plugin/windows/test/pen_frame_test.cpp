@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "pen_frame.h"
+#include "pen_sample.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+// What WacomService.decodePenFrame in lib/core/services/wacom_service.dart
+// rebuilds from a frame
+struct Decoded {
+  int64_t x, y, pressure, sw, time, sequence, deviceTime, strokeId, flags;
+};
+
+std::vector<Decoded> DecodePlain(const std::vector<int32_t>& packed, size_t count, int64_t t0) {
+  std::vector<Decoded> out;
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t* row = &packed[i * kFrameStride];
+    out.push_back({row[kFrameX], row[kFrameY], row[kFramePressure], row[kFrameSw],
+                   t0 + row[kFrameTime], row[kFrameSequence], t0 + row[kFrameDeviceTime],
+                   row[kFrameStrokeId], row[kFrameFlags]});
+  }
+  return out;
+}
+
+// The Dart decoder's arithmetic: varints of up to 5 bytes into a 64-bit
+// value, un-zigzagged, then summed per column except sw and flags
+std::vector<Decoded> DecodeDelta(const std::vector<uint8_t>& bytes, size_t count, int64_t t0) {
+  std::vector<Decoded> out;
+  size_t offset = 0;
+  int64_t row[kFrameStride];
+  Decoded sum{0, 0, 0, 0, t0, 0, t0, 0, 0};
+  for (size_t i = 0; i < count; ++i) {
+    for (int c = 0; c < kFrameStride; ++c) {
+      int64_t value = 0;
+      int shift = 0;
+      uint8_t byte = 0;
+      do {
+        byte = bytes.at(offset++);
+        value |= int64_t(byte & 0x7f) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+      row[c] = (value >> 1) ^ -(value & 1);
+    }
+    sum.x += row[kFrameX];
+    sum.y += row[kFrameY];
+    sum.pressure += row[kFramePressure];
+    sum.sw = row[kFrameSw];
+    sum.time += row[kFrameTime];
+    sum.sequence += row[kFrameSequence];
+    sum.deviceTime += row[kFrameDeviceTime];
+    sum.strokeId += row[kFrameStrokeId];
+    sum.flags = row[kFrameFlags];
+    out.push_back(sum);
+  }
+  EXPECT_EQ(offset, bytes.size());
+  return out;
+}
+
+PenSample Sample(uint16_t x, uint16_t y, uint16_t pressure, uint16_t sw, int64_t timeUs,
+                 int32_t sequence, int64_t deviceTimeUs, uint32_t strokeId, uint8_t flags) {
+  PenSample s;
+  s.x = x;
+  s.y = y;
+  s.pressure = pressure;
+  s.sw = sw;
+  s.timestampUs = timeUs;
+  s.deviceTimeUs = deviceTimeUs;
+  s.strokeId = strokeId;
+  s.flags = flags;
+  if (sequence >= 0) {
+    s.sequence = uint16_t(sequence);
+    s.flags |= kPenSampleHasSequence;
+  }
+  return s;
+}
+
+// Every column moving both ways: the sequence wrapping at 16 bits and
+// then missing, times before t0, the stroke id dropping back to 0 and
+// then to a value only int32 wraparound reaches, and sw and flags going
+// down, which only absolute columns survive
+std::vector<PenSample> Stroke() {
+  const uint8_t ink = kPenSampleProximity | kPenSampleInk;
+  return {
+      Sample(9600, 6000, 1023, 1, 1'000'000, 65534, 999'000, 7, ink | kPenSampleStrokeBegin),
+      Sample(9500, 6010, 1000, 1, 1'005'000, 65535, 1'004'800, 7, ink),
+      Sample(9400, 5990, 980, 1, 1'010'000, 0, 1'009'700, 7, ink | kPenSampleSynthetic),
+      Sample(0, 0, 0, 0, 1'008'000, -1, 995'000, 0, kPenSampleStrokeEnd),
+      Sample(65535, 65535, 4095, 3, 1'900'000'000, 1, 1'899'999'000, 0xFFFFFFF0u, 0),
+  };
+}
+
+void ExpectMatches(const std::vector<Decoded>& decoded, const std::vector<PenSample>& samples) {
+  ASSERT_EQ(decoded.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const PenSample& s = samples[i];
+    EXPECT_EQ(decoded[i].x, s.x) << i;
+    EXPECT_EQ(decoded[i].y, s.y) << i;
+    EXPECT_EQ(decoded[i].pressure, s.pressure) << i;
+    EXPECT_EQ(decoded[i].sw, s.sw) << i;
+    EXPECT_EQ(decoded[i].time, s.timestampUs) << i;
+    EXPECT_EQ(decoded[i].sequence, (s.flags & kPenSampleHasSequence) ? s.sequence : -1) << i;
+    EXPECT_EQ(decoded[i].deviceTime, s.deviceTimeUs) << i;
+    EXPECT_EQ(decoded[i].strokeId, int32_t(s.strokeId)) << i;
+    EXPECT_EQ(decoded[i].flags, s.flags) << i;
+  }
+}
+
+}  // namespace
+
+TEST(PenFrame, PlainFramesRoundTrip) {
+  const auto samples = Stroke();
+  const int64_t t0 = samples.front().timestampUs;
+  std::vector<int32_t> packed;
+  PackPenFrame(samples.data(), samples.size(), t0, packed);
+  ASSERT_EQ(packed.size(), samples.size() * kFrameStride);
+  ExpectMatches(DecodePlain(packed, samples.size(), t0), samples);
+}
+
+TEST(PenFrame, DeltaFramesRoundTrip) {
+  const auto samples = Stroke();
+  const int64_t t0 = samples.front().timestampUs;
+  std::vector<uint8_t> bytes;
+  PackPenFrameDelta(samples.data(), samples.size(), t0, bytes);
+  ExpectMatches(DecodeDelta(bytes, samples.size(), t0), samples);
+}
+
+TEST(PenFrame, MappedColumnsReplaceTheSamples) {
+  const auto samples = Stroke();
+  const int32_t x[] = {-1'000'000, 1'000'000, 0, -1, 1};
+  const int32_t y[] = {-5, 5, -5, 5, -5};
+  const int32_t pressure[] = {65536, 0, 65536, 0, 1};
+  const PenFrameMapped mapped{x, y, pressure};
+  const int64_t t0 = samples.front().timestampUs;
+
+  std::vector<int32_t> packed;
+  PackPenFrame(samples.data(), samples.size(), t0, packed, &mapped);
+  std::vector<uint8_t> bytes;
+  PackPenFrameDelta(samples.data(), samples.size(), t0, bytes, &mapped);
+  const auto plain = DecodePlain(packed, samples.size(), t0);
+  const auto delta = DecodeDelta(bytes, samples.size(), t0);
+  ASSERT_EQ(delta.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(plain[i].x, x[i]);
+    EXPECT_EQ(plain[i].y, y[i]);
+    EXPECT_EQ(plain[i].pressure, pressure[i]);
+    EXPECT_EQ(plain[i].sw, samples[i].sw);
+    EXPECT_EQ(delta[i].x, x[i]);
+    EXPECT_EQ(delta[i].y, y[i]);
+    EXPECT_EQ(delta[i].pressure, pressure[i]);
+    EXPECT_EQ(delta[i].sw, samples[i].sw);
+  }
+}
+
+// The bytes test/pen_frame_test.dart decodes; change the two together
+TEST(PenFrame, DeltaFixture) {
+  auto samples = Stroke();
+  samples.pop_back();
+  std::vector<uint8_t> bytes;
+  PackPenFrameDelta(samples.data(), samples.size(), samples.front().timestampUs, bytes);
+  const std::vector<uint8_t> expected = {
+      128, 150, 1,   224, 93,  254, 15, 2,   0,   252, 255, 7,   207, 15,  14,
+      30,  199, 1,   20,  45,  2,   144, 78, 2,   208, 90,  0,   14,  199, 1,
+      39,  39,  2,   144, 78,  253, 255, 7,  200, 76,  0,   142, 1,   239, 146,
+      1,   203, 93,  167, 15,  0,   159, 31, 1,   215, 229, 1,   13,  32,
+  };
+  EXPECT_EQ(bytes, expected);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "pen_pipeline.h"
+#include "pen_sample.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+PenSample Timed(uint16_t sequence, uint16_t x, uint16_t pressure) {
+  PenSample s;
+  s.x = x;
+  s.y = 1000;
+  s.pressure = pressure;
+  s.sw = pressure ? 1 : 0;
+  s.sequence = sequence;
+  s.timeCount = uint16_t(sequence * 5);
+  s.flags = kPenSampleHasSequence | kPenSampleProximity;
+  return s;
+}
+
+std::vector<PenSample> Drain(PenPipeline& pipeline) {
+  std::vector<PenSample> out;
+  pipeline.ring.Drain([&out](const PenSample& s) { out.push_back(s); });
+  return out;
+}
+
+}  // namespace
+
+TEST(PenPipeline, FilledSamplesAreInkOfTheSameStroke) {
+  PenPipeline pipeline;
+  EXPECT_TRUE(pipeline.Process(Timed(0, 100, 300)));
+  EXPECT_TRUE(pipeline.Process(Timed(1, 200, 300)));
+  // 2 and 3 lost
+  EXPECT_TRUE(pipeline.Process(Timed(4, 500, 300)));
+
+  const auto out = Drain(pipeline);
+  ASSERT_EQ(out.size(), 5u);
+  EXPECT_TRUE(out[0].flags & kPenSampleStrokeBegin);
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_EQ(out[i].x, 100 + 100 * i);
+    EXPECT_TRUE(out[i].flags & kPenSampleInk);
+    EXPECT_EQ(out[i].strokeId, out[0].strokeId);
+    EXPECT_EQ(bool(out[i].flags & kPenSampleSynthetic), i == 2 || i == 3) << i;
+  }
+  EXPECT_EQ(pipeline.gapFiller.stats().filled, 2u);
+}
+
+TEST(PenPipeline, MarksTheScreenInkedPastThePadsInkMark) {
+  PenPipeline pipeline;
+  pipeline.Process(Timed(0, 100, 300));
+  EXPECT_FALSE(pipeline.screenInked);
+
+  pipeline.hardwareInkPressure = 400;
+  pipeline.Process(Timed(1, 100, 399));
+  EXPECT_FALSE(pipeline.screenInked);
+  pipeline.Process(Timed(2, 100, 400));
+  EXPECT_TRUE(pipeline.screenInked);
+}
+
+TEST(PenPipeline, ResetStartsTheSequenceAndStrokeOver) {
+  PenPipeline pipeline;
+  pipeline.Process(Timed(10, 100, 300));
+  pipeline.Reset();
+  pipeline.Process(Timed(0, 100, 300));
+
+  const auto out = Drain(pipeline);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_TRUE(out[1].flags & kPenSampleStrokeBegin);
+  EXPECT_NE(out[1].strokeId, out[0].strokeId);
+  EXPECT_EQ(pipeline.gapFiller.stats().gaps, 0u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "pen_sample.h"
+#include "pen_transform.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+constexpr uint16_t kMaxX = 9600;
+constexpr uint16_t kMaxY = 6000;
+constexpr uint16_t kMaxPressure = 1023;
+
+PenSample Sample(uint16_t x, uint16_t y, uint16_t pressure = 0) {
+  PenSample s;
+  s.x = x;
+  s.y = y;
+  s.pressure = pressure;
+  return s;
+}
+
+struct Mapped {
+  std::vector<int32_t> x, y, pressure;
+};
+
+Mapped Apply(const PenTransform& transform, const std::vector<PenSample>& samples) {
+  Mapped out{std::vector<int32_t>(samples.size()), std::vector<int32_t>(samples.size()),
+             std::vector<int32_t>(samples.size())};
+  transform.Apply(samples.data(), samples.size(), out.x.data(), out.y.data(),
+                  out.pressure.data());
+  return out;
+}
+
+}  // namespace
+
+// Tablet to a 400 x 250 canvas, flipped and rotated slightly; every sample,
+// in the vector body and the tail, lands within one output step of the
+// double-precision result
+TEST(PenTransform, MatchesDoubleAffine) {
+  PenTransform::Config config;
+  config.a = 400.0 / kMaxX * std::cos(0.1);
+  config.b = -250.0 / kMaxY * std::sin(0.1);
+  config.c = 12.5;
+  config.d = 400.0 / kMaxX * std::sin(0.1);
+  config.e = -250.0 / kMaxY * std::cos(0.1);
+  config.f = 250.0;
+  PenTransform transform;
+  ASSERT_TRUE(transform.Configure(config, kMaxX, kMaxY, kMaxPressure));
+
+  std::srand(7);
+  std::vector<PenSample> samples;
+  for (int i = 0; i < 1003; ++i) {
+    samples.push_back(Sample(uint16_t(std::rand() % (kMaxX + 1)),
+                             uint16_t(std::rand() % (kMaxY + 1))));
+  }
+  const Mapped out = Apply(transform, samples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const double x = config.a * samples[i].x + config.b * samples[i].y + config.c;
+    const double y = config.d * samples[i].x + config.e * samples[i].y + config.f;
+    EXPECT_NEAR(out.x[i], x * PenTransform::kCoordOne, 1.0) << i;
+    EXPECT_NEAR(out.y[i], y * PenTransform::kCoordOne, 1.0) << i;
+  }
+}
+
+TEST(PenTransform, ClampsInputAndOutput) {
+  PenTransform::Config config;
+  config.a = 0.1;
+  config.e = 0.1;
+  config.clamp = true;
+  config.minX = 10;
+  config.maxX = 500;
+  config.minY = 0;
+  config.maxY = 100;
+  PenTransform transform;
+  ASSERT_TRUE(transform.Configure(config, kMaxX, kMaxY, kMaxPressure));
+
+  // Past the tablet's range, and past 32767
+  const Mapped out = Apply(transform, {Sample(0, 0), Sample(9000, 9000), Sample(65000, 300),
+                                       Sample(3000, 500), Sample(9600, 6000)});
+  const int32_t one = PenTransform::kCoordOne;
+  EXPECT_EQ(out.x, (std::vector<int32_t>{10 * one, 500 * one, 10 * one, 300 * one, 500 * one}));
+  EXPECT_EQ(out.y, (std::vector<int32_t>{0, 100 * one, 30 * one, 50 * one, 100 * one}));
+}
+
+TEST(PenTransform, PressureCurve) {
+  PenTransform transform;
+  PenTransform::Config config;
+  ASSERT_TRUE(transform.Configure(config, kMaxX, kMaxY, kMaxPressure));
+  Mapped out = Apply(transform, {Sample(0, 0, 0), Sample(0, 0, 1023), Sample(0, 0, 4000)});
+  EXPECT_EQ(out.pressure,
+            (std::vector<int32_t>{0, PenTransform::kPressureOne, PenTransform::kPressureOne}));
+
+  // Steep then flat
+  config.pressureCurve = {0.0, 0.8, 1.0};
+  ASSERT_TRUE(transform.Configure(config, kMaxX, kMaxY, kMaxPressure));
+  out = Apply(transform, {Sample(0, 0, 0), Sample(0, 0, 256), Sample(0, 0, 767)});
+  EXPECT_EQ(out.pressure[0], 0);
+  EXPECT_NEAR(out.pressure[1], 0.8 * 256 / 511.5 * PenTransform::kPressureOne, 2);
+  EXPECT_NEAR(out.pressure[2], (0.8 + 0.2 * 255.5 / 511.5) * PenTransform::kPressureOne, 2);
+}
+
+TEST(PenTransform, RejectsScalesPastFixedPoint) {
+  PenTransform transform;
+  PenTransform::Config config;
+  config.a = 5000;
+  EXPECT_FALSE(transform.Configure(config, kMaxX, kMaxY, kMaxPressure));
+  EXPECT_FALSE(transform.enabled());
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
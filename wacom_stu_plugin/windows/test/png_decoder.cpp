@@ -0,0 +1,380 @@
+#include "png_decoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+// Bits least significant first, as deflate packs them
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool Bits(int count, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < count; ++i) {
+      if (pos_ >= size_ * 8) return false;
+      value |= uint32_t((data_[pos_ >> 3] >> (pos_ & 7)) & 1) << i;
+      ++pos_;
+    }
+    return true;
+  }
+
+  void AlignToByte() { pos_ = (pos_ + 7) & ~size_t(7); }
+  size_t bytePos() const { return pos_ >> 3; }
+  void SkipBytes(size_t count) { pos_ += count * 8; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+};
+
+constexpr int kMaxBits = 15;
+
+// Canonical Huffman code as code counts per length and symbols in code
+// order (RFC 1951 3.2.2)
+struct Huffman {
+  int counts[kMaxBits + 1] = {};
+  std::vector<int> symbols;
+};
+
+// False if the lengths over-subscribe the code space
+bool BuildHuffman(const uint8_t* lengths, int count, Huffman& h) {
+  for (int& c : h.counts) c = 0;
+  for (int i = 0; i < count; ++i) h.counts[lengths[i]]++;
+  h.counts[0] = 0;
+  int left = 1;
+  for (int len = 1; len <= kMaxBits; ++len) {
+    left = (left << 1) - h.counts[len];
+    if (left < 0) return false;
+  }
+  int offsets[kMaxBits + 2] = {};
+  for (int len = 1; len <= kMaxBits; ++len) offsets[len + 1] = offsets[len] + h.counts[len];
+  h.symbols.assign(size_t(offsets[kMaxBits + 1]), 0);
+  for (int i = 0; i < count; ++i) {
+    if (lengths[i]) h.symbols[size_t(offsets[lengths[i]]++)] = i;
+  }
+  return true;
+}
+
+bool DecodeSymbol(BitReader& in, const Huffman& h, int& symbol) {
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len <= kMaxBits; ++len) {
+    uint32_t bit;
+    if (!in.Bits(1, bit)) return false;
+    code |= int(bit);
+    const int count = h.counts[len];
+    if (code - first < count) {
+      symbol = h.symbols[size_t(index + code - first)];
+      return true;
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return false;
+}
+
+constexpr int kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr int kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr int kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                               33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                               1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr int kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+bool InflateCodes(BitReader& in, const Huffman& lit, const Huffman& dist,
+                  std::vector<uint8_t>& out) {
+  for (;;) {
+    int symbol;
+    if (!DecodeSymbol(in, lit, symbol)) return false;
+    if (symbol < 256) {
+      out.push_back(uint8_t(symbol));
+      continue;
+    }
+    if (symbol == 256) return true;
+    symbol -= 257;
+    if (symbol >= 29) return false;
+    uint32_t extra;
+    if (!in.Bits(kLengthExtra[symbol], extra)) return false;
+    const size_t length = size_t(kLengthBase[symbol]) + extra;
+    if (!DecodeSymbol(in, dist, symbol) || symbol >= 30) return false;
+    if (!in.Bits(kDistExtra[symbol], extra)) return false;
+    const size_t distance = size_t(kDistBase[symbol]) + extra;
+    if (distance > out.size()) return false;
+    // Byte by byte, as the match may overlap what it copies
+    for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+  }
+}
+
+bool InflateStored(BitReader& in, std::vector<uint8_t>& out) {
+  in.AlignToByte();
+  const size_t pos = in.bytePos();
+  if (pos + 4 > in.size()) return false;
+  const uint8_t* p = in.data() + pos;
+  const uint16_t len = uint16_t(p[0] | (p[1] << 8));
+  const uint16_t nlen = uint16_t(p[2] | (p[3] << 8));
+  if (uint16_t(~nlen) != len || pos + 4 + len > in.size()) return false;
+  out.insert(out.end(), p + 4, p + 4 + len);
+  in.SkipBytes(4 + size_t(len));
+  return true;
+}
+
+bool InflateFixed(BitReader& in, std::vector<uint8_t>& out) {
+  uint8_t lengths[288];
+  for (int i = 0; i < 288; ++i) lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+  Huffman lit, dist;
+  BuildHuffman(lengths, 288, lit);
+  for (int i = 0; i < 30; ++i) lengths[i] = 5;
+  BuildHuffman(lengths, 30, dist);
+  return InflateCodes(in, lit, dist, out);
+}
+
+bool InflateDynamic(BitReader& in, std::vector<uint8_t>& out) {
+  static constexpr int kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+                                     11, 4, 12, 3, 13, 2, 14, 1, 15};
+  uint32_t hlit, hdist, hclen;
+  if (!in.Bits(5, hlit) || !in.Bits(5, hdist) || !in.Bits(4, hclen)) return false;
+  hlit += 257;
+  hdist += 1;
+  hclen += 4;
+  if (hlit > 286 || hdist > 30) return false;
+
+  uint8_t lengths[286 + 30] = {};
+  for (uint32_t i = 0; i < hclen; ++i) {
+    uint32_t len;
+    if (!in.Bits(3, len)) return false;
+    lengths[kOrder[i]] = uint8_t(len);
+  }
+  Huffman lencode;
+  if (!BuildHuffman(lengths, 19, lencode)) return false;
+
+  std::memset(lengths, 0, sizeof(lengths));
+  uint32_t index = 0;
+  while (index < hlit + hdist) {
+    int symbol;
+    if (!DecodeSymbol(in, lencode, symbol)) return false;
+    if (symbol < 16) {
+      lengths[index++] = uint8_t(symbol);
+      continue;
+    }
+    uint8_t len = 0;
+    uint32_t repeat;
+    if (symbol == 16) {
+      if (index == 0 || !in.Bits(2, repeat)) return false;
+      len = lengths[index - 1];
+      repeat += 3;
+    } else if (symbol == 17) {
+      if (!in.Bits(3, repeat)) return false;
+      repeat += 3;
+    } else {
+      if (!in.Bits(7, repeat)) return false;
+      repeat += 11;
+    }
+    if (index + repeat > hlit + hdist) return false;
+    while (repeat--) lengths[index++] = len;
+  }
+  if (lengths[256] == 0) return false;
+
+  Huffman lit, dist;
+  if (!BuildHuffman(lengths, int(hlit), lit) ||
+      !BuildHuffman(lengths + hlit, int(hdist), dist)) {
+    return false;
+  }
+  return InflateCodes(in, lit, dist, out);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+int Channels(uint8_t colorType) {
+  switch (colorType) {
+    case 0:
+    case 3:
+      return 1;
+    case 2:
+      return 3;
+    case 4:
+      return 2;
+    case 6:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+uint8_t Paeth(int a, int b, int c) {
+  const int pa = std::abs(b - c);
+  const int pb = std::abs(a - c);
+  const int pc = std::abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) return uint8_t(a);
+  return uint8_t(pb <= pc ? b : c);
+}
+
+// Sample |x| of a row packed at |depth| bits, most significant first
+int Sample(const uint8_t* row, int x, int depth) {
+  if (depth == 8) return row[x];
+  const int bit = x * depth;
+  return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+}
+
+}  // namespace
+
+bool ZlibInflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out,
+                 DecodeStats* stats) {
+  // Deflate method with a window of at most 32K, no preset dictionary
+  if (size < 6 || (data[0] & 0x0f) != 8 || (data[0] >> 4) > 7 ||
+      (data[0] * 256 + data[1]) % 31 != 0 || (data[1] & 0x20)) {
+    return false;
+  }
+  const size_t start = out.size();
+  BitReader in(data + 2, size - 2);
+  uint32_t last;
+  do {
+    uint32_t type;
+    if (!in.Bits(1, last) || !in.Bits(2, type)) return false;
+    bool ok = false;
+    if (type == 0) {
+      ok = InflateStored(in, out);
+      if (stats) stats->storedBlocks++;
+    } else if (type == 1) {
+      ok = InflateFixed(in, out);
+      if (stats) stats->fixedBlocks++;
+    } else if (type == 2) {
+      ok = InflateDynamic(in, out);
+      if (stats) stats->dynamicBlocks++;
+    }
+    if (!ok) return false;
+  } while (!last);
+
+  in.AlignToByte();
+  const size_t trailer = 2 + in.bytePos();
+  if (trailer + 4 != size) return false;
+  // Adler-32 computed here rather than with deflate.h's, so the check is
+  // independent of the encoder
+  uint32_t a = 1, b = 0;
+  for (size_t i = start; i < out.size(); ++i) {
+    a = (a + out[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return ReadU32(data + trailer) == ((b << 16) | a);
+}
+
+bool DecodePng(const std::vector<uint8_t>& png, DecodedPng& out, DecodeStats* stats) {
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  if (png.size() < 8 || std::memcmp(png.data(), kSignature, 8) != 0) return false;
+
+  std::vector<uint8_t> idat, plte, trns;
+  bool haveHeader = false, ended = false;
+  size_t pos = 8;
+  while (!ended && pos + 12 <= png.size()) {
+    const uint32_t size = ReadU32(&png[pos]);
+    if (pos + 12 + size > png.size()) return false;
+    const std::string type(png.begin() + pos + 4, png.begin() + pos + 8);
+    const uint8_t* data = &png[pos + 8];
+    if (type == "IHDR") {
+      if (size != 13) return false;
+      out.width = int(ReadU32(data));
+      out.height = int(ReadU32(data + 4));
+      out.bitDepth = data[8];
+      out.colorType = data[9];
+      // Deflate, adaptive filtering, no interlace
+      if (data[10] != 0 || data[11] != 0 || data[12] != 0) return false;
+      haveHeader = true;
+    } else if (type == "PLTE") {
+      plte.assign(data, data + size);
+    } else if (type == "tRNS") {
+      trns.assign(data, data + size);
+    } else if (type == "IDAT") {
+      idat.insert(idat.end(), data, data + size);
+    } else if (type == "IEND") {
+      ended = true;
+    }
+    pos += 12 + size;
+  }
+  const int channels = Channels(out.colorType);
+  if (!haveHeader || !ended || channels == 0 || out.width <= 0 || out.height <= 0) return false;
+  // 16-bit samples are never written by the encoder
+  if (out.bitDepth != 1 && out.bitDepth != 2 && out.bitDepth != 4 && out.bitDepth != 8) {
+    return false;
+  }
+  if (out.colorType == 3 && (plte.empty() || plte.size() % 3 != 0)) return false;
+
+  std::vector<uint8_t> raw;
+  if (!ZlibInflate(idat.data(), idat.size(), raw, stats)) return false;
+  const int depth = out.bitDepth;
+  const size_t rowBytes = (size_t(out.width) * channels * depth + 7) / 8;
+  const size_t bpp = std::max<size_t>(1, size_t(channels) * depth / 8);
+  if (raw.size() != (rowBytes + 1) * out.height) return false;
+
+  std::vector<uint8_t> prev(rowBytes, 0), cur(rowBytes);
+  out.rgba.assign(size_t(out.width) * out.height * 4, 0);
+  for (int y = 0; y < out.height; ++y) {
+    const uint8_t* src = &raw[(rowBytes + 1) * y];
+    const uint8_t filter = src[0];
+    if (filter > 4) return false;
+    if (stats) stats->filters[filter]++;
+    for (size_t i = 0; i < rowBytes; ++i) {
+      const int a = i >= bpp ? cur[i - bpp] : 0;
+      const int b = prev[i];
+      const int c = i >= bpp ? prev[i - bpp] : 0;
+      int predictor = 0;
+      switch (filter) {
+        case 1:
+          predictor = a;
+          break;
+        case 2:
+          predictor = b;
+          break;
+        case 3:
+          predictor = (a + b) / 2;
+          break;
+        case 4:
+          predictor = Paeth(a, b, c);
+          break;
+      }
+      cur[i] = uint8_t(src[1 + i] + predictor);
+    }
+
+    uint8_t* dst = &out.rgba[size_t(out.width) * 4 * y];
+    for (int x = 0; x < out.width; ++x, dst += 4) {
+      switch (out.colorType) {
+        case 0:
+        case 4: {
+          const int v = Sample(cur.data(), x * channels, depth) * 255 / ((1 << depth) - 1);
+          dst[0] = dst[1] = dst[2] = uint8_t(v);
+          dst[3] = out.colorType == 4 ? cur[size_t(x) * 2 + 1] : 255;
+          break;
+        }
+        case 3: {
+          const size_t index = size_t(Sample(cur.data(), x, depth));
+          if (index * 3 >= plte.size()) return false;
+          std::memcpy(dst, &plte[index * 3], 3);
+          dst[3] = index < trns.size() ? trns[index] : 255;
+          break;
+        }
+        default:
+          std::memcpy(dst, &cur[size_t(x) * channels], size_t(channels));
+          if (channels == 3) dst[3] = 255;
+          break;
+      }
+    }
+    std::swap(prev, cur);
+  }
+  return true;
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
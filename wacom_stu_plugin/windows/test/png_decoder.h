@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wacom_stu_plugin {
+namespace test {
+
+// Blocks and row filters a decode came across, so a test can tell which
+// paths of the encoder it exercised
+struct DecodeStats {
+  int storedBlocks = 0;
+  int fixedBlocks = 0;
+  int dynamicBlocks = 0;
+  // Rows per PNG filter type: None, Sub, Up, Average, Paeth
+  int filters[5] = {};
+};
+
+// Inflates a zlib stream (RFC 1950/1951) with stored, fixed and dynamic
+// blocks, checking the header and the Adler-32 trailer. Written for the
+// tests, independently of deflate.cpp; false if the stream is malformed.
+bool ZlibInflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out,
+                 DecodeStats* stats = nullptr);
+
+struct DecodedPng {
+  int width = 0;
+  int height = 0;
+  uint8_t bitDepth = 0;
+  uint8_t colorType = 0;
+  // Straight RGBA8, width * 4 bytes per row
+  std::vector<uint8_t> rgba;
+};
+
+// Decodes a non-interlaced PNG of any colour type and bit depth the
+// encoder writes: inflates IDAT, undoes each row's filter and expands
+// palette, tRNS, gray and sub-byte samples to RGBA. False if it is
+// malformed.
+bool DecodePng(const std::vector<uint8_t>& png, DecodedPng& out,
+               DecodeStats* stats = nullptr);
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
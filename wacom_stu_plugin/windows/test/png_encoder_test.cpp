@@ -0,0 +1,340 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "deflate.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// Chunk type -> data, checking each chunk's CRC on the way
+std::map<std::string, std::vector<uint8_t>> Chunks(const std::vector<uint8_t>& png) {
+  std::map<std::string, std::vector<uint8_t>> chunks;
+  size_t pos = 8;
+  while (pos + 12 <= png.size()) {
+    const uint32_t size = ReadU32(&png[pos]);
+    const uint8_t* type = &png[pos + 4];
+    EXPECT_EQ(Crc32(type, size + 4), ReadU32(&png[pos + 8 + size]));
+    chunks[std::string(type, type + 4)].assign(type + 4, type + 4 + size);
+    pos += 12 + size;
+  }
+  EXPECT_EQ(pos, png.size());
+  return chunks;
+}
+
+struct Image {
+  int width;
+  int height;
+  std::vector<uint8_t> rgba;
+
+  Image(int w, int h) : width(w), height(h), rgba(size_t(w) * h * 4, 0) {}
+
+  void Set(int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint8_t* p = &rgba[(size_t(y) * width + x) * 4];
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+    p[3] = a;
+  }
+
+  std::vector<uint8_t> Encode(const PngOptions& options = PngOptions()) const {
+    return EncodePng(rgba.data(), width, height, size_t(width) * 4, options);
+  }
+
+  // What a decoder should get back: transparent pixels are written as
+  // transparent black
+  std::vector<uint8_t> Expected() const {
+    std::vector<uint8_t> expected = rgba;
+    for (size_t i = 0; i < expected.size(); i += 4) {
+      if (expected[i + 3] == 0) expected[i] = expected[i + 1] = expected[i + 2] = 0;
+    }
+    return expected;
+  }
+};
+
+// Cheap deterministic noise, so the inputs do not depend on <random>
+struct Noise {
+  uint32_t state;
+  uint8_t Next() {
+    state = state * 1664525u + 1013904223u;
+    return uint8_t(state >> 24);
+  }
+};
+
+// Inputs that exercise literals, short and far matches, long runs and
+// more than one deflate block
+std::vector<std::vector<uint8_t>> DeflateInputs() {
+  std::vector<std::vector<uint8_t>> inputs;
+  inputs.emplace_back();
+  inputs.push_back({42});
+
+  Noise noise{1};
+  std::vector<uint8_t> random(5000);
+  for (uint8_t& b : random) b = noise.Next();
+  inputs.push_back(random);
+
+  // The same 20K twice, a match near the end of the window
+  std::vector<uint8_t> far(20000);
+  for (uint8_t& b : far) b = uint8_t(noise.Next() & 0x0f);
+  far.insert(far.end(), far.begin(), far.end());
+  inputs.push_back(far);
+
+  std::vector<uint8_t> text;
+  const char* words[] = {"pen ", "stroke ", "pressure ", "signature ", "pad ", "ink "};
+  while (text.size() < 300000) {
+    const char* word = words[noise.Next() % 6];
+    text.insert(text.end(), word, word + std::strlen(word));
+  }
+  inputs.push_back(text);
+
+  std::vector<uint8_t> runs(100000, 0);
+  for (size_t i = 0; i < runs.size(); i += 331) runs[i] = uint8_t(i);
+  inputs.push_back(runs);
+  return inputs;
+}
+
+struct Case {
+  const char* name;
+  Image image;
+  uint8_t colorType;
+  uint8_t bitDepth;
+  bool reduceColorType;
+};
+
+// One image per colour type and bit depth the encoder picks, plus RGBA
+// with reduction off. The 8-bit ones mix smooth gradients, which favour
+// Up, Average and Paeth, with noisy rows, which leave None and Sub.
+std::vector<Case> ColorTypeCases() {
+  const int w = 61, h = 37;
+  Noise noise{7};
+  std::vector<Case> cases;
+
+  auto palette = [&](const char* name, int colors, uint8_t depth) {
+    Image image(w, h);
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        const int c = (x / 3 + y * 5) % colors;
+        // Entry 0 is transparency; its colour channels are ignored
+        if (c == 0) {
+          image.Set(x, y, noise.Next(), 1, 2, 0);
+        } else {
+          image.Set(x, y, uint8_t(c * 7), uint8_t(200 - c), 99, uint8_t(c < colors / 2 ? 255 : c));
+        }
+      }
+    }
+    cases.push_back({name, image, 3, depth, true});
+  };
+  palette("palette 1-bit", 2, 1);
+  palette("palette 2-bit", 4, 2);
+  palette("palette 4-bit", 13, 4);
+  palette("palette 8-bit", 200, 8);
+
+  Image gray(w, h);
+  Image grayAlpha(w, h);
+  Image rgb(w, h);
+  Image rgba(w, h);
+  for (int y = 0; y < h; ++y) {
+    const bool noisy = y % 4 == 3;
+    for (int x = 0; x < w; ++x) {
+      const uint8_t v = noisy ? noise.Next() : uint8_t(x * 3 + y * 2);
+      gray.Set(x, y, v, v, v, 255);
+      grayAlpha.Set(x, y, v, v, v, uint8_t(noisy ? noise.Next() : x * 4));
+      const uint8_t r = noisy ? noise.Next() : uint8_t(x * 4 + y);
+      const uint8_t g = noisy ? noise.Next() : uint8_t(y * 6);
+      const uint8_t b = noisy ? noise.Next() : uint8_t((x * y) / 8);
+      rgb.Set(x, y, r, g, b, 255);
+      rgba.Set(x, y, r, g, b, uint8_t(x % 7 == 0 ? 0 : 255 - y * 3));
+    }
+  }
+  cases.push_back({"gray", gray, 0, 8, true});
+  cases.push_back({"gray+alpha", grayAlpha, 4, 8, true});
+  cases.push_back({"rgb", rgb, 2, 8, true});
+  cases.push_back({"rgba", rgba, 6, 8, true});
+  cases.push_back({"rgba unreduced", cases[1].image, 6, 8, false});
+  return cases;
+}
+
+}  // namespace
+
+TEST(PngEncoder, SignatureBecomesPaletteWithTransparency) {
+  Image image(64, 32);
+  for (int x = 0; x < 64; ++x) {
+    image.Set(x, 10, 37, 99, 235, 255);
+    image.Set(x, 11, 37, 99, 235, uint8_t(x * 4));
+  }
+
+  const auto chunks = Chunks(image.Encode());
+  const auto& ihdr = chunks.at("IHDR");
+  EXPECT_EQ(ihdr[9], 3);  // palette
+  EXPECT_EQ(ihdr[8], 8);
+  ASSERT_TRUE(chunks.count("PLTE"));
+  ASSERT_TRUE(chunks.count("tRNS"));
+  // 64 alphas on row 11 plus the opaque row; x = 0 is transparent black
+  EXPECT_EQ(chunks.at("PLTE").size(), 65u * 3);
+  EXPECT_EQ(chunks.at("tRNS").size(), 64u);
+}
+
+TEST(PngEncoder, TransparentPixelsShareOneEntry) {
+  Image image(16, 16);
+  for (int y = 0; y < 16; ++y) {
+    for (int x = 0; x < 16; ++x) image.Set(x, y, uint8_t(x * 16), uint8_t(y), 7, 0);
+  }
+  image.Set(3, 3, 0, 0, 0, 255);
+
+  const auto chunks = Chunks(image.Encode());
+  EXPECT_EQ(chunks.at("IHDR")[9], 3);
+  EXPECT_EQ(chunks.at("IHDR")[8], 1);
+  EXPECT_EQ(chunks.at("PLTE").size(), 2u * 3);
+}
+
+TEST(PngEncoder, PicksGrayTypes) {
+  Image opaque(300, 4);
+  Image translucent(300, 4);
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 300; ++x) {
+      const uint8_t v = uint8_t(x);
+      opaque.Set(x, y, v, v, v, 255);
+      translucent.Set(x, y, v, v, v, uint8_t(255 - y));
+    }
+  }
+  EXPECT_EQ(Chunks(opaque.Encode()).at("IHDR")[9], 0);
+  EXPECT_EQ(Chunks(translucent.Encode()).at("IHDR")[9], 4);
+}
+
+TEST(PngEncoder, KeepsRgbaWhenReductionIsOff) {
+  Image image(8, 8);
+  image.Set(1, 1, 255, 0, 0, 255);
+
+  PngOptions options;
+  options.reduceColorType = false;
+  const auto chunks = Chunks(image.Encode(options));
+  EXPECT_EQ(chunks.at("IHDR")[9], 6);
+  EXPECT_FALSE(chunks.count("PLTE"));
+}
+
+TEST(PngEncoder, PresetsOnlyTradeSize) {
+  Image image(200, 100);
+  for (int x = 0; x < 200; ++x) {
+    const int y = 50 + (x % 40) - 20;
+    image.Set(x, y, 0, 0, 0, 255);
+    image.Set(x, y + 1, 0, 0, 0, 128);
+  }
+
+  PngOptions fast;
+  fast.preset = PngPreset::kFast;
+  PngOptions smallest;
+  smallest.preset = PngPreset::kSmallest;
+  const auto a = Chunks(image.Encode(fast));
+  const auto b = Chunks(image.Encode(smallest));
+  EXPECT_EQ(a.at("IHDR"), b.at("IHDR"));
+  EXPECT_EQ(a.at("PLTE"), b.at("PLTE"));
+  EXPECT_LE(b.at("IDAT").size(), a.at("IDAT").size());
+}
+
+TEST(Deflate, WritesZlibFraming) {
+  std::vector<uint8_t> data(100000, 0);
+  for (size_t i = 0; i < data.size(); i += 331) data[i] = uint8_t(i);
+
+  for (bool dynamicHuffman : {false, true}) {
+    DeflateOptions options;
+    options.maxChain = 16;
+    options.dynamicHuffman = dynamicHuffman;
+    std::vector<uint8_t> out;
+    ZlibCompress(data.data(), data.size(), options, out);
+
+    ASSERT_GT(out.size(), 6u);
+    EXPECT_EQ(out[0], 0x78);
+    EXPECT_EQ((out[0] * 256 + out[1]) % 31, 0);
+    EXPECT_EQ(ReadU32(&out[out.size() - 4]), Adler32(data.data(), data.size()));
+    EXPECT_LT(out.size(), data.size() / 20);
+  }
+}
+
+TEST(Inflate, ReadsStoredBlocks) {
+  // Two stored blocks, the second final, as deflate.cpp never writes them;
+  // checks the test decoder itself
+  const uint8_t data[] = {'s', 't', 'u', '-', '5', '4', '0'};
+  std::vector<uint8_t> zlib = {0x78, 0x01, 0x00, 3, 0, 0xfc, 0xff, 's', 't', 'u',
+                               0x01, 4, 0, 0xfb, 0xff, '-', '5', '4', '0'};
+  const uint32_t adler = Adler32(data, sizeof(data));
+  for (int shift : {24, 16, 8, 0}) zlib.push_back(uint8_t(adler >> shift));
+
+  std::vector<uint8_t> out;
+  DecodeStats stats;
+  ASSERT_TRUE(ZlibInflate(zlib.data(), zlib.size(), out, &stats));
+  EXPECT_EQ(out, std::vector<uint8_t>(data, data + sizeof(data)));
+  EXPECT_EQ(stats.storedBlocks, 2);
+
+  zlib.back() ^= 1;
+  out.clear();
+  EXPECT_FALSE(ZlibInflate(zlib.data(), zlib.size(), out));
+}
+
+TEST(Deflate, RoundTripsWithFixedAndDynamicCodes) {
+  const auto inputs = DeflateInputs();
+  for (bool dynamicHuffman : {false, true}) {
+    for (int maxChain : {0, 1, 4, 16, 128}) {
+      for (bool lazy : {false, true}) {
+        DeflateOptions options;
+        options.maxChain = maxChain;
+        options.lazy = lazy;
+        options.dynamicHuffman = dynamicHuffman;
+        DecodeStats stats;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+          SCOPED_TRACE(testing::Message() << "input " << i << " chain " << maxChain
+                                          << " lazy " << lazy << " dynamic " << dynamicHuffman);
+          std::vector<uint8_t> packed;
+          ZlibCompress(inputs[i].data(), inputs[i].size(), options, packed);
+          std::vector<uint8_t> unpacked;
+          ASSERT_TRUE(ZlibInflate(packed.data(), packed.size(), unpacked, &stats));
+          EXPECT_EQ(unpacked, inputs[i]);
+        }
+        if (dynamicHuffman) {
+          EXPECT_GT(stats.dynamicBlocks, 0);
+        } else {
+          EXPECT_EQ(stats.dynamicBlocks, 0);
+          EXPECT_GT(stats.fixedBlocks, 0);
+        }
+      }
+    }
+  }
+}
+
+TEST(PngEncoder, PixelsRoundTripForEveryPresetAndColorType) {
+  DecodeStats stats;
+  for (const Case& c : ColorTypeCases()) {
+    for (PngPreset preset : {PngPreset::kFast, PngPreset::kBalanced, PngPreset::kSmallest}) {
+      SCOPED_TRACE(testing::Message() << c.name << " preset " << int(preset));
+      PngOptions options;
+      options.preset = preset;
+      options.reduceColorType = c.reduceColorType;
+      DecodedPng png;
+      ASSERT_TRUE(DecodePng(c.image.Encode(options), png, c.bitDepth == 8 ? &stats : nullptr));
+      EXPECT_EQ(png.colorType, c.colorType);
+      EXPECT_EQ(png.bitDepth, c.bitDepth);
+      ASSERT_EQ(png.width, c.image.width);
+      ASSERT_EQ(png.height, c.image.height);
+      EXPECT_EQ(png.rgba, c.image.Expected());
+    }
+  }
+  // Every filter was chosen somewhere, so each one's unfiltering was
+  // checked against the input
+  for (int filter = 0; filter < 5; ++filter) {
+    EXPECT_GT(stats.filters[filter], 0) << "filter " << filter;
+  }
+  EXPECT_GT(stats.dynamicBlocks, 0);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "report_decoder.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+std::vector<uint8_t> TimedReport(uint16_t x, uint16_t timeCount, uint16_t sequence) {
+  return {kPenReportDataTimeCountSequence, 0x81, 0x00, uint8_t(x >> 8), uint8_t(x), 0x00, 0x10,
+          uint8_t(timeCount >> 8), uint8_t(timeCount), uint8_t(sequence >> 8), uint8_t(sequence)};
+}
+
+}  // namespace
+
+TEST(PenReportDecoder, DecodesPlainReports) {
+  PenReportDecoder decoder(nullptr);
+  PenSample sample;
+
+  const uint8_t penData[] = {kPenReportData, 0x93, 0xFF, 0x25, 0x80, 0x17, 0x70};
+  ASSERT_EQ(decoder.Decode(penData, sizeof(penData), 1000, &sample), 1u);
+  EXPECT_EQ(sample.flags, kPenSampleProximity);
+  EXPECT_EQ(sample.sw, 1);
+  EXPECT_EQ(sample.pressure, 0x3FF);
+  EXPECT_EQ(sample.x, 9600);
+  EXPECT_EQ(sample.y, 6000);
+  EXPECT_EQ(sample.timestampUs, 1000);
+  EXPECT_EQ(sample.deviceTimeUs, 1000);
+
+  const uint8_t timed[] = {kPenReportDataTimeCountSequence, 0x00, 0x00, 0x00, 0x10, 0x00,
+                           0x20, 0x12, 0x34, 0xFF, 0xFE};
+  ASSERT_EQ(decoder.Decode(timed, sizeof(timed), 2000, &sample), 1u);
+  EXPECT_EQ(sample.flags, kPenSampleHasSequence);
+  EXPECT_EQ(sample.sw, 0);
+  EXPECT_EQ(sample.x, 16);
+  EXPECT_EQ(sample.y, 32);
+  EXPECT_EQ(sample.timeCount, 0x1234);
+  EXPECT_EQ(sample.sequence, 0xFFFE);
+
+  const uint8_t option[] = {kPenReportDataOption, 0x80, 0x40, 0, 1, 0, 2, 0xAB, 0xCD};
+  ASSERT_EQ(decoder.Decode(option, sizeof(option), 3000, &sample), 1u);
+  EXPECT_EQ(sample.pressure, 0x40);
+  EXPECT_EQ(sample.flags & kPenSampleHasSequence, 0);
+
+  // Windows hands out reports padded to the longest input report
+  uint8_t padded[16] = {kPenReportData, 0x80, 0x01, 0, 5, 0, 6};
+  ASSERT_EQ(decoder.Decode(padded, sizeof(padded), 4000, &sample), 1u);
+  EXPECT_EQ(sample.x, 5);
+}
+
+TEST(PenReportDecoder, SkipsShortEncryptedAndOtherReports) {
+  PenReportDecoder decoder(nullptr);
+  PenSample sample;
+  const auto timed = TimedReport(100, 1, 1);
+  EXPECT_EQ(decoder.Decode(timed.data(), 9, 0, &sample), 0u);
+  const uint8_t option[] = {kPenReportDataOption, 0x80, 0x40, 0, 1, 0, 2, 0xAB};
+  EXPECT_EQ(decoder.Decode(option, sizeof(option), 0, &sample), 0u);
+  uint8_t encrypted[17] = {kPenReportDataEncrypted};
+  EXPECT_EQ(decoder.Decode(encrypted, sizeof(encrypted), 0, &sample), 0u);
+  // A feature report id
+  uint8_t status[7] = {0x03};
+  EXPECT_EQ(decoder.Decode(status, sizeof(status), 0, &sample), 0u);
+  EXPECT_EQ(decoder.Decode(status, 0, 0, &sample), 0u);
+}
+
+TEST(PenReportDecoder, DecodesDecryptedReportsOfTheSession) {
+  PenReportDecoder decoder(nullptr);
+  decoder.SetSessionId(0x01020304);
+  PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+
+  const uint8_t pair[] = {kPenReportDataEncrypted, 0x01, 0x02, 0x03, 0x04,
+                          0x81, 0x00, 0x00, 0x0A, 0x00, 0x0B,
+                          0x80, 0x20, 0x00, 0x0C, 0x00, 0x0D};
+  EXPECT_TRUE(PenReportDecoder::IsEncrypted(pair, sizeof(pair)));
+  EXPECT_FALSE(PenReportDecoder::IsEncrypted(pair, 16));
+  // Still encrypted, as far as the decoder knows
+  EXPECT_EQ(decoder.Decode(pair, sizeof(pair), 0, samples), 0u);
+  ASSERT_EQ(decoder.Decode(pair, sizeof(pair), 7000, samples, true), 2u);
+  EXPECT_EQ(samples[0].pressure, 0x100);
+  EXPECT_EQ(samples[0].x, 10);
+  EXPECT_EQ(samples[0].y, 11);
+  EXPECT_EQ(samples[1].pressure, 0x20);
+  EXPECT_EQ(samples[1].x, 12);
+  EXPECT_EQ(samples[1].timestampUs, 7000);
+
+  const uint8_t timed[] = {kPenReportDataTimeCountSequenceEncrypted,
+                           0x80, 0x40, 0x00, 0x01, 0x00, 0x02, 0x00, 0x05, 0x00, 0x09,
+                           0x01, 0x02, 0x03, 0x04, 0x00, 0x00};
+  ASSERT_EQ(decoder.Decode(timed, sizeof(timed), 0, samples, true), 1u);
+  EXPECT_EQ(samples[0].timeCount, 5);
+  EXPECT_EQ(samples[0].sequence, 9);
+  EXPECT_EQ(samples[0].flags, kPenSampleProximity | kPenSampleHasSequence);
+
+  // Plain reports decode either way
+  const uint8_t plain[] = {kPenReportData, 0x80, 0x01, 0, 5, 0, 6};
+  EXPECT_FALSE(PenReportDecoder::IsEncrypted(plain, sizeof(plain)));
+  EXPECT_EQ(decoder.Decode(plain, sizeof(plain), 0, samples, true), 1u);
+
+  // Another session's reports, or ones decrypted with the wrong key
+  decoder.SetSessionId(0x01020305);
+  EXPECT_EQ(decoder.Decode(pair, sizeof(pair), 0, samples, true), 0u);
+  EXPECT_EQ(decoder.Decode(timed, sizeof(timed), 0, samples, true), 0u);
+  EXPECT_EQ(decoder.sessionMismatches(), 2u);
+}
+
+TEST(PenReportDecoder, MapsTimedReportsThroughTheClock) {
+  DeviceClockEstimator clock;
+  PenReportDecoder decoder(&clock);
+  PenSample sample;
+  for (uint16_t i = 0; i < 10; ++i) {
+    const auto report = TimedReport(100, uint16_t(i * 5), i);
+    ASSERT_EQ(decoder.Decode(report.data(), report.size(), 1'000'000 + i * 5000, &sample), 1u);
+  }
+  EXPECT_EQ(clock.stats().samples, 10u);
+  EXPECT_NEAR(double(sample.deviceTimeUs), 1'045'000.0, 1000.0);
+}
+
+TEST(PenReportDecoder, DecodesRunsOfRecordsInOnePass) {
+  std::vector<std::vector<uint8_t>> reports;
+  std::vector<ReportRecord> records;
+  for (uint16_t i = 0; i < 10; ++i) reports.push_back(TimedReport(uint16_t(100 + i), i, i));
+  // Not pen data, so no sample for it
+  reports.insert(reports.begin() + 4, std::vector<uint8_t>{0x03, 0, 0, 0, 0});
+  for (size_t i = 0; i < reports.size(); ++i) {
+    records.push_back({int64_t(i) * 5000, reports[i].data(), reports[i].size()});
+  }
+
+  PenReportDecoder decoder(nullptr);
+  PenSample samples[16];
+  size_t decoded = 0;
+  ASSERT_EQ(decoder.Decode(records.data(), records.size(), samples, 16, &decoded), 10u);
+  EXPECT_EQ(decoded, records.size());
+  for (uint16_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(samples[i].x, 100 + i);
+    EXPECT_EQ(samples[i].sequence, i);
+  }
+  EXPECT_EQ(samples[4].timestampUs, 5 * 5000);
+
+  // Out of room, it stops and says where; the last slot is too few for a
+  // report that may hold two samples
+  ASSERT_EQ(decoder.Decode(records.data(), records.size(), samples, 4, &decoded), 3u);
+  EXPECT_EQ(decoded, 3u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "report_session.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+class ReportSessionFile : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fs::temp_directory_path() /
+            ("report_session_test_" +
+             std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".stureport");
+    fs::remove(path_);
+  }
+  void TearDown() override { fs::remove(path_); }
+
+  fs::path path_;
+};
+
+ReportSessionHeader Header() {
+  ReportSessionHeader header;
+  header.productId = 0xA8;
+  header.tabletMaxX = 9600;
+  header.tabletMaxY = 6000;
+  header.tabletMaxPressure = 1023;
+  header.screenWidth = 800;
+  header.screenHeight = 480;
+  header.startUs = 5'000'000'000;
+  return header;
+}
+
+// A pen report's shape: id, then a few bytes that vary per report
+std::vector<uint8_t> Report(int i) {
+  return {0x34, uint8_t(0x80 | (i & 0x0F)), uint8_t(i), uint8_t(i >> 8), 0x12, 0x34, 0x00,
+          0x56, uint8_t(i * 5), uint8_t(i * 7), uint8_t(i)};
+}
+
+}  // namespace
+
+TEST_F(ReportSessionFile, RoundTripsReportsAndTimes) {
+  ReportSessionWriter writer;
+  ASSERT_TRUE(writer.Open(path_.u8string(), Header()));
+  // Past the writer's buffer, so it flushes along the way
+  const int count = 20000;
+  for (int i = 0; i < count; ++i) {
+    const auto report = Report(i);
+    writer.Append(Header().startUs + 1000 + i * 5000, report.data(), report.size());
+  }
+  // Out of order times are clamped, not stored negative
+  const uint8_t late[] = {0x01, 0x02};
+  writer.Append(Header().startUs, late, sizeof(late));
+  EXPECT_EQ(writer.reports(), uint64_t(count + 1));
+  ASSERT_TRUE(writer.Close());
+  EXPECT_EQ(writer.bytes(), uint64_t(fs::file_size(path_)));
+  // About a dozen bytes a report
+  EXPECT_LT(writer.bytes(), uint64_t(count) * 15);
+
+  ReportSession session;
+  ASSERT_TRUE(session.Load(path_.u8string()));
+  EXPECT_EQ(session.header().productId, 0xA8);
+  EXPECT_EQ(session.header().tabletMaxPressure, 1023);
+  EXPECT_EQ(session.header().screenHeight, 480);
+  EXPECT_EQ(session.header().startUs, Header().startUs);
+  ASSERT_EQ(session.size(), size_t(count + 1));
+  for (int i = 0; i < count; ++i) {
+    const auto report = Report(i);
+    ASSERT_EQ(session[i].hostUs, Header().startUs + 1000 + i * 5000) << i;
+    ASSERT_EQ(std::vector<uint8_t>(session[i].data, session[i].data + session[i].size), report)
+        << i;
+  }
+  EXPECT_EQ(session[count].hostUs, session[count - 1].hostUs);
+  EXPECT_EQ(session[count].size, 2u);
+}
+
+TEST_F(ReportSessionFile, TruncatedSessionKeepsWholeRecords) {
+  {
+    ReportSessionWriter writer;
+    ASSERT_TRUE(writer.Open(path_.u8string(), Header()));
+    for (int i = 0; i < 10; ++i) {
+      const auto report = Report(i);
+      writer.Append(Header().startUs + i * 5000, report.data(), report.size());
+    }
+  }
+  fs::resize_file(path_, fs::file_size(path_) - 3);
+
+  ReportSession session;
+  ASSERT_TRUE(session.Load(path_.u8string()));
+  EXPECT_EQ(session.size(), 9u);
+
+  EXPECT_FALSE(session.Parse({'S', 'T', 'U', 'S', 'C', 'R', 'N', '1'}));
+  EXPECT_EQ(session.size(), 0u);
+  EXPECT_FALSE(ReportSession().Load((path_.parent_path() / "missing.stureport").u8string()));
+}
+
+TEST(ReportReplay, FastReplayIsDeterministic) {
+  ReportSessionWriter writer;
+  const fs::path path = fs::temp_directory_path() / "report_replay_fast.stureport";
+  ASSERT_TRUE(writer.Open(path.u8string(), Header()));
+  for (int i = 0; i < 100; ++i) {
+    const auto report = Report(i);
+    // An hour apart; fast replay must not wait
+    writer.Append(Header().startUs + int64_t(i) * 3'600'000'000, report.data(), report.size());
+  }
+  ASSERT_TRUE(writer.Close());
+  ReportSession session;
+  ASSERT_TRUE(session.Load(path.u8string()));
+  fs::remove(path);
+
+  for (int run = 0; run < 2; ++run) {
+    ReportReplay replay(session, {false, 1.0, -Header().startUs});
+    ReportRecord record;
+    int i = 0;
+    while (replay.Next(record)) {
+      EXPECT_EQ(record.hostUs, int64_t(i) * 3'600'000'000);
+      EXPECT_EQ(record.data, session[i].data);
+      ++i;
+    }
+    EXPECT_EQ(i, 100);
+  }
+}
+
+TEST(ReportReplay, RealTimeKeepsSpacingAndCancels) {
+  std::vector<uint8_t> bytes;
+  {
+    const fs::path path = fs::temp_directory_path() / "report_replay_real_time.stureport";
+    ReportSessionWriter writer;
+    ASSERT_TRUE(writer.Open(path.u8string(), Header()));
+    for (int i = 0; i < 5; ++i) {
+      const auto report = Report(i);
+      writer.Append(Header().startUs + i * 40'000, report.data(), report.size());
+    }
+    // Far in the future; only Cancel ends the wait for it
+    const auto report = Report(5);
+    writer.Append(Header().startUs + 3'600'000'000, report.data(), report.size());
+    ASSERT_TRUE(writer.Close());
+    std::ifstream file(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    fs::remove(path);
+  }
+  ReportSession session;
+  ASSERT_TRUE(session.Parse(bytes));
+
+  // Twice as fast: 20 ms apart
+  ReportReplay replay(session, {true, 2.0, 0});
+  ReportRecord record;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(replay.Next(record));
+    EXPECT_EQ(record.hostUs, Header().startUs + i * 40'000);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(80));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(2000));
+
+  std::thread canceller([&replay] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    replay.Cancel();
+  });
+  EXPECT_FALSE(replay.Next(record));
+  canceller.join();
+  EXPECT_FALSE(replay.Next(record));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
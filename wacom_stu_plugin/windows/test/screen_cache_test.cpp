@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "screen_cache.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+class ScreenCacheDisk : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = fs::temp_directory_path() /
+           ("screen_cache_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) +
+            "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(dir_);
+  }
+  void TearDown() override { fs::remove_all(dir_); }
+
+  fs::path dir_;
+};
+
+}  // namespace
+
+TEST(ScreenCache, HashAndDigestSeeEveryInput) {
+  std::vector<uint8_t> pixels(800 * 480 * 4 + 3, 0x7F);
+  const uint64_t base = HashScreenBytes(pixels.data(), pixels.size());
+  EXPECT_EQ(HashScreenBytes(pixels.data(), pixels.size()), base);
+  for (size_t at : {size_t(0), size_t(31), pixels.size() / 2, pixels.size() - 1}) {
+    pixels[at] ^= 1;
+    EXPECT_NE(HashScreenBytes(pixels.data(), pixels.size()), base) << at;
+    pixels[at] ^= 1;
+  }
+
+  ScreenCacheKey key;
+  key.pixels = base;
+  key.model = 0xA5;
+  key.mode = 2;
+  const uint64_t digest = key.Digest();
+  key.mode = 1;
+  EXPECT_NE(key.Digest(), digest);
+  key.mode = 2;
+  key.model = 0xA6;
+  EXPECT_NE(key.Digest(), digest);
+}
+
+TEST(ScreenCache, EvictsLeastRecentlyUsed) {
+  ScreenCache cache(300);
+  cache.Store(1, std::vector<uint8_t>(100, 1));
+  cache.Store(2, std::vector<uint8_t>(100, 2));
+  cache.Store(3, std::vector<uint8_t>(100, 3));
+  ASSERT_NE(cache.Find(1), nullptr);  // 2 is now the oldest
+  cache.Store(4, std::vector<uint8_t>(100, 4));
+
+  EXPECT_EQ(cache.Find(2), nullptr);
+  ASSERT_NE(cache.Find(1), nullptr);
+  EXPECT_EQ(*cache.Find(4), std::vector<uint8_t>(100, 4));
+  EXPECT_EQ(cache.stats().entries, 3u);
+  EXPECT_EQ(cache.stats().bytes, 300u);
+
+  // Larger than the whole budget: not kept
+  cache.Store(5, std::vector<uint8_t>(301, 5));
+  EXPECT_EQ(cache.Find(5), nullptr);
+}
+
+TEST_F(ScreenCacheDisk, IsWarmAfterReopening) {
+  {
+    ScreenCache cache;
+    ASSERT_TRUE(cache.Open(dir_.u8string()));
+    cache.Store(0xABCDEF, {1, 2, 3});
+    cache.Store(42, {4, 5});
+  }
+  ScreenCache cache;
+  ASSERT_TRUE(cache.Open(dir_.u8string()));
+  EXPECT_EQ(cache.stats().entries, 2u);
+  ASSERT_NE(cache.Find(0xABCDEF), nullptr);
+  EXPECT_EQ(*cache.Find(0xABCDEF), (std::vector<uint8_t>{1, 2, 3}));
+  EXPECT_EQ(cache.stats().diskHits, 0u);
+}
+
+TEST_F(ScreenCacheDisk, LoadsFromDiskPastMemoryBudget) {
+  {
+    ScreenCache cache;
+    ASSERT_TRUE(cache.Open(dir_.u8string()));
+    cache.Store(1, std::vector<uint8_t>(100, 1));
+  }
+  ScreenCache cache(50);
+  ASSERT_TRUE(cache.Open(dir_.u8string()));
+  EXPECT_EQ(cache.stats().entries, 0u);
+  EXPECT_EQ(cache.Find(1), nullptr);  // too big to keep in memory, but read
+  EXPECT_EQ(cache.stats().diskHits, 1u);
+}
+
+TEST_F(ScreenCacheDisk, DropsCorruptFiles) {
+  {
+    ScreenCache cache;
+    ASSERT_TRUE(cache.Open(dir_.u8string()));
+    cache.Store(7, std::vector<uint8_t>(64, 7));
+  }
+  const fs::path file = dir_ / "0000000000000007.screen";
+  ASSERT_TRUE(fs::exists(file));
+  {
+    std::fstream f(file, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(40);
+    f.put(0);
+  }
+  ScreenCache cache;
+  ASSERT_TRUE(cache.Open(dir_.u8string()));
+  EXPECT_EQ(cache.Find(7), nullptr);
+  EXPECT_FALSE(fs::exists(file));
+}
+
+TEST_F(ScreenCacheDisk, BoundsDiskUsage) {
+  ScreenCache cache(1 << 20, 2 * (24 + 100));
+  ASSERT_TRUE(cache.Open(dir_.u8string()));
+  for (uint64_t key = 1; key <= 3; ++key) cache.Store(key, std::vector<uint8_t>(100, uint8_t(key)));
+  EXPECT_FALSE(fs::exists(dir_ / "0000000000000001.screen"));
+  EXPECT_TRUE(fs::exists(dir_ / "0000000000000003.screen"));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "screen_frame_encoder.h"
+#include "screen_image.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+constexpr int kWidth = 40;
+constexpr int kHeight = 20;
+
+ScreenFrameEncoder::Frame FrameOf(const std::vector<uint8_t>& pixels) {
+  ScreenFrameEncoder::Frame frame;
+  frame.pixels = pixels.data();
+  frame.size = pixels.size();
+  frame.format = ScreenPixelFormat::kBgr24;
+  frame.model = 0xA8;
+  frame.width = kWidth;
+  frame.height = kHeight;
+  return frame;
+}
+
+}  // namespace
+
+TEST(ScreenFrameEncoder, EncodesOnceThenServesTheCache) {
+  std::vector<uint8_t> pixels(kWidth * kHeight * 3);
+  for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = uint8_t(i * 13);
+  const auto frame = FrameOf(pixels);
+
+  ScreenFrameEncoder encoder;
+  std::vector<uint8_t> first, second, expected;
+  bool cached = true;
+  ASSERT_TRUE(encoder.Encode(frame, (int)ScreenEncoding::k16Bit, first, cached));
+  EXPECT_FALSE(cached);
+  ASSERT_TRUE(encoder.Encode(frame, (int)ScreenEncoding::k16Bit, second, cached));
+  EXPECT_TRUE(cached);
+  ASSERT_TRUE(EncodeScreen(pixels.data(), frame.format, kWidth, kHeight, ScreenEncoding::k16Bit,
+                           frame.dither, expected));
+  EXPECT_EQ(first, expected);
+  EXPECT_EQ(second, expected);
+
+  // Another mode is another entry
+  ASSERT_TRUE(encoder.Encode(frame, (int)ScreenEncoding::k1Bit, second, cached));
+  EXPECT_FALSE(cached);
+  const auto stats = encoder.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.entries, 2u);
+}
+
+TEST(ScreenFrameEncoder, ResolvesAutoAndRefusesUnknownModes) {
+  const std::vector<uint8_t> white(kWidth * kHeight * 3, 0xFF);
+  const auto frame = FrameOf(white);
+  ScreenCapabilities caps;
+  caps.zlib = true;
+  caps.color16 = true;
+  EXPECT_EQ(ScreenFrameEncoder::ResolveMode(-1, caps, frame), (int)ScreenEncoding::k1BitZlib);
+  EXPECT_EQ(ScreenFrameEncoder::ResolveMode(2, caps, frame), 2);
+
+  ScreenFrameEncoder encoder;
+  std::vector<uint8_t> out;
+  bool cached = false;
+  EXPECT_FALSE(encoder.Encode(frame, 7, out, cached));
+  EXPECT_EQ(encoder.stats().entries, 0u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
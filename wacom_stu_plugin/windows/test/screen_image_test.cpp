@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "screen_image.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+TEST(ScreenImage, SwizzlesRgbaAndBgraToBgr) {
+  const uint8_t rgba[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t bgr[6];
+
+  SwizzleToBgr24(rgba, ScreenPixelFormat::kRgba8888, 2, bgr, SwizzleKernel::kScalar);
+  EXPECT_EQ(std::vector<uint8_t>(bgr, bgr + 6), (std::vector<uint8_t>{3, 2, 1, 7, 6, 5}));
+
+  SwizzleToBgr24(rgba, ScreenPixelFormat::kBgra8888, 2, bgr, SwizzleKernel::kScalar);
+  EXPECT_EQ(std::vector<uint8_t>(bgr, bgr + 6), (std::vector<uint8_t>{1, 2, 3, 5, 6, 7}));
+}
+
+// SIMD kernels against the scalar one, across every tail length and with an
+// unaligned source. Kernels the CPU lacks fall back, so this runs anywhere.
+TEST(ScreenImage, KernelsMatchScalar) {
+  for (ScreenPixelFormat format : {ScreenPixelFormat::kRgba8888, ScreenPixelFormat::kBgra8888}) {
+    for (size_t count = 0; count < 100; ++count) {
+      std::vector<uint8_t> src(count * 4 + 1);
+      for (size_t i = 0; i < src.size(); ++i) src[i] = uint8_t(i * 37 + count);
+
+      std::vector<uint8_t> expected(count * 3 + 4, 0xEE);
+      SwizzleToBgr24(src.data() + 1, format, count, expected.data(), SwizzleKernel::kScalar);
+
+      for (SwizzleKernel kernel : {SwizzleKernel::kSsse3, SwizzleKernel::kAvx2, SwizzleKernel::kAuto}) {
+        std::vector<uint8_t> actual(count * 3 + 4, 0xEE);
+        SwizzleToBgr24(src.data() + 1, format, count, actual.data(), kernel);
+        EXPECT_EQ(actual, expected) << SwizzleKernelName(kernel) << " count " << count;
+      }
+    }
+  }
+}
+
+TEST(ScreenImage, Rgb565IsLittleEndian) {
+  const uint8_t rgba[] = {255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 255};
+  std::vector<uint8_t> out;
+  EncodeRgb565(rgba, ScreenPixelFormat::kRgba8888, 4, 1, ScreenDither::kNone, out);
+  EXPECT_EQ(out, (std::vector<uint8_t>{0x00, 0xF8, 0xE0, 0x07, 0x1F, 0x00, 0xFF, 0xFF}));
+
+  // Flat colours stay flat whatever the dither
+  for (ScreenDither dither : {ScreenDither::kOrdered, ScreenDither::kDiffusion}) {
+    EncodeRgb565(rgba, ScreenPixelFormat::kRgba8888, 4, 1, dither, out);
+    EXPECT_EQ(out, (std::vector<uint8_t>{0x00, 0xF8, 0xE0, 0x07, 0x1F, 0x00, 0xFF, 0xFF}));
+  }
+}
+
+// Packed bits against a per-pixel reference, across widths that exercise
+// the 16-pixel kernel, its tail and row padding
+TEST(ScreenImage, MonoPacksMsbFirstWithPaddedRows) {
+  for (int width = 1; width < 50; ++width) {
+    const int height = 3;
+    std::vector<uint8_t> bgr(size_t(width) * height * 3);
+    for (size_t i = 0; i < bgr.size(); i += 3) {
+      const uint8_t v = (i / 3) % 3 == 0 ? 255 : 0;
+      bgr[i] = bgr[i + 1] = bgr[i + 2] = v;
+    }
+    const size_t rowBytes = (width + 7) / 8;
+    std::vector<uint8_t> expected(rowBytes * height, 0);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if ((size_t(y) * width + x) % 3 == 0) {
+          expected[rowBytes * y + x / 8] |= uint8_t(0x80 >> (x % 8));
+        }
+      }
+    }
+    for (ScreenDither dither :
+         {ScreenDither::kNone, ScreenDither::kOrdered, ScreenDither::kDiffusion}) {
+      std::vector<uint8_t> out;
+      EncodeMono(bgr.data(), ScreenPixelFormat::kBgr24, width, height, dither, out);
+      EXPECT_EQ(out, expected) << "width " << width;
+    }
+  }
+}
+
+// A flat mid grey should come out about half white with either dither
+TEST(ScreenImage, MonoDitherKeepsAverageLevel) {
+  const int width = 64, height = 64;
+  std::vector<uint8_t> bgra(size_t(width) * height * 4, 128);
+  for (ScreenDither dither : {ScreenDither::kOrdered, ScreenDither::kDiffusion}) {
+    std::vector<uint8_t> out;
+    EncodeMono(bgra.data(), ScreenPixelFormat::kBgra8888, width, height, dither, out);
+    int white = 0;
+    for (uint8_t b : out) {
+      for (int bit = 0; bit < 8; ++bit) white += (b >> bit) & 1;
+    }
+    EXPECT_NEAR(white, width * height / 2, width * height / 16);
+  }
+}
+
+TEST(ScreenImage, ChoosesCheapestSupportedEncoding) {
+  ScreenCapabilities mono;
+  EXPECT_EQ(ChooseScreenEncoding(mono, false), ScreenEncoding::k1Bit);
+  mono.zlib = true;
+  EXPECT_EQ(ChooseScreenEncoding(mono, false), ScreenEncoding::k1BitZlib);
+
+  ScreenCapabilities colour;
+  colour.color16 = colour.color24 = true;
+  EXPECT_EQ(ChooseScreenEncoding(colour, false), ScreenEncoding::k16Bit);
+  EXPECT_EQ(ChooseScreenEncoding(colour, true), ScreenEncoding::k1Bit);
+  colour.color16 = false;
+  EXPECT_EQ(ChooseScreenEncoding(colour, false), ScreenEncoding::k24Bit);
+
+  const uint8_t bw[] = {0, 0, 0, 9, 255, 255, 255, 9};
+  const uint8_t grey[] = {0, 0, 0, 9, 128, 128, 128, 9};
+  EXPECT_TRUE(IsBlackAndWhite(bw, ScreenPixelFormat::kRgba8888, 2));
+  EXPECT_FALSE(IsBlackAndWhite(grey, ScreenPixelFormat::kRgba8888, 2));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
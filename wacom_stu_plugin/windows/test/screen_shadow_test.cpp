@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "screen_shadow.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+constexpr int kWidth = 100;
+constexpr int kHeight = 50;
+constexpr int kBpp = 4;
+
+std::vector<uint8_t> Frame(uint8_t value) {
+  return std::vector<uint8_t>(size_t(kWidth) * kHeight * kBpp, value);
+}
+
+void Poke(std::vector<uint8_t>& frame, int x, int y) {
+  frame[(size_t(y) * kWidth + x) * kBpp + 1] ^= 0xFF;
+}
+
+}  // namespace
+
+TEST(ScreenShadow, FirstFrameAndTagChangeAreFull) {
+  ScreenShadow shadow;
+  const auto frame = Frame(255);
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 1),
+            (std::vector<ScreenRect>{{0, 0, kWidth, kHeight}}));
+  EXPECT_TRUE(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 1).empty());
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 2).size(), 1u);
+
+  shadow.Reset();
+  EXPECT_FALSE(shadow.valid());
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 2),
+            (std::vector<ScreenRect>{{0, 0, kWidth, kHeight}}));
+}
+
+// Changes snap to 16-pixel tiles, clipped at the frame edge, and tiles in
+// one column merge downwards
+TEST(ScreenShadow, ReportsTileAlignedRects) {
+  ScreenShadow shadow;
+  auto frame = Frame(255);
+  shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0);
+
+  Poke(frame, 20, 3);
+  Poke(frame, 21, 20);
+  Poke(frame, 99, 49);
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0),
+            (std::vector<ScreenRect>{{16, 0, 16, 32}, {96, 48, 4, 2}}));
+
+  // The shadow took the new frame
+  EXPECT_TRUE(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0).empty());
+}
+
+TEST(ScreenShadow, CollapsesManyRectsToBoundingBox) {
+  ScreenShadow shadow;
+  auto frame = Frame(0);
+  shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0);
+  for (int x = 0; x < kWidth; x += 32) {
+    for (int y = 0; y < kHeight; y += 32) Poke(frame, x, y);
+  }
+  Poke(frame, 50, 20);
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0),
+            (std::vector<ScreenRect>{{0, 0, kWidth, 48}}));
+}
+
+// Ink the pad drew itself is resent even though the frame did not change
+TEST(ScreenShadow, InvalidatedAreaIsResent) {
+  ScreenShadow shadow;
+  const auto frame = Frame(255);
+  shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0);
+
+  shadow.Invalidate(ScreenRect{20, 10, 30, 8});
+  EXPECT_EQ(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0),
+            (std::vector<ScreenRect>{{16, 0, 48, 32}}));
+  EXPECT_TRUE(shadow.Update(frame.data(), kWidth, kHeight, kBpp, 0).empty());
+}
+
+TEST(ScreenShadow, KeepsLastFrameForRestore) {
+  ScreenShadow shadow;
+  auto frame = Frame(255);
+  shadow.Update(frame.data(), kWidth, kHeight, kBpp, 7);
+  Poke(frame, 40, 20);
+  shadow.Update(frame.data(), kWidth, kHeight, kBpp, 7);
+  EXPECT_EQ(shadow.pixels(), frame);
+  EXPECT_EQ(shadow.bytesPerPixel(), kBpp);
+  EXPECT_EQ(shadow.tag(), 7u);
+}
+
+TEST(ScreenShadow, CopiesRect) {
+  std::vector<uint8_t> frame(size_t(kWidth) * kHeight * 3);
+  for (size_t i = 0; i < frame.size(); ++i) frame[i] = uint8_t(i);
+  std::vector<uint8_t> out;
+  CopyScreenRect(frame.data(), kWidth, 3, ScreenRect{2, 1, 2, 2}, out);
+  const size_t row = kWidth * 3;
+  EXPECT_EQ(out, (std::vector<uint8_t>{
+                     uint8_t(row + 6), uint8_t(row + 7), uint8_t(row + 8), uint8_t(row + 9),
+                     uint8_t(row + 10), uint8_t(row + 11), uint8_t(2 * row + 6),
+                     uint8_t(2 * row + 7), uint8_t(2 * row + 8), uint8_t(2 * row + 9),
+                     uint8_t(2 * row + 10), uint8_t(2 * row + 11)}));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "pen_sample.h"
+#include "sequence_gap_filler.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+// A touching pen every 5 ms, as the pad reports at 200 Hz
+PenSample Timed(uint16_t sequence, uint16_t x, uint16_t pressure = 300) {
+  PenSample s;
+  s.x = x;
+  s.y = 1000;
+  s.pressure = pressure;
+  s.sw = pressure ? 1 : 0;
+  s.sequence = sequence;
+  s.timeCount = uint16_t(sequence * 5);
+  s.timestampUs = 100000 + int64_t(sequence) * 5000;
+  s.deviceTimeUs = 99000 + int64_t(sequence) * 5000;
+  s.flags = kPenSampleHasSequence | kPenSampleProximity;
+  return s;
+}
+
+std::vector<PenSample> Fill(SequenceGapFiller& filler, const std::vector<PenSample>& input) {
+  std::vector<PenSample> output;
+  PenSample buffer[SequenceGapFiller::kMaxOutput];
+  for (const PenSample& s : input) {
+    const size_t n = filler.Process(s, buffer);
+    output.insert(output.end(), buffer, buffer + n);
+  }
+  return output;
+}
+
+}  // namespace
+
+TEST(SequenceGapFiller, FillsAShortGapOnTheDeviceClock) {
+  SequenceGapFiller filler;
+  // Reports 11 to 13 lost
+  const auto out = Fill(filler, {Timed(9, 100), Timed(10, 200), Timed(14, 600)});
+  ASSERT_EQ(out.size(), 6u);
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_EQ(out[i].sequence, 9 + i);
+    EXPECT_EQ(out[i].timeCount, (9 + i) * 5);
+    EXPECT_EQ(out[i].timestampUs, Timed(uint16_t(9 + i), 0).timestampUs);
+    EXPECT_EQ(out[i].deviceTimeUs, Timed(uint16_t(9 + i), 0).deviceTimeUs);
+    EXPECT_EQ(bool(out[i].flags & kPenSampleSynthetic), i >= 2 && i <= 4) << i;
+  }
+  EXPECT_EQ(out[2].x, 300);
+  EXPECT_EQ(out[3].x, 400);
+  EXPECT_EQ(out[4].x, 500);
+
+  const auto stats = filler.stats();
+  EXPECT_EQ(stats.gaps, 1u);
+  EXPECT_EQ(stats.missing, 3u);
+  EXPECT_EQ(stats.filled, 3u);
+  EXPECT_EQ(stats.largestGap, 3u);
+}
+
+TEST(SequenceGapFiller, CountsGapsItCannotFill) {
+  SequenceGapFiller filler;
+  std::vector<PenSample> input{Timed(0, 100)};
+  // Too long to fill
+  input.push_back(Timed(SequenceGapFiller::kMaxFill + 2, 200));
+  // Pen lifted across the gap
+  input.push_back(Timed(SequenceGapFiller::kMaxFill + 4, 200, 0));
+  // The device clock stood still
+  PenSample stalled = Timed(SequenceGapFiller::kMaxFill + 6, 200, 0);
+  stalled.timeCount = input.back().timeCount;
+  input.push_back(stalled);
+  const auto out = Fill(filler, input);
+  ASSERT_EQ(out.size(), input.size());
+  for (const PenSample& s : out) EXPECT_FALSE(s.flags & kPenSampleSynthetic);
+
+  const auto stats = filler.stats();
+  EXPECT_EQ(stats.gaps, 3u);
+  EXPECT_EQ(stats.missing, SequenceGapFiller::kMaxFill + 1 + 1 + 1);
+  EXPECT_EQ(stats.filled, 0u);
+  EXPECT_EQ(stats.largestGap, SequenceGapFiller::kMaxFill + 1);
+}
+
+TEST(SequenceGapFiller, FollowsTheSequenceThroughWrapsAndRestarts) {
+  SequenceGapFiller filler;
+  // Across the 16-bit wrap, 0 lost
+  const auto wrapped = Fill(filler, {Timed(0xFFFF, 100), Timed(1, 300)});
+  ASSERT_EQ(wrapped.size(), 3u);
+  EXPECT_EQ(wrapped[1].sequence, 0);
+  EXPECT_EQ(wrapped[1].x, 200);
+
+  // The pad starting over, a repeat, and samples without a sequence are
+  // no gaps
+  PenSample plain;
+  plain.flags = kPenSampleProximity;
+  EXPECT_EQ(Fill(filler, {Timed(0, 100), Timed(0, 100), plain, Timed(1, 100)}).size(), 4u);
+  EXPECT_EQ(filler.stats().gaps, 1u);
+
+  // Nor is the first sample after a reset
+  filler.Reset();
+  EXPECT_EQ(Fill(filler, {Timed(40, 100)}).size(), 1u);
+  EXPECT_EQ(filler.stats().gaps, 1u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "session_key_exchange.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+using Key = SessionKeyExchange::Key;
+
+Key Small(uint64_t value) {
+  Key key{};
+  for (int i = 15; i >= 8; --i, value >>= 8) key[i] = uint8_t(value);
+  return key;
+}
+
+}  // namespace
+
+TEST(SessionKeyExchange, PowModMatchesKnownValues) {
+  EXPECT_EQ(SessionKeyExchange::PowMod(Small(4), Small(13), Small(497)), Small(445));
+  EXPECT_EQ(SessionKeyExchange::PowMod(Small(2), Small(0), Small(497)), Small(1));
+  // Fermat: a^(p-1) = 1 for the default prime
+  Key exponent = SessionKeyExchange::kDefaultPrime;
+  exponent[15] -= 1;
+  EXPECT_EQ(SessionKeyExchange::PowMod(Small(12345), exponent, SessionKeyExchange::kDefaultPrime),
+            Small(1));
+  // Near the top of the range, where sums carry out of 128 bits
+  Key large = SessionKeyExchange::kDefaultPrime;
+  large[15] -= 2;
+  EXPECT_EQ(SessionKeyExchange::PowMod(large, Small(2), SessionKeyExchange::kDefaultPrime),
+            Small(4));
+}
+
+TEST(SessionKeyExchange, BothSidesReachTheSameKey) {
+  SessionKeyExchange host;
+  SessionKeyExchange pad;
+  const Key hostPublic = host.GeneratePublicKey();
+  const Key padPublic = pad.GeneratePublicKey();
+  EXPECT_NE(hostPublic, padPublic);
+
+  Key hostKey{}, padKey{};
+  ASSERT_TRUE(host.ComputeSessionKey(padPublic, hostKey));
+  ASSERT_TRUE(pad.ComputeSessionKey(hostPublic, padKey));
+  EXPECT_EQ(hostKey, padKey);
+
+  // A fresh exchange gives a fresh key
+  Key again{};
+  host.GeneratePublicKey();
+  ASSERT_TRUE(host.ComputeSessionKey(padPublic, again));
+  EXPECT_NE(again, hostKey);
+}
+
+TEST(SessionKeyExchange, RejectsWeakParametersAndKeys) {
+  SessionKeyExchange exchange;
+  EXPECT_FALSE(exchange.SetParameters(Small(497), 2));
+  Key even = SessionKeyExchange::kDefaultPrime;
+  even[15] &= 0xFE;
+  EXPECT_FALSE(exchange.SetParameters(even, 2));
+  EXPECT_FALSE(exchange.SetParameters(SessionKeyExchange::kDefaultPrime, 1));
+  EXPECT_TRUE(exchange.SetParameters(SessionKeyExchange::kDefaultPrime, 5));
+  EXPECT_EQ(exchange.base(), 5);
+
+  exchange.GeneratePublicKey();
+  Key key{};
+  EXPECT_FALSE(exchange.ComputeSessionKey(Small(1), key));
+  Key last = SessionKeyExchange::kDefaultPrime;
+  last[15] -= 1;
+  EXPECT_FALSE(exchange.ComputeSessionKey(last, key));
+  EXPECT_TRUE(exchange.ComputeSessionKey(Small(3), key));
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
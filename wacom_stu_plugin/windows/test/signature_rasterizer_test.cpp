@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "ink_store.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+#include "signature_rasterizer.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+uint8_t Alpha(const std::vector<uint8_t>& rgba, const RasterOptions& options, int x, int y) {
+  return rgba[(size_t(y) * options.width + x) * 4 + 3];
+}
+
+// Rows of column |x| with any ink
+int InkedRows(const std::vector<uint8_t>& rgba, const RasterOptions& options, int x) {
+  int rows = 0;
+  for (int y = 0; y < options.height; ++y) rows += Alpha(rgba, options, x, y) != 0;
+  return rows;
+}
+
+}  // namespace
+
+TEST(SignatureRasterizer, CoverageFallsOffWithDistance) {
+  const std::vector<InkPoint> stroke = {{10, 20, 500}, {50, 20, 500}};
+  RasterOptions options;
+  options.width = 64;
+  options.height = 40;
+  options.minRadius = 1.25f;
+  options.maxRadius = 1.25f;
+  options.color = 0xFF2563EB;
+  const auto rgba = RasterizeStrokes({&stroke}, options);
+
+  // Pixel centres 0.5 and 1.5 from the line, against a radius of 1.25 and
+  // half a pixel of anti-aliasing
+  EXPECT_EQ(Alpha(rgba, options, 30, 17), 0);
+  EXPECT_EQ(Alpha(rgba, options, 30, 18), 64);
+  EXPECT_EQ(Alpha(rgba, options, 30, 19), 255);
+  EXPECT_EQ(Alpha(rgba, options, 30, 20), 255);
+  EXPECT_EQ(Alpha(rgba, options, 30, 21), 64);
+  EXPECT_EQ(Alpha(rgba, options, 30, 22), 0);
+  const uint8_t* px = &rgba[(size_t(19) * options.width + 30) * 4];
+  EXPECT_EQ(px[0], 0x25);
+  EXPECT_EQ(px[1], 0x63);
+  EXPECT_EQ(px[2], 0xEB);
+
+  // Round caps reach past the end points by the radius, and no further
+  EXPECT_NE(Alpha(rgba, options, 9, 19), 0);
+  EXPECT_NE(Alpha(rgba, options, 50, 19), 0);
+  EXPECT_EQ(Alpha(rgba, options, 7, 19), 0);
+  EXPECT_EQ(Alpha(rgba, options, 52, 19), 0);
+  EXPECT_EQ(Alpha(rgba, options, 30, 5), 0);
+}
+
+TEST(SignatureRasterizer, WidthFollowsPressure) {
+  // Tablet units at twice the output resolution
+  const std::vector<InkPoint> light = {{20, 40, 0}, {100, 40, 0}};
+  const std::vector<InkPoint> medium = {{20, 80, 500}, {100, 80, 500}};
+  const std::vector<InkPoint> firm = {{20, 120, 1000}, {100, 120, 1000}};
+  RasterOptions options;
+  options.width = 64;
+  options.height = 80;
+  options.scaleX = 0.5;
+  options.scaleY = 0.5;
+  options.minRadius = 0.5f;
+  options.maxRadius = 2.5f;
+  options.maxPressure = 1000;
+
+  // Radius 0.5, 1.5 and 2.5: inked rows run to half a pixel past the
+  // radius, and the outermost ones are half covered
+  struct Expected {
+    const std::vector<InkPoint>* stroke;
+    int rows;
+    uint8_t centre;
+  };
+  for (const Expected& e : {Expected{&light, 2, 128}, Expected{&medium, 4, 255},
+                            Expected{&firm, 6, 255}}) {
+    const auto rgba = RasterizeStrokes({e.stroke}, options);
+    const int y = (*e.stroke)[0].y / 2;
+    EXPECT_EQ(InkedRows(rgba, options, 30), e.rows);
+    EXPECT_EQ(Alpha(rgba, options, 30, y - 1), e.centre);
+    EXPECT_EQ(Alpha(rgba, options, 30, y), e.centre);
+    EXPECT_EQ(Alpha(rgba, options, 30, y - e.rows / 2), 128);
+    EXPECT_EQ(Alpha(rgba, options, 30, y + e.rows / 2 - 1), 128);
+  }
+}
+
+TEST(SignatureRasterizer, SinglePointIsADotInTheInkAlpha) {
+  const std::vector<InkPoint> dot = {{16, 16, 1023}};
+  RasterOptions options;
+  options.width = 32;
+  options.height = 32;
+  options.color = 0x80000000;
+  const auto rgba = RasterizeStrokes({&dot, nullptr}, options);
+
+  EXPECT_EQ(Alpha(rgba, options, 16, 16), 128);
+  EXPECT_EQ(Alpha(rgba, options, 15, 15), 128);
+  EXPECT_EQ(Alpha(rgba, options, 19, 16), 0);
+  EXPECT_EQ(InkedRows(rgba, options, 10), 0);
+}
+
+TEST(SignatureRasterizer, RenderedSignatureDecodesToTheSamePixels) {
+  // What renderSignature hands back: a rasterized signature as PNG
+  std::vector<InkPoint> stroke;
+  for (int i = 0; i <= 200; ++i) {
+    stroke.push_back({uint16_t(40 + i * 8),
+                      uint16_t(300 + 150 * std::sin(i * 0.1)),
+                      uint16_t(200 + (i * 7) % 800)});
+  }
+  RasterOptions options;
+  options.width = 420;
+  options.height = 160;
+  options.scaleX = 0.25;
+  options.scaleY = 0.25;
+  options.color = 0xFF1E3A8A;
+  const auto rgba = RasterizeStrokes({&stroke}, options);
+
+  DecodedPng png;
+  ASSERT_TRUE(DecodePng(EncodePng(rgba.data(), options.width, options.height,
+                                  size_t(options.width) * 4),
+                        png));
+  ASSERT_EQ(png.width, options.width);
+  ASSERT_EQ(png.height, options.height);
+  // One ink colour over transparency: a palette
+  EXPECT_EQ(png.colorType, 3);
+  // Pixels the rasterizer left at alpha 0 come back as transparent black
+  auto expected = rgba;
+  for (size_t i = 0; i < expected.size(); i += 4) {
+    if (expected[i + 3] == 0) expected[i] = expected[i + 1] = expected[i + 2] = 0;
+  }
+  EXPECT_EQ(png.rgba, expected);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
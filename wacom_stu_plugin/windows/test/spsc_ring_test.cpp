@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include "pen_sample.h"
+#include "spsc_ring.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+TEST(SpscRing, PushDrainPreservesOrder) {
+  auto ring = std::make_unique<SpscRing<PenSample, 8>>();
+  for (uint16_t i = 0; i < 5; ++i) {
+    PenSample s;
+    s.x = i;
+    EXPECT_TRUE(ring->TryPush(s));
+  }
+
+  uint16_t expected = 0;
+  const size_t drained = ring->Drain([&](const PenSample& s) {
+    EXPECT_EQ(s.x, expected++);
+  });
+  EXPECT_EQ(drained, 5u);
+
+  PenSample out;
+  EXPECT_FALSE(ring->TryPop(out));
+}
+
+TEST(SpscRing, CountsOverflowInsteadOfBlocking) {
+  auto ring = std::make_unique<SpscRing<PenSample, 4>>();
+  PenSample s;
+  for (int i = 0; i < 6; ++i) ring->TryPush(s);
+
+  const auto stats = ring->stats();
+  EXPECT_EQ(stats.pushed, 4u);
+  EXPECT_EQ(stats.dropped, 2u);
+  EXPECT_EQ(stats.highWater, 4u);
+}
+
+TEST(SpscRing, CrossThreadHandOff) {
+  auto ring = std::make_unique<SpscRing<PenSample, 64>>();
+  constexpr int kCount = 20000;
+
+  std::thread producer([&] {
+    for (int i = 0; i < kCount; ++i) {
+      PenSample s;
+      s.x = static_cast<uint16_t>(i);
+      while (!ring->TryPush(s)) std::this_thread::yield();
+    }
+  });
+
+  int received = 0;
+  while (received < kCount) {
+    ring->Drain([&](const PenSample& s) {
+      EXPECT_EQ(s.x, static_cast<uint16_t>(received));
+      ++received;
+    });
+  }
+  producer.join();
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "pen_sample.h"
+#include "stroke_simplifier.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+PenSample Ink(double x, double y, uint8_t extraFlags = 0) {
+  PenSample s;
+  s.x = static_cast<uint16_t>(std::lround(x));
+  s.y = static_cast<uint16_t>(std::lround(y));
+  s.pressure = 100;
+  s.strokeId = 1;
+  s.flags = kPenSampleProximity | kPenSampleInk | extraFlags;
+  return s;
+}
+
+PenSample End() {
+  PenSample s;
+  s.strokeId = 1;
+  s.flags = kPenSampleProximity | kPenSampleStrokeEnd;
+  return s;
+}
+
+std::vector<PenSample> Simplify(StrokeSimplifier& simplifier,
+                           const std::vector<PenSample>& input) {
+  std::vector<PenSample> output;
+  PenSample buffer[StrokeSimplifier::kMaxOutput];
+  for (const PenSample& s : input) {
+    const size_t n = simplifier.Process(s, buffer);
+    output.insert(output.end(), buffer, buffer + n);
+  }
+  return output;
+}
+
+StrokeSimplifier::Config Enabled() {
+  StrokeSimplifier::Config config;
+  config.enabled = true;
+  config.minDistance = 2.0f;
+  config.tolerance = 3.0f;
+  config.lookahead = 16;
+  return config;
+}
+
+}  // namespace
+
+TEST(StrokeSimplifier, PassesThroughWhenDisabled) {
+  StrokeSimplifier simplifier;
+  std::vector<PenSample> input = {Ink(0, 0, kPenSampleStrokeBegin)};
+  for (int i = 1; i < 50; ++i) input.push_back(Ink(i * 10, 0));
+  input.push_back(End());
+
+  EXPECT_EQ(Simplify(simplifier, input).size(), input.size());
+}
+
+TEST(StrokeSimplifier, CollapsesStraightLine) {
+  StrokeSimplifier simplifier;
+  simplifier.SetConfig(Enabled());
+
+  std::vector<PenSample> input = {Ink(100, 100, kPenSampleStrokeBegin)};
+  for (int i = 1; i < 200; ++i) input.push_back(Ink(100 + i * 5, 100 + i * 2));
+  input.push_back(End());
+
+  const auto output = Simplify(simplifier, input);
+  ASSERT_GE(output.size(), 3u);
+  EXPECT_LT(output.size(), 30u);
+  EXPECT_TRUE(output.front().flags & kPenSampleStrokeBegin);
+  EXPECT_TRUE(output.back().flags & kPenSampleStrokeEnd);
+  // The last ink point survives
+  EXPECT_EQ(output[output.size() - 2].x, input[input.size() - 2].x);
+}
+
+TEST(StrokeSimplifier, KeepsShapeWithinTolerance) {
+  StrokeSimplifier simplifier;
+  const auto config = Enabled();
+  simplifier.SetConfig(config);
+
+  std::vector<PenSample> input = {Ink(1000, 1000, kPenSampleStrokeBegin)};
+  for (int i = 1; i < 400; ++i) {
+    const double a = i * 0.05;
+    input.push_back(Ink(1000 + 300 * std::cos(a), 1000 + 300 * std::sin(a)));
+  }
+  input.push_back(End());
+
+  const auto output = Simplify(simplifier, input);
+  EXPECT_LT(output.size(), input.size() / 2);
+
+  const auto stats = simplifier.stats();
+  EXPECT_EQ(stats.pointsIn, input.size() - 1);
+  EXPECT_EQ(stats.pointsOut, output.size() - 1);
+  EXPECT_LE(stats.maxError, config.minDistance + config.tolerance);
+}
+
+TEST(StrokeSimplifier, DropsJitterWhilePenRests) {
+  StrokeSimplifier simplifier;
+  simplifier.SetConfig(Enabled());
+
+  std::vector<PenSample> input = {Ink(500, 500, kPenSampleStrokeBegin)};
+  for (int i = 0; i < 100; ++i) input.push_back(Ink(500 + (i & 1), 500));
+  input.push_back(End());
+
+  // Begin, the final resting point and the end marker
+  EXPECT_EQ(Simplify(simplifier, input).size(), 3u);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
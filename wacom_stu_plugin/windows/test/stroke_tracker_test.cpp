@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "pen_sample.h"
+#include "stroke_tracker.h"
+
+namespace wacom_stu_plugin {
+namespace test {
+
+namespace {
+
+PenSample Sample(bool rdy, uint16_t pressure) {
+  PenSample s;
+  s.flags = rdy ? kPenSampleProximity : 0;
+  s.pressure = pressure;
+  return s;
+}
+
+}  // namespace
+
+TEST(StrokeTracker, EmitsBeginInkEndWithIds) {
+  StrokeTracker tracker;
+
+  PenSample hover = Sample(true, 0);
+  tracker.Process(hover);
+  EXPECT_EQ(hover.strokeId, 0u);
+  EXPECT_FALSE(hover.flags & kPenSampleInk);
+
+  PenSample down = Sample(true, 100);
+  tracker.Process(down);
+  EXPECT_TRUE(down.flags & kPenSampleStrokeBegin);
+  EXPECT_EQ(down.strokeId, 1u);
+
+  PenSample move = Sample(true, 80);
+  tracker.Process(move);
+  EXPECT_TRUE(move.flags & kPenSampleInk);
+  EXPECT_FALSE(move.flags & kPenSampleStrokeBegin);
+  EXPECT_EQ(move.strokeId, 1u);
+
+  PenSample up = Sample(true, 0);
+  tracker.Process(up);
+  EXPECT_TRUE(up.flags & kPenSampleStrokeEnd);
+  EXPECT_FALSE(up.flags & kPenSampleInk);
+  EXPECT_EQ(up.strokeId, 1u);
+
+  PenSample again = Sample(true, 100);
+  tracker.Process(again);
+  EXPECT_EQ(again.strokeId, 2u);
+}
+
+TEST(StrokeTracker, PressureHysteresisKeepsStrokeOpen) {
+  StrokeTracker tracker;
+  StrokeTracker::Thresholds t;
+  t.pressureOn = 20;
+  t.pressureOff = 10;
+  tracker.SetThresholds(t);
+
+  PenSample light = Sample(true, 15);
+  tracker.Process(light);
+  EXPECT_EQ(light.strokeId, 0u);  // below the start threshold
+
+  PenSample down = Sample(true, 25);
+  tracker.Process(down);
+  PenSample dip = Sample(true, 12);  // between off and on: still inking
+  tracker.Process(dip);
+  EXPECT_TRUE(dip.flags & kPenSampleInk);
+
+  PenSample lift = Sample(true, 9);
+  tracker.Process(lift);
+  EXPECT_TRUE(lift.flags & kPenSampleStrokeEnd);
+}
+
+TEST(StrokeTracker, ProximityDropoutIsDebounced) {
+  StrokeTracker tracker;
+  PenSample down = Sample(true, 100);
+  tracker.Process(down);
+
+  // A single sample without rdy does not end the stroke...
+  PenSample glitch = Sample(false, 100);
+  tracker.Process(glitch);
+  EXPECT_TRUE(glitch.flags & kPenSampleInk);
+
+  // ...but the pen leaving range does
+  PenSample away = Sample(false, 100);
+  tracker.Process(away);
+  EXPECT_TRUE(away.flags & kPenSampleStrokeEnd);
+}
+
+}  // namespace test
+}  // namespace wacom_stu_plugin
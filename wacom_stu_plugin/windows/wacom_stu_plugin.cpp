@@ -1,65 +1,227 @@
 #include "wacom_stu_plugin.h"
+#include "device_id.h"
+#include "pen_frame.h"
+#include "host_clock.h"
+#include "png_encoder.h"
+#include "report_decoder.h"
+#include "screen_image.h"
+#include "signature_rasterizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <dbt.h>
+#include <random>
 #include <flutter/standard_method_codec.h>
 #include <WacomGSS/STU/Tablet.hpp>
 #include <WacomGSS/STU/getUsbDevices.hpp>
 #include <WacomGSS/STU/UsbInterface.hpp>
 #include <WacomGSS/STU/ProtocolHelper.hpp>
-#include <WacomGSS/STU/ReportHandler.hpp>
+#include <WacomGSS/STU/InterfaceQueue.hpp>
 
 using flutter::EncodableValue;
 
 // Custom Window Message ID
 #define WM_WACOM_EVENT (WM_USER + 101)
+// Posted when work is queued for the platform thread, see PostToPlatformThread
+#define WM_WACOM_PLATFORM_TASK (WM_USER + 102)
 
-// PenHandler to process reports
-class PenHandler : public WacomGSS::STU::ProtocolHelper::ReportHandler {
-public:
-    PenHandler(std::function<void(const EncodableValue&)> callback) 
-        : callback_(callback) {}
+static const wchar_t kWakeupWindowClass[] = L"WACOM_STU_PLUGIN_WAKEUP_WINDOW";
 
-    void onReport(WacomGSS::STU::Protocol::PenData& penData) override {
-        Notify(penData.x, penData.y, penData.pressure, penData.sw);
-    }
+// GUID_DEVINTERFACE_USB_DEVICE, the interface class getUsbDevices lists
+static const GUID kUsbDeviceInterface = {
+    0xA5DCBF10, 0x6530, 0x11D2, {0x90, 0x1F, 0x00, 0xC0, 0x4F, 0xB9, 0x51, 0xED}};
 
-    void onReport(WacomGSS::STU::Protocol::PenDataOption& penData) override {
-        Notify(penData.x, penData.y, penData.pressure, penData.sw);
-    }
+// Reads that fail this many times in a row mean the pad is gone, even if
+// its interface still looks open
+constexpr int kMaxReportFailures = 8;
+// A pad that just arrived can take a moment to open; the reconnect thread
+// retries for about five seconds, then waits for the next arrival
+constexpr int kReconnectAttempts = 20;
+constexpr int kReconnectRetryMs = 250;
+// The pad works out its half of the key exchange in firmware; it is given
+// this long, polled at the interval below
+constexpr int kKeyExchangeTimeoutMs = 2000;
+constexpr int kKeyExchangeRetryMs = 10;
 
-    void onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequence& penData) override {
-        Notify(penData.x, penData.y, penData.pressure, penData.sw);
+// Interface paths come in varying case
+static std::wstring LowerPath(std::wstring path) {
+    for (auto& c : path) {
+        if (c >= L'A' && c <= L'Z') c += L'a' - L'A';
     }
+    return path;
+}
 
-    void onReport(WacomGSS::STU::Protocol::PenDataEncrypted& penData) override {
-        // Encrypted data contains 2 pen data points
-        for (const auto& p : penData.penData) {
-            Notify(p.x, p.y, p.pressure, p.sw);
-        }
+// The capability and information reports and the supported report ids of
+// a freshly attached pad. Each report is a feature report round trip.
+static DeviceInfo ReadDeviceInfo(wgssSTU::Tablet& tablet, const wgssSTU::UsbDevice& usbDevice) {
+    DeviceInfo info;
+    info.productId = usbDevice.idProduct;
+    info.bcdDevice = usbDevice.bcdDevice;
+
+    const auto cap = tablet.getCapability();
+    info.tabletMaxX = cap.tabletMaxX;
+    info.tabletMaxY = cap.tabletMaxY;
+    info.tabletMaxPressure = cap.tabletMaxPressure;
+    info.screenWidth = cap.screenWidth;
+    info.screenHeight = cap.screenHeight;
+    info.maxReportRate = cap.maxReportRate;
+    info.resolution = cap.resolution;
+    // Older firmware reports no encoding flags; the SDK fills them in from
+    // the product id
+    info.encodingFlag = WacomGSS::STU::ProtocolHelper::simulateEncodingFlag(
+        usbDevice.idProduct, cap.encodingFlag);
+
+    const auto information = tablet.getInformation();
+    const auto& name = information.modelName;
+    info.modelName.assign(name.begin(), std::find(name.begin(), name.end(), '\0'));
+    info.firmwareMajor = information.firmwareMajorVersion;
+    info.firmwareMinor = information.firmwareMinorVersion;
+    info.secureIc = information.secureIc;
+
+    info.areaWrites = tablet.isSupported(WacomGSS::STU::Protocol::ReportId_StartImageDataArea);
+    info.hardwareInk = tablet.isSupported(WacomGSS::STU::Protocol::ReportId_InkingMode);
+    info.penDataOptionMode = tablet.isSupported(WacomGSS::STU::Protocol::ReportId_PenDataOptionMode);
+    return info;
+}
+
+// The host's side of an encrypted capture: agrees a session key with the
+// pad and starts the capture under a fresh session id. A pad without usable
+// parameters of its own takes the host's. False if the pad does not finish
+// its half in time or answers with a key that cannot be used.
+static bool StartEncryptedCapture(wgssSTU::Tablet& tablet, SessionKeyExchange::Key& sessionKey,
+                                  uint32_t& sessionId) {
+    SessionKeyExchange exchange;
+    const auto prime = tablet.getDHprime();
+    SessionKeyExchange::Key padPrime;
+    std::copy(prime.begin(), prime.end(), padPrime.begin());
+    if (!exchange.SetParameters(padPrime, tablet.getDHbase())) {
+        WacomGSS::STU::Protocol::DHprime hostPrime;
+        std::copy(exchange.prime().begin(), exchange.prime().end(), hostPrime.begin());
+        tablet.setDHprime(hostPrime);
+        tablet.setDHbase(exchange.base());
     }
-    
-    void onReport(WacomGSS::STU::Protocol::PenDataEncryptedOption& penData) override {
-         // EncryptedOption inherits from Encrypted, so it also has penData[2]
-        for (const auto& p : penData.penData) {
-            Notify(p.x, p.y, p.pressure, p.sw);
-        }
+
+    const auto hostKey = exchange.GeneratePublicKey();
+    WacomGSS::STU::Protocol::PublicKey hostPublicKey;
+    std::copy(hostKey.begin(), hostKey.end(), hostPublicKey.begin());
+    tablet.setHostPublicKey(hostPublicKey);
+
+    const int64_t deadlineUs = HostTimeUs() + kKeyExchangeTimeoutMs * 1000;
+    while (tablet.getStatus().statusCode != WacomGSS::STU::Protocol::StatusCode_Ready) {
+        if (HostTimeUs() > deadlineUs) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(kKeyExchangeRetryMs));
     }
+    const auto padKey = tablet.getDevicePublicKey();
+    SessionKeyExchange::Key devicePublicKey;
+    std::copy(padKey.begin(), padKey.end(), devicePublicKey.begin());
+    const bool agreed = exchange.ComputeSessionKey(devicePublicKey, sessionKey);
+    exchange.Clear();
+    if (!agreed) return false;
+
+    std::random_device random;
+    sessionId = random();
+    tablet.startCapture(sessionId);
+    return true;
+}
+
+// Argument helpers for method calls that take a map of optional settings.
+// Dart ints arrive as int32 or int64 depending on magnitude.
+static const EncodableValue* FindArg(const flutter::EncodableMap& map, const char* key) {
+    auto it = map.find(EncodableValue(key));
+    return it == map.end() ? nullptr : &it->second;
+}
+
+static double GetDoubleArg(const flutter::EncodableMap& map, const char* key, double fallback) {
+    const EncodableValue* value = FindArg(map, key);
+    if (!value) return fallback;
+    if (const auto* d = std::get_if<double>(value)) return *d;
+    if (const auto* i = std::get_if<int32_t>(value)) return *i;
+    if (const auto* l = std::get_if<int64_t>(value)) return (double)*l;
+    return fallback;
+}
+
+static int64_t GetIntArg(const flutter::EncodableMap& map, const char* key, int64_t fallback) {
+    const EncodableValue* value = FindArg(map, key);
+    if (!value) return fallback;
+    if (const auto* i = std::get_if<int32_t>(value)) return *i;
+    if (const auto* l = std::get_if<int64_t>(value)) return *l;
+    return fallback;
+}
+
+static bool GetBoolArg(const flutter::EncodableMap& map, const char* key, bool fallback) {
+    const EncodableValue* value = FindArg(map, key);
+    if (!value) return fallback;
+    if (const auto* b = std::get_if<bool>(value)) return *b;
+    return fallback;
+}
 
-    void onReport(WacomGSS::STU::Protocol::PenDataTimeCountSequenceEncrypted& penData) override {
-        // This one inherits from PenDataTimeCountSequence, so it has x,y directly
-        Notify(penData.x, penData.y, penData.pressure, penData.sw);
+// setHardwareInking's settings: color (ARGB), thickness, area {x, y,
+// width, height} in screen pixels, onPressure and offPressure
+static HardwareInkConfig GetHardwareInkConfig(const flutter::EncodableMap& map) {
+    HardwareInkConfig config;
+    config.color = (uint32_t)GetIntArg(map, "color", config.color);
+    config.thickness = (int)GetIntArg(map, "thickness", config.thickness);
+    config.onPressure = (int)GetIntArg(map, "onPressure", 0);
+    config.offPressure = (int)GetIntArg(map, "offPressure", 0);
+    const auto* area_value = FindArg(map, "area");
+    if (const auto* area = area_value ? std::get_if<flutter::EncodableMap>(area_value) : nullptr) {
+        config.area.x = (int)GetIntArg(*area, "x", 0);
+        config.area.y = (int)GetIntArg(*area, "y", 0);
+        config.area.width = (int)GetIntArg(*area, "width", 0);
+        config.area.height = (int)GetIntArg(*area, "height", 0);
     }
+    return config;
+}
 
-private:
-   void Notify(uint16_t x, uint16_t y, uint16_t p, uint16_t sw) {
-        flutter::EncodableMap map;
-        map[EncodableValue("x")] = EncodableValue((int64_t)x);
-        map[EncodableValue("y")] = EncodableValue((int64_t)y);
-        map[EncodableValue("pressure")] = EncodableValue((int64_t)p);
-        map[EncodableValue("sw")] = EncodableValue((int64_t)sw);
-        callback_(EncodableValue(map));
+// Converts a sample into the map format the Dart side listens for
+static EncodableValue EncodePenSample(const PenSample& sample, const std::string& deviceId) {
+    flutter::EncodableMap map;
+    map[EncodableValue("deviceId")] = EncodableValue(deviceId);
+    map[EncodableValue("x")] = EncodableValue((int64_t)sample.x);
+    map[EncodableValue("y")] = EncodableValue((int64_t)sample.y);
+    map[EncodableValue("pressure")] = EncodableValue((int64_t)sample.pressure);
+    map[EncodableValue("sw")] = EncodableValue((int64_t)sample.sw);
+    map[EncodableValue("timestamp")] = EncodableValue(sample.timestampUs);
+    map[EncodableValue("deviceTimestamp")] = EncodableValue(sample.deviceTimeUs);
+    if (sample.flags & kPenSampleHasSequence) {
+        map[EncodableValue("sequence")] = EncodableValue((int64_t)sample.sequence);
     }
+    map[EncodableValue("strokeId")] = EncodableValue((int64_t)sample.strokeId);
+    map[EncodableValue("flags")] = EncodableValue((int64_t)sample.flags);
+    return EncodableValue(map);
+}
 
-    std::function<void(const EncodableValue&)> callback_;
-};
+// Builds a single event holding a whole batch of samples, see pen_frame.h
+static EncodableValue EncodePenFrame(
+    const std::string& deviceId,
+    const std::vector<PenSample>& samples,
+    bool delta,
+    std::vector<int32_t>& packed,
+    std::vector<uint8_t>& deltaPacked,
+    const PenFrameMapped* mapped) {
+    const int64_t t0 = samples.front().timestampUs;
+
+    flutter::EncodableMap map;
+    map[EncodableValue("type")] = EncodableValue("penFrame");
+    map[EncodableValue("deviceId")] = EncodableValue(deviceId);
+    map[EncodableValue("stride")] = EncodableValue((int32_t)kFrameStride);
+    map[EncodableValue("count")] = EncodableValue((int32_t)samples.size());
+    map[EncodableValue("t0")] = EncodableValue(t0);
+    map[EncodableValue("delta")] = EncodableValue(delta);
+    if (mapped) {
+        // x and y are target units times coordOne, pressure 0..pressureOne
+        map[EncodableValue("coordOne")] = EncodableValue(PenTransform::kCoordOne);
+        map[EncodableValue("pressureOne")] = EncodableValue(PenTransform::kPressureOne);
+    }
+    if (delta) {
+        PackPenFrameDelta(samples.data(), samples.size(), t0, deltaPacked, mapped);
+        map[EncodableValue("samples")] = EncodableValue(deltaPacked);
+    } else {
+        PackPenFrame(samples.data(), samples.size(), t0, packed, mapped);
+        map[EncodableValue("samples")] = EncodableValue(packed);
+    }
+    return EncodableValue(map);
+}
 
 // ForwardingStreamHandler to avoid double ownership
 class ForwardingStreamHandler : public flutter::StreamHandler<EncodableValue> {
@@ -80,11 +242,11 @@ private:
     WacomStuPlugin* plugin_;
 };
 
-WacomStuPlugin::WacomStuPlugin() : keepRunning(false) {}
+WacomStuPlugin::WacomStuPlugin() {}
 
 WacomStuPlugin::~WacomStuPlugin() {
-  StopReportThread();
-  if (tablet) tablet->disconnect();
+  while (!devices.empty()) DisconnectDevice(devices.begin()->first);
+  DestroyWakeupWindow();
 }
 
 void WacomStuPlugin::RegisterWithRegistrar(
@@ -112,19 +274,65 @@ void WacomStuPlugin::RegisterWithRegistrar(
   event_channel->SetStreamHandler(
       std::make_unique<ForwardingStreamHandler>(plugin.get()));
 
-  // Capture raw pointer before move
-  WacomStuPlugin* plugin_ptr = plugin.get();
-
-  // Register Window Proc
-  plugin_ptr->windowId = registrar->RegisterTopLevelWindowProcDelegate(
-      [plugin_ptr](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
-        return plugin_ptr->HandleWindowProc(hwnd, message, wparam, lparam);
-      });
+  // Registration runs on the platform thread, so the wakeup window's
+  // messages are dispatched there by the runner's message loop.
+  plugin->CreateWakeupWindow();
 
   registrar->AddPlugin(std::move(plugin));
 }
 
-// ... existing OnListen/OnCancel ...
+void WacomStuPlugin::CreateWakeupWindow() {
+    HINSTANCE instance = GetModuleHandle(nullptr);
+
+    WNDCLASSEX windowClass{};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = &WacomStuPlugin::WakeupWindowProc;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = kWakeupWindowClass;
+    // Fails harmlessly if a previous engine instance already registered it
+    RegisterClassEx(&windowClass);
+
+    wakeupWindow = CreateWindowEx(0, kWakeupWindowClass, L"", 0, 0, 0, 0, 0,
+                                  HWND_MESSAGE, nullptr, instance, nullptr);
+    if (wakeupWindow) {
+        SetWindowLongPtr(wakeupWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+        // USB devices coming and going, so unplugged pads can be picked up
+        // again
+        DEV_BROADCAST_DEVICEINTERFACE_W filter{};
+        filter.dbcc_size = sizeof(filter);
+        filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+        filter.dbcc_classguid = kUsbDeviceInterface;
+        deviceNotification = RegisterDeviceNotificationW(wakeupWindow, &filter,
+                                                         DEVICE_NOTIFY_WINDOW_HANDLE);
+    }
+}
+
+void WacomStuPlugin::DestroyWakeupWindow() {
+    if (deviceNotification) {
+        UnregisterDeviceNotification(deviceNotification);
+        deviceNotification = nullptr;
+    }
+    if (wakeupWindow) {
+        SetWindowLongPtr(wakeupWindow, GWLP_USERDATA, 0);
+        DestroyWindow(wakeupWindow);
+        wakeupWindow = nullptr;
+    }
+}
+
+LRESULT CALLBACK WacomStuPlugin::WakeupWindowProc(
+      HWND window,
+      UINT message,
+      WPARAM wparam,
+      LPARAM lparam) {
+    auto* plugin = reinterpret_cast<WacomStuPlugin*>(GetWindowLongPtr(window, GWLP_USERDATA));
+    if (plugin) {
+        if (auto handled = plugin->HandleWindowProc(window, message, wparam, lparam)) {
+            return *handled;
+        }
+    }
+    return DefWindowProc(window, message, wparam, lparam);
+}
 
 // Implement WindowProc
 std::optional<LRESULT> WacomStuPlugin::HandleWindowProc(
@@ -133,26 +341,116 @@ std::optional<LRESULT> WacomStuPlugin::HandleWindowProc(
       WPARAM wparam,
       LPARAM lparam) {
     if (message == WM_WACOM_EVENT) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        std::lock_guard<std::mutex> sinkLock(sinkMutex);
-        
-        while (!eventQueue.empty()) {
-            if (eventSink) {
-                eventSink->Success(eventQueue.front());
-            }
-            eventQueue.pop();
-        }
+        ++wakeupsHandled;
+        DeliverPenEvents();
+        return 0;
+    }
+    if (message == WM_WACOM_PLATFORM_TASK) {
+        RunPlatformTasks();
         return 0;
     }
+    if (message == WM_DEVICECHANGE) {
+        const auto* header = reinterpret_cast<const DEV_BROADCAST_HDR*>(lparam);
+        if (header && header->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE) {
+            const auto* device = reinterpret_cast<const DEV_BROADCAST_DEVICEINTERFACE_W*>(header);
+            if (wparam == DBT_DEVICEARRIVAL) OnDeviceArrival();
+            else if (wparam == DBT_DEVICEREMOVECOMPLETE) OnDeviceRemoval(device->dbcc_name);
+        }
+        return TRUE;
+    }
     return std::nullopt;
 }
 
+// Called by a report thread after each successful push. Only the push that
+// finds no wakeup outstanding posts a message, so a burst of samples costs a
+// single message no matter how long the platform thread takes to get to it.
+void WacomStuPlugin::PostWakeup() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (wakeupPending.exchange(true)) return;
+
+    if (wakeupWindow && PostMessage(wakeupWindow, WM_WACOM_EVENT, 0, 0)) {
+        wakeupsPosted.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        wakeupPending = false;
+    }
+}
+
+void WacomStuPlugin::DeliverPenEvents() {
+    // Re-arm before draining: anything pushed after this point either shows
+    // up in the drains below or posts a fresh wakeup.
+    wakeupPending = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (auto& [id, device] : devices) {
+        DeliverPenEvents(*device);
+    }
+}
+
+// One pad's ring; a batched listener gets one frame per pad
+void WacomStuPlugin::DeliverPenEvents(StuDevice& device) {
+    // Only the sink is locked here; the report thread keeps pushing into
+    // the ring while we deliver.
+    std::lock_guard<std::mutex> sinkLock(sinkMutex);
+
+    if (!batchedEvents) {
+        device.samplesDelivered += device.pipeline.ring.Drain([this, &device](const PenSample& sample) {
+            device.inkStore.Add(sample);
+            if (eventSink) {
+                eventSink->Success(EncodePenSample(sample, device.id));
+                ++eventsSent;
+            }
+        });
+        return;
+    }
+
+    drainScratch.clear();
+    device.pipeline.ring.Drain([this, &device](const PenSample& sample) {
+        device.inkStore.Add(sample);
+        drainScratch.push_back(sample);
+    });
+    if (drainScratch.empty() || !eventSink) return;
+
+    // Mapped here, after the ink store kept the raw sample; the transform
+    // only changes on this thread, so a batch never mixes two
+    const PenTransform& penTransform = device.penTransform;
+    PenFrameMapped mapped{};
+    if (penTransform.enabled()) {
+        const size_t count = drainScratch.size();
+        mappedX.resize(count);
+        mappedY.resize(count);
+        mappedPressure.resize(count);
+        penTransform.Apply(drainScratch.data(), count, mappedX.data(), mappedY.data(),
+                           mappedPressure.data());
+        mapped = PenFrameMapped{mappedX.data(), mappedY.data(), mappedPressure.data()};
+    }
+    eventSink->Success(EncodePenFrame(device.id, drainScratch, deltaFrames, frameScratch,
+                                      deltaScratch, penTransform.enabled() ? &mapped : nullptr));
+    ++eventsSent;
+    device.samplesDelivered += drainScratch.size();
+}
+
 std::unique_ptr<flutter::StreamHandlerError<EncodableValue>> WacomStuPlugin::OnListenInternal(
     const EncodableValue* arguments,
     std::unique_ptr<flutter::EventSink<EncodableValue>>&& events) {
     
     std::lock_guard<std::mutex> lock(sinkMutex);
     eventSink = std::move(events);
+
+    // {"format": "frames", "delta": bool} switches to batched delivery
+    batchedEvents = false;
+    deltaFrames = false;
+    if (const auto* args = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr) {
+        auto format_it = args->find(EncodableValue("format"));
+        if (format_it != args->end()) {
+            const auto* format = std::get_if<std::string>(&format_it->second);
+            batchedEvents = format && *format == "frames";
+        }
+        auto delta_it = args->find(EncodableValue("delta"));
+        if (delta_it != args->end()) {
+            const auto* delta = std::get_if<bool>(&delta_it->second);
+            deltaFrames = delta && *delta;
+        }
+    }
     return nullptr;
 }
 
@@ -167,108 +465,837 @@ std::unique_ptr<flutter::StreamHandlerError<EncodableValue>> WacomStuPlugin::OnC
 // Custom Window Message ID
 #define WM_WACOM_EVENT (WM_USER + 101)
 
-void WacomStuPlugin::StartReportThread() {
-    if (keepRunning) return;
-    
-    // Ensure we are connected first
-    if (!tablet || !tablet->isConnected()) return;
-
-    keepRunning = true;
-    reportThread = std::thread([this]() {
-        // Init pen handler with callback to queue
-        PenHandler penHandler([this](const EncodableValue& val) {
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                eventQueue.push(val);
+StuDevice* WacomStuPlugin::FindDevice(const EncodableValue* arguments) {
+    const auto* map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+    const auto* id_value = map ? FindArg(*map, "deviceId") : nullptr;
+    const auto* id = id_value ? std::get_if<std::string>(id_value) : nullptr;
+    auto it = devices.find(id ? *id : defaultDeviceId);
+    if (it == devices.end() && !id && !devices.empty()) it = devices.begin();
+    return it == devices.end() ? nullptr : it->second.get();
+}
+
+// Platform thread. Stops the pad's threads and releases it; a pad that is
+// not connected is ignored.
+void WacomStuPlugin::DisconnectDevice(const std::string& id) {
+    auto it = devices.find(id);
+    if (it == devices.end()) return;
+    StuDevice& device = *it->second;
+
+    device.reconnectCancel = true;
+    if (device.reconnectThread.joinable()) device.reconnectThread.join();
+    StopReportThread(device);
+    device.decryptWorker.reset();
+    device.screenWorker.Cancel();
+    device.screenWorker.WaitIdle();
+    if (device.tablet) {
+        // Otherwise the pad keeps inking, or capturing, with no one listening
+        try {
+            if (device.tablet->isConnected()) {
+                if (device.hardwareInkOn) DisableHardwareInk(device);
+                if (device.encrypted) device.tablet->endCapture();
             }
-            // Notify main thread
-            // We need a handle. Since we are in a thread, we can't easily get the main window handle 
-            // without storing it. But PostMessage to the active window usually works for single window apps,
-            // or we can assume the registrar's window is active.
-            // Better: Store HWND in RegisterWithRegistrar if possible, but we didn't.
-            // Let's use GetActiveWindow() as a fallback or Broadcast? No.
-            // Actually, we can pass it.
-            // Notify main thread
-            // If we don't have the handle yet, try to find it.
-            HWND targetWindow = hwnd;
-            if (!targetWindow) {
-                targetWindow = FindWindow(L"FLUTTER_RUNNER_WIN32_WINDOW", nullptr);
-                if (targetWindow) {
-                    hwnd = targetWindow; // Cache it
-                }
+        } catch (...) {
+            // Already unplugged
+        }
+        device.tablet->disconnect();
+    }
+    devices.erase(it);
+}
+
+// Platform thread, from the report thread giving up or a removal
+// notification. Keeps the pad's state for the reconnect.
+void WacomStuPlugin::OnDeviceLost(const std::string& id) {
+    auto it = devices.find(id);
+    if (it == devices.end() || it->second->lost) return;
+    StuDevice& device = *it->second;
+
+    device.lost = true;
+    device.lostAtUs = HostTimeUs();
+    StopReportThread(device);
+    // Decodes what it still holds, for the delivery below
+    device.decryptWorker.reset();
+    {
+        // Waits out an upload failing against the missing pad
+        std::lock_guard<std::mutex> lock(device.screenMutex);
+        if (device.tablet) {
+            try {
+                device.tablet->disconnect();
+            } catch (...) {
+                // Already gone
             }
+            device.tablet.reset();
+        }
+    }
+    // What was read before it went
+    DeliverPenEvents(device);
+    SendDeviceEvent("deviceRemoved", id);
+
+    // A pad that dropped off without a removal (a firmware reset, say)
+    // comes straight back; one that was unplugged waits for its arrival
+    StartReconnect(device);
+}
 
-            if (targetWindow) {
-                PostMessage(targetWindow, WM_WACOM_EVENT, 0, 0);
+// Platform thread. Retries in the background until the pad opens again,
+// then puts back the report mode, the last screen and the pad's inking.
+// Capabilities are the ones read at connect; the hot zones, transform and
+// simplifier settings never left.
+void WacomStuPlugin::StartReconnect(StuDevice& device) {
+    if (device.reconnectThread.joinable()) {
+        device.retryReconnect = true;
+        return;
+    }
+    device.reconnectCancel = false;
+    device.retryReconnect = false;
+    const int64_t startUs = HostTimeUs();
+    device.reconnectThread = std::thread([this, &device, startUs]() {
+        bool connected = false;
+        bool screenRestored = false;
+        for (int attempt = 0; attempt < kReconnectAttempts && !connected; ++attempt) {
+            if (attempt) std::this_thread::sleep_for(std::chrono::milliseconds(kReconnectRetryMs));
+            if (device.reconnectCancel) break;
+            try {
+                for (const auto& usbDevice : wgssSTU::getUsbDevices()) {
+                    if (StuDeviceId(usbDevice.idVendor, usbDevice.idProduct, usbDevice.fileName) !=
+                        device.id) {
+                        continue;
+                    }
+                    auto usbInterface = std::make_unique<wgssSTU::UsbInterface>();
+                    if (usbInterface->connect(usbDevice, true)) break;
+                    auto tablet = std::make_unique<wgssSTU::Tablet>();
+                    tablet->attach(std::move(usbInterface));
+                    try {
+                        if (device.info.penDataOptionMode) {
+                            tablet->setPenDataOptionMode(
+                                WacomGSS::STU::Protocol::PenDataOptionMode_TimeCountSequence);
+                        }
+                    } catch (...) {
+                        // Older firmware; plain PenData reports still work
+                    }
+                    // The session went with the pad; the next one has a
+                    // new key. Tried again on the next attempt if it fails.
+                    if (device.encrypted &&
+                        !StartEncryptedCapture(*tablet, device.sessionKey, device.sessionId)) {
+                        break;
+                    }
+
+                    std::lock_guard<std::mutex> lock(device.screenMutex);
+                    device.tablet = std::move(tablet);
+                    device.path = LowerPath(usbDevice.fileName);
+                    connected = true;
+                    // Screen first, so the restored ink area is not written
+                    // with inking on
+                    const bool inking = device.hardwareInkOn;
+                    device.hardwareInkOn = false;
+                    device.pipeline.hardwareInkPressure = 0;
+                    screenRestored = RestoreScreen(device);
+                    if (inking) EnableHardwareInk(device, device.hardwareInk);
+                    break;
+                }
+            } catch (...) {
+                // Not ready yet, or the restore failed after connecting
             }
+        }
+        const double reconnectMs = (HostTimeUs() - startUs) / 1000.0;
+        PostToPlatformThread([this, id = device.id, connected, screenRestored, reconnectMs] {
+            FinishReconnect(id, connected, screenRestored, reconnectMs);
         });
+    });
+}
+
+bool WacomStuPlugin::RestoreScreen(StuDevice& device) {
+    if (!device.screenShadow.valid()) return false;
+    // The frame the shadow kept, in the mode it went out in
+    const uint32_t tag = device.screenShadow.tag();
+    ScreenUpload upload;
+    upload.data = device.screenShadow.pixels();
+    upload.mode = (int)(tag & 0xFF);
+    upload.format = (ScreenPixelFormat)((tag >> 8) & 0xFF);
+    upload.dither = (ScreenDither)((tag >> 16) & 0xFF);
+    // None of it is on the pad now
+    device.screenShadow.Reset();
+    device.pipeline.screenInked = false;
+    return WriteScreen(device, upload, device.reconnectCancel) && upload.errorCode.empty();
+}
+
+// Platform thread, once the reconnect thread is done
+void WacomStuPlugin::FinishReconnect(const std::string& id, bool connected,
+                                     bool screenRestored, double reconnectMs) {
+    auto it = devices.find(id);
+    if (it == devices.end()) return;
+    StuDevice& device = *it->second;
+    if (device.reconnectThread.joinable()) device.reconnectThread.join();
+    // Disconnected and connected anew in the meantime
+    if (!device.lost) return;
+
+    if (!connected) {
+        // Gone for good until the next arrival, unless one came already
+        if (device.retryReconnect) StartReconnect(device);
+        return;
+    }
+    device.lost = false;
+    device.reconnects++;
+    device.lastReconnectMs = reconnectMs;
+    if (device.encrypted) StartDecryptWorker(device);
+    StartReportThread(device);
+
+    flutter::EncodableMap fields;
+    fields[EncodableValue("reconnectMs")] = EncodableValue(reconnectMs);
+    fields[EncodableValue("offlineMs")] =
+        EncodableValue((HostTimeUs() - device.lostAtUs) / 1000.0);
+    fields[EncodableValue("screenRestored")] = EncodableValue(screenRestored);
+    SendDeviceEvent("deviceReconnected", id, std::move(fields));
+}
 
-        // Create queue via tablet interface
-        WacomGSS::STU::InterfaceQueue queue = tablet->interfaceQueue();
+// Platform thread. Some USB device arrived; any pad that is missing may be
+// it.
+void WacomStuPlugin::OnDeviceArrival() {
+    for (auto& [id, device] : devices) {
+        if (device->lost) StartReconnect(*device);
+    }
+}
+
+void WacomStuPlugin::OnDeviceRemoval(const std::wstring& path) {
+    const std::wstring removed = LowerPath(path);
+    std::vector<std::string> lost;
+    for (const auto& [id, device] : devices) {
+        if (!device->lost && device->path == removed) lost.push_back(id);
+    }
+    for (const auto& id : lost) OnDeviceLost(id);
+}
+
+void WacomStuPlugin::SendDeviceEvent(const std::string& type, const std::string& id,
+                                     flutter::EncodableMap fields) {
+    fields[EncodableValue("type")] = EncodableValue(type);
+    fields[EncodableValue("deviceId")] = EncodableValue(id);
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    if (eventSink) eventSink->Success(EncodableValue(fields));
+}
+
+void WacomStuPlugin::StartReportThread(StuDevice& device) {
+    if (device.keepRunning) return;
+    
+    // Ensure we are connected first
+    if (!device.tablet || !device.tablet->isConnected()) return;
+
+    // Created here rather than on the thread so StopReportThread can always
+    // reach it to wake a blocked read.
+    device.reportQueue =
+        std::make_unique<WacomGSS::STU::InterfaceQueue>(device.tablet->interfaceQueue());
+    device.clockEstimator.Reset();
+    device.pipeline.Reset();
 
-        while (keepRunning) {
+    device.keepRunning = true;
+    device.reportThread = std::thread([this, &device]() {
+        PenReportDecoder decoder(&device.clockEstimator);
+        PenSample samples[PenReportDecoder::kMaxSamplesPerReport];
+        int failures = 0;
+
+        while (device.keepRunning) {
             WacomGSS::STU::Report report;
             try {
-                // Poll for report, returns true if report retrieved
-                if (queue.try_getReport(report)) {
-                     penHandler.handleReport(report.begin(), report.end(), false); 
-                } else {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                // Blocks until a report arrives or StopReportThread notifies the
+                // queue, so an idle pen costs no CPU and no poll latency.
+                const bool gotReport = device.reportQueue->wait_getReport_predicate(
+                    report, [&device] { return !device.keepRunning; });
+                device.reportWakeups.fetch_add(1, std::memory_order_relaxed);
+                if (gotReport) {
+                     const int64_t reportUs = HostTimeUs();
+                     if (device.recording.load(std::memory_order_relaxed)) {
+                         std::lock_guard<std::mutex> lock(device.recorderMutex);
+                         if (device.recorder) {
+                             device.recorder->Append(reportUs, report.data(), report.size());
+                         }
+                     }
+                     // Encrypted captures are recorded as read, so their
+                     // replays hold no pen data
+                     if (device.decryptWorker) {
+                         device.decryptWorker->Push(report.data(), report.size(), reportUs);
+                     } else {
+                         const size_t count =
+                             decoder.Decode(report.data(), report.size(), reportUs, samples);
+                         for (size_t i = 0; i < count; ++i) OnPenSample(device, samples[i]);
+                     }
+                     device.reportsRead.fetch_add(1, std::memory_order_relaxed);
                 }
+                failures = 0;
             } catch (...) {
-                // Ignore transient errors
+                // A one-off is transient; a closed interface or a run of
+                // failures is the pad going away, which the platform thread
+                // turns into a reconnect
+                if (!device.tablet->isConnected() || ++failures >= kMaxReportFailures) {
+                    PostToPlatformThread([this, id = device.id] { OnDeviceLost(id); });
+                    return;
+                }
             }
         }
     });
 }
 
-void WacomStuPlugin::StopReportThread() {
-    keepRunning = false;
-    if (reportThread.joinable()) {
-        reportThread.join();
+// Report thread, or the decrypt worker in an encrypted capture: runs each
+// decoded sample through the pad's pipeline to the platform thread.
+void WacomStuPlugin::OnPenSample(StuDevice& device, const PenSample& sample) {
+    if (device.pipeline.Process(sample)) PostWakeup();
+}
+
+// Platform thread, before the report thread starts. The session the key
+// exchange left goes to a new worker and the key is wiped.
+void WacomStuPlugin::StartDecryptWorker(StuDevice& device) {
+    device.decryptWorker = std::make_unique<DecryptWorker>(
+        device.sessionKey.data(), device.sessionId, &device.clockEstimator,
+        [this, &device](const PenSample& sample) { OnPenSample(device, sample); });
+    device.sessionKey.fill(0);
+}
+
+void WacomStuPlugin::StopReportThread(StuDevice& device) {
+    device.keepRunning = false;
+    if (device.reportQueue) {
+        device.reportQueue->notify_all();
+    }
+    if (device.reportThread.joinable()) {
+        device.reportThread.join();
+    }
+    device.reportQueue.reset();
+}
+
+// CPU time consumed by the report thread so far, in milliseconds
+static double ThreadCpuMs(std::thread& thread) {
+    if (!thread.joinable()) return 0.0;
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(thread.native_handle(), &created, &exited, &kernel, &user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 10000.0;
+}
+
+void WacomStuPlugin::ClearScreen(StuDevice& device) {
+    // Waits out a screen write in progress; the tablet takes one command
+    // sequence at a time
+    std::lock_guard<std::mutex> lock(device.screenMutex);
+    if (device.tablet && device.tablet->isConnected()) {
+        // Capture is over; the pad stops inking along with its ink
+        if (device.hardwareInkOn) DisableHardwareInk(device);
+        device.tablet->setClearScreen();
+    }
+    device.screenShadowStale = true;
+    device.pipeline.screenInked = false;
+}
+
+void WacomStuPlugin::EnableHardwareInk(StuDevice& device, const HardwareInkSettings& settings) {
+    namespace Protocol = WacomGSS::STU::Protocol;
+    // Settings only take while inking is off
+    if (device.hardwareInkOn) device.tablet->setInkingMode(Protocol::InkingMode_Off);
+    device.hardwareInkOn = false;
+    device.pipeline.hardwareInkPressure = 0;
+
+    // Mono models ink in black at a fixed width and over the whole screen
+    if (device.tablet->isSupported(Protocol::ReportId_HandwritingThicknessColor)) {
+        device.tablet->setHandwritingThicknessColor(
+            Protocol::HandwritingThicknessColor{settings.color565, settings.thickness});
+    }
+    if (device.tablet->isSupported(Protocol::ReportId_HandwritingDisplayArea)) {
+        device.tablet->setHandwritingDisplayArea(
+            Protocol::Rectangle{settings.left, settings.top, settings.right, settings.bottom});
+    }
+    if (device.tablet->isSupported(Protocol::ReportId_InkThreshold)) {
+        device.tablet->setInkThreshold(Protocol::InkThreshold{settings.onPressure, settings.offPressure});
+    }
+    device.tablet->setInkingMode(Protocol::InkingMode_On);
+
+    device.hardwareInk = settings;
+    device.hardwareInkOn = true;
+    device.pipeline.hardwareInkPressure = settings.onPressure;
+}
+
+// Platform thread. Waits out a screen upload in progress, like ClearScreen.
+bool WacomStuPlugin::SetHardwareInking(StuDevice& device, bool enabled,
+                                       const HardwareInkConfig& config,
+                                       std::string& errorCode, std::string& errorMessage) {
+    std::lock_guard<std::mutex> lock(device.screenMutex);
+    if (!device.tablet || !device.tablet->isConnected()) {
+        errorCode = "NO_DEVICE";
+        errorMessage = "Tablet not connected";
+        return false;
+    }
+    try {
+        if (!enabled) {
+            if (device.hardwareInkOn) DisableHardwareInk(device);
+            return true;
+        }
+        if (!device.info.hardwareInk) {
+            errorCode = "UNSUPPORTED";
+            errorMessage = "This model has no inking mode";
+            return false;
+        }
+        HardwareInkSettings settings;
+        if (!ResolveHardwareInk(config, device.info.screenWidth, device.info.screenHeight,
+                                device.info.tabletMaxPressure, device.pipeline.strokeTracker.thresholds(),
+                                settings)) {
+            errorCode = "INVALID_ARGUMENTS";
+            errorMessage = "Ink area is off screen";
+            return false;
+        }
+        EnableHardwareInk(device, settings);
+        return true;
+    } catch (const std::exception& e) {
+        errorCode = "INKING_FAILED";
+        errorMessage = e.what();
+        return false;
+    }
+}
+
+void WacomStuPlugin::DisableHardwareInk(StuDevice& device) {
+    device.pipeline.hardwareInkPressure = 0;
+    device.hardwareInkOn = false;
+    device.tablet->setInkingMode(WacomGSS::STU::Protocol::InkingMode_Off);
+}
+
+void WacomStuPlugin::SetSignatureScreen(
+    StuDevice& device,
+    const EncodableValue* arguments,
+    std::unique_ptr<flutter::MethodResult<EncodableValue>> result) {
+    try {
+        const auto* map = std::get_if<flutter::EncodableMap>(arguments);
+        if (!map) {
+             result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+             return;
+        }
+
+        auto data_it = map->find(EncodableValue("data"));
+        auto mode_it = map->find(EncodableValue("mode"));
+
+        if (data_it == map->end() || mode_it == map->end()) {
+             result->Error("INVALID_ARGUMENTS", "Missing 'data' or 'mode'");
+             return;
+        }
+
+        // Read straight out of the codec's buffer; no copy
+        const auto* data = std::get_if<std::vector<uint8_t>>(&data_it->second);
+        if (!data) {
+             result->Error("INVALID_ARGUMENTS", "'data' must be a byte array");
+             return;
+        }
+
+        int mode = 0;
+        if (std::holds_alternative<int>(mode_it->second)) {
+             mode = std::get<int>(mode_it->second);
+        } else if (std::holds_alternative<int64_t>(mode_it->second)) {
+             mode = (int)std::get<int64_t>(mode_it->second);
+        }
+
+        // "bgr24" (default): data is already in the tablet's format for
+        // 'mode'. "rgba8888" / "bgra8888": 32-bit pixels as dart:ui hands
+        // them out, encoded here for 'mode'. Mode -1 picks the cheapest
+        // encoding the model supports and takes "bgr24" as pixels too.
+        ScreenPixelFormat format = ScreenPixelFormat::kBgr24;
+        const auto* format_value = FindArg(*map, "format");
+        const auto* format_name = format_value ? std::get_if<std::string>(format_value) : nullptr;
+        if (format_name && *format_name == "rgba8888") format = ScreenPixelFormat::kRgba8888;
+        else if (format_name && *format_name == "bgra8888") format = ScreenPixelFormat::kBgra8888;
+        else if (format_name && *format_name != "bgr24") {
+             result->Error("INVALID_ARGUMENTS", "Unknown pixel format '" + *format_name + "'");
+             return;
+        }
+
+        // Used when pixels are reduced to 16 or 1 bit
+        ScreenDither dither = ScreenDither::kOrdered;
+        const auto* dither_value = FindArg(*map, "dither");
+        const auto* dither_name = dither_value ? std::get_if<std::string>(dither_value) : nullptr;
+        if (dither_name && *dither_name == "none") dither = ScreenDither::kNone;
+        else if (dither_name && *dither_name == "diffusion") dither = ScreenDither::kDiffusion;
+
+        // The tablet slot is the reconnect thread's while the pad is lost;
+        // the screen worker checks the tablet itself under screenMutex
+        if (device.lost) {
+             result->Error("NO_DEVICE", "Tablet not connected");
+             return;
+        }
+
+        const bool rawPixels = format != ScreenPixelFormat::kBgr24 || mode == -1;
+        const int bytesPerPixel = format == ScreenPixelFormat::kBgr24 ? 3 : 4;
+        const auto& info = device.info;
+        if (rawPixels && data->size() != (size_t)info.screenWidth * info.screenHeight * bytesPerPixel) {
+             result->Error("INVALID_ARGUMENTS", "Image must be " + std::to_string(info.screenWidth) + "x" +
+                           std::to_string(info.screenHeight) + " pixels");
+             return;
+        }
+
+        // Encoding and the USB transfer run on the screen worker, and the
+        // reply comes back through the wakeup window. A newer screen
+        // replaces one still waiting. The codec's buffer does not outlive
+        // this call, so the pixels are copied.
+        auto upload = std::make_shared<ScreenUpload>();
+        upload->data = *data;
+        upload->mode = mode;
+        upload->format = format;
+        upload->dither = dither;
+        std::shared_ptr<flutter::MethodResult<EncodableValue>> pending(std::move(result));
+        device.screenWorker.Submit(
+            [this, &device, upload](const std::atomic<bool>& cancelled) {
+              return UploadScreen(device, *upload, cancelled);
+            },
+            [this, upload, pending](LatestWinsWorker::Outcome outcome) {
+              PostToPlatformThread([upload, pending, outcome] {
+                if (outcome == LatestWinsWorker::Outcome::kReplaced) {
+                  pending->Error("REPLACED", "A newer screen replaced this one");
+                } else if (outcome == LatestWinsWorker::Outcome::kCancelled) {
+                  pending->Error("CANCELLED", "Screen upload cancelled");
+                } else if (!upload->errorCode.empty()) {
+                  pending->Error(upload->errorCode, upload->errorMessage);
+                } else {
+                  pending->Success(EncodableValue(upload->reply));
+                }
+              });
+            });
+    } catch (const std::exception& e) {
+        if (result) result->Error("WRITE_IMAGE_FAILED", e.what());
+    }
+}
+
+// Turns the pad's inking off for an image write and back on after, so no
+// ink lands on a half-written screen
+class InkingPause {
+public:
+    InkingPause(WacomGSS::STU::Tablet& tablet, bool inking)
+        : tablet_(tablet), inking_(inking) {
+        if (inking_) tablet_.setInkingMode(WacomGSS::STU::Protocol::InkingMode_Off);
+    }
+    ~InkingPause() {
+        if (!inking_) return;
+        try {
+            tablet_.setInkingMode(WacomGSS::STU::Protocol::InkingMode_On);
+        } catch (...) {
+            // The write failed the same way and reports it
+        }
+    }
+
+private:
+    WacomGSS::STU::Tablet& tablet_;
+    bool inking_;
+};
+
+// Screen worker thread. Returns false if |cancelled| stopped it early.
+bool WacomStuPlugin::UploadScreen(StuDevice& device, ScreenUpload& upload,
+                                  const std::atomic<bool>& cancelled) {
+    std::lock_guard<std::mutex> lock(device.screenMutex);
+    return WriteScreen(device, upload, cancelled);
+}
+
+bool WacomStuPlugin::WriteScreen(StuDevice& device, ScreenUpload& upload,
+                                 const std::atomic<bool>& cancelled) {
+    if (device.screenShadowStale.exchange(false)) device.screenShadow.Reset();
+    // Ink the pad drew is not in the shadow; its area goes out again
+    if (device.pipeline.screenInked.exchange(false)) {
+        device.screenShadow.Invalidate(device.hardwareInk.rect());
+    }
+    if (cancelled) return false;
+    if (!device.tablet || !device.tablet->isConnected()) {
+        upload.errorCode = "NO_DEVICE";
+        upload.errorMessage = "Tablet not connected";
+        return true;
+    }
+
+    const std::vector<uint8_t>& data = upload.data;
+    const ScreenPixelFormat format = upload.format;
+    const ScreenDither dither = upload.dither;
+    const bool rawPixels = format != ScreenPixelFormat::kBgr24 || upload.mode == -1;
+    const int bytesPerPixel = format == ScreenPixelFormat::kBgr24 ? 3 : 4;
+    ScreenFrameEncoder::Frame frame;
+    frame.pixels = data.data();
+    frame.size = data.size();
+    frame.format = format;
+    frame.dither = dither;
+    frame.model = device.info.productId;
+    frame.width = device.info.screenWidth;
+    frame.height = device.info.screenHeight;
+    const int mode = ScreenFrameEncoder::ResolveMode(upload.mode, device.screenCaps, frame);
+
+    // Pixels are diffed against the last frame sent and only the dirty
+    // rectangles go out, where the model has area writes. Error diffusion
+    // reaches across the whole frame, so it always sends it all;
+    // pre-encoded data cannot be diffed. The shadow keeps every pixel
+    // frame either way, to put back on a pad that was unplugged.
+    const ScreenRect fullRect{0, 0, device.info.screenWidth, device.info.screenHeight};
+    std::vector<ScreenRect> rects{fullRect};
+    if (rawPixels) {
+        const uint32_t tag = (uint32_t)mode | (uint32_t)format << 8 | (uint32_t)dither << 16;
+        rects = device.screenShadow.Update(data.data(), device.info.screenWidth,
+                                           device.info.screenHeight, bytesPerPixel, tag);
+        if (!device.info.areaWrites || dither == ScreenDither::kDiffusion) {
+            rects.assign(1, fullRect);
+        }
+    } else {
+        device.screenShadow.Reset();
+    }
+    const bool fullFrame = rects.size() == 1 && rects[0].width == device.info.screenWidth &&
+                           rects[0].height == device.info.screenHeight;
+
+    // Whole frames go through the screen cache shared with the other pads;
+    // dirty rectangles are encoded as they go out
+    const int64_t frameStart = HostTimeUs();
+    bool cached = false;
+    if (rawPixels && fullFrame &&
+        !screenEncoder.Encode(frame, mode, device.screenScratch, cached)) {
+        device.screenShadow.Reset();
+        upload.errorCode = "INVALID_ARGUMENTS";
+        upload.errorMessage = "Unknown encoding mode " + std::to_string(mode);
+        return true;
+    }
+
+    double encodeMs = (HostTimeUs() - frameStart) / 1000.0;
+    double uploadMs = 0;
+    size_t bytesSent = 0;
+    size_t rectsSent = 0;
+    try {
+        InkingPause inkingPause(*device.tablet, device.hardwareInkOn && !rects.empty());
+        for (const ScreenRect& rect : rects) {
+            // Between rectangles is the only safe place to stop; what was
+            // sent so far is on screen, so the shadow no longer matches
+            if (cancelled) {
+                device.screenShadow.Reset();
+                return false;
+            }
+
+            const int64_t encodeStart = HostTimeUs();
+            const uint8_t* image = data.data();
+            size_t imageSize = data.size();
+            if (rawPixels && !fullFrame) {
+                CopyScreenRect(image, device.info.screenWidth, bytesPerPixel, rect,
+                               device.areaScratch);
+                if (!EncodeScreen(device.areaScratch.data(), format, rect.width, rect.height,
+                                  (ScreenEncoding)mode, dither, device.screenScratch)) {
+                    device.screenShadow.Reset();
+                    upload.errorCode = "INVALID_ARGUMENTS";
+                    upload.errorMessage = "Unknown encoding mode " + std::to_string(mode);
+                    return true;
+                }
+            }
+            if (rawPixels) {
+                image = device.screenScratch.data();
+                imageSize = device.screenScratch.size();
+            }
+
+            // 0=1bit, 1=1bit_Zlib, 2=16bit, 4=24bit
+            // We cast int to EncodingMode
+            const int64_t uploadStart = HostTimeUs();
+            if (fullFrame) {
+                device.tablet->writeImage((WacomGSS::STU::Protocol::EncodingMode)mode, image,
+                                          imageSize);
+            } else {
+                // Corners are inclusive
+                const WacomGSS::STU::Protocol::Rectangle area{
+                    (uint16_t)rect.x, (uint16_t)rect.y, (uint16_t)(rect.x + rect.width - 1),
+                    (uint16_t)(rect.y + rect.height - 1)};
+                device.tablet->writeImageArea((WacomGSS::STU::Protocol::EncodingMode)mode, area,
+                                              image, imageSize);
+            }
+            const int64_t uploadEnd = HostTimeUs();
+            encodeMs += (uploadStart - encodeStart) / 1000.0;
+            uploadMs += (uploadEnd - uploadStart) / 1000.0;
+            bytesSent += imageSize;
+            rectsSent++;
+        }
+    } catch (const std::exception& e) {
+        // What reached the screen is unknown
+        device.screenShadow.Reset();
+        upload.errorCode = "WRITE_IMAGE_FAILED";
+        upload.errorMessage = e.what();
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> statsLock(device.screenStatsMutex);
+        auto& stats = device.screenUploadStats[mode];
+        stats.uploads++;
+        if (!fullFrame) stats.partialUploads++;
+        stats.bytes += bytesSent;
+        stats.encodeMs += encodeMs;
+        stats.uploadMs += uploadMs;
+    }
+    upload.reply[EncodableValue("mode")] = EncodableValue(mode);
+    upload.reply[EncodableValue("rects")] = EncodableValue((int64_t)rectsSent);
+    upload.reply[EncodableValue("fullFrame")] = EncodableValue(fullFrame);
+    upload.reply[EncodableValue("cached")] = EncodableValue(cached);
+    upload.reply[EncodableValue("bytes")] = EncodableValue((int64_t)bytesSent);
+    upload.reply[EncodableValue("encodeMs")] = EncodableValue(encodeMs);
+    upload.reply[EncodableValue("uploadMs")] = EncodableValue(uploadMs);
+    return true;
+}
+
+// Any thread. Runs |task| on the platform thread, where MethodResult has to
+// be completed and the devices live.
+void WacomStuPlugin::PostToPlatformThread(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(platformTaskMutex);
+        platformTasks.push_back(std::move(task));
     }
+    if (wakeupWindow) PostMessage(wakeupWindow, WM_WACOM_PLATFORM_TASK, 0, 0);
 }
 
-void WacomStuPlugin::ClearScreen() {
-    if (tablet && tablet->isConnected()) {
-        tablet->setClearScreen();
+void WacomStuPlugin::RunPlatformTasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(platformTaskMutex);
+        tasks.swap(platformTasks);
     }
+    for (auto& task : tasks) task();
 }
 
 void WacomStuPlugin::HandleMethodCall(
     const flutter::MethodCall<EncodableValue>& call,
     std::unique_ptr<flutter::MethodResult<EncodableValue>> result) {
 
-  if (call.method_name() == "connect") {
+  // The pad a per-pad call acts on: its 'deviceId', or the first one
+  // connected
+  StuDevice* device = FindDevice(call.arguments());
+
+  if (call.method_name() == "getDevices") {
+    // Every pad plugged in, connected or not
     try {
-      auto devices = wgssSTU::getUsbDevices();
-      if (devices.empty()) {
-        result->Error("NO_DEVICE", "No STU device found");
+      flutter::EncodableList reply;
+      for (const auto& usbDevice : wgssSTU::getUsbDevices()) {
+        const std::string id =
+            StuDeviceId(usbDevice.idVendor, usbDevice.idProduct, usbDevice.fileName);
+        flutter::EncodableMap entry;
+        entry[EncodableValue("deviceId")] = EncodableValue(id);
+        entry[EncodableValue("vendorId")] = EncodableValue((int32_t)usbDevice.idVendor);
+        entry[EncodableValue("productId")] = EncodableValue((int32_t)usbDevice.idProduct);
+        entry[EncodableValue("firmware")] = EncodableValue((int32_t)usbDevice.bcdDevice);
+        entry[EncodableValue("connected")] = EncodableValue(devices.count(id) != 0);
+        reply.push_back(EncodableValue(entry));
+      }
+      result->Success(EncodableValue(reply));
+    } catch (const std::exception& e) {
+      result->Error("EXCEPTION", e.what());
+    }
+  }
+
+  else if (call.method_name() == "connect") {
+    const int64_t connectStart = HostTimeUs();
+    const auto* args = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* id_value = args ? FindArg(*args, "deviceId") : nullptr;
+    const auto* requestedId = id_value ? std::get_if<std::string>(id_value) : nullptr;
+    try {
+      // With no 'deviceId', the first pad found, as with a single pad
+      auto usbDevices = wgssSTU::getUsbDevices();
+      auto usbDevice = usbDevices.begin();
+      for (; requestedId && usbDevice != usbDevices.end(); ++usbDevice) {
+        if (StuDeviceId(usbDevice->idVendor, usbDevice->idProduct, usbDevice->fileName) ==
+            *requestedId) {
+          break;
+        }
+      }
+      if (usbDevice == usbDevices.end()) {
+        result->Error("NO_DEVICE", requestedId ? "No STU device '" + *requestedId + "'"
+                                               : std::string("No STU device found"));
         return;
       }
-      auto device = devices[0];
-      usbInterface = std::make_unique<wgssSTU::UsbInterface>();
-      
-      std::error_code ec = usbInterface->connect(device, true);
+      const std::string id =
+          StuDeviceId(usbDevice->idVendor, usbDevice->idProduct, usbDevice->fileName);
+
+      // Connecting again starts the pad over; the report thread, the
+      // screen worker and their state belong to the old connection
+      DisconnectDevice(id);
+
+      auto usbInterface = std::make_unique<wgssSTU::UsbInterface>();
+      std::error_code ec = usbInterface->connect(*usbDevice, true);
       if (ec) {
         result->Error("CONNECTION_FAILED", ec.message());
         return;
       }
 
-      tablet = std::make_unique<wgssSTU::Tablet>();
-      tablet->attach(std::move(usbInterface));
-      
-      // Get capability for max X/Y
-      auto cap = tablet->getCapability();
+      auto owned = std::make_unique<StuDevice>();
+      StuDevice& newDevice = *owned;
+      newDevice.id = id;
+      newDevice.path = LowerPath(usbDevice->fileName);
+      newDevice.tablet = std::make_unique<wgssSTU::Tablet>();
+      newDevice.tablet->attach(std::move(usbInterface));
       
-      StartReportThread();
+      // A pad seen before under the same firmware is not asked again; the
+      // record only changes with the model or the firmware
+      const DeviceInfo* cached =
+          deviceInfoCache.Find(id, usbDevice->idProduct, usbDevice->bcdDevice);
+      newDevice.infoCached = cached != nullptr;
+      newDevice.info = cached ? *cached : ReadDeviceInfo(*newDevice.tablet, *usbDevice);
+      if (!cached) deviceInfoCache.Store(id, newDevice.info);
+      const DeviceInfo& info = newDevice.info;
+
+      newDevice.screenCaps.zlib = (info.encodingFlag & WacomGSS::STU::Protocol::EncodingFlag_Zlib) != 0;
+      newDevice.screenCaps.color16 = (info.encodingFlag & WacomGSS::STU::Protocol::EncodingFlag_16bit) != 0;
+      newDevice.screenCaps.color24 = (info.encodingFlag & WacomGSS::STU::Protocol::EncodingFlag_24bit) != 0;
+      newDevice.screenShadowStale = true;
+
+      newDevice.pipeline.strokeTracker.SetThresholds(
+          StrokeTracker::ThresholdsForMaxPressure(info.tabletMaxPressure));
+
+      // Ask for PenDataTimeCountSequence reports where the model has them,
+      // so samples carry the device clock and sequence number.
+      try {
+        if (info.penDataOptionMode) {
+          newDevice.tablet->setPenDataOptionMode(WacomGSS::STU::Protocol::PenDataOptionMode_TimeCountSequence);
+        }
+      } catch (...) {
+        // Older firmware; plain PenData reports still work
+      }
+
+      // Optional 'encrypted' has the pad encrypt its pen data under a key
+      // agreed now; reports are decrypted off the report thread
+      if (args && GetBoolArg(*args, "encrypted", false)) {
+        if (!newDevice.tablet->isSupported(WacomGSS::STU::Protocol::ReportId_HostPublicKey)) {
+          newDevice.tablet->disconnect();
+          result->Error("UNSUPPORTED", "The pad has no encrypted pen data");
+          return;
+        }
+        if (!StartEncryptedCapture(*newDevice.tablet, newDevice.sessionKey, newDevice.sessionId)) {
+          newDevice.tablet->disconnect();
+          result->Error("ENCRYPTION_FAILED", "The pad did not complete the key exchange");
+          return;
+        }
+        newDevice.encrypted = true;
+        StartDecryptWorker(newDevice);
+      }
+
+      devices[id] = std::move(owned);
+      if (!devices.count(defaultDeviceId)) defaultDeviceId = id;
+      StartReportThread(newDevice);
+
+      // Optional 'hardwareInking' settings turn the pad's inking on right
+      // away; a model without it still connects
+      bool hardwareInking = false;
+      const auto* ink_value = args ? FindArg(*args, "hardwareInking") : nullptr;
+      if (const auto* ink = ink_value ? std::get_if<flutter::EncodableMap>(ink_value) : nullptr) {
+        std::string errorCode, errorMessage;
+        hardwareInking = SetHardwareInking(newDevice, true, GetHardwareInkConfig(*ink), errorCode,
+                                           errorMessage);
+      }
+
+      newDevice.connectMs = (HostTimeUs() - connectStart) / 1000.0;
 
       flutter::EncodableMap reply;
       reply[EncodableValue("status")] = EncodableValue("Connected");
-      reply[EncodableValue("maxX")] = EncodableValue((int64_t)cap.tabletMaxX);
-      reply[EncodableValue("maxY")] = EncodableValue((int64_t)cap.tabletMaxY);
-      reply[EncodableValue("screenWidth")] = EncodableValue((int64_t)cap.screenWidth);
-      reply[EncodableValue("screenHeight")] = EncodableValue((int64_t)cap.screenHeight);
+      reply[EncodableValue("deviceId")] = EncodableValue(id);
+      reply[EncodableValue("maxX")] = EncodableValue((int64_t)info.tabletMaxX);
+      reply[EncodableValue("maxY")] = EncodableValue((int64_t)info.tabletMaxY);
+      reply[EncodableValue("maxPressure")] = EncodableValue((int64_t)info.tabletMaxPressure);
+      reply[EncodableValue("screenWidth")] = EncodableValue((int64_t)info.screenWidth);
+      reply[EncodableValue("screenHeight")] = EncodableValue((int64_t)info.screenHeight);
+      reply[EncodableValue("maxReportRate")] = EncodableValue((int64_t)info.maxReportRate);
+      reply[EncodableValue("resolution")] = EncodableValue((int64_t)info.resolution);
+      reply[EncodableValue("modelName")] = EncodableValue(info.modelName);
+      reply[EncodableValue("firmwareMajor")] = EncodableValue((int64_t)info.firmwareMajor);
+      reply[EncodableValue("firmwareMinor")] = EncodableValue((int64_t)info.firmwareMinor);
+      reply[EncodableValue("secureIc")] = EncodableValue(info.secureIc != 0);
+      reply[EncodableValue("color")] = EncodableValue(newDevice.screenCaps.color16 ||
+                                                      newDevice.screenCaps.color24);
+      reply[EncodableValue("hardwareInkingSupported")] = EncodableValue(info.hardwareInk);
+      reply[EncodableValue("hardwareInking")] = EncodableValue(hardwareInking);
+      reply[EncodableValue("encrypted")] = EncodableValue(newDevice.encrypted);
+      reply[EncodableValue("connectMs")] = EncodableValue(newDevice.connectMs);
+      reply[EncodableValue("infoCached")] = EncodableValue(newDevice.infoCached);
 
       result->Success(EncodableValue(reply));
     } catch (const std::exception& e) {
@@ -277,68 +1304,422 @@ void WacomStuPlugin::HandleMethodCall(
   }
 
   else if (call.method_name() == "disconnect") {
-    StopReportThread();
-    if (tablet) {
-      tablet->disconnect();
-      tablet.reset();
+    // A 'deviceId' disconnects that pad; none disconnects them all
+    const auto* args = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* id_value = args ? FindArg(*args, "deviceId") : nullptr;
+    if (const auto* id = id_value ? std::get_if<std::string>(id_value) : nullptr) {
+      DisconnectDevice(*id);
+    } else {
+      while (!devices.empty()) DisconnectDevice(devices.begin()->first);
     }
     result->Success(EncodableValue("Disconnected"));
   }
-  
 
+  else if (call.method_name() == "setScreenCacheDirectory") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* path_value = map ? FindArg(*map, "path") : nullptr;
+    const auto* path = path_value ? std::get_if<std::string>(path_value) : nullptr;
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    // Loads what earlier runs left there, so the first screens hit
+    result->Success(EncodableValue(screenEncoder.Open(*path)));
+  }
+
+  else if (call.method_name() == "setDeviceCacheDirectory") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* path_value = map ? FindArg(*map, "path") : nullptr;
+    const auto* path = path_value ? std::get_if<std::string>(path_value) : nullptr;
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    // Loads the pads earlier runs saw, so connecting them skips the reads
+    result->Success(EncodableValue(deviceInfoCache.Open(*path)));
+  }
 
   else if (call.method_name() == "clearScreen") {
     try {
-        ClearScreen();
+        if (device) ClearScreen(*device);
         result->Success(EncodableValue(true));
     } catch (const std::exception& e) {
         result->Error("CLEAR_FAILED", e.what());
     }
   }
 
+  else if (call.method_name() == "setHardwareInking") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!map) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    std::string errorCode, errorMessage;
+    if (SetHardwareInking(*device, GetBoolArg(*map, "enabled", true), GetHardwareInkConfig(*map),
+                          errorCode, errorMessage)) {
+      result->Success(EncodableValue(true));
+    } else {
+      result->Error(errorCode, errorMessage);
+    }
+  }
+
   else if (call.method_name() == "setSignatureScreen") {
-    try {
-        const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
-        if (!map) {
-             result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
-             return;
-        }
+    // Time spent here is time the Flutter UI cannot run
+    const int64_t callStart = HostTimeUs();
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    SetSignatureScreen(*device, call.arguments(), std::move(result));
+    const double callMs = (HostTimeUs() - callStart) / 1000.0;
+    screenCalls++;
+    screenCallMs += callMs;
+    screenCallMaxMs = std::max(screenCallMaxMs, callMs);
+  }
 
-        auto data_it = map->find(EncodableValue("data"));
-        auto mode_it = map->find(EncodableValue("mode"));
+  else if (call.method_name() == "cancelScreenUpload") {
+    // The waiting upload is dropped now; the running one stops at its next
+    // rectangle. Both complete their calls with CANCELLED.
+    if (device) device->screenWorker.Cancel();
+    result->Success(EncodableValue(true));
+  }
 
-        if (data_it == map->end() || mode_it == map->end()) {
-             result->Error("INVALID_ARGUMENTS", "Missing 'data' or 'mode'");
-             return;
-        }
+  else if (call.method_name() == "setSimplifier") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!map) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
 
-        std::vector<uint8_t> data;
-        if (std::holds_alternative<std::vector<uint8_t>>(data_it->second)) {
-            data = std::get<std::vector<uint8_t>>(data_it->second);
-        } else {
-             result->Error("INVALID_ARGUMENTS", "'data' must be a byte array");
-             return;
-        }
+    StrokeSimplifier::Config config;
+    config.enabled = GetBoolArg(*map, "enabled", true);
+    config.minDistance = (float)GetDoubleArg(*map, "minDistance", 0.0);
+    config.tolerance = (float)GetDoubleArg(*map, "tolerance", 0.0);
+    config.cornerAngleDeg = (float)GetDoubleArg(*map, "cornerAngle", 0.0);
+    config.lookahead = (uint32_t)std::clamp<int64_t>(
+        GetIntArg(*map, "lookahead", 8), 2, (int64_t)StrokeSimplifier::kMaxLookahead);
+    device->pipeline.strokeSimplifier.SetConfig(config);
+    result->Success(EncodableValue(true));
+  }
 
-        int mode = 0;
-        if (std::holds_alternative<int>(mode_it->second)) {
-             mode = std::get<int>(mode_it->second);
-        } else if (std::holds_alternative<int64_t>(mode_it->second)) {
-             mode = (int)std::get<int64_t>(mode_it->second);
-        }
+  else if (call.method_name() == "setHotZones") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* zones_value = map ? FindArg(*map, "zones") : nullptr;
+    const auto* zones = zones_value ? std::get_if<flutter::EncodableList>(zones_value) : nullptr;
+    if (!zones) {
+      result->Error("INVALID_ARGUMENTS", "'zones' must be a list");
+      return;
+    }
+    if (zones->size() > HotZoneTracker::kMaxZones) {
+      result->Error("INVALID_ARGUMENTS", "At most " + std::to_string(HotZoneTracker::kMaxZones) + " zones");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
 
-        if (tablet && tablet->isConnected()) {
-             // 0=1bit, 1=1bit_Zlib, 2=16bit, 4=24bit
-             // We cast int to EncodingMode
-             tablet->writeImage((WacomGSS::STU::Protocol::EncodingMode)mode, data.data(), data.size());
-             result->Success(EncodableValue(true));
-        } else {
-             result->Error("NO_DEVICE", "Tablet not connected");
-        }
-        
-    } catch (const std::exception& e) {
-        result->Error("WRITE_IMAGE_FAILED", e.what());
+    // Each zone is {id, x, y, width, height} in screen pixels; ids are
+    // non-zero and come back as a click's strokeId
+    HotZoneTracker::Config config;
+    for (const auto& zone_value : *zones) {
+      const auto* zone = std::get_if<flutter::EncodableMap>(&zone_value);
+      const int64_t id = zone ? GetIntArg(*zone, "id", 0) : 0;
+      if (id <= 0 || id > UINT32_MAX) {
+        result->Error("INVALID_ARGUMENTS", "Every zone needs a positive 'id'");
+        return;
+      }
+      const ScreenRect rect{(int)GetIntArg(*zone, "x", 0), (int)GetIntArg(*zone, "y", 0),
+                            (int)GetIntArg(*zone, "width", 0), (int)GetIntArg(*zone, "height", 0)};
+      config.zones[config.count++] = HotZoneTracker::ZoneFromScreen(
+          (uint32_t)id, rect, device->info.screenWidth, device->info.screenHeight,
+          device->info.tabletMaxX, device->info.tabletMaxY);
+    }
+    config.minPressUs = GetIntArg(*map, "minPressMs", config.minPressUs / 1000) * 1000;
+    config.refractoryUs = GetIntArg(*map, "refractoryMs", config.refractoryUs / 1000) * 1000;
+    device->pipeline.hotZones.SetConfig(config);
+    result->Success(EncodableValue(true));
+  }
+
+  else if (call.method_name() == "startReportRecording") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    const auto* path_value = map ? FindArg(*map, "path") : nullptr;
+    const auto* path = path_value ? std::get_if<std::string>(path_value) : nullptr;
+    if (!path) {
+      result->Error("INVALID_ARGUMENTS", "Missing 'path'");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+    // Replaces a recording already running, which is closed first
+    ReportSessionHeader header;
+    header.productId = device->info.productId;
+    header.tabletMaxX = device->info.tabletMaxX;
+    header.tabletMaxY = device->info.tabletMaxY;
+    header.tabletMaxPressure = device->info.tabletMaxPressure;
+    header.screenWidth = device->info.screenWidth;
+    header.screenHeight = device->info.screenHeight;
+    header.startUs = HostTimeUs();
+    auto recorder = std::make_unique<ReportSessionWriter>();
+    if (!recorder->Open(*path, header)) {
+      result->Error("RECORDING_FAILED", "Cannot create '" + *path + "'");
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(device->recorderMutex);
+      device->recorder = std::move(recorder);
+    }
+    device->recording = true;
+    result->Success(EncodableValue(true));
+  }
+
+  else if (call.method_name() == "stopReportRecording") {
+    std::unique_ptr<ReportSessionWriter> recorder;
+    if (device) {
+      device->recording = false;
+      std::lock_guard<std::mutex> lock(device->recorderMutex);
+      recorder = std::move(device->recorder);
+    }
+    if (!recorder) {
+      result->Success();
+      return;
+    }
+    const bool written = recorder->Close();
+    if (!written) {
+      result->Error("RECORDING_FAILED", "Session file write failed");
+      return;
+    }
+    flutter::EncodableMap reply;
+    reply[EncodableValue("reports")] = EncodableValue((int64_t)recorder->reports());
+    reply[EncodableValue("bytes")] = EncodableValue((int64_t)recorder->bytes());
+    result->Success(EncodableValue(reply));
+  }
+
+  else if (call.method_name() == "setPenTransform") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!map) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    if (!GetBoolArg(*map, "enabled", true)) {
+      if (device) device->penTransform.Clear();
+      result->Success(EncodableValue(true));
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    // 'matrix' is [a, b, c, d, e, f]: x' = a*x + b*y + c, y' = d*x + e*y + f
+    const auto* matrix_value = FindArg(*map, "matrix");
+    const auto* matrix = matrix_value ? std::get_if<std::vector<double>>(matrix_value) : nullptr;
+    if (!matrix || matrix->size() != 6) {
+      result->Error("INVALID_ARGUMENTS", "'matrix' must be 6 doubles");
+      return;
+    }
+    PenTransform::Config config;
+    config.a = (*matrix)[0];
+    config.b = (*matrix)[1];
+    config.c = (*matrix)[2];
+    config.d = (*matrix)[3];
+    config.e = (*matrix)[4];
+    config.f = (*matrix)[5];
+    const auto* curve_value = FindArg(*map, "pressureCurve");
+    if (const auto* curve = curve_value ? std::get_if<std::vector<double>>(curve_value) : nullptr) {
+      config.pressureCurve = *curve;
+    }
+    // {x, y, width, height} in target units
+    const auto* clamp_value = FindArg(*map, "clamp");
+    if (const auto* clamp = clamp_value ? std::get_if<flutter::EncodableMap>(clamp_value) : nullptr) {
+      config.clamp = true;
+      config.minX = GetDoubleArg(*clamp, "x", 0.0);
+      config.minY = GetDoubleArg(*clamp, "y", 0.0);
+      config.maxX = config.minX + GetDoubleArg(*clamp, "width", 0.0);
+      config.maxY = config.minY + GetDoubleArg(*clamp, "height", 0.0);
+    }
+    if (!device->penTransform.Configure(config, device->info.tabletMaxX, device->info.tabletMaxY,
+                                        device->info.tabletMaxPressure)) {
+      result->Error("INVALID_ARGUMENTS", "Transform scales too far for fixed point");
+      return;
+    }
+    result->Success(EncodableValue(true));
+  }
+
+  else if (call.method_name() == "clearStrokes") {
+    if (device) device->inkStore.Clear();
+    result->Success(EncodableValue(true));
+  }
+
+  else if (call.method_name() == "renderSignature") {
+    const auto* map = std::get_if<flutter::EncodableMap>(call.arguments());
+    if (!map) {
+      result->Error("INVALID_ARGUMENTS", "Arguments must be a map");
+      return;
+    }
+    const auto* ids_value = FindArg(*map, "strokeIds");
+    const auto* ids = ids_value ? std::get_if<flutter::EncodableList>(ids_value) : nullptr;
+    if (!ids) {
+      result->Error("INVALID_ARGUMENTS", "'strokeIds' must be a list");
+      return;
+    }
+    if (!device) {
+      result->Error("NO_DEVICE", "Tablet not connected");
+      return;
+    }
+
+    std::vector<const std::vector<InkPoint>*> strokes;
+    for (const auto& id : *ids) {
+      int64_t strokeId = -1;
+      if (const auto* i = std::get_if<int32_t>(&id)) strokeId = *i;
+      else if (const auto* l = std::get_if<int64_t>(&id)) strokeId = *l;
+      const auto* points = strokeId >= 0 ? device->inkStore.Find((uint32_t)strokeId) : nullptr;
+      if (!points) {
+        result->Error("UNKNOWN_STROKE", "Stroke " + std::to_string(strokeId) + " is not in the native ink store");
+        return;
+      }
+      strokes.push_back(points);
+    }
+
+    // Width/height and stroke widths are logical pixels; dpi scales them
+    const double scale = GetDoubleArg(*map, "dpi", 96.0) / 96.0;
+    RasterOptions options;
+    options.width = (int)std::lround(GetDoubleArg(*map, "width", 400.0) * scale);
+    options.height = (int)std::lround(GetDoubleArg(*map, "height", 200.0) * scale);
+    if (options.width <= 0 || options.height <= 0 || options.width > 8192 || options.height > 8192) {
+      result->Error("INVALID_ARGUMENTS", "Output size out of range");
+      return;
+    }
+    options.scaleX = (double)options.width / device->info.tabletMaxX;
+    options.scaleY = (double)options.height / device->info.tabletMaxY;
+    options.minRadius = (float)(GetDoubleArg(*map, "minWidth", 1.2) * scale / 2.0);
+    options.maxRadius = (float)(GetDoubleArg(*map, "maxWidth", 2.8) * scale / 2.0);
+    options.maxPressure = device->info.tabletMaxPressure;
+    options.color = (uint32_t)GetIntArg(*map, "color", 0xFF000000);
+
+    // "fast", "balanced" (default) or "smallest"
+    PngOptions pngOptions;
+    const auto* preset_value = FindArg(*map, "preset");
+    const auto* preset = preset_value ? std::get_if<std::string>(preset_value) : nullptr;
+    if (preset && *preset == "fast") pngOptions.preset = PngPreset::kFast;
+    else if (preset && *preset == "smallest") pngOptions.preset = PngPreset::kSmallest;
+
+    const auto rgba = RasterizeStrokes(strokes, options);
+    result->Success(EncodableValue(
+        EncodePng(rgba.data(), options.width, options.height, (size_t)options.width * 4, pngOptions)));
+  }
+
+  else if (call.method_name() == "getPipelineStats") {
+    flutter::EncodableMap reply;
+    reply[EncodableValue("eventsSent")] = EncodableValue((int64_t)eventsSent);
+    reply[EncodableValue("wakeupsPosted")] = EncodableValue((int64_t)wakeupsPosted.load());
+    reply[EncodableValue("wakeupsHandled")] = EncodableValue((int64_t)wakeupsHandled);
+
+    // Platform thread time per setSignatureScreen call, i.e. UI stall
+    reply[EncodableValue("screenCalls")] = EncodableValue((int64_t)screenCalls);
+    reply[EncodableValue("screenCallMs")] = EncodableValue(screenCallMs);
+    reply[EncodableValue("screenCallMaxMs")] = EncodableValue(screenCallMaxMs);
+
+    {
+      const auto cacheStats = screenEncoder.stats();
+      reply[EncodableValue("screenCacheHits")] = EncodableValue((int64_t)cacheStats.hits);
+      reply[EncodableValue("screenCacheDiskHits")] = EncodableValue((int64_t)cacheStats.diskHits);
+      reply[EncodableValue("screenCacheMisses")] = EncodableValue((int64_t)cacheStats.misses);
+      reply[EncodableValue("screenCacheEntries")] = EncodableValue((int64_t)cacheStats.entries);
+      reply[EncodableValue("screenCacheBytes")] = EncodableValue((int64_t)cacheStats.bytes);
+    }
+
+    const auto infoStats = deviceInfoCache.stats();
+    reply[EncodableValue("deviceInfoCacheHits")] = EncodableValue((int64_t)infoStats.hits);
+    reply[EncodableValue("deviceInfoCacheStale")] = EncodableValue((int64_t)infoStats.stale);
+    reply[EncodableValue("deviceInfoCacheMisses")] = EncodableValue((int64_t)infoStats.misses);
+
+    // The rest are the pad's; with none connected only the above
+    if (!device) {
+      result->Success(EncodableValue(reply));
+      return;
+    }
+    reply[EncodableValue("deviceId")] = EncodableValue(device->id);
+
+    const auto ringStats = device->pipeline.ring.stats();
+    reply[EncodableValue("samplesQueued")] = EncodableValue((int64_t)ringStats.pushed);
+    reply[EncodableValue("samplesDropped")] = EncodableValue((int64_t)ringStats.dropped);
+    reply[EncodableValue("queueHighWater")] = EncodableValue((int64_t)ringStats.highWater);
+    reply[EncodableValue("queueCapacity")] = EncodableValue((int64_t)PenSampleRing::capacity());
+    reply[EncodableValue("samplesDelivered")] = EncodableValue((int64_t)device->samplesDelivered);
+    reply[EncodableValue("reportsRead")] = EncodableValue((int64_t)device->reportsRead.load());
+    reply[EncodableValue("reportWakeups")] = EncodableValue((int64_t)device->reportWakeups.load());
+    reply[EncodableValue("reportThreadCpuMs")] = EncodableValue(ThreadCpuMs(device->reportThread));
+    reply[EncodableValue("connectMs")] = EncodableValue(device->connectMs);
+    reply[EncodableValue("infoCached")] = EncodableValue(device->infoCached);
+    reply[EncodableValue("reconnects")] = EncodableValue((int64_t)device->reconnects);
+    reply[EncodableValue("lastReconnectMs")] = EncodableValue(device->lastReconnectMs);
+
+    const auto clockStats = device->clockEstimator.stats();
+    reply[EncodableValue("clockSamples")] = EncodableValue((int64_t)clockStats.samples);
+    reply[EncodableValue("clockResets")] = EncodableValue((int64_t)clockStats.resets);
+    reply[EncodableValue("clockDriftPpm")] = EncodableValue(clockStats.driftPpm);
+    reply[EncodableValue("clockMeanDelayUs")] = EncodableValue(clockStats.meanDelayUs);
+
+    // Reports lost between the pad and the report thread, by sequence
+    // number; short gaps come back as synthetic samples. maxReportRate is
+    // the pad's capability, in reports per second.
+    const auto gapStats = device->pipeline.gapFiller.stats();
+    reply[EncodableValue("maxReportRate")] = EncodableValue((int64_t)device->info.maxReportRate);
+    reply[EncodableValue("sequenceGaps")] = EncodableValue((int64_t)gapStats.gaps);
+    reply[EncodableValue("reportsMissing")] = EncodableValue((int64_t)gapStats.missing);
+    reply[EncodableValue("samplesInterpolated")] = EncodableValue((int64_t)gapStats.filled);
+    reply[EncodableValue("largestSequenceGap")] = EncodableValue((int64_t)gapStats.largestGap);
+
+    // Since the session started, i.e. the last connect or reconnect
+    reply[EncodableValue("encrypted")] = EncodableValue(device->encrypted);
+    if (device->decryptWorker) {
+      const auto decryptStats = device->decryptWorker->stats();
+      reply[EncodableValue("decryptReports")] = EncodableValue((int64_t)decryptStats.reports);
+      reply[EncodableValue("decryptDropped")] = EncodableValue((int64_t)decryptStats.dropped);
+      reply[EncodableValue("decryptBatches")] = EncodableValue((int64_t)decryptStats.batches);
+      reply[EncodableValue("decryptBlocks")] = EncodableValue((int64_t)decryptStats.blocks);
+      reply[EncodableValue("decryptSessionMismatches")] =
+          EncodableValue((int64_t)decryptStats.sessionMismatches);
+      reply[EncodableValue("decryptMs")] = EncodableValue(decryptStats.decryptMs);
+      reply[EncodableValue("decryptHardware")] = EncodableValue(decryptStats.hardware);
+    }
+
+    const auto simplifierStats = device->pipeline.strokeSimplifier.stats();
+    reply[EncodableValue("simplifierPointsIn")] = EncodableValue((int64_t)simplifierStats.pointsIn);
+    reply[EncodableValue("simplifierPointsOut")] = EncodableValue((int64_t)simplifierStats.pointsOut);
+    reply[EncodableValue("simplifierMaxError")] = EncodableValue(simplifierStats.maxError);
+
+    const auto hotZoneStats = device->pipeline.hotZones.stats();
+    reply[EncodableValue("hotZoneSamplesDropped")] = EncodableValue((int64_t)hotZoneStats.dropped);
+    reply[EncodableValue("hotZoneClicks")] = EncodableValue((int64_t)hotZoneStats.clicks);
+    reply[EncodableValue("hotZoneBounces")] = EncodableValue((int64_t)hotZoneStats.bounces);
+
+    std::lock_guard<std::mutex> statsLock(device->screenStatsMutex);
+    // Keyed by encoding name: uploads, partialUploads, bytes, encodeMs,
+    // uploadMs
+    flutter::EncodableMap screenUploads;
+    for (const auto& [mode, stats] : device->screenUploadStats) {
+      flutter::EncodableMap entry;
+      entry[EncodableValue("uploads")] = EncodableValue((int64_t)stats.uploads);
+      entry[EncodableValue("partialUploads")] = EncodableValue((int64_t)stats.partialUploads);
+      entry[EncodableValue("bytes")] = EncodableValue((int64_t)stats.bytes);
+      entry[EncodableValue("encodeMs")] = EncodableValue(stats.encodeMs);
+      entry[EncodableValue("uploadMs")] = EncodableValue(stats.uploadMs);
+      screenUploads[EncodableValue(ScreenEncodingName((ScreenEncoding)mode))] = EncodableValue(entry);
     }
+    reply[EncodableValue("screenUploads")] = EncodableValue(screenUploads);
+    result->Success(EncodableValue(reply));
   }
 
   else {
@@ -13,7 +13,7 @@
 namespace WacomGSS {
   namespace STU {
     class Tablet;
-    class UsbInterface;
+    class InterfaceQueue;
   }
 }
 
@@ -23,10 +23,130 @@ namespace wgssSTU = WacomGSS::STU;
 #include <flutter/event_stream_handler_functions.h>
 #include <thread>
 #include <atomic>
+#include <functional>
+#include <map>
 #include <mutex>
-#include <queue>
+#include <string>
+#include <vector>
 #include <windows.h>
 
+#include "decrypt_worker.h"
+#include "device_clock_estimator.h"
+#include "device_info_cache.h"
+#include "hardware_ink.h"
+#include "hot_zones.h"
+#include "ink_store.h"
+#include "latest_wins_worker.h"
+#include "pen_pipeline.h"
+#include "pen_sample.h"
+#include "pen_transform.h"
+#include "report_session.h"
+#include "screen_frame_encoder.h"
+#include "screen_image.h"
+#include "screen_shadow.h"
+#include "session_key_exchange.h"
+#include "stroke_simplifier.h"
+#include "stroke_tracker.h"
+
+// One connected pad: its tablet, report pipeline and screen state. Each has
+// its own report thread and screen worker, so pads capture and upload side
+// by side; the event sink, the wakeup window and the screen cache are the
+// plugin's.
+struct StuDevice {
+  // StuDeviceId; tags the pad's events and picks it in method calls
+  std::string id;
+  // USB interface path, lower case, to match removal notifications
+  std::wstring path;
+  // Null while the pad is gone; swapped under screenMutex
+  std::unique_ptr<WacomGSS::STU::Tablet> tablet;
+
+  // Set on the platform thread when the pad goes away, cleared when it is
+  // back. The reconnect thread owns the tablet slot in between.
+  bool lost = false;
+  int64_t lostAtUs = 0;
+  std::thread reconnectThread;
+  std::atomic<bool> reconnectCancel{false};
+  // The pad arrived while the reconnect thread was finishing; try again if
+  // it failed
+  bool retryReconnect = false;
+  uint64_t reconnects = 0;
+  double lastReconnectMs = 0;
+
+  // Capability and information of the pad, read at connect or taken from
+  // the plugin's DeviceInfoCache; its product id is part of every screen
+  // cache key
+  DeviceInfo info;
+  // Screen encodings the model accepts, for mode 'auto'
+  ScreenCapabilities screenCaps;
+  // Time from the connect call to the pad capturing, and whether the info
+  // came from the cache
+  double connectMs = 0;
+  bool infoCached = false;
+
+  // Screen uploads run here, latest wins. The worker holds screenMutex for
+  // each upload; everything below up to the stats is its own, and other
+  // tablet writes, the reconnect thread's included, take the mutex too.
+  LatestWinsWorker screenWorker;
+  std::mutex screenMutex;
+  // Last frame sent, so the next one can go out as dirty rectangles. The
+  // platform thread marks it stale instead of touching it.
+  ScreenShadow screenShadow;
+  std::atomic<bool> screenShadowStale{false};
+  // The pad's own inking, if on, and the area it draws in; its ink mark is
+  // pipeline.hardwareInkPressure
+  bool hardwareInkOn = false;
+  HardwareInkSettings hardwareInk;
+  // Reused buffers for screens encoded natively
+  std::vector<uint8_t> screenScratch;
+  std::vector<uint8_t> areaScratch;
+
+  // Per encoding mode, for getPipelineStats, under screenStatsMutex
+  std::mutex screenStatsMutex;
+  struct ScreenUploadStats {
+    uint64_t uploads = 0;
+    uint64_t partialUploads = 0;
+    uint64_t bytes = 0;
+    double encodeMs = 0;
+    double uploadMs = 0;
+  };
+  std::map<int, ScreenUploadStats> screenUploadStats;
+
+  // Threading
+  std::thread reportThread;
+  std::atomic<bool> keepRunning{false};
+  std::unique_ptr<WacomGSS::STU::InterfaceQueue> reportQueue;
+  // Every return from the blocking read vs. the ones that carried a report;
+  // the difference is spurious or shutdown wakeups.
+  std::atomic<uint64_t> reportWakeups{0};
+  std::atomic<uint64_t> reportsRead{0};
+  // Capture mode: every raw report also goes to a session file, for replay
+  // without the pad. Swapped on the platform thread under recorderMutex;
+  // recording lets the report thread skip the lock when off.
+  std::mutex recorderMutex;
+  std::unique_ptr<ReportSessionWriter> recorder;
+  std::atomic<bool> recording{false};
+  // Encrypted capture, asked for at connect. Whichever thread opens the
+  // tablet runs the key exchange and leaves the session here; the platform
+  // thread makes it the decrypt worker before the report thread starts and
+  // wipes the key. While the worker is set the report thread hands it every
+  // report, and the worker runs the pipeline below in its place.
+  bool encrypted = false;
+  SessionKeyExchange::Key sessionKey{};
+  uint32_t sessionId = 0;
+  std::unique_ptr<DecryptWorker> decryptWorker;
+  // Owned by the report thread while it runs
+  DeviceClockEstimator clockEstimator;
+  // Decoded samples to the platform thread
+  PenPipeline pipeline;
+  uint64_t samplesDelivered = 0;
+
+  // Tablet to drawing space for packed frames, set via setPenTransform
+  PenTransform penTransform;
+
+  // Every ink sample delivered to Dart, for renderSignature
+  InkStore inkStore;
+};
+
 class WacomStuPlugin : public flutter::Plugin, public flutter::StreamHandler<flutter::EncodableValue> {
  public:
   static void RegisterWithRegistrar(flutter::PluginRegistrarWindows* registrar);
@@ -43,32 +163,119 @@ class WacomStuPlugin : public flutter::Plugin, public flutter::StreamHandler<flu
       const flutter::EncodableValue* arguments) override;
 
  private:
-  void StartReportThread();
-  void StopReportThread();
-  void ClearScreen();
+  // Pads by StuDeviceId. Connected, disconnected and read on the platform
+  // thread only; each report thread and screen worker sees just its own.
+  std::map<std::string, std::unique_ptr<StuDevice>> devices;
+  // Used by calls that name no deviceId: the first pad connected while it
+  // stays connected, then the lowest id
+  std::string defaultDeviceId;
+  // The pad named by the call's 'deviceId', or the default one; nullptr if
+  // that is not connected
+  StuDevice* FindDevice(const flutter::EncodableValue* arguments);
+  void DisconnectDevice(const std::string& id);
+
+  void StartReportThread(StuDevice& device);
+  void StopReportThread(StuDevice& device);
+  void StartDecryptWorker(StuDevice& device);
+  void ClearScreen(StuDevice& device);
+  bool SetHardwareInking(StuDevice& device, bool enabled, const HardwareInkConfig& config,
+                         std::string& errorCode, std::string& errorMessage);
+  // Caller holds screenMutex and has checked the tablet is connected
+  void EnableHardwareInk(StuDevice& device, const HardwareInkSettings& settings);
+  void DisableHardwareInk(StuDevice& device);
+  void RunPlatformTasks();
+  void DeliverPenEvents();
+  void DeliverPenEvents(StuDevice& device);
+  void OnPenSample(StuDevice& device, const PenSample& sample);
 
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue>& method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-  std::unique_ptr<WacomGSS::STU::Tablet> tablet;
-  std::unique_ptr<WacomGSS::STU::UsbInterface> usbInterface;
-  
-  // Threading
-  std::thread reportThread;
-  std::atomic<bool> keepRunning;
-  
+  // One setSignatureScreen call, handed to the screen worker
+  struct ScreenUpload {
+    std::vector<uint8_t> data;
+    int mode = 0;
+    ScreenPixelFormat format = ScreenPixelFormat::kBgr24;
+    ScreenDither dither = ScreenDither::kOrdered;
+    // Filled in by UploadScreen; an empty errorCode means success
+    flutter::EncodableMap reply;
+    std::string errorCode;
+    std::string errorMessage;
+  };
+  void SetSignatureScreen(
+      StuDevice& device,
+      const flutter::EncodableValue* arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  bool UploadScreen(StuDevice& device, ScreenUpload& upload, const std::atomic<bool>& cancelled);
+  // UploadScreen with screenMutex already held
+  bool WriteScreen(StuDevice& device, ScreenUpload& upload, const std::atomic<bool>& cancelled);
+  void PostToPlatformThread(std::function<void()> task);
+
+  // Hotplug. A pad that goes away stays in |devices|, settings, shadow and
+  // all, and a reconnect thread brings it back when it returns.
+  void OnDeviceLost(const std::string& id);
+  void StartReconnect(StuDevice& device);
+  void FinishReconnect(const std::string& id, bool connected, bool screenRestored,
+                       double reconnectMs);
+  // Caller holds screenMutex. Writes the shadow's frame to a pad that lost
+  // its screen; false if there is none or the write failed.
+  bool RestoreScreen(StuDevice& device);
+  void OnDeviceArrival();
+  void OnDeviceRemoval(const std::wstring& path);
+  // Sends a device event on the event channel
+  void SendDeviceEvent(const std::string& type, const std::string& id,
+                       flutter::EncodableMap fields = {});
+
+  // Capability and information of every pad seen, so connecting one again
+  // skips reading them. Platform thread only.
+  DeviceInfoCache deviceInfoCache;
+
+  // Encoded full frames, in memory and under the app support directory.
+  // Shared by every pad's screen worker.
+  ScreenFrameEncoder screenEncoder;
+  // Work handed to the platform thread: screen replies, device changes
+  std::mutex platformTaskMutex;
+  std::vector<std::function<void()>> platformTasks;
+
+  // Platform thread time spent in setSignatureScreen
+  uint64_t screenCalls = 0;
+  double screenCallMs = 0;
+  double screenCallMaxMs = 0;
+
   // Event Sink
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> eventSink;
   std::mutex sinkMutex;
 
-  // Thread-safe event queue
-  std::queue<flutter::EncodableValue> eventQueue;
-  std::mutex queueMutex;
-  
-  // Windows message handling
-  HWND hwnd = nullptr;
-  int windowId = -1;
+  // Event delivery format, chosen by the listener's arguments. Batched mode
+  // sends one packed frame per pad per wakeup instead of one map per sample.
+  bool batchedEvents = false;
+  bool deltaFrames = false;
+  std::vector<PenSample> drainScratch;
+  std::vector<int32_t> frameScratch;
+  std::vector<uint8_t> deltaScratch;
+  std::vector<int32_t> mappedX;
+  std::vector<int32_t> mappedY;
+  std::vector<int32_t> mappedPressure;
+  uint64_t eventsSent = 0;
+
+  // Windows message handling. The plugin owns a message-only window on the
+  // platform thread; a report thread posts to it only when no wakeup is
+  // outstanding, and each wakeup drains every pad's ring.
+  HWND wakeupWindow = nullptr;
+  // Pad arrival and removal, delivered to the wakeup window
+  HDEVNOTIFY deviceNotification = nullptr;
+  std::atomic<bool> wakeupPending{false};
+  std::atomic<uint64_t> wakeupsPosted{0};
+  uint64_t wakeupsHandled = 0;
+  void CreateWakeupWindow();
+  void DestroyWakeupWindow();
+  void PostWakeup();
+  static LRESULT CALLBACK WakeupWindowProc(
+      HWND window,
+      UINT message,
+      WPARAM wparam,
+      LPARAM lparam);
   std::optional<LRESULT> HandleWindowProc(
       HWND windowArg,
       UINT message,